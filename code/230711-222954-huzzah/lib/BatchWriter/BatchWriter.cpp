@@ -0,0 +1,318 @@
+#include "BatchWriter.h"
+
+#include <string.h>
+
+// Alphabet of the auto-generated document ids, as used by the Firestore SDKs
+static const char idAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+#define DOCUMENT_ID_LENGTH 20
+
+BatchWriter::BatchWriter(CommitSink &sink, Clock clock, size_t maxWrites, unsigned long maxDelay)
+    : _sink(sink), _clock(clock), _maxWrites(maxWrites), _maxDelay(maxDelay), _firstPending(0),
+      _retrying(false), _random(1), _count(0), _cacheNext(0)
+{
+  if (_maxWrites == 0 || _maxWrites > BATCH_WRITER_MAX_WRITES)
+  {
+    _maxWrites = BATCH_WRITER_MAX_WRITES;
+  }
+  memset(_cache, 0, sizeof(_cache));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool BatchWriter::addDocument(const char *collectionPath, const char *content)
+{
+  size_t length = strlen(collectionPath);
+  if (length + DOCUMENT_ID_LENGTH + 2 > BATCH_PATH_SIZE || strlen(content) >= BATCH_CONTENT_SIZE)
+  {
+    _stats.dropped++;
+    return false;
+  }
+
+  BatchWrite *write = reserve();
+  if (write == NULL)
+  {
+    return false;
+  }
+  memcpy(write->path, collectionPath, length);
+  if (length > 0 && collectionPath[length - 1] != '/')
+  {
+    write->path[length++] = '/';
+  }
+  nextId(write->path + length);
+  copy(write->content, content, BATCH_CONTENT_SIZE);
+  write->mask[0] = '\0';
+  write->hash = 0;
+  _count++;
+  return true;
+}
+
+bool BatchWriter::patchDocument(const char *documentPath, const char *content, const char *mask)
+{
+  if (strlen(documentPath) >= BATCH_PATH_SIZE || strlen(content) >= BATCH_CONTENT_SIZE ||
+      strlen(mask) >= BATCH_MASK_SIZE)
+  {
+    _stats.dropped++;
+    return false;
+  }
+
+  uint32_t target = hash(mask, hash(documentPath));
+  uint32_t value = hash(content);
+
+  // A patch of the same fields is already waiting, replace its value
+  for (size_t i = 0; i < _count; i++)
+  {
+    BatchWrite &write = _writes[i];
+    if (write.hash == target && write.mask[0] != '\0' && strcmp(write.path, documentPath) == 0 &&
+        strcmp(write.mask, mask) == 0)
+    {
+      copy(write.content, content, BATCH_CONTENT_SIZE);
+      _stats.coalesced++;
+      return true;
+    }
+  }
+
+  if (isCommitted(target, value))
+  {
+    _stats.elided++;
+    return true;
+  }
+
+  BatchWrite *write = reserve();
+  if (write == NULL)
+  {
+    return false;
+  }
+  copy(write->path, documentPath, BATCH_PATH_SIZE);
+  copy(write->content, content, BATCH_CONTENT_SIZE);
+  copy(write->mask, mask, BATCH_MASK_SIZE);
+  write->hash = target;
+  _count++;
+  return true;
+}
+
+bool BatchWriter::poll()
+{
+  if (_count == 0)
+  {
+    return true;
+  }
+  // A full batch that failed to commit still waits for the retry
+  if ((_count >= _maxWrites && !_retrying) || _clock() - _firstPending >= _maxDelay)
+  {
+    return flush();
+  }
+  return true;
+}
+
+bool BatchWriter::flush()
+{
+  if (_count == 0)
+  {
+    return true;
+  }
+
+  _stats.requests++;
+  if (!_sink.commit(_writes, _count))
+  {
+    // Keep the writes and try again after another maxDelay
+    _stats.failures++;
+    _firstPending = _clock();
+    _retrying = true;
+    return false;
+  }
+  _retrying = false;
+
+  for (size_t i = 0; i < _count; i++)
+  {
+    if (_writes[i].mask[0] != '\0')
+    {
+      remember(_writes[i].hash, hash(_writes[i].content));
+    }
+  }
+  _stats.writes += _count;
+  _count = 0;
+  return true;
+}
+
+void BatchWriter::clearMetadataCache()
+{
+  memset(_cache, 0, sizeof(_cache));
+  _cacheNext = 0;
+}
+
+// Return a free write slot, or NULL if the batch is full
+BatchWrite *BatchWriter::reserve()
+{
+  if (_count >= _maxWrites)
+  {
+    _stats.rejected++;
+    return NULL;
+  }
+  if (_count == 0)
+  {
+    _firstPending = _clock();
+  }
+  return &_writes[_count];
+}
+
+bool BatchWriter::isCommitted(uint32_t target, uint32_t value) const
+{
+  for (size_t i = 0; i < BATCH_METADATA_CACHE; i++)
+  {
+    if (_cache[i].target == target && target != 0)
+    {
+      return _cache[i].value == value;
+    }
+  }
+  return false;
+}
+
+void BatchWriter::remember(uint32_t target, uint32_t value)
+{
+  for (size_t i = 0; i < BATCH_METADATA_CACHE; i++)
+  {
+    if (_cache[i].target == target)
+    {
+      _cache[i].value = value;
+      return;
+    }
+  }
+  _cache[_cacheNext].target = target;
+  _cache[_cacheNext].value = value;
+  _cacheNext = (_cacheNext + 1) % BATCH_METADATA_CACHE;
+}
+
+void BatchWriter::nextId(char *id)
+{
+  for (int i = 0; i < DOCUMENT_ID_LENGTH; i++)
+  {
+    // xorshift32
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    id[i] = idAlphabet[_random % (sizeof(idAlphabet) - 1)];
+  }
+  id[DOCUMENT_ID_LENGTH] = '\0';
+}
+
+// FNV-1a
+uint32_t BatchWriter::hash(const char *str, uint32_t seed)
+{
+  uint32_t h = seed;
+  while (*str)
+  {
+    h ^= (uint8_t)*str++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+bool BatchWriter::copy(char *dest, const char *src, size_t size)
+{
+  size_t length = strlen(src);
+  if (length >= size)
+  {
+    return false;
+  }
+  memcpy(dest, src, length + 1);
+  return true;
+}
+
+// Bounded string builder for renderCommit()
+struct BodyWriter
+{
+  char *buffer;
+  size_t size;
+  size_t length;
+  bool overflowed;
+
+  void append(const char *str, size_t n)
+  {
+    if (overflowed || length + n >= size)
+    {
+      overflowed = true;
+      return;
+    }
+    memcpy(buffer + length, str, n);
+    length += n;
+    buffer[length] = '\0';
+  }
+
+  void append(const char *str) { append(str, strlen(str)); }
+};
+
+size_t BatchWriter::renderCommit(const BatchWrite *writes, size_t count, const char *projectId,
+                                 const char *databaseId, char *buffer, size_t size)
+{
+  BodyWriter body = {buffer, size, 0, size == 0};
+  if (databaseId == NULL || databaseId[0] == '\0')
+  {
+    databaseId = "(default)";
+  }
+
+  body.append("{\"writes\":[");
+  for (size_t i = 0; i < count; i++)
+  {
+    const BatchWrite &write = writes[i];
+    if (i > 0)
+    {
+      body.append(",");
+    }
+    body.append("{\"update\":{\"name\":\"projects/");
+    body.append(projectId);
+    body.append("/databases/");
+    body.append(databaseId);
+    body.append("/documents/");
+    // Document names have no leading or trailing slash
+    const char *path = write.path[0] == '/' ? write.path + 1 : write.path;
+    size_t pathLength = strlen(path);
+    if (pathLength > 0 && path[pathLength - 1] == '/')
+    {
+      pathLength--;
+    }
+    body.append(path, pathLength);
+    body.append("\"");
+
+    // Splice the content object into the update object
+    const char *content = write.content;
+    while (*content == ' ')
+    {
+      content++;
+    }
+    if (*content == '{')
+    {
+      content++;
+    }
+    while (*content == ' ')
+    {
+      content++;
+    }
+    if (*content != '}' && *content != '\0')
+    {
+      body.append(",");
+    }
+    body.append(*content == '\0' ? "}" : content);
+
+    if (write.mask[0] != '\0')
+    {
+      body.append(",\"updateMask\":{\"fieldPaths\":[\"");
+      const char *field = write.mask;
+      while (*field)
+      {
+        const char *comma = strchr(field, ',');
+        size_t n = comma ? (size_t)(comma - field) : strlen(field);
+        body.append(field, n);
+        if (comma == NULL)
+        {
+          break;
+        }
+        body.append("\",\"");
+        field = comma + 1;
+      }
+      body.append("\"]}");
+    }
+    body.append("}");
+  }
+  body.append("]}");
+
+  return body.overflowed ? 0 : body.length;
+}
@@ -0,0 +1,129 @@
+#ifndef BATCH_WRITER_H
+#define BATCH_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Maximum number of writes held before a flush is forced
+#ifndef BATCH_WRITER_MAX_WRITES
+#define BATCH_WRITER_MAX_WRITES 16
+#endif
+
+#define BATCH_PATH_SIZE 128
+#define BATCH_CONTENT_SIZE 192
+#define BATCH_MASK_SIZE 48
+
+// Number of documents whose last committed metadata is remembered
+#define BATCH_METADATA_CACHE 32
+
+// One write of a Firestore commit: the document path relative to
+// ".../documents/", the document content as {"fields":{...}} and, for
+// patches, the comma separated field mask.
+struct BatchWrite
+{
+  char path[BATCH_PATH_SIZE];
+  char content[BATCH_CONTENT_SIZE];
+  char mask[BATCH_MASK_SIZE];
+  uint32_t hash; // Hash of path and mask, identifies a patch target
+};
+
+// Sends a batch of writes as one request. The device implementation calls
+// Firebase.Firestore.commitDocument(), the host tests record the requests.
+class CommitSink
+{
+public:
+  virtual ~CommitSink() {}
+  virtual bool commit(const BatchWrite *writes, size_t count) = 0;
+};
+
+struct BatchStats
+{
+  uint32_t requests;  // Commit requests sent
+  uint32_t failures;  // Commit requests that failed
+  uint32_t writes;    // Writes committed
+  uint32_t coalesced; // Patches merged into a pending patch of the same target
+  uint32_t elided;    // Patches skipped because the value was already stored
+  uint32_t dropped;   // Writes too long to queue
+  uint32_t rejected;  // Writes refused because the batch was full
+};
+
+// Accumulates Firestore writes and sends them as a single commit once
+// `maxWrites` are pending or the oldest one is `maxDelay` ms old.
+//
+// Documents added with addDocument() get a client-generated id, the same way
+// the Firestore SDKs create documents inside a batch. Metadata patches are
+// coalesced while pending (the last value wins) and skipped entirely when the
+// same value was already committed for that document and field mask.
+//
+// Writes that fail to commit stay pending and are retried after another
+// `maxDelay`. Adding never sends anything: once the batch is full, writes are
+// refused until poll() or flush() commits it, so the caller sees the
+// backpressure and decides what to do with them.
+class BatchWriter
+{
+public:
+  typedef unsigned long (*Clock)();
+
+  BatchWriter(CommitSink &sink, Clock clock, size_t maxWrites = BATCH_WRITER_MAX_WRITES,
+              unsigned long maxDelay = 10000);
+
+  // Queue a new document in `collectionPath`. Returns false if the write was
+  // dropped (too long) or rejected (batch full).
+  bool addDocument(const char *collectionPath, const char *content);
+
+  // Queue a patch of the fields in `mask` of the document at `documentPath`.
+  // Returns false as addDocument() does.
+  bool patchDocument(const char *documentPath, const char *content, const char *mask);
+
+  // Flush if the batch is full or old enough. Call this regularly.
+  // Returns false only if a flush was attempted and failed.
+  bool poll();
+
+  // Send all pending writes now
+  bool flush();
+
+  // Forget the committed metadata, e.g. after the documents were deleted
+  void clearMetadataCache();
+
+  void setSeed(uint32_t seed) { _random = seed ? seed : 1; }
+
+  size_t pending() const { return _count; }
+  // Writes that can be added before the batch is full
+  size_t room() const { return _maxWrites - _count; }
+  const BatchStats &stats() const { return _stats; }
+
+  // Render the writes as the body of a Firestore REST documents:commit
+  // request. Returns the body length, or 0 if `size` was too small.
+  static size_t renderCommit(const BatchWrite *writes, size_t count, const char *projectId,
+                             const char *databaseId, char *buffer, size_t size);
+
+private:
+  struct CachedMetadata
+  {
+    uint32_t target;
+    uint32_t value;
+  };
+
+  BatchWrite *reserve();
+  bool isCommitted(uint32_t target, uint32_t value) const;
+  void remember(uint32_t target, uint32_t value);
+  void nextId(char *id);
+
+  static uint32_t hash(const char *str, uint32_t seed = 2166136261u);
+  static bool copy(char *dest, const char *src, size_t size);
+
+  CommitSink &_sink;
+  Clock _clock;
+  size_t _maxWrites;
+  unsigned long _maxDelay;
+  unsigned long _firstPending;
+  bool _retrying; // The last commit failed, the next waits for maxDelay
+  uint32_t _random;
+  size_t _count;
+  BatchWrite _writes[BATCH_WRITER_MAX_WRITES];
+  CachedMetadata _cache[BATCH_METADATA_CACHE];
+  size_t _cacheNext;
+  BatchStats _stats;
+};
+
+#endif
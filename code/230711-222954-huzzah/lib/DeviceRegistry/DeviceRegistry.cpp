@@ -0,0 +1,248 @@
+#include "DeviceRegistry.h"
+
+#include <string.h>
+
+static_assert(DEVICE_REGISTRY_CAPACITY >= 32 && (DEVICE_REGISTRY_CAPACITY & (DEVICE_REGISTRY_CAPACITY - 1)) == 0,
+              "DEVICE_REGISTRY_CAPACITY must be a power of two, at least 32");
+static_assert(DEVICE_REGISTRY_CAPACITY <= 16384, "DEVICE_REGISTRY_CAPACITY must fit the 16-bit index");
+
+DeviceRegistry::DeviceRegistry()
+{
+  clear();
+}
+
+void DeviceRegistry::clear()
+{
+  memset(_index, 0xff, sizeof(_index));
+  memset(_used, 0, sizeof(_used));
+  memset(&_totals, 0, sizeof(_totals));
+}
+
+int DeviceRegistry::find(const char *name, size_t length) const
+{
+  uint16_t slot;
+  return probe(name, length, hash(name, length), slot);
+}
+
+int DeviceRegistry::find(const char *name) const
+{
+  return find(name, strlen(name));
+}
+
+int DeviceRegistry::intern(const char *name, size_t length, unsigned long now)
+{
+  if (length == 0 || length >= DEVICE_NAME_SIZE)
+  {
+    return -1;
+  }
+
+  uint32_t h = hash(name, length);
+  uint16_t slot;
+  int id = probe(name, length, h, slot);
+  if (id >= 0)
+  {
+    return id;
+  }
+
+  // Lowest free id keeps the columns dense
+  for (uint16_t word = 0; word < DEVICE_REGISTRY_CAPACITY / 32; word++)
+  {
+    if (_used[word] == 0xffffffff)
+    {
+      continue;
+    }
+    uint32_t bits = ~_used[word];
+    uint16_t bit = 0;
+    while ((bits & 1) == 0)
+    {
+      bits >>= 1;
+      bit++;
+    }
+    id = word * 32 + bit;
+    _used[word] |= 1u << bit;
+    break;
+  }
+  if (id < 0)
+  {
+    return -1;
+  }
+
+  memcpy(_names[id], name, length);
+  _names[id][length] = '\0';
+  _hashes[id] = h;
+  _lastUpdated[id] = now;
+  _power[id] = 0;
+  _today[id] = 0;
+  _yesterday[id] = 0;
+  _total[id] = 0;
+  _startDate[id][0] = '\0';
+  _index[slot] = id;
+  _totals.devices++;
+  return id;
+}
+
+int DeviceRegistry::intern(const char *name, unsigned long now)
+{
+  return intern(name, strlen(name), now);
+}
+
+bool DeviceRegistry::update(int id, const DeviceData &data)
+{
+  if (!contains(id))
+  {
+    return false;
+  }
+  subtractFromTotals(id);
+  _lastUpdated[id] = data.lastUpdated;
+  _power[id] = data.power;
+  _today[id] = data.today;
+  _yesterday[id] = data.yesterday;
+  _total[id] = data.total;
+  memcpy(_startDate[id], data.startDate, sizeof(_startDate[id]));
+  addToTotals(id);
+  return true;
+}
+
+bool DeviceRegistry::remove(int id)
+{
+  if (!contains(id))
+  {
+    return false;
+  }
+  uint16_t slot;
+  probe(_names[id], strlen(_names[id]), _hashes[id], slot);
+  unlinkSlot(slot);
+  subtractFromTotals(id);
+  _used[id / 32] &= ~(1u << (id % 32));
+  _totals.devices--;
+  return true;
+}
+
+size_t DeviceRegistry::expire(unsigned long now, unsigned long maxAge)
+{
+  size_t removed = 0;
+  for (int id = first(); id >= 0; id = next(id))
+  {
+    if (now - _lastUpdated[id] > maxAge)
+    {
+      remove(id);
+      removed++;
+    }
+  }
+  // Start again from exact sums
+  _totals = sum();
+  return removed;
+}
+
+DeviceTotals DeviceRegistry::sum() const
+{
+  DeviceTotals totals;
+  memset(&totals, 0, sizeof(totals));
+  for (int id = first(); id >= 0; id = next(id))
+  {
+    totals.power += _power[id];
+    totals.today += _today[id];
+    totals.yesterday += _yesterday[id];
+    totals.total += _total[id];
+    totals.devices++;
+  }
+  return totals;
+}
+
+int DeviceRegistry::next(int id) const
+{
+  for (id++; id < DEVICE_REGISTRY_CAPACITY; id++)
+  {
+    uint32_t word = _used[id / 32] >> (id % 32);
+    if (word == 0)
+    {
+      // Skip the rest of an empty word
+      id = (id | 31);
+      continue;
+    }
+    if (word & 1)
+    {
+      return id;
+    }
+  }
+  return -1;
+}
+
+bool DeviceRegistry::contains(int id) const
+{
+  return id >= 0 && id < DEVICE_REGISTRY_CAPACITY && (_used[id / 32] & (1u << (id % 32)));
+}
+
+// FNV-1a
+uint32_t DeviceRegistry::hash(const char *name, size_t length)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < length; i++)
+  {
+    h ^= (uint8_t)name[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// Look a name up in the index. Returns its id, or -1 with `slot` set to the
+// empty slot where it would be inserted.
+int16_t DeviceRegistry::probe(const char *name, size_t length, uint32_t h, uint16_t &slot) const
+{
+  slot = h & (IndexSize - 1);
+  while (true)
+  {
+    int16_t id = _index[slot];
+    if (id == EmptySlot)
+    {
+      return -1;
+    }
+    if (_hashes[id] == h && strncmp(_names[id], name, length) == 0 && _names[id][length] == '\0')
+    {
+      return id;
+    }
+    slot = (slot + 1) & (IndexSize - 1);
+  }
+}
+
+// Backward-shift deletion: move later entries of the probe sequence into the
+// hole so lookups never need tombstones.
+void DeviceRegistry::unlinkSlot(uint16_t slot)
+{
+  uint16_t hole = slot;
+  uint16_t current = slot;
+  while (true)
+  {
+    current = (current + 1) & (IndexSize - 1);
+    int16_t id = _index[current];
+    if (id == EmptySlot)
+    {
+      break;
+    }
+    uint16_t home = _hashes[id] & (IndexSize - 1);
+    // Move the entry unless its home lies cyclically in (hole, current]
+    bool stays = hole <= current ? (hole < home && home <= current) : (hole < home || home <= current);
+    if (!stays)
+    {
+      _index[hole] = id;
+      hole = current;
+    }
+  }
+  _index[hole] = EmptySlot;
+}
+
+void DeviceRegistry::addToTotals(int id)
+{
+  _totals.power += _power[id];
+  _totals.today += _today[id];
+  _totals.yesterday += _yesterday[id];
+  _totals.total += _total[id];
+}
+
+void DeviceRegistry::subtractFromTotals(int id)
+{
+  _totals.power -= _power[id];
+  _totals.today -= _today[id];
+  _totals.yesterday -= _yesterday[id];
+  _totals.total -= _total[id];
+}
@@ -0,0 +1,112 @@
+#ifndef DEVICE_REGISTRY_H
+#define DEVICE_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SensorDecoder.h>
+
+// Maximum number of plugs tracked at once. Must be a power of two.
+#ifndef DEVICE_REGISTRY_CAPACITY
+#define DEVICE_REGISTRY_CAPACITY 256
+#endif
+
+// Longest device name taken from an MQTT topic, including the terminator
+#ifndef DEVICE_NAME_SIZE
+#define DEVICE_NAME_SIZE 32
+#endif
+
+// Sums over all registered devices
+struct DeviceTotals
+{
+  long power;
+  double today;
+  double yesterday;
+  double total;
+  uint16_t devices;
+};
+
+// Fixed-capacity table of the plugs seen on the broker.
+//
+// Device names are interned once into a small integer id; lookups hash the
+// name straight from the topic and probe an open-addressing index, so the
+// hot path never allocates. Readings are stored as structure-of-arrays
+// columns indexed by id, so the aggregates only touch the numbers, and the
+// sums are kept up to date on every update and removal. expire() walks the
+// columns once, drops stale devices and recomputes the sums exactly to
+// cancel any floating point drift.
+class DeviceRegistry
+{
+public:
+  DeviceRegistry();
+
+  // Id of the device, or -1 if it is unknown
+  int find(const char *name, size_t length) const;
+  int find(const char *name) const;
+
+  // Id of the device, registering it if needed. Returns -1 if the name is
+  // too long or the table is full.
+  int intern(const char *name, size_t length, unsigned long now);
+  int intern(const char *name, unsigned long now);
+
+  // Store the latest readings of a device
+  bool update(int id, const DeviceData &data);
+
+  bool remove(int id);
+
+  // Remove the devices not updated for more than `maxAge`. Returns the number
+  // of devices removed.
+  size_t expire(unsigned long now, unsigned long maxAge);
+
+  void clear();
+
+  // Running sums, O(1)
+  const DeviceTotals &totals() const { return _totals; }
+
+  // Sums recomputed in a single pass over the columns
+  DeviceTotals sum() const;
+
+  uint16_t size() const { return _totals.devices; }
+  static uint16_t capacity() { return DEVICE_REGISTRY_CAPACITY; }
+
+  // Iterate over the registered ids: for (int id = first(); id >= 0; id = next(id))
+  int first() const { return next(-1); }
+  int next(int id) const;
+
+  bool contains(int id) const;
+  const char *name(int id) const { return _names[id]; }
+  unsigned long lastUpdated(int id) const { return _lastUpdated[id]; }
+  int power(int id) const { return _power[id]; }
+  float today(int id) const { return _today[id]; }
+  float yesterday(int id) const { return _yesterday[id]; }
+  double total(int id) const { return _total[id]; }
+  const char *startDate(int id) const { return _startDate[id]; }
+
+private:
+  static const uint16_t IndexSize = DEVICE_REGISTRY_CAPACITY * 2;
+  static const int16_t EmptySlot = -1;
+
+  static uint32_t hash(const char *name, size_t length);
+  int16_t probe(const char *name, size_t length, uint32_t h, uint16_t &slot) const;
+  void unlinkSlot(uint16_t slot);
+  void addToTotals(int id);
+  void subtractFromTotals(int id);
+
+  // Open-addressing index from name hash to id, linear probing
+  int16_t _index[IndexSize];
+
+  // Columns, indexed by id
+  uint32_t _hashes[DEVICE_REGISTRY_CAPACITY];
+  uint32_t _used[DEVICE_REGISTRY_CAPACITY / 32];
+  unsigned long _lastUpdated[DEVICE_REGISTRY_CAPACITY];
+  int _power[DEVICE_REGISTRY_CAPACITY];
+  float _today[DEVICE_REGISTRY_CAPACITY];
+  float _yesterday[DEVICE_REGISTRY_CAPACITY];
+  double _total[DEVICE_REGISTRY_CAPACITY];
+  char _names[DEVICE_REGISTRY_CAPACITY][DEVICE_NAME_SIZE];
+  char _startDate[DEVICE_REGISTRY_CAPACITY][TIMESTAMP_LENGTH + 2];
+
+  DeviceTotals _totals;
+};
+
+#endif
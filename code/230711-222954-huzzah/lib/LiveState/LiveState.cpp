@@ -0,0 +1,135 @@
+#include "LiveState.h"
+
+#include <string.h>
+
+LiveState::LiveState()
+{
+  _listenerCount = 0;
+  clear();
+}
+
+void LiveState::clear()
+{
+  memset(&_state, 0, sizeof(_state));
+  _set = 0;
+  _reported = 0;
+  _hydrated = 0;
+  _changed = 0;
+}
+
+void LiveState::changed(StateField field)
+{
+  _set |= STATE_MASK(field);
+  _changed |= STATE_MASK(field);
+}
+
+void LiveState::setPower(long power)
+{
+  if (power != _state.power || !isSet(STATE_POWER))
+  {
+    _state.power = power;
+    changed(STATE_POWER);
+  }
+  raiseMaxPower(power);
+}
+
+void LiveState::setMeanPower(float power)
+{
+  if (power != _state.meanPower || !isSet(STATE_MEAN_POWER))
+  {
+    _state.meanPower = power;
+    changed(STATE_MEAN_POWER);
+  }
+}
+
+void LiveState::setToday(float today, bool reported)
+{
+  if (reported)
+  {
+    _reported |= STATE_MASK(STATE_TODAY);
+  }
+  else if ((_hydrated & ~_reported) & STATE_MASK(STATE_TODAY))
+  {
+    return;
+  }
+  if (today != _state.today || !isSet(STATE_TODAY))
+  {
+    _state.today = today;
+    changed(STATE_TODAY);
+  }
+}
+
+void LiveState::setDevices(uint16_t devices)
+{
+  if (devices != _state.devices || !isSet(STATE_DEVICES))
+  {
+    _state.devices = devices;
+    changed(STATE_DEVICES);
+  }
+}
+
+bool LiveState::raiseMaxPower(long power)
+{
+  if (isSet(STATE_MAX_POWER) && power <= _state.maxPower)
+  {
+    return false;
+  }
+  _state.maxPower = power;
+  changed(STATE_MAX_POWER);
+  return true;
+}
+
+void LiveState::hydrateMaxPower(long power)
+{
+  raiseMaxPower(power);
+}
+
+void LiveState::hydrateToday(float today)
+{
+  if (_reported & STATE_MASK(STATE_TODAY))
+  {
+    return;
+  }
+  _hydrated |= STATE_MASK(STATE_TODAY);
+  if (today != _state.today || !isSet(STATE_TODAY))
+  {
+    _state.today = today;
+    changed(STATE_TODAY);
+  }
+}
+
+bool LiveState::subscribe(Listener listener, uint32_t mask)
+{
+  if (_listenerCount >= LIVE_STATE_MAX_LISTENERS)
+  {
+    return false;
+  }
+  _listeners[_listenerCount].listener = listener;
+  _listeners[_listenerCount].mask = mask;
+  _listenerCount++;
+  // New listeners see the values already known
+  _changed |= mask & _set;
+  return true;
+}
+
+uint8_t LiveState::dispatch()
+{
+  // Take the changes first, listeners may set values for the next dispatch
+  uint32_t changed = _changed;
+  _changed = 0;
+  if (changed == 0)
+  {
+    return 0;
+  }
+
+  uint8_t called = 0;
+  for (uint8_t i = 0; i < _listenerCount; i++)
+  {
+    if (_listeners[i].mask & changed)
+    {
+      _listeners[i].listener(_state, _listeners[i].mask & changed);
+      called++;
+    }
+  }
+  return called;
+}
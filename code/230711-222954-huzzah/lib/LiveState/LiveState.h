@@ -0,0 +1,102 @@
+#ifndef LIVE_STATE_H
+#define LIVE_STATE_H
+
+#include <stdint.h>
+
+// Maximum number of listeners
+#ifndef LIVE_STATE_MAX_LISTENERS
+#define LIVE_STATE_MAX_LISTENERS 8
+#endif
+
+enum StateField
+{
+  STATE_POWER,      // Overall power now (W)
+  STATE_MEAN_POWER, // Overall power, 1 minute mean (W)
+  STATE_MAX_POWER,  // Highest overall power seen (W)
+  STATE_TODAY,      // Energy used today by all devices (kWh)
+  STATE_DEVICES,    // Number of devices reporting
+  STATE_FIELD_COUNT
+};
+
+#define STATE_MASK(field) (1u << (field))
+#define STATE_ALL ((1u << STATE_FIELD_COUNT) - 1)
+
+struct StateSnapshot
+{
+  long power;
+  float meanPower;
+  long maxPower;
+  float today;
+  uint16_t devices;
+};
+
+// The values the display shows, kept on the device.
+//
+// The ingest path writes the values as samples arrive; setters only record
+// what changed. dispatch() then calls each listener whose mask matches the
+// changed fields, once per dispatch however many updates came in between, so
+// the display follows new samples within one loop pass without polling
+// Firestore for values the device computed itself.
+//
+// Firestore is only read at cold start, through the hydrate functions. A
+// hydrated value never replaces one set from data the devices reported, except
+// the maximum power, which keeps the higher of the two. Until a device has
+// reported, the local value is only a placeholder: hydration replaces it, and
+// it does not replace a hydrated value.
+class LiveState
+{
+public:
+  // Called with the current values and the mask of the fields that changed
+  typedef void (*Listener)(const StateSnapshot &state, uint32_t changed);
+
+  LiveState();
+
+  void setPower(long power);
+  void setMeanPower(float power);
+  // `reported` is false while no device has reported yet
+  void setToday(float today, bool reported = true);
+  void setDevices(uint16_t devices);
+
+  // Raise the maximum power to `power`. Returns true if it grew.
+  bool raiseMaxPower(long power);
+
+  void hydrateMaxPower(long power);
+  void hydrateToday(float today);
+
+  // True once the field was set, locally or by hydration
+  bool isSet(StateField field) const { return _set & STATE_MASK(field); }
+
+  // Returns false if the listener table is full
+  bool subscribe(Listener listener, uint32_t mask);
+
+  // Mark fields changed so their listeners run again, e.g. after the
+  // display was switched back on
+  void touch(uint32_t mask) { _changed |= mask & _set; }
+
+  // Call the listeners of the changed fields. Returns the number called.
+  uint8_t dispatch();
+
+  uint32_t pending() const { return _changed; }
+  const StateSnapshot &snapshot() const { return _state; }
+
+  void clear();
+
+private:
+  struct Subscription
+  {
+    Listener listener;
+    uint32_t mask;
+  };
+
+  void changed(StateField field);
+
+  StateSnapshot _state;
+  uint32_t _set;
+  uint32_t _reported; // set from data the devices reported
+  uint32_t _hydrated;
+  uint32_t _changed;
+  Subscription _listeners[LIVE_STATE_MAX_LISTENERS];
+  uint8_t _listenerCount;
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include "Rollup.h"
+
+#include <string.h>
+
+static const uint32_t windowLengths[ROLLUP_WINDOWS] = {60, 900, 3600, 86400};
+static const char *const windowNames[ROLLUP_WINDOWS] = {"1m", "15m", "1h", "1d"};
+
+// Lower edge of each histogram bin in W, finer where plugs usually sit
+static const uint16_t binEdges[ROLLUP_BINS] = {0, 5, 10, 20, 35, 50, 75, 100,
+                                               150, 200, 300, 500, 750, 1000, 1500, 2500};
+
+uint32_t rollupWindowLength(RollupWindow window)
+{
+  return windowLengths[window];
+}
+
+const char *rollupWindowName(RollupWindow window)
+{
+  return windowNames[window];
+}
+
+static uint8_t binOf(uint16_t power)
+{
+  uint8_t bin = ROLLUP_BINS - 1;
+  while (bin > 0 && power < binEdges[bin])
+  {
+    bin--;
+  }
+  return bin;
+}
+
+// Value below which `rank` of the merged samples lie, interpolated linearly
+// inside the bin and clamped to the observed range
+static int percentile(const uint32_t *histogram, uint32_t rank, int minPower, int maxPower)
+{
+  uint32_t seen = 0;
+  for (uint8_t bin = 0; bin < ROLLUP_BINS; bin++)
+  {
+    if (histogram[bin] == 0 || seen + histogram[bin] < rank)
+    {
+      seen += histogram[bin];
+      continue;
+    }
+    int low = binEdges[bin] > minPower ? binEdges[bin] : minPower;
+    int high = bin + 1 < ROLLUP_BINS && binEdges[bin + 1] - 1 < maxPower ? binEdges[bin + 1] - 1 : maxPower;
+    return low + (int)((float)(high - low) * (rank - seen) / histogram[bin] + 0.5f);
+  }
+  return maxPower;
+}
+
+RollupSeries::RollupSeries()
+{
+  clear();
+}
+
+void RollupSeries::clear()
+{
+  memset(_buckets, 0, sizeof(_buckets));
+}
+
+RollupSeries::Bucket &RollupSeries::bucket(RollupWindow window, uint32_t now)
+{
+  uint32_t slot = now / (windowLengths[window] / ROLLUP_SLOTS);
+  Bucket &bucket = _buckets[window][slot % ROLLUP_SLOTS];
+  if (bucket.slot != slot)
+  {
+    // Recycle the bucket of an older slot
+    memset(&bucket, 0, sizeof(bucket));
+    bucket.slot = slot;
+  }
+  return bucket;
+}
+
+void RollupSeries::addPower(uint32_t now, int power)
+{
+  uint16_t value = power < 0 ? 0 : power > 0xffff ? 0xffff : power;
+  uint8_t bin = binOf(value);
+  for (uint8_t window = 0; window < ROLLUP_WINDOWS; window++)
+  {
+    Bucket &b = bucket((RollupWindow)window, now);
+    if (b.count == 0xffff)
+    {
+      continue;
+    }
+    if (b.count == 0 || value < b.minPower)
+    {
+      b.minPower = value;
+    }
+    if (b.count == 0 || value > b.maxPower)
+    {
+      b.maxPower = value;
+    }
+    b.count++;
+    b.sumPower += value;
+    b.histogram[bin]++;
+  }
+}
+
+void RollupSeries::addEnergy(uint32_t now, float energy)
+{
+  for (uint8_t window = 0; window < ROLLUP_WINDOWS; window++)
+  {
+    bucket((RollupWindow)window, now).energy += energy;
+  }
+}
+
+bool RollupSeries::stats(RollupWindow window, uint32_t now, RollupStats &stats) const
+{
+  uint32_t slot = now / (windowLengths[window] / ROLLUP_SLOTS);
+  uint32_t histogram[ROLLUP_BINS] = {0};
+  uint32_t sum = 0;
+  bool hasData = false;
+  memset(&stats, 0, sizeof(stats));
+
+  for (uint8_t i = 0; i < ROLLUP_SLOTS; i++)
+  {
+    const Bucket &b = _buckets[window][i];
+    // Only the current slot and the ROLLUP_SLOTS - 1 before it
+    if (slot - b.slot >= ROLLUP_SLOTS || (b.count == 0 && b.energy == 0))
+    {
+      continue;
+    }
+    hasData = true;
+    stats.energy += b.energy;
+    if (b.count == 0)
+    {
+      continue;
+    }
+    if (stats.samples == 0 || b.minPower < stats.minPower)
+    {
+      stats.minPower = b.minPower;
+    }
+    if (stats.samples == 0 || b.maxPower > stats.maxPower)
+    {
+      stats.maxPower = b.maxPower;
+    }
+    stats.samples += b.count;
+    sum += b.sumPower;
+    for (uint8_t bin = 0; bin < ROLLUP_BINS; bin++)
+    {
+      histogram[bin] += b.histogram[bin];
+    }
+  }
+
+  if (stats.samples > 0)
+  {
+    stats.meanPower = (float)sum / stats.samples;
+    stats.p50Power = percentile(histogram, (stats.samples * 50 + 99) / 100, stats.minPower, stats.maxPower);
+    stats.p95Power = percentile(histogram, (stats.samples * 95 + 99) / 100, stats.minPower, stats.maxPower);
+  }
+  return hasData;
+}
+
+RollupEngine::RollupEngine()
+{
+  clear();
+}
+
+void RollupEngine::clear()
+{
+  _overall.clear();
+  for (int id = 0; id < ROLLUP_MAX_DEVICES; id++)
+  {
+    _devices[id].clear();
+  }
+  memset(_known, 0, sizeof(_known));
+}
+
+void RollupEngine::addDevice(int id, uint32_t now, int power, double total)
+{
+  if (id < 0 || id >= DEVICE_REGISTRY_CAPACITY)
+  {
+    return;
+  }
+
+  // Energy used since the previous reading. The first reading only sets the
+  // baseline, and a counter that went backwards was reset on the plug.
+  float energy = 0;
+  uint32_t mask = 1u << (id % 32);
+  if ((_known[id / 32] & mask) && total > _lastTotal[id])
+  {
+    energy = (float)(total - _lastTotal[id]);
+  }
+  _known[id / 32] |= mask;
+  _lastTotal[id] = total;
+
+  if (energy > 0)
+  {
+    _overall.addEnergy(now, energy);
+  }
+  if (id < ROLLUP_MAX_DEVICES)
+  {
+    _devices[id].addPower(now, power);
+    if (energy > 0)
+    {
+      _devices[id].addEnergy(now, energy);
+    }
+  }
+}
+
+void RollupEngine::removeDevice(int id)
+{
+  if (id < 0 || id >= DEVICE_REGISTRY_CAPACITY || (_known[id / 32] & (1u << (id % 32))) == 0)
+  {
+    return;
+  }
+  _known[id / 32] &= ~(1u << (id % 32));
+  if (id < ROLLUP_MAX_DEVICES)
+  {
+    _devices[id].clear();
+  }
+}
+
+void RollupEngine::addOverall(uint32_t now, int power)
+{
+  _overall.addPower(now, power);
+}
+
+bool RollupEngine::overall(RollupWindow window, uint32_t now, RollupStats &stats) const
+{
+  return _overall.stats(window, now, stats);
+}
+
+bool RollupEngine::device(int id, RollupWindow window, uint32_t now, RollupStats &stats) const
+{
+  if (id < 0 || id >= ROLLUP_MAX_DEVICES)
+  {
+    return false;
+  }
+  return _devices[id].stats(window, now, stats);
+}
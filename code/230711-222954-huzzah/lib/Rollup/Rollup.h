@@ -0,0 +1,125 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Ids are the ones handed out by DeviceRegistry
+#include <DeviceRegistry.h>
+
+// Number of devices, by lowest registry id, that keep their own rollups.
+// Every device still counts towards the overall energy.
+#ifndef ROLLUP_MAX_DEVICES
+#define ROLLUP_MAX_DEVICES 48
+#endif
+
+// Each window slides in this many steps
+#define ROLLUP_SLOTS 4
+
+// Number of power histogram bins used for the percentiles
+#define ROLLUP_BINS 16
+
+enum RollupWindow
+{
+  ROLLUP_1MIN,
+  ROLLUP_15MIN,
+  ROLLUP_1HOUR,
+  ROLLUP_1DAY,
+  ROLLUP_WINDOWS
+};
+
+// Length of a window in seconds, and its short name ("1m", "15m", "1h", "1d")
+uint32_t rollupWindowLength(RollupWindow window);
+const char *rollupWindowName(RollupWindow window);
+
+// Statistics over one window
+struct RollupStats
+{
+  uint32_t samples;
+  int minPower;
+  int maxPower;
+  float meanPower;
+  int p50Power; // Percentiles are estimated from the histogram
+  int p95Power;
+  float energy; // kWh used during the window
+};
+
+// Power and energy statistics of one stream over every window, in constant
+// memory.
+//
+// A window is a ring of ROLLUP_SLOTS buckets, each a quarter of the window
+// long, so it slides in quarter steps: the 1 hour window covers the current
+// 15 minute slot and the three before it. A bucket keeps the count, sum,
+// min and max of the power samples, a histogram for the percentiles and the
+// energy used. Adding a sample is O(1); a query merges ROLLUP_SLOTS buckets.
+class RollupSeries
+{
+public:
+  RollupSeries();
+
+  // Record a power sample taken at `now` (seconds)
+  void addPower(uint32_t now, int power);
+
+  // Record energy (kWh) used up to `now` (seconds)
+  void addEnergy(uint32_t now, float energy);
+
+  // Statistics of the window ending at `now`. Returns false if the window
+  // holds no data.
+  bool stats(RollupWindow window, uint32_t now, RollupStats &stats) const;
+
+  void clear();
+
+private:
+  struct Bucket
+  {
+    uint32_t slot; // now / slot length, identifies the time slot held
+    uint16_t count;
+    uint16_t minPower;
+    uint16_t maxPower;
+    uint32_t sumPower;
+    float energy;
+    uint16_t histogram[ROLLUP_BINS];
+  };
+
+  Bucket &bucket(RollupWindow window, uint32_t now);
+
+  Bucket _buckets[ROLLUP_WINDOWS][ROLLUP_SLOTS];
+};
+
+// Overall and per-device rollups.
+//
+// Device readings carry the cumulative energy counter of the plug; the engine
+// turns it into energy deltas, ignoring counter resets, and adds them to both
+// the device and the overall series. The overall power is sampled separately
+// at a fixed rate so that it is not weighted by how often plugs report.
+class RollupEngine
+{
+public:
+  RollupEngine();
+
+  // Record a reading of the device with registry id `id`. `total` is its
+  // energy counter in kWh, a double so that the few Wh between two readings
+  // are not lost against a counter in the thousands of kWh.
+  void addDevice(int id, uint32_t now, int power, double total);
+
+  // Forget a device, e.g. after it expired from the registry
+  void removeDevice(int id);
+
+  // Record a sample of the overall power
+  void addOverall(uint32_t now, int power);
+
+  bool overall(RollupWindow window, uint32_t now, RollupStats &stats) const;
+
+  // Returns false if the device has no data or no rollups of its own
+  bool device(int id, RollupWindow window, uint32_t now, RollupStats &stats) const;
+
+  void clear();
+
+private:
+  RollupSeries _overall;
+  RollupSeries _devices[ROLLUP_MAX_DEVICES];
+  double _lastTotal[DEVICE_REGISTRY_CAPACITY];
+  uint32_t _known[DEVICE_REGISTRY_CAPACITY / 32];
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// What push() does when the queue is full
+enum QueuePolicy
+{
+  QUEUE_DROP_NEWEST,     // Reject the new record
+  QUEUE_OVERWRITE_OLDEST // Discard the oldest record to make room
+};
+
+struct QueueStats
+{
+  uint32_t pushed;      // Records accepted by push()
+  uint32_t popped;      // Records handed out by pop()
+  uint32_t dropped;     // Records rejected because the queue was full
+  uint32_t overwritten; // Old records discarded to make room
+  uint32_t highWater;   // Largest depth seen
+  uint32_t lastLag;     // Time the last popped record spent in the queue
+  uint32_t maxLag;      // Longest time a record spent in the queue
+};
+
+// Bounded, lock-free single-producer/single-consumer ring buffer.
+//
+// One task (the MQTT callback) calls push(), one other task (the uploader)
+// calls pop(). Neither call blocks or allocates. Capacity must be a power of
+// two so the free-running indices can be masked.
+//
+// With QUEUE_OVERWRITE_OLDEST the producer claims the oldest slot with a
+// compare-and-swap on the read index before rewriting it. A consumer that was
+// copying that slot at the same time loses the race on the read index, throws
+// its copy away and retries, so it never returns a torn record.
+//
+// Timestamps passed to push() and pop() are only used for the lag counters;
+// any monotonic unit works (millis() on the device).
+template <typename T, size_t Capacity>
+class SampleQueue
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SampleQueue capacity must be a power of two");
+
+public:
+  explicit SampleQueue(QueuePolicy policy = QUEUE_DROP_NEWEST)
+      : _head(0), _tail(0), _policy(policy)
+  {
+    resetStats();
+  }
+
+  // Producer side. Returns false if the record was dropped.
+  bool push(const T &value, uint32_t now)
+  {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    if (head - tail >= Capacity)
+    {
+      if (_policy == QUEUE_DROP_NEWEST)
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      // The consumer may pop concurrently, in which case there is room again
+      // and the compare-and-swap fails harmlessly.
+      if (_tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel))
+      {
+        _overwritten.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    Slot &slot = _slots[head & (Capacity - 1)];
+    slot.value = value;
+    slot.enqueuedAt = now;
+    _head.store(head + 1, std::memory_order_release);
+    _pushed.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t depth = head + 1 - _tail.load(std::memory_order_relaxed);
+    if (depth > _highWater.load(std::memory_order_relaxed))
+    {
+      _highWater.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer side. Returns false if the queue is empty.
+  bool pop(T &value, uint32_t now)
+  {
+    while (true)
+    {
+      uint32_t tail = _tail.load(std::memory_order_acquire);
+      uint32_t head = _head.load(std::memory_order_acquire);
+      if (tail == head)
+      {
+        return false;
+      }
+      const Slot &slot = _slots[tail & (Capacity - 1)];
+      value = slot.value;
+      uint32_t enqueuedAt = slot.enqueuedAt;
+      if (_tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel))
+      {
+        uint32_t lag = now - enqueuedAt;
+        _lastLag.store(lag, std::memory_order_relaxed);
+        if (lag > _maxLag.load(std::memory_order_relaxed))
+        {
+          _maxLag.store(lag, std::memory_order_relaxed);
+        }
+        _popped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      // The producer overwrote this slot while it was being copied
+    }
+  }
+
+  size_t size() const
+  {
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    uint32_t depth = head - tail;
+    return depth > Capacity ? Capacity : depth;
+  }
+
+  bool empty() const { return size() == 0; }
+  static size_t capacity() { return Capacity; }
+  QueuePolicy policy() const { return _policy; }
+
+  // Snapshot of the counters. Individual fields are consistent, the set as a
+  // whole may be mid-update while both sides are running.
+  QueueStats stats() const
+  {
+    QueueStats stats;
+    stats.pushed = _pushed.load(std::memory_order_relaxed);
+    stats.popped = _popped.load(std::memory_order_relaxed);
+    stats.dropped = _dropped.load(std::memory_order_relaxed);
+    stats.overwritten = _overwritten.load(std::memory_order_relaxed);
+    stats.highWater = _highWater.load(std::memory_order_relaxed);
+    stats.lastLag = _lastLag.load(std::memory_order_relaxed);
+    stats.maxLag = _maxLag.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  void resetStats()
+  {
+    _pushed.store(0);
+    _popped.store(0);
+    _dropped.store(0);
+    _overwritten.store(0);
+    _highWater.store(0);
+    _lastLag.store(0);
+    _maxLag.store(0);
+  }
+
+private:
+  struct Slot
+  {
+    T value;
+    uint32_t enqueuedAt;
+  };
+
+  Slot _slots[Capacity];
+  std::atomic<uint32_t> _head; // Next slot to write, owned by the producer
+  std::atomic<uint32_t> _tail; // Next slot to read
+  QueuePolicy _policy;
+
+  std::atomic<uint32_t> _pushed;
+  std::atomic<uint32_t> _popped;
+  std::atomic<uint32_t> _dropped;
+  std::atomic<uint32_t> _overwritten;
+  std::atomic<uint32_t> _highWater;
+  std::atomic<uint32_t> _lastLag;
+  std::atomic<uint32_t> _maxLag;
+};
+
+#endif
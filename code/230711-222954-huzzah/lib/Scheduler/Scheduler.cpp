@@ -0,0 +1,272 @@
+#include "Scheduler.h"
+
+#include <string.h>
+
+Scheduler::Scheduler(SchedulerClock clock, unsigned long budget)
+    : _clock(clock), _budget(budget), _pass(0), _count(0)
+{
+  memset(_tasks, 0, sizeof(_tasks));
+}
+
+int Scheduler::addPeriodic(const char *name, TaskCallback callback, unsigned long interval,
+                           uint8_t priority, bool runNow)
+{
+  int id = add(name, callback, TASK_PERIODIC, interval, 0, priority);
+  if (id >= 0 && runNow)
+  {
+    _tasks[id].lastRun -= interval;
+  }
+  return id;
+}
+
+int Scheduler::addOneShot(const char *name, TaskCallback callback, unsigned long delay,
+                          uint8_t priority)
+{
+  return add(name, callback, TASK_ONESHOT, delay, 0, priority);
+}
+
+int Scheduler::addDeadline(const char *name, TaskCallback callback, unsigned long delay,
+                           unsigned long deadline, uint8_t priority)
+{
+  if (deadline < delay)
+  {
+    deadline = delay;
+  }
+  return add(name, callback, TASK_DEADLINE, delay, deadline, priority);
+}
+
+int Scheduler::add(const char *name, TaskCallback callback, TaskType type, unsigned long interval,
+                   unsigned long deadline, uint8_t priority)
+{
+  if (callback == NULL)
+  {
+    return -1;
+  }
+  for (int i = 0; i < SCHEDULER_MAX_TASKS; i++)
+  {
+    Task &task = _tasks[i];
+    if (task.active)
+    {
+      continue;
+    }
+    memset(&task, 0, sizeof(Task));
+    task.name = name;
+    task.callback = callback;
+    task.type = type;
+    task.interval = interval;
+    task.deadline = deadline;
+    task.priority = priority;
+    task.lastRun = _clock();
+    task.pass = _pass;
+    task.active = true;
+    task.enabled = true;
+    _count++;
+    return i;
+  }
+  return -1;
+}
+
+bool Scheduler::remove(int id)
+{
+  if (!validId(id))
+  {
+    return false;
+  }
+  _tasks[id].active = false;
+  _count--;
+  return true;
+}
+
+bool Scheduler::setEnabled(int id, bool enabled)
+{
+  if (!validId(id))
+  {
+    return false;
+  }
+  Task &task = _tasks[id];
+  if (enabled && !task.enabled)
+  {
+    // Restart the period so a task disabled for a long time does not fire
+    // straight away.
+    task.lastRun = _clock();
+  }
+  task.enabled = enabled;
+  return true;
+}
+
+bool Scheduler::setInterval(int id, unsigned long interval)
+{
+  if (!validId(id))
+  {
+    return false;
+  }
+  _tasks[id].interval = interval;
+  return true;
+}
+
+bool Scheduler::trigger(int id)
+{
+  if (!validId(id))
+  {
+    return false;
+  }
+  Task &task = _tasks[id];
+  task.lastRun = _clock() - task.interval;
+  return true;
+}
+
+uint8_t Scheduler::run()
+{
+  unsigned long start = _clock();
+  uint8_t ran = 0;
+  _pass++;
+
+  while (true)
+  {
+    unsigned long now = _clock();
+    int id = pickNext(now);
+    if (id < 0)
+    {
+      break;
+    }
+
+    Task &task = _tasks[id];
+    unsigned long lateness = now - task.lastRun - task.interval;
+    if (task.type == TASK_DEADLINE && now - task.lastRun > task.deadline)
+    {
+      task.stats.missedDeadlines++;
+    }
+    if (lateness > task.stats.maxLateness)
+    {
+      task.stats.maxLateness = lateness;
+    }
+
+    // Periodic tasks keep their phase unless they fell more than one period
+    // behind, in which case the missed runs are skipped rather than bursted.
+    if (task.type == TASK_PERIODIC && task.interval > 0 && lateness < task.interval)
+    {
+      task.lastRun += task.interval;
+    }
+    else
+    {
+      task.lastRun = now;
+    }
+    task.pass = _pass;
+
+    TaskCallback callback = task.callback;
+    callback();
+    ran++;
+
+    unsigned long end = _clock();
+    unsigned long elapsed = end - now;
+    // The callback may have removed its own slot and a new task may have
+    // taken it; only account to the task that actually ran.
+    if (task.active && task.callback == callback)
+    {
+      task.stats.runs++;
+      task.stats.totalTime += elapsed;
+      if (elapsed > task.stats.maxTime)
+      {
+        task.stats.maxTime = elapsed;
+      }
+      if (task.type != TASK_PERIODIC)
+      {
+        task.active = false;
+        _count--;
+      }
+    }
+
+    if (end - start >= _budget)
+    {
+      break;
+    }
+  }
+
+  return ran;
+}
+
+unsigned long Scheduler::nextDue() const
+{
+  unsigned long now = _clock();
+  unsigned long next = (unsigned long)-1;
+  for (int i = 0; i < SCHEDULER_MAX_TASKS; i++)
+  {
+    const Task &task = _tasks[i];
+    if (!task.active || !task.enabled)
+    {
+      continue;
+    }
+    unsigned long wait = waitTime(task, now);
+    if (wait < next)
+    {
+      next = wait;
+    }
+  }
+  return next;
+}
+
+bool Scheduler::isActive(int id) const
+{
+  return id >= 0 && id < SCHEDULER_MAX_TASKS && _tasks[id].active;
+}
+
+const TaskStats *Scheduler::stats(int id) const
+{
+  if (!validId(id))
+  {
+    return NULL;
+  }
+  return &_tasks[id].stats;
+}
+
+const char *Scheduler::name(int id) const
+{
+  if (!validId(id))
+  {
+    return NULL;
+  }
+  return _tasks[id].name;
+}
+
+// Pick the due task that should run next: highest priority first, then the
+// most urgent one. Urgency is the time left before the deadline for deadline
+// tasks and the time since the due time for the others. Each task runs at
+// most once per run() call so zero-interval tasks cannot spin forever.
+int Scheduler::pickNext(unsigned long now) const
+{
+  int best = -1;
+  long bestSlack = 0;
+  for (int i = 0; i < SCHEDULER_MAX_TASKS; i++)
+  {
+    const Task &task = _tasks[i];
+    if (!task.active || !task.enabled || task.pass == _pass || !isDue(task, now))
+    {
+      continue;
+    }
+    unsigned long limit = task.type == TASK_DEADLINE ? task.deadline : task.interval;
+    long slack = (long)(task.lastRun + limit - now);
+    if (best < 0 || task.priority > _tasks[best].priority ||
+        (task.priority == _tasks[best].priority && slack < bestSlack))
+    {
+      best = i;
+      bestSlack = slack;
+    }
+  }
+  return best;
+}
+
+bool Scheduler::isDue(const Task &task, unsigned long now) const
+{
+  return now - task.lastRun >= task.interval;
+}
+
+unsigned long Scheduler::waitTime(const Task &task, unsigned long now) const
+{
+  unsigned long elapsed = now - task.lastRun;
+  return elapsed >= task.interval ? 0 : task.interval - elapsed;
+}
+
+bool Scheduler::validId(int id) const
+{
+  return id >= 0 && id < SCHEDULER_MAX_TASKS && _tasks[id].active;
+}
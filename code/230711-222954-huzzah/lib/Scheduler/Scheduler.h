@@ -0,0 +1,123 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// Maximum number of tasks a Scheduler can hold. Tasks live in a fixed array so
+// registering a task never allocates.
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 16
+#endif
+
+// Task priorities. Higher values run first when several tasks are due.
+#define PRIORITY_LOW 0
+#define PRIORITY_NORMAL 1
+#define PRIORITY_HIGH 2
+#define PRIORITY_CRITICAL 3
+
+typedef void (*TaskCallback)();
+
+// Time source in milliseconds. Pass millis() on the device, a fake clock on
+// the host.
+typedef unsigned long (*SchedulerClock)();
+
+enum TaskType
+{
+  TASK_PERIODIC,
+  TASK_ONESHOT,
+  TASK_DEADLINE
+};
+
+// Per-task run-time accounting
+struct TaskStats
+{
+  unsigned long runs;            // Number of times the callback was invoked
+  unsigned long totalTime;       // Sum of callback durations
+  unsigned long maxTime;         // Longest single callback duration
+  unsigned long maxLateness;     // Longest delay between due time and start
+  unsigned long missedDeadlines; // Deadline tasks started after their deadline
+};
+
+// Cooperative, non-preemptive task scheduler.
+//
+// Tasks are run from run(), which is called from loop(). Due tasks run in
+// priority order, earliest due time first within a priority. Once the time
+// spent in a single run() call exceeds the budget, the remaining tasks are
+// left for the next call, so a slow low-priority job (e.g. a Firestore upload)
+// delays high-priority jobs by at most one task.
+//
+// All time comparisons use unsigned subtraction so they survive the millis()
+// roll-over every 49.7 days.
+class Scheduler
+{
+public:
+  explicit Scheduler(SchedulerClock clock, unsigned long budget = 50);
+
+  // Run `callback` every `interval` ms. If `runNow` is true the first run is
+  // due immediately, otherwise after one interval. Returns the task id, or -1
+  // if the table is full.
+  int addPeriodic(const char *name, TaskCallback callback, unsigned long interval,
+                  uint8_t priority = PRIORITY_NORMAL, bool runNow = false);
+
+  // Run `callback` once, `delay` ms from now. The slot is freed afterwards.
+  int addOneShot(const char *name, TaskCallback callback, unsigned long delay,
+                 uint8_t priority = PRIORITY_NORMAL);
+
+  // Run `callback` once, no earlier than `delay` ms and no later than
+  // `deadline` ms from now. Among tasks of the same priority, deadline tasks
+  // are ordered earliest-deadline-first. A start after the deadline is counted
+  // in missedDeadlines but the callback still runs.
+  int addDeadline(const char *name, TaskCallback callback, unsigned long delay,
+                  unsigned long deadline, uint8_t priority = PRIORITY_NORMAL);
+
+  bool remove(int id);
+  bool setEnabled(int id, bool enabled);
+  bool setInterval(int id, unsigned long interval);
+  // Make the task due now without changing its period.
+  bool trigger(int id);
+
+  // Run the due tasks. Returns the number of callbacks invoked.
+  uint8_t run();
+
+  // Milliseconds until the next enabled task is due (0 if one is due now).
+  unsigned long nextDue() const;
+
+  bool isActive(int id) const;
+  const TaskStats *stats(int id) const;
+  const char *name(int id) const;
+  uint8_t size() const { return _count; }
+
+  void setBudget(unsigned long budget) { _budget = budget; }
+  unsigned long budget() const { return _budget; }
+
+private:
+  struct Task
+  {
+    const char *name;
+    TaskCallback callback;
+    unsigned long interval;
+    unsigned long deadline;
+    unsigned long lastRun; // Reference point the due time is measured from
+    unsigned long pass;    // Last run() pass this task was invoked in
+    TaskType type;
+    uint8_t priority;
+    bool active;
+    bool enabled;
+    TaskStats stats;
+  };
+
+  int add(const char *name, TaskCallback callback, TaskType type, unsigned long interval,
+          unsigned long deadline, uint8_t priority);
+  int pickNext(unsigned long now) const;
+  bool isDue(const Task &task, unsigned long now) const;
+  unsigned long waitTime(const Task &task, unsigned long now) const;
+  bool validId(int id) const;
+
+  Task _tasks[SCHEDULER_MAX_TASKS];
+  SchedulerClock _clock;
+  unsigned long _budget;
+  unsigned long _pass;
+  uint8_t _count;
+};
+
+#endif
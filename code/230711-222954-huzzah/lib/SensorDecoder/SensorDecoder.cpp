@@ -0,0 +1,421 @@
+#include "SensorDecoder.h"
+
+#include <float.h>
+#include <limits.h>
+#include <string.h>
+
+enum FieldType
+{
+  FIELD_INT,
+  FIELD_FLOAT,
+  FIELD_DOUBLE,
+  FIELD_TIMESTAMP,     // Copied as is
+  FIELD_ZULU_TIMESTAMP // Copied with a "Z" suffix
+};
+
+// Where a JSON member ends up in DeviceData
+struct FieldSpec
+{
+  const char *key;
+  uint8_t keyLength;
+  uint8_t type;
+  uint16_t offset;
+  uint16_t size;
+};
+
+#define SENSOR_FIELD(key, member, type) \
+  {key, sizeof(key) - 1, type, offsetof(DeviceData, member), sizeof(((DeviceData *)0)->member)}
+
+// The schema of a Tasmota SENSOR message, resolved at compile time
+static const FieldSpec rootFields[] = {
+    SENSOR_FIELD("Time", time, FIELD_TIMESTAMP),
+};
+
+static const FieldSpec energyFields[] = {
+    SENSOR_FIELD("TotalStartTime", startDate, FIELD_ZULU_TIMESTAMP),
+    SENSOR_FIELD("Total", total, FIELD_DOUBLE),
+    SENSOR_FIELD("Yesterday", yesterday, FIELD_FLOAT),
+    SENSOR_FIELD("Today", today, FIELD_FLOAT),
+    SENSOR_FIELD("Power", power, FIELD_INT),
+};
+
+#define ROOT_FIELD_COUNT (sizeof(rootFields) / sizeof(rootFields[0]))
+#define ENERGY_FIELD_COUNT (sizeof(energyFields) / sizeof(energyFields[0]))
+#define ALL_FIELDS ((1u << (ROOT_FIELD_COUNT + ENERGY_FIELD_COUNT)) - 1)
+
+// Limit for nested values that are skipped
+#define MAX_SKIP_DEPTH 8
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+                                     1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+const char *decodeResultString(DecodeResult result)
+{
+  switch (result)
+  {
+  case DECODE_OK:
+    return "Ok";
+  case DECODE_INCOMPLETE:
+    return "Incomplete";
+  default:
+    return "InvalidInput";
+  }
+}
+
+namespace
+{
+  // Cursor over the payload. Every read is bounds-checked against `end`.
+  struct Cursor
+  {
+    const char *p;
+    const char *end;
+
+    bool atEnd() const { return p >= end; }
+
+    char peek() const { return p < end ? *p : '\0'; }
+
+    void skipSpaces()
+    {
+      while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+      {
+        p++;
+      }
+    }
+
+    bool consume(char c)
+    {
+      skipSpaces();
+      if (p < end && *p == c)
+      {
+        p++;
+        return true;
+      }
+      return false;
+    }
+
+    // Read a string without escapes in place. Points `str` at its first
+    // character and `length` at its length. Strings with escapes are accepted
+    // but reported raw, which is fine for keys and timestamps.
+    bool readString(const char *&str, size_t &length)
+    {
+      if (!consume('"'))
+      {
+        return false;
+      }
+      str = p;
+      while (p < end && *p != '"')
+      {
+        if (*p == '\\')
+        {
+          p++;
+        }
+        p++;
+      }
+      if (p >= end)
+      {
+        return false;
+      }
+      length = p - str;
+      p++;
+      return true;
+    }
+
+    bool readNumber(double &value)
+    {
+      skipSpaces();
+      const char *start = p;
+      bool negative = false;
+      if (p < end && (*p == '-' || *p == '+'))
+      {
+        negative = *p == '-';
+        p++;
+      }
+
+      uint64_t mantissa = 0;
+      int exponent = 0;
+      int digits = 0;
+      while (p < end && *p >= '0' && *p <= '9')
+      {
+        if (mantissa < 100000000000000000ull)
+        {
+          mantissa = mantissa * 10 + (*p - '0');
+        }
+        else
+        {
+          exponent++;
+        }
+        p++;
+        digits++;
+      }
+      if (p < end && *p == '.')
+      {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+          if (mantissa < 100000000000000000ull)
+          {
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
+          }
+          p++;
+          digits++;
+        }
+      }
+      if (digits == 0)
+      {
+        p = start;
+        return false;
+      }
+      if (p < end && (*p == 'e' || *p == 'E'))
+      {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+          negativeExponent = *p == '-';
+          p++;
+        }
+        int e = 0;
+        if (p >= end || *p < '0' || *p > '9')
+        {
+          return false;
+        }
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+          if (e < 1000)
+          {
+            e = e * 10 + (*p - '0');
+          }
+          p++;
+        }
+        exponent += negativeExponent ? -e : e;
+      }
+
+      double result = (double)mantissa;
+      while (exponent > 0)
+      {
+        int step = exponent > 15 ? 15 : exponent;
+        result *= powersOfTen[step];
+        exponent -= step;
+      }
+      while (exponent < 0)
+      {
+        int step = -exponent > 15 ? 15 : -exponent;
+        result /= powersOfTen[step];
+        exponent += step;
+      }
+      value = negative ? -result : result;
+      return true;
+    }
+
+    bool skipLiteral(const char *literal)
+    {
+      size_t length = strlen(literal);
+      if ((size_t)(end - p) < length || memcmp(p, literal, length) != 0)
+      {
+        return false;
+      }
+      p += length;
+      return true;
+    }
+
+    // Skip any JSON value
+    bool skipValue(int depth = 0)
+    {
+      skipSpaces();
+      const char *str;
+      size_t length;
+      double number;
+      switch (peek())
+      {
+      case '"':
+        return readString(str, length);
+      case '{':
+      case '[':
+      {
+        if (depth >= MAX_SKIP_DEPTH)
+        {
+          return false;
+        }
+        char close = *p == '{' ? '}' : ']';
+        bool isObject = *p == '{';
+        p++;
+        if (consume(close))
+        {
+          return true;
+        }
+        do
+        {
+          if (isObject && (!readString(str, length) || !consume(':')))
+          {
+            return false;
+          }
+          if (!skipValue(depth + 1))
+          {
+            return false;
+          }
+        } while (consume(','));
+        return consume(close);
+      }
+      case 't':
+        return skipLiteral("true");
+      case 'f':
+        return skipLiteral("false");
+      case 'n':
+        return skipLiteral("null");
+      default:
+        return readNumber(number);
+      }
+    }
+  };
+
+  const FieldSpec *findField(const FieldSpec *fields, size_t count, const char *key, size_t length,
+                             size_t &index)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      if (fields[i].keyLength == length && memcmp(fields[i].key, key, length) == 0)
+      {
+        index = i;
+        return &fields[i];
+      }
+    }
+    return NULL;
+  }
+
+  // Returns false on invalid JSON. `isSet` tells whether the field got a value:
+  // a value of the wrong type, or a number out of range, is skipped.
+  bool readField(Cursor &cursor, const FieldSpec &field, DeviceData &data, bool &isSet)
+  {
+    isSet = false;
+    uint8_t *target = (uint8_t *)&data + field.offset;
+    if (field.type == FIELD_TIMESTAMP || field.type == FIELD_ZULU_TIMESTAMP)
+    {
+      const char *str;
+      size_t length;
+      if (cursor.peek() == 'n')
+      {
+        // null leaves the previous value
+        isSet = true;
+        return cursor.skipLiteral("null");
+      }
+      if (!cursor.readString(str, length))
+      {
+        return false;
+      }
+      size_t room = field.size - (field.type == FIELD_ZULU_TIMESTAMP ? 2 : 1);
+      if (length > room)
+      {
+        length = room;
+      }
+      memcpy(target, str, length);
+      if (field.type == FIELD_ZULU_TIMESTAMP)
+      {
+        target[length++] = 'Z';
+      }
+      target[length] = '\0';
+      isSet = true;
+      return true;
+    }
+
+    double value;
+    if (!cursor.readNumber(value))
+    {
+      return cursor.skipValue();
+    }
+    if (field.type == FIELD_INT)
+    {
+      if (!(value >= (double)INT_MIN && value <= (double)INT_MAX))
+      {
+        return true;
+      }
+      *(int *)target = (int)value;
+    }
+    else if (field.type == FIELD_DOUBLE)
+    {
+      if (!(value >= -DBL_MAX && value <= DBL_MAX))
+      {
+        return true;
+      }
+      *(double *)target = value;
+    }
+    else
+    {
+      if (!(value >= -FLT_MAX && value <= FLT_MAX))
+      {
+        return true;
+      }
+      *(float *)target = (float)value;
+    }
+    isSet = true;
+    return true;
+  }
+
+  // Decode the members of an object against `fields`, setting bit
+  // `firstBit + index` in `found` for every field read.
+  bool decodeObject(Cursor &cursor, const FieldSpec *fields, size_t count, uint32_t firstBit,
+                    uint32_t &found, DeviceData &data, bool isRoot)
+  {
+    if (!cursor.consume('{'))
+    {
+      return false;
+    }
+    if (cursor.consume('}'))
+    {
+      return true;
+    }
+    do
+    {
+      const char *key;
+      size_t length;
+      size_t index;
+      if (!cursor.readString(key, length) || !cursor.consume(':'))
+      {
+        return false;
+      }
+      cursor.skipSpaces();
+
+      const FieldSpec *field = findField(fields, count, key, length, index);
+      if (field != NULL)
+      {
+        bool isSet;
+        if (!readField(cursor, *field, data, isSet))
+        {
+          return false;
+        }
+        if (isSet)
+        {
+          found |= 1u << (firstBit + index);
+        }
+      }
+      else if (isRoot && length == 6 && memcmp(key, "ENERGY", 6) == 0 && cursor.peek() == '{')
+      {
+        if (!decodeObject(cursor, energyFields, ENERGY_FIELD_COUNT, ROOT_FIELD_COUNT, found, data,
+                          false))
+        {
+          return false;
+        }
+      }
+      else if (!cursor.skipValue(1))
+      {
+        return false;
+      }
+    } while (cursor.consume(','));
+    return cursor.consume('}');
+  }
+}
+
+DecodeResult decodeSensor(const uint8_t *payload, size_t length, DeviceData &data)
+{
+  if (payload == NULL)
+  {
+    return DECODE_INVALID;
+  }
+  Cursor cursor = {(const char *)payload, (const char *)payload + length};
+  uint32_t found = 0;
+  if (!decodeObject(cursor, rootFields, ROOT_FIELD_COUNT, 0, found, data, true))
+  {
+    return DECODE_INVALID;
+  }
+  return found == ALL_FIELDS ? DECODE_OK : DECODE_INCOMPLETE;
+}
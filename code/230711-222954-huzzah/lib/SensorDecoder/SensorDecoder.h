@@ -0,0 +1,40 @@
+#ifndef SENSOR_DECODER_H
+#define SENSOR_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Length of a Tasmota timestamp, "2023-07-11T22:29:54"
+#define TIMESTAMP_LENGTH 19
+
+// Latest readings of one plug. Plain old data: fixed-width timestamps, no
+// String members, so records can be copied and queued without the heap.
+struct DeviceData
+{
+  unsigned long lastUpdated;
+  int power;
+  float today;
+  float yesterday;
+  double total; // a counter that reaches thousands of kWh, kept to the Wh
+  char time[TIMESTAMP_LENGTH + 1];      // "Time", local time as sent by Tasmota
+  char startDate[TIMESTAMP_LENGTH + 2]; // "ENERGY.TotalStartTime" in Zulu format
+};
+
+enum DecodeResult
+{
+  DECODE_OK,         // All schema fields were found
+  DECODE_INCOMPLETE, // Valid JSON, some schema fields were missing
+  DECODE_INVALID     // Not a JSON object, or malformed
+};
+
+const char *decodeResultString(DecodeResult result);
+
+// Decode a Tasmota SENSOR message
+//   {"Time":"...","ENERGY":{"TotalStartTime":"...","Total":1.2,"Yesterday":0.3,
+//    "Today":0.1,"Power":12,...}}
+// straight from the MQTT buffer into `data`. The payload does not need to be
+// NUL-terminated and is not modified; nothing is allocated. Fields outside
+// the schema are skipped. Fields that are missing keep their previous value.
+DecodeResult decodeSensor(const uint8_t *payload, size_t length, DeviceData &data);
+
+#endif
@@ -0,0 +1,570 @@
+#include "Spool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Frame layout, little endian:
+//   0  magic
+//   1  type
+//   2  payload length (2 bytes)
+//   4  sequence number (4 bytes): record number, acknowledged record number,
+//      or segment number for the segment header
+//   8  CRC-32 of bytes 1..7 and the payload (4 bytes)
+//  12  payload
+#define FRAME_MAGIC 0xA5
+#define FRAME_HEADER_SIZE 12
+
+#define FRAME_SEGMENT 1 // First frame of a segment, payload is firstSeq
+#define FRAME_RECORD 2
+#define FRAME_ACK 3
+
+static void put16(uint8_t *p, uint16_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// CRC-32 (IEEE), one nibble at a time to keep the table small
+uint32_t spoolCrc32(const void *data, size_t length, uint32_t crc)
+{
+  static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc = table[(crc ^ p[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (p[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+static uint32_t frameCrc(const uint8_t *header, const uint8_t *payload, size_t length)
+{
+  return spoolCrc32(payload, length, spoolCrc32(header + 1, 7));
+}
+
+Spool::Spool(SpoolFs &fs, const char *directory, size_t segmentSize, size_t maxSegments)
+    : _fs(fs), _directory(directory), _segmentSize(segmentSize), _maxSegments(maxSegments)
+{
+  if (_maxSegments < 2 || _maxSegments > SPOOL_MAX_SEGMENTS)
+  {
+    _maxSegments = SPOOL_MAX_SEGMENTS;
+  }
+  if (_segmentSize < 2 * (FRAME_HEADER_SIZE + SPOOL_RECORD_SIZE))
+  {
+    _segmentSize = 2 * (FRAME_HEADER_SIZE + SPOOL_RECORD_SIZE);
+  }
+  _first = 0;
+  _count = 0;
+  _nextNumber = 0;
+  _lastSeq = 0;
+  _ackedSeq = 0;
+  _readSeq = 0;
+  _readSegment = 0;
+  _readOffset = 0;
+  _ackSegment = 0;
+  _ackOffset = 0;
+  _readerOpen = false;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool Spool::begin()
+{
+  closeReader();
+  _first = 0;
+  _count = 0;
+  _nextNumber = 0;
+  _lastSeq = 0;
+  _ackedSeq = 0;
+
+  // Collect the segments, the slot of a file does not tell its age
+  Segment found[SPOOL_MAX_SEGMENTS];
+  size_t foundCount = 0;
+  bool ok = true;
+  for (size_t slot = 0; slot < _maxSegments; slot++)
+  {
+    char name[SPOOL_PATH_SIZE];
+    path(slot, name);
+    if (!_fs.existed(name))
+    {
+      continue;
+    }
+    Segment segment;
+    if (scan(slot, segment))
+    {
+      found[foundCount++] = segment;
+    }
+    else if (!_fs.remove(name))
+    {
+      _stats.failures++;
+      ok = false;
+    }
+  }
+
+  // Insertion sort by segment number
+  for (size_t i = 1; i < foundCount; i++)
+  {
+    Segment segment = found[i];
+    size_t j = i;
+    for (; j > 0 && found[j - 1].number > segment.number; j--)
+    {
+      found[j] = found[j - 1];
+    }
+    found[j] = segment;
+  }
+
+  for (size_t i = 0; i < foundCount; i++)
+  {
+    // Only the newest segment takes appends
+    if (i + 1 < foundCount)
+    {
+      found[i].sealed = true;
+    }
+    _segments[i] = found[i];
+    if (found[i].lastSeq > _lastSeq)
+    {
+      _lastSeq = found[i].lastSeq;
+    }
+  }
+  _count = foundCount;
+
+  if (_count > 0)
+  {
+    _nextNumber = newest().number + 1;
+    // Records before the oldest segment were deleted with their segment
+    if (_ackedSeq < segmentAt(0).firstSeq)
+    {
+      _ackedSeq = segmentAt(0).firstSeq;
+    }
+    if (_ackedSeq > _lastSeq)
+    {
+      _ackedSeq = _lastSeq;
+    }
+    _ackSegment = segmentAt(0).number;
+  }
+  else
+  {
+    _ackSegment = _nextNumber;
+  }
+  _ackOffset = 0;
+  _readSeq = _ackedSeq;
+  _readSegment = _ackSegment;
+  _readOffset = _ackOffset;
+
+  compact();
+  return ok;
+}
+
+bool Spool::append(const void *record, size_t length)
+{
+  if (length == 0 || length > SPOOL_RECORD_SIZE)
+  {
+    return false;
+  }
+  closeReader();
+
+  if (_count == 0 || newest().sealed || newest().size + FRAME_HEADER_SIZE + length > _segmentSize)
+  {
+    if (!startSegment())
+    {
+      return false;
+    }
+  }
+  if (!writeFrame(FRAME_RECORD, _lastSeq + 1, record, length))
+  {
+    return false;
+  }
+  _lastSeq++;
+  newest().lastSeq = _lastSeq;
+  _stats.appended++;
+  return true;
+}
+
+size_t Spool::next(void *buffer, size_t size)
+{
+  while (_readSeq < _lastSeq && _count > 0)
+  {
+    Segment *segment = find(_readSegment);
+    if (segment == NULL)
+    {
+      // The segment was deleted, continue with the oldest one left
+      closeReader();
+      if (_readSegment > newest().number)
+      {
+        return 0;
+      }
+      _readSegment = segmentAt(0).number;
+      _readOffset = 0;
+      continue;
+    }
+    if (_readOffset >= segment->size)
+    {
+      closeReader();
+      if (segment == &newest())
+      {
+        return 0;
+      }
+      _readSegment++;
+      _readOffset = 0;
+      continue;
+    }
+
+    char name[SPOOL_PATH_SIZE];
+    if (!_readerOpen)
+    {
+      path(segment->number, name);
+      if (_fs.open(name, SPOOL_OPEN_READ) < 0 || !_fs.seek(_readOffset))
+      {
+        _fs.close();
+        _stats.failures++;
+        return 0;
+      }
+      _readerOpen = true;
+    }
+
+    uint8_t header[FRAME_HEADER_SIZE];
+    uint8_t payload[SPOOL_RECORD_SIZE];
+    size_t length = 0;
+    bool valid = _fs.read(header, FRAME_HEADER_SIZE) == FRAME_HEADER_SIZE && header[0] == FRAME_MAGIC;
+    if (valid)
+    {
+      length = get16(header + 2);
+      valid = length <= SPOOL_RECORD_SIZE && _readOffset + FRAME_HEADER_SIZE + length <= segment->size &&
+              (length == 0 || _fs.read(payload, length) == (int)length) &&
+              frameCrc(header, payload, length) == get32(header + 8);
+    }
+    if (!valid)
+    {
+      // The frame went bad after begin() checked it, skip the rest of the segment
+      // and count its remaining records as lost.
+      _stats.corrupted++;
+      segment->size = _readOffset;
+      segment->sealed = true;
+      if (segment->lastSeq > _readSeq)
+      {
+        _stats.dropped += segment->lastSeq - _readSeq;
+        _readSeq = segment->lastSeq;
+      }
+      continue;
+    }
+
+    uint32_t seq = get32(header + 4);
+    if (header[1] != FRAME_RECORD || seq <= _readSeq)
+    {
+      _readOffset += FRAME_HEADER_SIZE + length;
+      continue;
+    }
+    if (length > size)
+    {
+      // Leave the cursor on the record so a larger buffer can read it
+      closeReader();
+      return 0;
+    }
+    _readOffset += FRAME_HEADER_SIZE + length;
+    memcpy(buffer, payload, length);
+    _readSeq = seq;
+    _stats.replayed++;
+    return length;
+  }
+  return 0;
+}
+
+bool Spool::ack()
+{
+  if (_readSeq <= _ackedSeq)
+  {
+    return true;
+  }
+  closeReader();
+
+  bool written = true;
+  if (_count == 0 || newest().sealed || newest().size + FRAME_HEADER_SIZE > _segmentSize)
+  {
+    written = startSegment();
+  }
+  written = written && writeFrame(FRAME_ACK, _readSeq, NULL, 0);
+
+  // The records were uploaded even if the ack did not reach the flash, in
+  // which case they are sent again after a restart.
+  _stats.acked += _readSeq - _ackedSeq;
+  _ackedSeq = _readSeq;
+  _ackSegment = _readSegment;
+  _ackOffset = _readOffset;
+  compact();
+  return written;
+}
+
+void Spool::rewind()
+{
+  closeReader();
+  _readSeq = _ackedSeq;
+  _readSegment = _ackSegment;
+  _readOffset = _ackOffset;
+}
+
+size_t Spool::bytesUsed() const
+{
+  size_t bytes = 0;
+  for (size_t i = 0; i < _count; i++)
+  {
+    bytes += _segments[(_first + i) % SPOOL_MAX_SEGMENTS].size;
+  }
+  return bytes;
+}
+
+// Read the frames of the segment in `slot`, stopping at the first bad one
+bool Spool::scan(size_t slot, Segment &segment)
+{
+  char name[SPOOL_PATH_SIZE];
+  path(slot, name);
+  int fileSize = _fs.open(name, SPOOL_OPEN_READ);
+  if (fileSize < FRAME_HEADER_SIZE)
+  {
+    _fs.close();
+    return false;
+  }
+
+  uint8_t header[FRAME_HEADER_SIZE];
+  uint8_t payload[SPOOL_RECORD_SIZE];
+  uint32_t offset = 0;
+  uint32_t ackedSeq = 0;
+  while (offset + FRAME_HEADER_SIZE <= (uint32_t)fileSize)
+  {
+    if (_fs.read(header, FRAME_HEADER_SIZE) != FRAME_HEADER_SIZE || header[0] != FRAME_MAGIC)
+    {
+      break;
+    }
+    size_t length = get16(header + 2);
+    if (length > SPOOL_RECORD_SIZE || offset + FRAME_HEADER_SIZE + length > (uint32_t)fileSize ||
+        (length > 0 && _fs.read(payload, length) != (int)length) ||
+        frameCrc(header, payload, length) != get32(header + 8))
+    {
+      break;
+    }
+
+    uint32_t seq = get32(header + 4);
+    if (offset == 0)
+    {
+      if (header[1] != FRAME_SEGMENT || length != 4 || seq % _maxSegments != slot)
+      {
+        break;
+      }
+      segment.number = seq;
+      segment.firstSeq = get32(payload);
+      segment.lastSeq = segment.firstSeq;
+    }
+    else if (header[1] == FRAME_RECORD)
+    {
+      // Records are numbered without gaps
+      if (seq != segment.lastSeq + 1)
+      {
+        break;
+      }
+      segment.lastSeq = seq;
+    }
+    else if (header[1] == FRAME_ACK)
+    {
+      if (seq > ackedSeq)
+      {
+        ackedSeq = seq;
+      }
+    }
+    offset += FRAME_HEADER_SIZE + length;
+  }
+  _fs.close();
+
+  if (offset == 0)
+  {
+    _stats.corrupted++;
+    return false;
+  }
+  if (ackedSeq > _ackedSeq)
+  {
+    _ackedSeq = ackedSeq;
+  }
+  segment.size = offset;
+  // A torn or damaged tail is left alone, appends go to a new segment
+  segment.sealed = offset < (uint32_t)fileSize || offset >= _segmentSize;
+  if (offset < (uint32_t)fileSize)
+  {
+    _stats.corrupted++;
+  }
+  return true;
+}
+
+bool Spool::startSegment()
+{
+  if (_count > 0)
+  {
+    newest().sealed = true;
+  }
+  if (_count >= _maxSegments)
+  {
+    dropOldest();
+  }
+
+  Segment &segment = _segments[(_first + _count) % SPOOL_MAX_SEGMENTS];
+  segment.number = _nextNumber++;
+  segment.firstSeq = _lastSeq;
+  segment.lastSeq = _lastSeq;
+  segment.size = 0;
+  segment.sealed = false;
+  _count++;
+
+  // The slot may still hold a file from before a crash
+  char name[SPOOL_PATH_SIZE];
+  path(segment.number, name);
+  uint8_t firstSeq[4];
+  put32(firstSeq, _lastSeq);
+  if (!_fs.remove(name) || !writeFrame(FRAME_SEGMENT, segment.number, firstSeq, sizeof(firstSeq)))
+  {
+    _stats.failures++;
+    _count--;
+    return false;
+  }
+  return true;
+}
+
+// Delete the oldest segment to make room, with its unacknowledged records
+void Spool::dropOldest()
+{
+  Segment &oldest = segmentAt(0);
+  closeReader();
+  if (oldest.lastSeq > _ackedSeq)
+  {
+    uint32_t from = _ackedSeq > oldest.firstSeq ? _ackedSeq : oldest.firstSeq;
+    _stats.dropped += oldest.lastSeq - from;
+    _ackedSeq = oldest.lastSeq;
+  }
+  if (_readSeq < oldest.lastSeq)
+  {
+    _readSeq = oldest.lastSeq;
+  }
+  if (_readSegment <= oldest.number)
+  {
+    _readSegment = oldest.number + 1;
+    _readOffset = 0;
+  }
+  if (_ackSegment <= oldest.number)
+  {
+    _ackSegment = oldest.number + 1;
+    _ackOffset = 0;
+  }
+
+  char name[SPOOL_PATH_SIZE];
+  path(oldest.number, name);
+  if (!_fs.remove(name))
+  {
+    _stats.failures++;
+  }
+  _first = (_first + 1) % SPOOL_MAX_SEGMENTS;
+  _count--;
+}
+
+// Delete the segments whose records are all acknowledged. The newest segment
+// stays, it carries the segment number across restarts.
+void Spool::compact()
+{
+  while (_count > 1 && segmentAt(0).lastSeq <= _ackedSeq)
+  {
+    Segment &oldest = segmentAt(0);
+    if (_readerOpen && _readSegment == oldest.number)
+    {
+      closeReader();
+    }
+    char name[SPOOL_PATH_SIZE];
+    path(oldest.number, name);
+    if (!_fs.remove(name))
+    {
+      _stats.failures++;
+      return;
+    }
+    if (_ackSegment <= oldest.number)
+    {
+      _ackSegment = oldest.number + 1;
+      _ackOffset = 0;
+    }
+    if (_readSegment <= oldest.number)
+    {
+      _readSegment = oldest.number + 1;
+      _readOffset = 0;
+    }
+    _first = (_first + 1) % SPOOL_MAX_SEGMENTS;
+    _count--;
+  }
+}
+
+// Append one frame to the newest segment
+bool Spool::writeFrame(uint8_t type, uint32_t seq, const void *payload, size_t length)
+{
+  uint8_t frame[FRAME_HEADER_SIZE + SPOOL_RECORD_SIZE];
+  frame[0] = FRAME_MAGIC;
+  frame[1] = type;
+  put16(frame + 2, (uint16_t)length);
+  put32(frame + 4, seq);
+  if (length > 0)
+  {
+    memcpy(frame + FRAME_HEADER_SIZE, payload, length);
+  }
+  put32(frame + 8, frameCrc(frame, frame + FRAME_HEADER_SIZE, length));
+
+  Segment &segment = newest();
+  char name[SPOOL_PATH_SIZE];
+  path(segment.number, name);
+  size_t total = FRAME_HEADER_SIZE + length;
+  bool written = _fs.open(name, SPOOL_OPEN_APPEND) >= 0 && _fs.write(frame, total) == (int)total;
+  // Closing commits the data to flash
+  _fs.close();
+  if (!written)
+  {
+    // Part of the frame may be on flash, never append after it
+    segment.sealed = true;
+    _stats.failures++;
+    return false;
+  }
+  segment.size += total;
+  return true;
+}
+
+void Spool::closeReader()
+{
+  if (_readerOpen)
+  {
+    _fs.close();
+    _readerOpen = false;
+  }
+}
+
+void Spool::path(uint32_t number, char *buffer) const
+{
+  snprintf(buffer, SPOOL_PATH_SIZE, "%s/seg%u", _directory, (unsigned)(number % _maxSegments));
+}
+
+Spool::Segment *Spool::find(uint32_t number)
+{
+  if (_count == 0 || number < segmentAt(0).number || number > newest().number)
+  {
+    return NULL;
+  }
+  return &segmentAt(number - segmentAt(0).number);
+}
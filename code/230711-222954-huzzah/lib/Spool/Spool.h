@@ -0,0 +1,148 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Most segment files a spool may use, the size of its segment table. Bounds
+// the flash used to SPOOL_MAX_SEGMENTS * segment size.
+#ifndef SPOOL_MAX_SEGMENTS
+#define SPOOL_MAX_SEGMENTS 32
+#endif
+
+#ifndef SPOOL_SEGMENT_SIZE
+#define SPOOL_SEGMENT_SIZE 16384
+#endif
+
+// Largest record accepted by append()
+#define SPOOL_RECORD_SIZE 255
+
+#define SPOOL_PATH_SIZE 32
+
+enum SpoolOpenMode
+{
+  SPOOL_OPEN_READ,
+  SPOOL_OPEN_APPEND
+};
+
+// The few file operations the spool needs, modelled on MB_FS from the
+// Firebase client. Only one file is open at a time, as with MB_FS. The device
+// implementation wraps MB_FS on the flash file system, the host tests use
+// plain files.
+class SpoolFs
+{
+public:
+  virtual ~SpoolFs() {}
+  // Returns the size of the file, or a negative value on error
+  virtual int open(const char *path, SpoolOpenMode mode) = 0;
+  virtual int read(uint8_t *buffer, size_t length) = 0;
+  virtual int write(const uint8_t *buffer, size_t length) = 0;
+  virtual bool seek(size_t position) = 0;
+  virtual void close() = 0;
+  virtual bool existed(const char *path) = 0;
+  virtual bool remove(const char *path) = 0;
+};
+
+struct SpoolStats
+{
+  uint32_t appended;  // Records written
+  uint32_t replayed;  // Records handed out by next()
+  uint32_t acked;     // Records acknowledged
+  uint32_t dropped;   // Unacknowledged records lost to the size limit
+  uint32_t corrupted; // Frames that failed the length or CRC check
+  uint32_t failures;  // File operations that failed
+};
+
+// Persistent append-only queue of upload records on flash.
+//
+// Records are stored in segment files as frames of a 12 byte header (magic,
+// type, length, sequence number and CRC-32) and the payload. Acknowledgements
+// are frames as well, so nothing is ever rewritten in place. A new segment is
+// started once the current one is full, cycling through SPOOL_MAX_SEGMENTS
+// file names so the writes spread over the flash.
+//
+// begin() rebuilds the state from the files: frames are read up to the first
+// bad one in each segment, and a segment with a torn tail gets no further
+// appends. Segments whose records are all acknowledged are deleted. When all
+// segments are in use the oldest one is deleted to make room, losing its
+// unacknowledged records.
+//
+// next() reads records in order without consuming them; ack() makes the
+// records read so far permanent, rewind() goes back to the last ack() so a
+// batch that failed to upload is read again.
+class Spool
+{
+public:
+  explicit Spool(SpoolFs &fs, const char *directory = "/spool", size_t segmentSize = SPOOL_SEGMENT_SIZE,
+                 size_t maxSegments = SPOOL_MAX_SEGMENTS);
+
+  // Recover the spool from flash. Returns false if the files cannot be read.
+  bool begin();
+
+  bool append(const void *record, size_t length);
+
+  // Copy the next record into `buffer`. Returns its length, or 0 if there is
+  // no record left or it does not fit.
+  size_t next(void *buffer, size_t size);
+
+  // Acknowledge the records returned by next()
+  bool ack();
+
+  // Read the unacknowledged records again
+  void rewind();
+
+  // Records appended but not acknowledged
+  size_t pending() const { return (size_t)(_lastSeq - _ackedSeq); }
+  bool empty() const { return _lastSeq == _ackedSeq; }
+
+  // Bytes used by the segment files
+  size_t bytesUsed() const;
+  size_t segments() const { return _count; }
+
+  const SpoolStats &stats() const { return _stats; }
+
+private:
+  struct Segment
+  {
+    uint32_t number;   // Increases by one per new segment
+    uint32_t firstSeq; // Sequence number before the first record
+    uint32_t lastSeq;  // Sequence number of the last record
+    uint32_t size;     // Bytes of valid frames
+    bool sealed;       // No more appends, e.g. after a torn write
+  };
+
+  bool scan(size_t slot, Segment &segment);
+  bool startSegment();
+  void dropOldest();
+  void compact();
+  bool writeFrame(uint8_t type, uint32_t seq, const void *payload, size_t length);
+  void closeReader();
+  void path(uint32_t number, char *buffer) const;
+  Segment *find(uint32_t number);
+  Segment &segmentAt(size_t index) { return _segments[(_first + index) % SPOOL_MAX_SEGMENTS]; }
+  Segment &newest() { return segmentAt(_count - 1); }
+
+  SpoolFs &_fs;
+  const char *_directory;
+  size_t _segmentSize;
+  size_t _maxSegments;
+  Segment _segments[SPOOL_MAX_SEGMENTS]; // Ring ordered by number
+  size_t _first;
+  size_t _count;
+  uint32_t _nextNumber;
+  uint32_t _lastSeq;  // Last record appended
+  uint32_t _ackedSeq; // Last record acknowledged
+  uint32_t _readSeq;  // Last record returned by next()
+  // Read cursor: segment number and offset of the next frame
+  uint32_t _readSegment;
+  uint32_t _readOffset;
+  // Where the reader restarts after rewind()
+  uint32_t _ackSegment;
+  uint32_t _ackOffset;
+  bool _readerOpen;
+  SpoolStats _stats;
+};
+
+uint32_t spoolCrc32(const void *data, size_t length, uint32_t crc = 0);
+
+#endif
@@ -0,0 +1,439 @@
+#include "Broker.h"
+
+#include "Heap.h"
+#include "SimClock.h"
+
+#include <math.h>
+
+// Cost of a socket call that finds nothing to read
+#define EMPTY_POLL_US 5
+
+static BrokerConfig config = {24, 10000000, 0, 20000, 1, {}};
+static BrokerStats counters = {};
+static std::function<void(const char *, int)> publishListener;
+
+static uint32_t hash(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352d;
+  x ^= x >> 15;
+  x *= 0x846ca68b;
+  x ^= x >> 16;
+  return x;
+}
+
+static std::string plugName(int plug)
+{
+  char name[16];
+  snprintf(name, sizeof(name), "plug%02d", plug);
+  return name;
+}
+
+static void formatTime(time_t at, char *buffer, size_t size)
+{
+  struct tm info;
+  gmtime_r(&at, &info);
+  strftime(buffer, size, "%Y-%m-%dT%H:%M:%S", &info);
+}
+
+void BrokerClient::configure(const BrokerConfig &brokerConfig)
+{
+  sim::HostScope host;
+  config = brokerConfig;
+  for (size_t i = 0; i < config.replay.size(); i++)
+  {
+    config.plugs = std::max(config.plugs, config.replay[i].devices);
+  }
+}
+
+void BrokerClient::onPublish(std::function<void(const char *plug, int power)> listener)
+{
+  sim::HostScope host;
+  publishListener = listener;
+}
+
+bool BrokerClient::loadReplay(const char *path, std::vector<ReplayRow> &rows)
+{
+  sim::HostScope host;
+  FILE *file = fopen(path, "r");
+  if (!file)
+  {
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), file))
+  {
+    // Skip the id, rows that do not parse (the header) are ignored
+    const char *fields = strchr(line, ',');
+    ReplayRow row;
+    if (fields && sscanf(fields, ",%d,%d", &row.devices, &row.power) == 2 && row.devices > 0)
+    {
+      rows.push_back(row);
+    }
+  }
+  fclose(file);
+  return !rows.empty();
+}
+
+const BrokerStats &BrokerClient::stats()
+{
+  return counters;
+}
+
+BrokerClient::BrokerClient()
+    : _connected(false), _subscribed(false), _keepAlive(0), _lastHeard(0), _nextMessage(0), _message(0), _row(0),
+      _rowPlug(0), _offset(0), _backlog(0)
+{
+}
+
+int BrokerClient::connect(IPAddress ip, uint16_t port)
+{
+  return connect("", port);
+}
+
+int BrokerClient::connect(const char *host, uint16_t port)
+{
+  sim::HostScope scope;
+  // A TCP handshake over the internet
+  sim::sleep(config.networkDelay * 2);
+  if (_today.empty())
+  {
+    _today.assign(config.plugs, 0);
+    _yesterday.assign(config.plugs, 0);
+    _total.assign(config.plugs, 0);
+    _lastReading.assign(config.plugs, sim::micros());
+    _day.assign(config.plugs, sim::now() / 86400);
+    for (int i = 0; i < config.plugs; i++)
+    {
+      _total[i] = 50 + hash(config.seed + i) % 500;
+      _yesterday[i] = (hash(config.seed * 31 + i) % 3000) / 1000.0;
+    }
+    _nextMessage = sim::micros();
+  }
+  endSession();
+  _connected = true;
+  _keepAlive = 0;
+  _lastHeard = sim::micros();
+  counters.connects++;
+  return 1;
+}
+
+size_t BrokerClient::write(uint8_t b)
+{
+  return write(&b, 1);
+}
+
+// Parse whole packets out of what the client sent
+size_t BrokerClient::write(const uint8_t *buf, size_t size)
+{
+  sim::HostScope host;
+  advance();
+  if (!_connected)
+  {
+    return 0;
+  }
+  _lastHeard = sim::micros();
+  _inbound.append((const char *)buf, size);
+  while (_inbound.size() >= 2)
+  {
+    size_t length = 0;
+    size_t header = 1;
+    int shift = 0;
+    uint8_t digit;
+    do
+    {
+      if (header >= _inbound.size())
+      {
+        return size;
+      }
+      digit = (uint8_t)_inbound[header++];
+      length |= (size_t)(digit & 0x7F) << shift;
+      shift += 7;
+    } while (digit & 0x80);
+    if (_inbound.size() < header + length)
+    {
+      return size;
+    }
+    handle((uint8_t)_inbound[0] & 0xF0, (const uint8_t *)_inbound.data() + header, length);
+    _inbound.erase(0, header + length);
+  }
+  return size;
+}
+
+void BrokerClient::handle(uint8_t type, const uint8_t *body, size_t length)
+{
+  switch (type)
+  {
+  case 0x10: // CONNECT
+  {
+    size_t nameLength = length >= 2 ? (body[0] << 8) | body[1] : 0;
+    size_t at = 2 + nameLength + 2;
+    if (at + 2 <= length)
+    {
+      _keepAlive = (uint64_t)((body[at] << 8) | body[at + 1]) * 1000000;
+    }
+    send(0x20, std::string("\x00\x00", 2), config.networkDelay);
+    break;
+  }
+  case 0x80: // SUBSCRIBE, every filter granted at QoS 0
+  {
+    std::string ack((const char *)body, 2);
+    for (size_t at = 2; at + 2 <= length;)
+    {
+      at += 2 + ((body[at] << 8) | body[at + 1]) + 1;
+      ack += '\0';
+    }
+    send(0x90, ack, config.networkDelay);
+    if (!_subscribed)
+    {
+      _subscribed = true;
+      for (int i = 0; i < config.plugs; i++)
+      {
+        publish(BROKER_TOPIC_PREFIX + plugName(i) + "/LWT", "Online", true);
+      }
+    }
+    break;
+  }
+  case 0xC0: // PINGREQ
+    counters.pings++;
+    send(0xD0, "", config.networkDelay);
+    break;
+  case 0xE0: // DISCONNECT
+    _connected = false;
+    break;
+  default: // PUBLISH and the rest are accepted and ignored
+    break;
+  }
+}
+
+void BrokerClient::send(uint8_t header, const std::string &body, uint64_t delay, bool reading)
+{
+  Packet packet;
+  packet.at = sim::micros() + delay;
+  packet.reading = reading;
+  packet.bytes += (char)header;
+  size_t length = body.size();
+  do
+  {
+    uint8_t digit = length & 0x7F;
+    length >>= 7;
+    packet.bytes += (char)(length ? digit | 0x80 : digit);
+  } while (length);
+  packet.bytes += body;
+  _backlog += packet.bytes.size();
+  counters.maxBacklog = std::max(counters.maxBacklog, _backlog);
+  _outbound.push_back(packet);
+}
+
+void BrokerClient::publish(const std::string &topic, const std::string &payload, bool retained)
+{
+  std::string body;
+  body += (char)(topic.size() >> 8);
+  body += (char)(topic.size() & 0xFF);
+  body += topic;
+  body += payload;
+  send(retained ? 0x31 : 0x30, body, config.networkDelay);
+  counters.delivered++;
+}
+
+// Messages still in the socket are lost with the session
+void BrokerClient::endSession()
+{
+  for (size_t i = 0; i < _outbound.size(); i++)
+  {
+    counters.dropped += _outbound[i].reading;
+  }
+  _connected = false;
+  _subscribed = false;
+  _inbound.clear();
+  _outbound.clear();
+  _offset = 0;
+  _backlog = 0;
+}
+
+// Produce the plug messages due by now and enforce the keepalive
+void BrokerClient::advance()
+{
+  if (_today.empty())
+  {
+    return;
+  }
+  uint64_t now = sim::micros();
+  if (_connected && _keepAlive && now - _lastHeard > _keepAlive * 3 / 2)
+  {
+    endSession();
+    counters.disconnects++;
+  }
+
+  uint64_t spacing = config.rate > 0 ? (uint64_t)(1e6 / config.rate) : config.period / config.plugs;
+  spacing = std::max<uint64_t>(spacing, 1);
+  while (_nextMessage <= now)
+  {
+    time_t at = sim::epoch() + (time_t)(_nextMessage / 1000000);
+    int power;
+    int plug = nextPlug(power);
+    if (power < 0)
+    {
+      power = modelPower(plug, at);
+    }
+    std::string payload = reading(plug, power, at);
+    counters.published++;
+    if (publishListener)
+    {
+      publishListener(plugName(plug).c_str(), power);
+    }
+    if (_connected && _subscribed)
+    {
+      uint64_t lag = _nextMessage + config.networkDelay > now ? _nextMessage + config.networkDelay - now : 0;
+      std::string topic = BROKER_TOPIC_PREFIX + plugName(plug) + "/SENSOR";
+      std::string body;
+      body += (char)(topic.size() >> 8);
+      body += (char)(topic.size() & 0xFF);
+      body += topic;
+      body += payload;
+      send(0x30, body, lag, true);
+      counters.delivered++;
+    }
+    else
+    {
+      counters.missed++;
+    }
+    _message++;
+    _nextMessage += spacing;
+  }
+}
+
+// Plug sending the next message. `power` is its share of the replayed row,
+// or -1 without replay.
+int BrokerClient::nextPlug(int &power)
+{
+  if (config.replay.empty())
+  {
+    power = -1;
+    return (int)(_message % config.plugs);
+  }
+  const ReplayRow &row = config.replay[_row];
+  int plug = _rowPlug;
+  power = row.power / row.devices + (plug < row.power % row.devices ? 1 : 0);
+  if (++_rowPlug >= row.devices)
+  {
+    _rowPlug = 0;
+    _row = (_row + 1) % config.replay.size();
+  }
+  return plug;
+}
+
+// Office load: a base, a daytime hump and some noise
+int BrokerClient::modelPower(int plug, time_t at)
+{
+  struct tm info;
+  gmtime_r(&at, &info);
+  double hour = info.tm_hour + info.tm_min / 60.0;
+  double base = 5 + hash(config.seed + plug * 7) % 40;
+  double daytime = hour > 7 && hour < 20 ? sin((hour - 7) / 13 * M_PI) : 0;
+  int noise = (int)(hash(config.seed ^ (uint32_t)(_message * 2654435761u)) % 21) - 10;
+  return std::max(0, (int)(base + daytime * (40 + plug * 5) + noise));
+}
+
+// Tasmota ENERGY reading of a plug, advancing its counters to `at`
+std::string BrokerClient::reading(int plug, int power, time_t at)
+{
+  uint64_t now = _nextMessage;
+  double hours = (now - _lastReading[plug]) / 3600e6;
+  _lastReading[plug] = now;
+
+  // Tasmota moves Today to Yesterday at midnight
+  if (at / 86400 != _day[plug])
+  {
+    _day[plug] = at / 86400;
+    _yesterday[plug] = _today[plug];
+    _today[plug] = 0;
+  }
+  double energy = power * hours / 1000;
+  _today[plug] += energy;
+  _total[plug] += energy;
+
+  char time[24];
+  formatTime(at, time, sizeof(time));
+  char payload[320];
+  snprintf(payload, sizeof(payload),
+           "{\"Time\":\"%s\",\"ENERGY\":{\"TotalStartTime\":\"2023-01-05T10:11:12\",\"Total\":%.3f,"
+           "\"Yesterday\":%.3f,\"Today\":%.3f,\"Period\":%d,\"Power\":%d,\"ApparentPower\":%d,"
+           "\"ReactivePower\":%d,\"Factor\":0.92,\"Voltage\":240,\"Current\":%.3f}}",
+           time, _total[plug], _yesterday[plug], _today[plug], (int)(energy * 1000), power, power * 100 / 92,
+           power * 39 / 92, power / 240.0);
+  return payload;
+}
+
+// Bytes readable now. Only the first packet is counted, which keeps polling
+// cheap with a long backlog; the client only needs to know there is data.
+size_t BrokerClient::ready() const
+{
+  if (_outbound.empty() || _outbound.front().at > sim::micros())
+  {
+    return 0;
+  }
+  return _outbound.front().bytes.size() - _offset;
+}
+
+int BrokerClient::available()
+{
+  sim::HostScope host;
+  advance();
+  size_t bytes = _connected ? ready() : 0;
+  if (bytes == 0)
+  {
+    sim::sleep(EMPTY_POLL_US);
+  }
+  return (int)std::min<size_t>(bytes, 0x7FFFFFFF);
+}
+
+int BrokerClient::read()
+{
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int BrokerClient::read(uint8_t *buf, size_t size)
+{
+  sim::HostScope host;
+  uint64_t now = sim::micros();
+  size_t n = 0;
+  while (n < size && !_outbound.empty() && _outbound.front().at <= now)
+  {
+    const std::string &bytes = _outbound.front().bytes;
+    size_t chunk = std::min(size - n, bytes.size() - _offset);
+    memcpy(buf + n, bytes.data() + _offset, chunk);
+    n += chunk;
+    _offset += chunk;
+    if (_offset == bytes.size())
+    {
+      _outbound.pop_front();
+      _offset = 0;
+    }
+  }
+  _backlog -= n;
+  return n ? (int)n : -1;
+}
+
+int BrokerClient::peek()
+{
+  if (_outbound.empty() || _outbound.front().at > sim::micros())
+  {
+    return -1;
+  }
+  return (uint8_t)_outbound.front().bytes[_offset];
+}
+
+void BrokerClient::stop()
+{
+  sim::HostScope host;
+  endSession();
+}
+
+uint8_t BrokerClient::connected()
+{
+  sim::HostScope host;
+  advance();
+  return _connected;
+}
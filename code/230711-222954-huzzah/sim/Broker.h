@@ -0,0 +1,119 @@
+#ifndef SIM_BROKER_H
+#define SIM_BROKER_H
+
+#include "Arduino.h"
+#include "Client.h"
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define BROKER_TOPIC_PREFIX "UCL/OPS/107/EM/gosund/"
+
+// One minute of recorded traffic: the plugs online and their total power
+struct ReplayRow
+{
+  int devices;
+  int power;
+};
+
+struct BrokerConfig
+{
+  int plugs;             // Plugs publishing SENSOR messages
+  uint64_t period;       // Microseconds between two messages of a plug
+  double rate;           // Messages per second from all plugs, replaces `period` if set
+  uint64_t networkDelay; // Microseconds from publishing to the client's socket
+  uint32_t seed;         // Seed of the power noise
+  std::vector<ReplayRow> replay; // Recorded traffic to play instead of the daily curve
+};
+
+struct BrokerStats
+{
+  uint64_t connects;    // Sessions started
+  uint64_t disconnects; // Sessions dropped for a missed keepalive
+  uint64_t published;   // SENSOR messages published by the plugs
+  uint64_t delivered;   // Messages queued to the client, LWTs included
+  uint64_t missed;      // SENSOR messages published while not subscribed
+  uint64_t dropped;     // SENSOR messages unread in the socket when the session ended
+  uint64_t pings;       // PINGREQs answered
+  size_t maxBacklog;    // Most bytes waiting in the client's socket
+};
+
+// Simulated MQTT 3.1.1 broker with its Tasmota plugs, as seen through the
+// sketch's network client.
+//
+// The plugs publish ENERGY readings one after the other so each plug reports
+// once per period. Their power follows a daily curve with noise, and the
+// energy counters grow with it. The broker answers CONNECT, SUBSCRIBE and
+// PINGREQ, sends the retained "Online" LWT of every plug on subscribe and
+// drops a client it has not heard from for 1.5 keepalive intervals.
+//
+// With replay rows the plugs instead share the recorded power of one row per
+// round, cycling through the rows.
+//
+// Messages are produced lazily when the client polls the socket, so a run
+// costs no work between polls.
+class BrokerClient : public Client
+{
+public:
+  BrokerClient();
+
+  static void configure(const BrokerConfig &config);
+  static const BrokerStats &stats();
+  // Called for every SENSOR message a plug publishes
+  static void onPublish(std::function<void(const char *plug, int power)> listener);
+  // Read "id,devices,power,time" rows as exported from Firestore
+  static bool loadReplay(const char *path, std::vector<ReplayRow> &rows);
+
+  int connect(IPAddress ip, uint16_t port);
+  int connect(const char *host, uint16_t port);
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buf, size_t size);
+  int available();
+  int read();
+  int read(uint8_t *buf, size_t size);
+  int peek();
+  void flush() {}
+  void stop();
+  uint8_t connected();
+  operator bool() { return true; }
+
+private:
+  struct Packet
+  {
+    uint64_t at; // Virtual time it can be read
+    bool reading;
+    std::string bytes;
+  };
+
+  void advance();
+  void handle(uint8_t type, const uint8_t *body, size_t length);
+  void send(uint8_t header, const std::string &body, uint64_t delay, bool reading = false);
+  void publish(const std::string &topic, const std::string &payload, bool retained);
+  void endSession();
+  int nextPlug(int &power);
+  int modelPower(int plug, time_t at);
+  std::string reading(int plug, int power, time_t at);
+  size_t ready() const;
+
+  bool _connected;
+  bool _subscribed;
+  uint64_t _keepAlive;
+  uint64_t _lastHeard;
+  uint64_t _nextMessage;
+  uint64_t _message;
+  size_t _row;
+  int _rowPlug;
+  std::string _inbound;
+  std::deque<Packet> _outbound;
+  size_t _offset;
+  size_t _backlog;
+  std::vector<double> _today;
+  std::vector<double> _yesterday;
+  std::vector<double> _total;
+  std::vector<uint64_t> _lastReading;
+  std::vector<time_t> _day;
+};
+
+#endif
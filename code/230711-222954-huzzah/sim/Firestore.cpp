@@ -0,0 +1,378 @@
+#include "Firestore.h"
+
+#include "Heap.h"
+#include "SimClock.h"
+
+#include <ArduinoJson.h>
+
+#include <algorithm>
+
+#define FIRESTORE_NAME_PREFIX "projects/energycelab/databases/(default)/documents/"
+
+namespace sim
+{
+  Firestore &firestore()
+  {
+    static Firestore instance;
+    return instance;
+  }
+
+  Firestore::Firestore() : _latency(250000), _timeout(5000000), _nextId(0), _stats() {}
+
+  // Path without the leading and trailing slashes
+  static std::string normalize(const std::string &path)
+  {
+    size_t start = path.find_first_not_of('/');
+    size_t end = path.find_last_not_of('/');
+    return start == std::string::npos ? std::string() : path.substr(start, end - start + 1);
+  }
+
+  static size_t segments(const std::string &path)
+  {
+    return path.empty() ? 0 : 1 + std::count(path.begin(), path.end(), '/');
+  }
+
+  static std::string lastSegment(const std::string &path)
+  {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+  }
+
+  static std::string timestamp()
+  {
+    char buffer[40];
+    time_t now = sim::now();
+    struct tm info;
+    gmtime_r(&now, &info);
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &info);
+    snprintf(buffer + strlen(buffer), sizeof(buffer) - strlen(buffer), ".%06uZ",
+             (unsigned)(sim::micros() % 1000000));
+    return buffer;
+  }
+
+  static size_t capacityFor(size_t length)
+  {
+    return 1024 + length * 4;
+  }
+
+  // Firestore returns integers as strings
+  static void quoteIntegers(JsonVariant value)
+  {
+    if (value.is<JsonObject>())
+    {
+      for (JsonPair pair : value.as<JsonObject>())
+      {
+        if (strcmp(pair.key().c_str(), "integerValue") == 0 && pair.value().is<long long>())
+        {
+          pair.value().set(std::to_string(pair.value().as<long long>()));
+        }
+        else
+        {
+          quoteIntegers(pair.value());
+        }
+      }
+    }
+    else if (value.is<JsonArray>())
+    {
+      for (JsonVariant element : value.as<JsonArray>())
+      {
+        quoteIntegers(element);
+      }
+    }
+  }
+
+  void Firestore::onWrite(std::function<void(const std::string &path, const std::string &content)> listener)
+  {
+    HostScope host;
+    _writeListener = listener;
+  }
+
+  void Firestore::addOutage(uint64_t start, uint64_t duration)
+  {
+    HostScope host;
+    _outages.push_back(std::make_pair(start, start + duration));
+  }
+
+  bool Firestore::request()
+  {
+    HostScope host;
+    _stats.requests++;
+    uint64_t now = sim::micros();
+    for (size_t i = 0; i < _outages.size(); i++)
+    {
+      if (now >= _outages[i].first && now < _outages[i].second)
+      {
+        _stats.failed++;
+        _stats.busyMicros += _timeout;
+        sim::sleep(_timeout);
+        return false;
+      }
+    }
+    _stats.busyMicros += _latency;
+    sim::sleep(_latency);
+    return true;
+  }
+
+  int Firestore::get(const std::string &path, std::string &payload)
+  {
+    HostScope host;
+    if (!request())
+    {
+      return FIRESTORE_ERROR_READ_TIMEOUT;
+    }
+    std::map<std::string, Document>::const_iterator found = _documents.find(normalize(path));
+    if (found == _documents.end())
+    {
+      payload = "{\"error\":{\"code\":404,\"message\":\"Document not found\",\"status\":\"NOT_FOUND\"}}";
+      return 404;
+    }
+    payload = render(found->first, found->second);
+    return 200;
+  }
+
+  int Firestore::create(const std::string &path, const std::string &content, std::string &payload)
+  {
+    HostScope host;
+    if (!request())
+    {
+      return FIRESTORE_ERROR_READ_TIMEOUT;
+    }
+    std::string documentPath = normalize(path);
+    if (segments(documentPath) % 2 == 1)
+    {
+      char id[24];
+      snprintf(id, sizeof(id), "sim%017llu", (unsigned long long)++_nextId);
+      retain(documentPath, documentPath + "/" + id);
+      documentPath += "/";
+      documentPath += id;
+    }
+    else if (_documents.count(documentPath))
+    {
+      payload = "{\"error\":{\"code\":409,\"message\":\"Document already exists\",\"status\":\"ALREADY_EXISTS\"}}";
+      return 409;
+    }
+    if (!write(documentPath, content, ""))
+    {
+      payload = "{\"error\":{\"code\":400,\"message\":\"Invalid JSON payload\",\"status\":\"INVALID_ARGUMENT\"}}";
+      return 400;
+    }
+    payload = render(documentPath, _documents[documentPath]);
+    return 200;
+  }
+
+  int Firestore::patch(const std::string &path, const std::string &content, const std::string &mask,
+                       std::string &payload)
+  {
+    HostScope host;
+    if (!request())
+    {
+      return FIRESTORE_ERROR_READ_TIMEOUT;
+    }
+    std::string documentPath = normalize(path);
+    if (!write(documentPath, content, mask))
+    {
+      payload = "{\"error\":{\"code\":400,\"message\":\"Invalid JSON payload\",\"status\":\"INVALID_ARGUMENT\"}}";
+      return 400;
+    }
+    payload = render(documentPath, _documents[documentPath]);
+    return 200;
+  }
+
+  int Firestore::commit(const std::vector<FirestoreWrite> &writes, std::string &payload)
+  {
+    HostScope host;
+    if (!request())
+    {
+      return FIRESTORE_ERROR_READ_TIMEOUT;
+    }
+    std::string time = timestamp();
+    payload = "{\"writeResults\":[";
+    for (size_t i = 0; i < writes.size(); i++)
+    {
+      // Update writes create missing documents, so the document id is known
+      std::string documentPath = normalize(writes[i].path);
+      if (!_documents.count(documentPath))
+      {
+        size_t slash = documentPath.rfind('/');
+        retain(documentPath.substr(0, slash == std::string::npos ? 0 : slash), documentPath);
+      }
+      write(documentPath, writes[i].content, writes[i].mask);
+      payload += i ? ",{\"updateTime\":\"" : "{\"updateTime\":\"";
+      payload += time;
+      payload += "\"}";
+    }
+    payload += "],\"commitTime\":\"";
+    payload += time;
+    payload += "\"}";
+    _stats.commits++;
+    return 200;
+  }
+
+  int Firestore::runQuery(const std::string &parent, const std::string &query, std::string &payload)
+  {
+    HostScope host;
+    if (!request())
+    {
+      return FIRESTORE_ERROR_READ_TIMEOUT;
+    }
+    DynamicJsonDocument structured(capacityFor(query.size()));
+    if (deserializeJson(structured, query))
+    {
+      payload = "{\"error\":{\"code\":400,\"message\":\"Invalid JSON payload\",\"status\":\"INVALID_ARGUMENT\"}}";
+      return 400;
+    }
+    std::string collection = normalize(parent) + "/" + structured["from"]["collectionId"].as<std::string>();
+    std::string field = structured["orderBy"]["field"]["fieldPath"].as<std::string>();
+    bool descending = structured["orderBy"]["direction"] == "DESCENDING";
+    size_t limit = structured["limit"] | 0;
+
+    // Order on the text of the field's value, which suits timestamps
+    std::vector<std::pair<std::string, std::string> > matches;
+    std::string prefix = collection + "/";
+    for (std::map<std::string, Document>::const_iterator it = _documents.lower_bound(prefix);
+         it != _documents.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+    {
+      if (it->first.find('/', prefix.size()) != std::string::npos)
+      {
+        continue;
+      }
+      std::string key;
+      if (!field.empty())
+      {
+        DynamicJsonDocument fields(capacityFor(it->second.fields.size()));
+        deserializeJson(fields, it->second.fields);
+        for (JsonPair value : fields[field].as<JsonObject>())
+        {
+          serializeJson(value.value(), key);
+        }
+      }
+      matches.push_back(std::make_pair(key, it->first));
+    }
+    std::stable_sort(matches.begin(), matches.end());
+    if (descending)
+    {
+      std::reverse(matches.begin(), matches.end());
+    }
+    if (limit && matches.size() > limit)
+    {
+      matches.resize(limit);
+    }
+
+    std::string time = timestamp();
+    payload = "[";
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+      payload += i ? ",{\"document\":" : "{\"document\":";
+      payload += render(matches[i].second, _documents[matches[i].second]);
+      payload += ",\"readTime\":\"" + time + "\"}";
+    }
+    if (matches.empty())
+    {
+      payload += "{\"readTime\":\"" + time + "\"}";
+    }
+    payload += "]";
+    return 200;
+  }
+
+  uint64_t Firestore::created(const std::string &collectionId) const
+  {
+    std::map<std::string, uint64_t>::const_iterator found = _createdByCollectionId.find(collectionId);
+    return found == _createdByCollectionId.end() ? 0 : found->second;
+  }
+
+  std::string Firestore::reason(int code, const std::string &payload)
+  {
+    switch (code)
+    {
+    case FIRESTORE_ERROR_READ_TIMEOUT:
+      return "response payload read timed out";
+    case FIRESTORE_ERROR_CONNECTION_LOST:
+      return "connection lost";
+    default:
+      return payload;
+    }
+  }
+
+  // Apply `content` to the document: all fields, or only those in `mask`
+  bool Firestore::write(const std::string &path, const std::string &content, const std::string &mask)
+  {
+    DynamicJsonDocument update(capacityFor(content.size()));
+    if (deserializeJson(update, content))
+    {
+      return false;
+    }
+    quoteIntegers(update.as<JsonVariant>());
+
+    bool exists = _documents.count(path) != 0;
+    Document &document = _documents[path];
+    std::string time = timestamp();
+    if (!exists)
+    {
+      document.fields = "{}";
+      document.createTime = time;
+      _stats.created++;
+      _createdByCollectionId[lastSegment(path.substr(0, path.rfind('/')))]++;
+    }
+    document.updateTime = time;
+    _stats.writes++;
+    if (_writeListener)
+    {
+      _writeListener(path, content);
+    }
+
+    if (mask.empty())
+    {
+      document.fields.clear();
+      serializeJson(update["fields"], document.fields);
+      if (document.fields == "null")
+      {
+        document.fields = "{}";
+      }
+      return true;
+    }
+
+    DynamicJsonDocument fields(capacityFor(document.fields.size() + content.size()));
+    deserializeJson(fields, document.fields);
+    size_t start = 0;
+    while (start <= mask.size())
+    {
+      size_t end = mask.find(',', start);
+      end = end == std::string::npos ? mask.size() : end;
+      std::string name = mask.substr(start, end - start);
+      start = end + 1;
+      if (name.empty())
+      {
+        continue;
+      }
+      if (update["fields"].containsKey(name))
+      {
+        fields[name] = update["fields"][name];
+      }
+      else
+      {
+        fields.remove(name);
+      }
+    }
+    document.fields.clear();
+    serializeJson(fields, document.fields);
+    return true;
+  }
+
+  std::string Firestore::render(const std::string &path, const Document &document) const
+  {
+    return "{\"name\":\"" FIRESTORE_NAME_PREFIX + path + "\",\"fields\":" + document.fields +
+           ",\"createTime\":\"" + document.createTime + "\",\"updateTime\":\"" + document.updateTime + "\"}";
+  }
+
+  // Keep the newest autogenerated documents of a collection
+  void Firestore::retain(const std::string &collection, const std::string &path)
+  {
+    std::deque<std::string> &paths = _autogenerated[collection];
+    paths.push_back(path);
+    if (paths.size() > FIRESTORE_RETAINED_DOCUMENTS)
+    {
+      _documents.erase(paths.front());
+      paths.pop_front();
+    }
+  }
+}
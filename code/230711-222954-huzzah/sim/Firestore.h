@@ -0,0 +1,107 @@
+#ifndef SIM_FIRESTORE_H
+#define SIM_FIRESTORE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Documents kept per collection of autogenerated documents. Older ones are
+// only counted, which keeps a multi-day run in bounded memory.
+#ifndef FIRESTORE_RETAINED_DOCUMENTS
+#define FIRESTORE_RETAINED_DOCUMENTS 256
+#endif
+
+// Error codes of the Firebase client
+#define FIRESTORE_ERROR_CONNECTION_LOST -5
+#define FIRESTORE_ERROR_READ_TIMEOUT -11
+
+namespace sim
+{
+  struct FirestoreWrite
+  {
+    std::string path;
+    std::string content;
+    std::string mask;
+  };
+
+  struct FirestoreStats
+  {
+    uint64_t requests;  // Calls made, including failed ones
+    uint64_t failed;    // Calls that timed out during an outage
+    uint64_t writes;    // Documents created or updated
+    uint64_t created;   // Documents created
+    uint64_t commits;   // Commit calls that succeeded
+    uint64_t busyMicros; // Virtual time spent waiting for responses
+  };
+
+  // In-memory Firestore answering the sketch's REST calls.
+  //
+  // Each call takes a round trip of virtual time. Within an outage window
+  // calls fail once the client's read timeout passes. Paths with an odd
+  // number of segments are collections and get an autogenerated document id.
+  class Firestore
+  {
+  public:
+    Firestore();
+
+    void setLatency(uint64_t us) { _latency = us; }
+    void setTimeout(uint64_t us) { _timeout = us; }
+    // Fail every call made from `start` for `duration` virtual microseconds
+    void addOutage(uint64_t start, uint64_t duration);
+    bool hasOutages() const { return !_outages.empty(); }
+
+    // Called with each document written, after the write succeeded
+    void onWrite(std::function<void(const std::string &path, const std::string &content)> listener);
+
+    // Take the time of one round trip, false if it failed
+    bool request();
+
+    // HTTP status codes, or a negative client error code
+    int get(const std::string &path, std::string &payload);
+    int create(const std::string &path, const std::string &content, std::string &payload);
+    int patch(const std::string &path, const std::string &content, const std::string &mask, std::string &payload);
+    int commit(const std::vector<FirestoreWrite> &writes, std::string &payload);
+    // Structured query of a child collection of `parent`: from.collectionId,
+    // orderBy on one field and limit
+    int runQuery(const std::string &parent, const std::string &query, std::string &payload);
+
+    const FirestoreStats &stats() const { return _stats; }
+    size_t documents() const { return _documents.size(); }
+    // Documents ever created in the collections named `collectionId`
+    uint64_t created(const std::string &collectionId) const;
+
+    // Error text like the one the Firebase client reports
+    static std::string reason(int code, const std::string &payload);
+
+  private:
+    struct Document
+    {
+      std::string fields; // JSON object
+      std::string createTime;
+      std::string updateTime;
+    };
+
+    bool write(const std::string &path, const std::string &content, const std::string &mask);
+    std::string render(const std::string &path, const Document &document) const;
+    void retain(const std::string &collection, const std::string &path);
+
+    uint64_t _latency;
+    uint64_t _timeout;
+    std::vector<std::pair<uint64_t, uint64_t> > _outages;
+    std::map<std::string, Document> _documents;
+    std::map<std::string, std::deque<std::string> > _autogenerated;
+    std::map<std::string, uint64_t> _createdByCollectionId;
+    uint64_t _nextId;
+    FirestoreStats _stats;
+    std::function<void(const std::string &, const std::string &)> _writeListener;
+  };
+
+  Firestore &firestore();
+}
+
+#endif
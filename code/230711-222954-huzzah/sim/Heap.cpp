@@ -0,0 +1,147 @@
+#include "Heap.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+// Block header: the size, with the low bit set if the block is counted.
+// Two words keep the blocks aligned as malloc would.
+#define HEADER_SIZE (2 * sizeof(size_t))
+#define COUNTED 1
+
+static thread_local int hostDepth = 0;
+static std::atomic<size_t> inUse(0);
+static std::atomic<size_t> highWater(0);
+static std::atomic<uint64_t> allocations(0);
+static sim::HeapStats snapshot;
+
+extern "C"
+{
+  void *__real_malloc(size_t size);
+  void __real_free(void *ptr);
+  void *__real_realloc(void *ptr, size_t size);
+
+  void *__wrap_malloc(size_t size)
+  {
+    size_t *block = (size_t *)__real_malloc(size + HEADER_SIZE);
+    if (block == NULL)
+    {
+      return NULL;
+    }
+    // Sizes are rounded to even so the low bit is free for the flag
+    size = (size + 1) & ~(size_t)1;
+    block[0] = size | (hostDepth == 0 ? COUNTED : 0);
+    if (hostDepth == 0)
+    {
+      size_t now = inUse += size;
+      size_t peak = highWater;
+      while (now > peak && !highWater.compare_exchange_weak(peak, now))
+      {
+      }
+      allocations++;
+    }
+    return (char *)block + HEADER_SIZE;
+  }
+
+  void __wrap_free(void *ptr)
+  {
+    if (ptr == NULL)
+    {
+      return;
+    }
+    size_t *block = (size_t *)((char *)ptr - HEADER_SIZE);
+    if (block[0] & COUNTED)
+    {
+      inUse -= block[0] & ~(size_t)COUNTED;
+    }
+    __real_free(block);
+  }
+
+  void *__wrap_calloc(size_t count, size_t size)
+  {
+    void *ptr = __wrap_malloc(count * size);
+    if (ptr)
+    {
+      memset(ptr, 0, count * size);
+    }
+    return ptr;
+  }
+
+  void *__wrap_realloc(void *ptr, size_t size)
+  {
+    if (ptr == NULL)
+    {
+      return __wrap_malloc(size);
+    }
+    size_t *block = (size_t *)((char *)ptr - HEADER_SIZE);
+    size_t old = block[0] & ~(size_t)COUNTED;
+    void *moved = __wrap_malloc(size);
+    if (moved)
+    {
+      memcpy(moved, ptr, old < size ? old : size);
+      __wrap_free(ptr);
+    }
+    return moved;
+  }
+}
+
+void *operator new(size_t size)
+{
+  void *ptr = __wrap_malloc(size);
+  if (ptr == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  return __wrap_malloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+  return __wrap_malloc(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  __wrap_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  __wrap_free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  __wrap_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+  __wrap_free(ptr);
+}
+
+namespace sim
+{
+  const HeapStats &heapStats()
+  {
+    snapshot.inUse = inUse;
+    snapshot.highWater = highWater;
+    snapshot.allocations = allocations;
+    return snapshot;
+  }
+
+  HostScope::HostScope() { hostDepth++; }
+
+  HostScope::~HostScope() { hostDepth--; }
+}
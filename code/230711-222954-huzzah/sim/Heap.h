@@ -0,0 +1,39 @@
+#ifndef SIM_HEAP_H
+#define SIM_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of the ESP32 heap the firmware starts with, for ESP.getFreeHeap()
+#define HEAP_SIZE 327680
+
+// Accounting of the firmware's heap.
+//
+// malloc() and friends are wrapped at link time and operator new is replaced,
+// so every block the sketch, its libraries and the library shims allocate is
+// counted. Blocks allocated inside a HostScope belong to the simulation (the
+// broker, Firestore and the clock) and are left out.
+namespace sim
+{
+  struct HeapStats
+  {
+    size_t inUse;         // Bytes allocated by the firmware now
+    size_t highWater;     // Most bytes allocated at once
+    uint64_t allocations; // Blocks allocated
+  };
+
+  const HeapStats &heapStats();
+
+  class HostScope
+  {
+  public:
+    HostScope();
+    ~HostScope();
+
+  private:
+    HostScope(const HostScope &);
+    HostScope &operator=(const HostScope &);
+  };
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "Histogram.h"
+
+#include <string.h>
+
+Histogram::Histogram()
+{
+  clear();
+}
+
+void Histogram::clear()
+{
+  memset(_buckets, 0, sizeof(_buckets));
+  _count = 0;
+  _sum = 0;
+  _min = UINT64_MAX;
+  _max = 0;
+}
+
+void Histogram::add(uint64_t us)
+{
+  _buckets[bucket(us)]++;
+  _count++;
+  _sum += us;
+  _min = us < _min ? us : _min;
+  _max = us > _max ? us : _max;
+}
+
+// Values below HISTOGRAM_SUB_BUCKETS get a bucket each, every power of two
+// above is split into HISTOGRAM_SUB_BUCKETS equal buckets
+size_t Histogram::bucket(uint64_t us)
+{
+  if (us < HISTOGRAM_SUB_BUCKETS)
+  {
+    return (size_t)us;
+  }
+  int exponent = 63 - __builtin_clzll(us);
+  size_t sub = (size_t)(us >> (exponent - 2)) & (HISTOGRAM_SUB_BUCKETS - 1);
+  size_t index = (size_t)(exponent - 1) * HISTOGRAM_SUB_BUCKETS + sub;
+  return index < HISTOGRAM_BUCKETS ? index : HISTOGRAM_BUCKETS - 1;
+}
+
+uint64_t Histogram::upperBound(size_t bucket)
+{
+  if (bucket < HISTOGRAM_SUB_BUCKETS)
+  {
+    return bucket;
+  }
+  int exponent = (int)(bucket / HISTOGRAM_SUB_BUCKETS) + 1;
+  uint64_t step = 1ULL << (exponent - 2);
+  return (HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) * step + step - 1;
+}
+
+uint64_t Histogram::percentile(double quantile) const
+{
+  if (_count == 0)
+  {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(quantile * _count + 0.5);
+  rank = rank < 1 ? 1 : rank;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+  {
+    seen += _buckets[i];
+    if (seen >= rank)
+    {
+      uint64_t bound = upperBound(i);
+      return bound < _max ? bound : _max;
+    }
+  }
+  return _max;
+}
+
+void Histogram::print(FILE *out, const char *title, bool bars) const
+{
+  char a[16], b[16], c[16], d[16], e[16];
+  fprintf(out, "%s: %llu samples, mean %s, p50 %s, p99 %s, p99.9 %s, max %s\n", title, (unsigned long long)_count,
+          formatMicros((uint64_t)mean(), a, sizeof(a)), formatMicros(percentile(0.5), b, sizeof(b)),
+          formatMicros(percentile(0.99), c, sizeof(c)), formatMicros(percentile(0.999), d, sizeof(d)),
+          formatMicros(_max, e, sizeof(e)));
+
+  for (size_t i = 0; bars && i < HISTOGRAM_BUCKETS; i++)
+  {
+    if (_buckets[i] == 0)
+    {
+      continue;
+    }
+    // Bars are on a log scale so rare slow passes stay visible
+    int width = 1;
+    for (uint64_t n = _buckets[i]; n > 1 && width < 40; n /= 2)
+    {
+      width++;
+    }
+    char bar[48];
+    memset(bar, '#', width);
+    bar[width] = '\0';
+    fprintf(out, "  <= %9s %12llu  %s\n", formatMicros(upperBound(i), a, sizeof(a)),
+            (unsigned long long)_buckets[i], bar);
+  }
+}
+
+const char *formatMicros(uint64_t us, char *buffer, size_t size)
+{
+  if (us < 1000)
+  {
+    snprintf(buffer, size, "%lluus", (unsigned long long)us);
+  }
+  else if (us < 1000000)
+  {
+    snprintf(buffer, size, "%.1fms", us / 1000.0);
+  }
+  else
+  {
+    snprintf(buffer, size, "%.2fs", us / 1000000.0);
+  }
+  return buffer;
+}
@@ -0,0 +1,48 @@
+#ifndef SIM_HISTOGRAM_H
+#define SIM_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Buckets per power of two. 4 keeps the bucket error under 19%.
+#define HISTOGRAM_SUB_BUCKETS 4
+// Values up to 2^40 us (12 days)
+#define HISTOGRAM_BUCKETS (40 * HISTOGRAM_SUB_BUCKETS)
+
+// Log-linear latency histogram in microseconds. Constant memory, so it can
+// take every loop pass of a multi-day run.
+class Histogram
+{
+public:
+  Histogram();
+
+  void add(uint64_t us);
+  void clear();
+
+  uint64_t count() const { return _count; }
+  uint64_t min() const { return _count ? _min : 0; }
+  uint64_t max() const { return _max; }
+  double mean() const { return _count ? (double)_sum / _count : 0; }
+
+  // Upper bound of the bucket holding the given quantile (0..1)
+  uint64_t percentile(double quantile) const;
+
+  // One line summary, then a bar per non-empty bucket if `bars` is set
+  void print(FILE *out, const char *title, bool bars = true) const;
+
+private:
+  static size_t bucket(uint64_t us);
+  static uint64_t upperBound(size_t bucket);
+
+  uint64_t _buckets[HISTOGRAM_BUCKETS];
+  uint64_t _count;
+  uint64_t _sum;
+  uint64_t _min;
+  uint64_t _max;
+};
+
+// Format a duration in microseconds as "850us", "12.5ms" or "3.20s"
+const char *formatMicros(uint64_t us, char *buffer, size_t size);
+
+#endif
@@ -0,0 +1,111 @@
+#include "SimClock.h"
+
+#include "Heap.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sim
+{
+  struct Actor
+  {
+    const char *name;
+    uint64_t wake;  // Virtual time the actor wants to run again
+    uint64_t order; // Ties on `wake` resume in the order the actors slept
+    std::condition_variable resume;
+  };
+
+  static std::mutex lock;
+  // Actor 0 is the thread that runs setup() and loop()
+  static std::vector<Actor *> actors = []
+  {
+    HostScope host;
+    return std::vector<Actor *>(1, new Actor{"loop", 0, 0, {}});
+  }();
+  static size_t running = 0;
+  static uint64_t clock = 0;
+  static uint64_t sleeps = 0;
+  static uint64_t switchCount = 0;
+  static time_t epochSeconds = 0;
+  static thread_local size_t self = 0;
+
+  // Pick the next actor to run. Called with the lock held.
+  static void dispatch()
+  {
+    size_t next = 0;
+    for (size_t i = 1; i < actors.size(); i++)
+    {
+      if (actors[i]->wake < actors[next]->wake ||
+          (actors[i]->wake == actors[next]->wake && actors[i]->order < actors[next]->order))
+      {
+        next = i;
+      }
+    }
+    if (actors[next]->wake > clock)
+    {
+      clock = actors[next]->wake;
+    }
+    if (next != running)
+    {
+      running = next;
+      switchCount++;
+      actors[next]->resume.notify_one();
+    }
+  }
+
+  // Only the running actor reads or moves the clock, and actors hand over
+  // through the lock, so reads need no locking
+  uint64_t micros() { return clock; }
+
+  void sleep(uint64_t us)
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    size_t me = self;
+    actors[me]->wake = clock + us;
+    actors[me]->order = ++sleeps;
+    dispatch();
+    actors[me]->resume.wait(guard, [me] { return running == me; });
+  }
+
+  struct Start
+  {
+    size_t id;
+    void (*task)(void *);
+    void *parameter;
+  };
+
+  static void run(Start start)
+  {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      self = start.id;
+      actors[self]->resume.wait(guard, [&start] { return running == start.id; });
+    }
+    start.task(start.parameter);
+
+    // The task returned: never schedule it again
+    std::unique_lock<std::mutex> guard(lock);
+    actors[self]->wake = UINT64_MAX;
+    dispatch();
+  }
+
+  void spawn(void (*task)(void *), void *parameter, const char *name)
+  {
+    HostScope host;
+    std::lock_guard<std::mutex> guard(lock);
+    Actor *actor = new Actor{name, clock, ++sleeps, {}};
+    actors.push_back(actor);
+    Start start = {actors.size() - 1, task, parameter};
+    std::thread(run, start).detach();
+  }
+
+  void setEpoch(time_t epoch) { epochSeconds = epoch; }
+
+  time_t epoch() { return epochSeconds; }
+
+  time_t now() { return epochSeconds + (time_t)(micros() / 1000000); }
+
+  uint64_t switches() { return switchCount; }
+}
@@ -0,0 +1,35 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Virtual time for the host simulation.
+//
+// The sketch's loop() and every task it starts run as actors on their own
+// host threads, but only one actor runs at a time. An actor gives up the
+// processor by sleeping for some virtual time (delay(), vTaskDelay() and the
+// simulated cost of blocking I/O); the clock then jumps straight to the
+// earliest wake-up and resumes that actor. Runs are deterministic and a day
+// of traffic takes as long as the work done in it, not 24 hours.
+namespace sim
+{
+  // Virtual microseconds since the start of the simulation
+  uint64_t micros();
+
+  // Suspend the calling actor for `us` virtual microseconds
+  void sleep(uint64_t us);
+
+  // Start `task(parameter)` as a new actor, runnable at the current time
+  void spawn(void (*task)(void *), void *parameter, const char *name);
+
+  // Wall-clock epoch of virtual time zero, used by time() and getLocalTime()
+  void setEpoch(time_t epoch);
+  time_t epoch();
+  time_t now();
+
+  // Number of switches between actors
+  uint64_t switches();
+}
+
+#endif
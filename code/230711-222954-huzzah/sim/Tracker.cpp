@@ -0,0 +1,63 @@
+#include "Tracker.h"
+
+#include "SimClock.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Live readings are written to .../sensors/{plug}/live/{id}
+#define LIVE_SEGMENT "/live/"
+#define SENSORS_SEGMENT "/sensors/"
+#define POWER_FIELD "\"power\":{\"integerValue\":"
+
+void Tracker::published(const char *plug, int power)
+{
+  Reading reading = {sim::micros(), power};
+  _plugs[plug].push_back(reading);
+}
+
+void Tracker::written(const std::string &path, const std::string &content)
+{
+  size_t live = path.rfind(LIVE_SEGMENT);
+  size_t sensors = path.rfind(SENSORS_SEGMENT, live);
+  size_t field = content.find(POWER_FIELD);
+  if (live == std::string::npos || sensors == std::string::npos || field == std::string::npos)
+  {
+    return;
+  }
+  std::string plug = path.substr(sensors + strlen(SENSORS_SEGMENT), live - sensors - strlen(SENSORS_SEGMENT));
+  const char *value = content.c_str() + field + strlen(POWER_FIELD);
+  int power = atoi(*value == '"' ? value + 1 : value);
+
+  // Such as the overall live documents
+  std::map<std::string, std::deque<Reading> >::iterator found = _plugs.find(plug);
+  if (found == _plugs.end())
+  {
+    return;
+  }
+  std::deque<Reading> &readings = found->second;
+  size_t skipped = 0;
+  while (skipped < readings.size() && readings[skipped].power != power)
+  {
+    skipped++;
+  }
+  if (skipped == readings.size())
+  {
+    _unmatched++;
+    return;
+  }
+  _latency.add(sim::micros() - readings[skipped].at);
+  _uploaded++;
+  _lost += skipped;
+  readings.erase(readings.begin(), readings.begin() + skipped + 1);
+}
+
+uint64_t Tracker::outstanding() const
+{
+  uint64_t count = 0;
+  for (std::map<std::string, std::deque<Reading> >::const_iterator it = _plugs.begin(); it != _plugs.end(); ++it)
+  {
+    count += it->second.size();
+  }
+  return count;
+}
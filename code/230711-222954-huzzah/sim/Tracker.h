@@ -0,0 +1,48 @@
+#ifndef SIM_TRACKER_H
+#define SIM_TRACKER_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "Histogram.h"
+
+// Follows each plug reading from the broker to Firestore.
+//
+// The firmware keeps the readings of a plug in order from the callback to
+// the upload and only ever drops some of them, so an uploaded reading is
+// matched to the oldest outstanding reading of its plug with the same power.
+// Readings passed over on the way were lost.
+class Tracker
+{
+public:
+  // A plug published a reading
+  void published(const char *plug, int power);
+  // A document was written to Firestore, live readings are picked out
+  void written(const std::string &path, const std::string &content);
+
+  // Ingest to upload latency of the readings that made it
+  const Histogram &latency() const { return _latency; }
+  uint64_t uploaded() const { return _uploaded; }
+  uint64_t lost() const { return _lost; }
+  // Uploads that matched no reading
+  uint64_t unmatched() const { return _unmatched; }
+  uint64_t outstanding() const;
+
+private:
+  struct Reading
+  {
+    uint64_t at;
+    int power;
+  };
+
+  std::map<std::string, std::deque<Reading> > _plugs;
+  Histogram _latency;
+  uint64_t _uploaded = 0;
+  uint64_t _lost = 0;
+  uint64_t _unmatched = 0;
+};
+
+#endif
@@ -0,0 +1,370 @@
+// Runs the marble machine firmware on the host against simulated plugs,
+// broker, Firestore and hardware, on a virtual clock. See README.md.
+
+// The sketch as C++, made by prototypes.awk. Including it gives the report
+// the counters of every stage.
+#include "combined.cpp"
+
+#include <chrono>
+#include <unistd.h>
+
+#include "Broker.h"
+#include "Firestore.h"
+#include "Heap.h"
+#include "Histogram.h"
+#include "SimClock.h"
+#include "Tracker.h"
+
+#define TOUCH_SENSOR_PIN 33
+// A marble passes the touch sensor this often while the wheel runs backward
+#define MARBLE_INTERVAL_US 4000000
+#define MARBLE_TOUCH_US 50000
+
+struct Options
+{
+  double days;
+  uint64_t tick;
+  time_t epoch;
+  const char *log;
+  const char *flashDirectory;
+  bool summary;
+  bool check;
+};
+
+static Tracker tracker;
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  --days N            Virtual days to run (default 1)\n"
+          "  --plugs N           Plugs publishing readings (default 24)\n"
+          "  --period S          Seconds between readings of a plug (default 10)\n"
+          "  --rate N            Readings per second from all plugs, replaces --period\n"
+          "  --replay FILE       Play the total power of a live_overall.csv export\n"
+          "  --latency MS        Firestore round trip (default 250)\n"
+          "  --timeout MS        Firestore read timeout during outages (default 5000)\n"
+          "  --outage START:LEN  Firestore outage, in seconds from the start (repeatable)\n"
+          "  --tick MS           Shortest loop() pass (default 10)\n"
+          "  --epoch T           Unix time at the start (default 1689062400, 2023-07-11 08:00 UTC)\n"
+          "  --seed N            Seed of the plug readings (default 1)\n"
+          "  --log FILE          Write the serial output to FILE, - for stdout\n"
+          "  --flash-dir DIR     Host directory of the flash files (default build/flash)\n"
+          "  --summary           Print the results as one tab separated line\n"
+          "  --check             Fail unless every reading the firmware received was uploaded\n",
+          name);
+}
+
+// Touch sensor: LOW for a moment each time a marble passes
+static int readPin(uint8_t pin)
+{
+  if (pin == TOUCH_SENSOR_PIN && myMotor->command() == BACKWARD && myMotor->speed() > 0)
+  {
+    return sim::micros() % MARBLE_INTERVAL_US < MARBLE_TOUCH_US ? LOW : HIGH;
+  }
+  return HIGH;
+}
+
+static const char *formatBytes(size_t bytes, char *buffer, size_t size)
+{
+  if (bytes < 10240)
+  {
+    snprintf(buffer, size, "%zu B", bytes);
+  }
+  else
+  {
+    snprintf(buffer, size, "%.1f KiB", bytes / 1024.0);
+  }
+  return buffer;
+}
+
+// Readings in and out of each stage of the firmware, from the broker to
+// Firestore. A stage's losses are what went in and neither came out nor is
+// still waiting in it.
+static void reportPipeline()
+{
+  const BrokerStats &broker = BrokerClient::stats();
+  QueueStats queue = ingestQueue.stats();
+  const SpoolStats &spooled = spool.stats();
+  const BatchStats &batches = liveWriter.stats();
+  const sim::HeapStats &heap = sim::heapStats();
+  char a[16], b[16];
+
+  printf("Pipeline (readings):\n");
+  printf("  %-22s %10s %10s %10s\n", "stage", "in", "out", "lost");
+  printf("  %-22s %10llu %10llu %10llu\n", "broker", (unsigned long long)broker.published,
+         (unsigned long long)(broker.published - broker.missed - broker.dropped),
+         (unsigned long long)(broker.missed + broker.dropped));
+  printf("  %-22s %10llu %10llu %10llu\n", "mqtt, decode, devices",
+         (unsigned long long)(broker.published - broker.missed - broker.dropped), (unsigned long long)queue.pushed,
+         (unsigned long long)(broker.published - broker.missed - broker.dropped - queue.pushed));
+  printf("  %-22s %10u %10u %10u\n", "ingest queue", queue.pushed, queue.popped, queue.overwritten + queue.dropped);
+  printf("  %-22s %10u %10u %10u\n", "spool", spooled.appended, spooled.acked, spooled.dropped);
+  printf("  %-22s %10s %10llu %10llu\n", "upload", "", (unsigned long long)tracker.uploaded(),
+         (unsigned long long)tracker.lost());
+  printf("  batch writes dropped %u, rejected %u, commit failures %u, uploads unmatched %llu, readings in flight %llu\n",
+         batches.dropped, batches.rejected, batches.failures, (unsigned long long)tracker.unmatched(),
+         (unsigned long long)tracker.outstanding());
+  tracker.latency().print(stdout, "Ingest to upload latency", false);
+  printf("Heap: high water %s, in use %s at the end, %llu allocations\n", formatBytes(heap.highWater, a, sizeof(a)),
+         formatBytes(heap.inUse, b, sizeof(b)), (unsigned long long)heap.allocations);
+}
+
+// One line for comparing runs, see `make bench`
+static void reportSummary(const BrokerConfig &broker)
+{
+  const BrokerStats &stats = BrokerClient::stats();
+  QueueStats queue = ingestQueue.stats();
+  double rate = broker.rate > 0 ? broker.rate : broker.plugs * 1e6 / broker.period;
+  printf("%.1f\t%llu\t%llu\t%llu\t%llu\t%llu\t%u\t%u\t%llu\t%zu\t%llu\n", rate,
+         (unsigned long long)stats.published, (unsigned long long)tracker.uploaded(),
+         (unsigned long long)tracker.latency().percentile(0.5) / 1000,
+         (unsigned long long)tracker.latency().percentile(0.99) / 1000,
+         (unsigned long long)(stats.missed + stats.dropped), queue.overwritten + queue.dropped,
+         spool.stats().dropped, (unsigned long long)tracker.lost(), sim::heapStats().highWater,
+         (unsigned long long)(stats.connects > 0 ? stats.connects - 1 : 0));
+}
+
+static void report(const Options &options, const Histogram &passes, const Histogram &host, double wallSeconds)
+{
+  char a[16], b[16];
+  const BrokerStats &broker = BrokerClient::stats();
+  const sim::FirestoreStats &firestore = sim::firestore().stats();
+  const sim::FlashStats &flash = sim::flashStats();
+  const SpoolStats &spooled = spool.stats();
+  uint64_t elapsed = sim::micros();
+
+  printf("\nSimulated %s of firmware time in %.2fs of host time (%.0fx)\n", formatMicros(elapsed, a, sizeof(a)),
+         wallSeconds, elapsed / 1e6 / (wallSeconds > 0 ? wallSeconds : 1));
+  passes.print(stdout, "loop() pass, virtual time");
+  host.print(stdout, "loop() pass, host time", false);
+  printf("MQTT: %llu connects, %llu keepalive drops, %llu readings published, %llu missed, %llu messages delivered, "
+         "%llu pings, socket backlog max %zu bytes\n",
+         (unsigned long long)broker.connects, (unsigned long long)broker.disconnects,
+         (unsigned long long)broker.published, (unsigned long long)broker.missed,
+         (unsigned long long)broker.delivered, (unsigned long long)broker.pings, broker.maxBacklog);
+  printf("Firestore: %llu requests, %llu failed, %llu commits, %llu writes, %llu documents created "
+         "(%llu live, %llu history, %llu rollups), %s waiting\n",
+         (unsigned long long)firestore.requests, (unsigned long long)firestore.failed,
+         (unsigned long long)firestore.commits, (unsigned long long)firestore.writes,
+         (unsigned long long)firestore.created, (unsigned long long)sim::firestore().created("live"),
+         (unsigned long long)sim::firestore().created("history"),
+         (unsigned long long)sim::firestore().created("rollups"),
+         formatMicros(firestore.busyMicros, b, sizeof(b)));
+  printf("Spool: %u appended, %u replayed, %u acked, %u dropped, %u corrupted, %u pending\n", spooled.appended,
+         spooled.replayed, spooled.acked, spooled.dropped, spooled.corrupted, (unsigned)spool.pending());
+  printf("Flash: %llu opens, %llu bytes written, %llu bytes read, %llu removes\n", (unsigned long long)flash.opens,
+         (unsigned long long)flash.bytesWritten, (unsigned long long)flash.bytesRead,
+         (unsigned long long)flash.removes);
+  printf("Hardware: %llu LED shows, %u LEDs lit, wheel turned for %s\n", (unsigned long long)pixels.shows(),
+         (unsigned)pixels.litPixels(), formatMicros(myMotor->runningMicros(), a, sizeof(a)));
+  printf("Serial: %llu bytes, actor switches: %llu\n", (unsigned long long)sim::serialBytes(),
+         (unsigned long long)sim::switches());
+  reportPipeline();
+}
+
+// For --check: every reading that reached the firmware was uploaded, and
+// what an outage spooled was replayed. Readings still in flight at the end
+// are not lost.
+static bool check()
+{
+  const BrokerStats &broker = BrokerClient::stats();
+  QueueStats queue = ingestQueue.stats();
+  const SpoolStats &spooled = spool.stats();
+  uint64_t lost = tracker.lost() - std::min(tracker.lost(), broker.missed + broker.dropped);
+  bool passed = true;
+
+  if (queue.overwritten + queue.dropped > 0)
+  {
+    printf("check: %u readings lost in the ingest queue\n", queue.overwritten + queue.dropped);
+    passed = false;
+  }
+  if (spooled.dropped > 0)
+  {
+    printf("check: %u readings lost in the spool\n", spooled.dropped);
+    passed = false;
+  }
+  if (lost > 0)
+  {
+    printf("check: %llu readings lost after the broker\n", (unsigned long long)lost);
+    passed = false;
+  }
+  if (sim::firestore().hasOutages() && spooled.appended == 0)
+  {
+    printf("check: nothing was spooled during the outages\n");
+    passed = false;
+  }
+  if (spool.pending() > 0)
+  {
+    printf("check: %u readings left in the spool\n", (unsigned)spool.pending());
+    passed = false;
+  }
+  printf("check: %s\n", passed ? "passed" : "failed");
+  return passed;
+}
+
+// Parse the options and set up the simulation. Returns the exit code, or -1
+// to run the firmware.
+static int configure(int argc, char **argv, Options &options, BrokerConfig &broker, FILE *&log)
+{
+  sim::HostScope host;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(argv[i], "--summary") == 0)
+    {
+      options.summary = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--check") == 0)
+    {
+      options.check = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--help") == 0 || value == NULL)
+    {
+      usage(argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? 0 : 2;
+    }
+    i++;
+    if (strcmp(argv[i - 1], "--days") == 0)
+    {
+      options.days = atof(value);
+    }
+    else if (strcmp(argv[i - 1], "--plugs") == 0)
+    {
+      broker.plugs = std::max(1, atoi(value));
+    }
+    else if (strcmp(argv[i - 1], "--period") == 0)
+    {
+      broker.period = (uint64_t)(atof(value) * 1e6);
+    }
+    else if (strcmp(argv[i - 1], "--rate") == 0)
+    {
+      broker.rate = atof(value);
+    }
+    else if (strcmp(argv[i - 1], "--replay") == 0)
+    {
+      if (!BrokerClient::loadReplay(value, broker.replay))
+      {
+        fprintf(stderr, "%s: no readings\n", value);
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i - 1], "--latency") == 0)
+    {
+      sim::firestore().setLatency((uint64_t)(atof(value) * 1000));
+    }
+    else if (strcmp(argv[i - 1], "--timeout") == 0)
+    {
+      sim::firestore().setTimeout((uint64_t)(atof(value) * 1000));
+    }
+    else if (strcmp(argv[i - 1], "--outage") == 0)
+    {
+      double start, length;
+      if (sscanf(value, "%lf:%lf", &start, &length) != 2)
+      {
+        usage(argv[0]);
+        return 2;
+      }
+      sim::firestore().addOutage((uint64_t)(start * 1e6), (uint64_t)(length * 1e6));
+    }
+    else if (strcmp(argv[i - 1], "--tick") == 0)
+    {
+      options.tick = (uint64_t)(atof(value) * 1000);
+    }
+    else if (strcmp(argv[i - 1], "--epoch") == 0)
+    {
+      options.epoch = (time_t)atoll(value);
+    }
+    else if (strcmp(argv[i - 1], "--seed") == 0)
+    {
+      broker.seed = (uint32_t)strtoul(value, NULL, 10);
+    }
+    else if (strcmp(argv[i - 1], "--log") == 0)
+    {
+      options.log = value;
+    }
+    else if (strcmp(argv[i - 1], "--flash-dir") == 0)
+    {
+      options.flashDirectory = value;
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (options.log)
+  {
+    log = strcmp(options.log, "-") == 0 ? stdout : fopen(options.log, "w");
+    if (!log)
+    {
+      perror(options.log);
+      return 1;
+    }
+  }
+  sim::setSerialOutput(log);
+  sim::setPinReader(readPin);
+  sim::setEpoch(options.epoch);
+  sim::setFlashDirectory(options.flashDirectory);
+  BrokerClient::configure(broker);
+  BrokerClient::onPublish([](const char *plug, int power) { tracker.published(plug, power); });
+  sim::firestore().onWrite([](const std::string &path, const std::string &content)
+                           { tracker.written(path, content); });
+  return -1;
+}
+
+int main(int argc, char **argv)
+{
+  Options options = {1, 10000, 1689062400, NULL, "build/flash", false, false};
+  BrokerConfig broker = {24, 10000000, 0, 20000, 1, {}};
+  FILE *log = NULL;
+  int code = configure(argc, argv, options, broker, log);
+  if (code >= 0)
+  {
+    return code;
+  }
+
+  Histogram passes;
+  Histogram hostTimes;
+  uint64_t end = (uint64_t)(options.days * 86400e6);
+  std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+  setup();
+  while (sim::micros() < end)
+  {
+    uint64_t start = sim::micros();
+    std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+    loop();
+    uint64_t took = sim::micros() - start;
+    passes.add(took);
+    hostTimes.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostStart)
+                 .count());
+    if (took < options.tick)
+    {
+      sim::sleep(options.tick - took);
+    }
+  }
+
+  double wallSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  if (options.summary)
+  {
+    reportSummary(broker);
+  }
+  else
+  {
+    report(options, passes, hostTimes, wallSeconds);
+  }
+  if (log)
+  {
+    fflush(log);
+  }
+  int status = options.check && !check() ? 1 : 0;
+  fflush(stdout);
+  // The sketch's tasks never return, leave without joining them
+  _exit(status);
+}
@@ -0,0 +1,32 @@
+# Turn the sketch into C++ the way the Arduino builder does: declare every
+# top-level function ahead of the first one so they can be used before they
+# are defined. Functions with default arguments keep them on the definition.
+
+{
+  lines[NR] = $0
+}
+
+/^[A-Za-z_][A-Za-z0-9_:<>]*[ \t*&]+[A-Za-z_][A-Za-z0-9_]*[ \t]*\([^;={}]*\)[ \t]*$/ &&
+  $1 !~ /^(else|return|if|while|for|switch|case|do|typedef|class|struct|new|delete)$/ {
+  if (!first)
+  {
+    first = NR
+  }
+  prototypes[++count] = $0 ";"
+}
+
+END {
+  printf "#line 1 \"%s\"\n", FILENAME
+  for (i = 1; i <= NR; i++)
+  {
+    if (i == first)
+    {
+      for (j = 1; j <= count; j++)
+      {
+        print prototypes[j]
+      }
+      printf "#line %d \"%s\"\n", i, FILENAME
+    }
+    print lines[i]
+  }
+}
@@ -0,0 +1,39 @@
+#include "Adafruit_MotorShield.h"
+
+#include "../SimClock.h"
+
+#define I2C_COMMAND_US 300
+
+void Adafruit_DCMotor::run(uint8_t command)
+{
+  account();
+  _command = command;
+  sim::sleep(I2C_COMMAND_US);
+}
+
+void Adafruit_DCMotor::setSpeed(uint8_t speed)
+{
+  account();
+  _speed = speed;
+  sim::sleep(I2C_COMMAND_US);
+}
+
+void Adafruit_DCMotor::account()
+{
+  uint64_t now = sim::micros();
+  if ((_command == FORWARD || _command == BACKWARD) && _speed > 0)
+  {
+    _running += now - _since;
+  }
+  _since = now;
+}
+
+uint64_t Adafruit_DCMotor::runningMicros() const
+{
+  uint64_t running = _running;
+  if ((_command == FORWARD || _command == BACKWARD) && _speed > 0)
+  {
+    running += sim::micros() - _since;
+  }
+  return running;
+}
@@ -0,0 +1,44 @@
+#ifndef _Adafruit_MotorShield_h_
+#define _Adafruit_MotorShield_h_
+
+#include "Arduino.h"
+
+#define FORWARD 1
+#define BACKWARD 2
+#define BRAKE 3
+#define RELEASE 4
+
+// DC motor that remembers what it was told. Each command is one I2C
+// transaction to the PCA9685 on the shield, about 300 us at 100 kHz.
+class Adafruit_DCMotor
+{
+public:
+  void run(uint8_t command);
+  void setSpeed(uint8_t speed);
+
+  uint8_t command() const { return _command; }
+  uint8_t speed() const { return _speed; }
+  // Simulation: virtual microseconds spent turning
+  uint64_t runningMicros() const;
+
+private:
+  void account();
+
+  uint8_t _command = RELEASE;
+  uint8_t _speed = 0;
+  uint64_t _since = 0;
+  uint64_t _running = 0;
+};
+
+class Adafruit_MotorShield
+{
+public:
+  Adafruit_MotorShield(uint8_t addr = 0x60) {}
+  bool begin(uint16_t freq = 1600) { return true; }
+  Adafruit_DCMotor *getMotor(uint8_t n) { return n >= 1 && n <= 4 ? &_motors[n - 1] : NULL; }
+
+private:
+  Adafruit_DCMotor _motors[4];
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "Adafruit_NeoPixel.h"
+
+#include "../SimClock.h"
+
+#define SHOW_US_PER_PIXEL 30
+#define SHOW_LATCH_US 300
+
+void Adafruit_NeoPixel::show()
+{
+  _shown = _pixels;
+  _shows++;
+  sim::sleep(SHOW_LATCH_US + (uint64_t)SHOW_US_PER_PIXEL * _pixels.size());
+}
+
+uint32_t Adafruit_NeoPixel::ColorHSV(uint16_t hue, uint8_t sat, uint8_t val)
+{
+  // Six segments of the colour wheel
+  uint32_t segment = (uint32_t)hue * 6 / 65536;
+  uint32_t fraction = ((uint32_t)hue * 6 % 65536) >> 8;
+  uint32_t p = val * (255 - sat) / 255;
+  uint32_t q = val * (255 - sat * fraction / 255) / 255;
+  uint32_t t = val * (255 - sat * (255 - fraction) / 255) / 255;
+  switch (segment)
+  {
+  case 0:
+    return Color(val, t, p);
+  case 1:
+    return Color(q, val, p);
+  case 2:
+    return Color(p, val, t);
+  case 3:
+    return Color(p, q, val);
+  case 4:
+    return Color(t, p, val);
+  default:
+    return Color(val, p, q);
+  }
+}
+
+uint32_t Adafruit_NeoPixel::gamma32(uint32_t x)
+{
+  uint8_t *bytes = (uint8_t *)&x;
+  for (int i = 0; i < 4; i++)
+  {
+    bytes[i] = gamma8(bytes[i]);
+  }
+  return x;
+}
+
+uint16_t Adafruit_NeoPixel::litPixels() const
+{
+  uint16_t lit = 0;
+  for (size_t i = 0; i < _shown.size(); i++)
+  {
+    lit += _shown[i] != 0;
+  }
+  return lit;
+}
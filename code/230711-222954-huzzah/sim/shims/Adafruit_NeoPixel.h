@@ -0,0 +1,54 @@
+#ifndef ADAFRUIT_NEOPIXEL_H
+#define ADAFRUIT_NEOPIXEL_H
+
+#include "Arduino.h"
+
+#include <vector>
+
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+// NeoPixel strip that keeps the colours in memory. show() takes the time the
+// ESP32 spends clocking the data out: 30 us per pixel plus the latch.
+class Adafruit_NeoPixel
+{
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, uint16_t type = NEO_GRB + NEO_KHZ800) : _pixels(n, 0), _shown(n, 0) {}
+
+  void begin() {}
+  void show();
+  void clear() { std::fill(_pixels.begin(), _pixels.end(), 0); }
+  void fill(uint32_t c = 0) { std::fill(_pixels.begin(), _pixels.end(), c); }
+  void setBrightness(uint8_t brightness) { _brightness = brightness; }
+  void setPixelColor(uint16_t n, uint32_t c)
+  {
+    if (n < _pixels.size())
+    {
+      _pixels[n] = c;
+    }
+  }
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) { setPixelColor(n, Color(r, g, b)); }
+  uint32_t getPixelColor(uint16_t n) const { return n < _pixels.size() ? _pixels[n] : 0; }
+  uint16_t numPixels() const { return (uint16_t)_pixels.size(); }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w)
+  {
+    return ((uint32_t)w << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+  static uint32_t ColorHSV(uint16_t hue, uint8_t sat = 255, uint8_t val = 255);
+  static uint8_t gamma8(uint8_t x) { return (uint8_t)((x * x + 255) >> 8); }
+  static uint32_t gamma32(uint32_t x);
+
+  // Simulation: pixels lit at the last show() and number of shows
+  uint16_t litPixels() const;
+  uint64_t shows() const { return _shows; }
+
+private:
+  std::vector<uint32_t> _pixels;
+  std::vector<uint32_t> _shown;
+  uint8_t _brightness = 255;
+  uint64_t _shows = 0;
+};
+
+#endif
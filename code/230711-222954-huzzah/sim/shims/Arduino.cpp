@@ -0,0 +1,152 @@
+#include "Arduino.h"
+
+#include "../Heap.h"
+#include "../SimClock.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static FILE *serialOutput = NULL;
+static uint64_t serialByteCount = 0;
+static int (*pinReader)(uint8_t) = NULL;
+static void (*restartHandler)() = NULL;
+static uint32_t randomState = 0x9E3779B9;
+
+// Time given to other tasks by a yield() in a busy-wait loop
+#define YIELD_COST_US 10
+
+extern "C"
+{
+  unsigned long millis(void) { return (unsigned long)(sim::micros() / 1000); }
+  unsigned long micros(void) { return (unsigned long)sim::micros(); }
+
+  // Linked with --wrap=time: the sketch and the libraries see virtual time
+  time_t __wrap_time(time_t *t)
+  {
+    time_t now = sim::now();
+    if (t)
+    {
+      *t = now;
+    }
+    return now;
+  }
+}
+
+void delay(unsigned long ms)
+{
+  sim::sleep((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  sim::sleep(us);
+}
+
+void yield()
+{
+  sim::sleep(YIELD_COST_US);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+int digitalRead(uint8_t pin)
+{
+  // Inputs are pulled up: buttons and the touch sensor read HIGH when idle
+  return pinReader ? pinReader(pin) : HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+  _baud = baud;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return write((const char *)&c, 1);
+}
+
+size_t HardwareSerial::write(const char *str, size_t length)
+{
+  if (serialOutput)
+  {
+    fwrite(str, 1, length, serialOutput);
+  }
+  serialByteCount += length;
+  // 10 bits per byte on the wire
+  sim::sleep((uint64_t)length * 10 * 1000000 / _baud);
+  return length;
+}
+
+size_t HardwareSerial::printf(const char *format, ...)
+{
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0)
+  {
+    return 0;
+  }
+  return write(buffer, std::min((size_t)length, sizeof(buffer) - 1));
+}
+
+void EspClass::restart()
+{
+  if (restartHandler)
+  {
+    restartHandler();
+  }
+  fprintf(stderr, "ESP.restart() called\n");
+  exit(1);
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  size_t used = sim::heapStats().inUse;
+  return used < HEAP_SIZE ? (uint32_t)(HEAP_SIZE - used) : 0;
+}
+
+int xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackSize, void *parameter,
+                            unsigned int priority, TaskHandle_t *handle, int core)
+{
+  sim::spawn(task, parameter, name);
+  if (handle)
+  {
+    *handle = (TaskHandle_t)task;
+  }
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  sim::sleep((uint64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+// Deterministic, so runs can be repeated
+uint32_t esp_random()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+void configTime(long gmtOffset, int daylightOffset, const char *server) {}
+
+bool getLocalTime(struct tm *info, uint32_t ms)
+{
+  time_t now = sim::now();
+  gmtime_r(&now, info);
+  return true;
+}
+
+namespace sim
+{
+  void setSerialOutput(FILE *out) { serialOutput = out; }
+  void setPinReader(int (*reader)(uint8_t pin)) { pinReader = reader; }
+  void setRestartHandler(void (*handler)()) { restartHandler = handler; }
+  uint64_t serialBytes() { return serialByteCount; }
+}
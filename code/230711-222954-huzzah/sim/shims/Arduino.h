@@ -0,0 +1,128 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Host stand-in for the ESP32 Arduino core. Takes the place of the Arduino.h
+// of the PubSubClient test shims (same include guard) and keeps their
+// Print, Client and IPAddress.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "Print.h"
+#include "IPAddress.h"
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#include "avr/pgmspace.h"
+
+#define pgm_read_byte_near(x) (*(x))
+
+// Strings in flash, told apart by type as on the ESP32 core
+class __FlashStringHelper;
+#define F(string) (reinterpret_cast<const __FlashStringHelper *>(string))
+
+extern "C"
+{
+  unsigned long millis(void);
+  unsigned long micros(void);
+}
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+// Serial output goes to the simulation log. Each byte costs the time it
+// takes on the wire, as the ESP32 UART driver blocks once its FIFO is full.
+class HardwareSerial : public Print
+{
+public:
+  void begin(unsigned long baud);
+  size_t write(uint8_t c);
+  size_t write(const char *str, size_t length);
+
+  size_t print(const char *str) { return write(str, strlen(str)); }
+  size_t print(const String &str) { return write(str.c_str(), str.length()); }
+  size_t print(const __FlashStringHelper *str) { return print(reinterpret_cast<const char *>(str)); }
+  size_t print(char c) { return write(&c, 1); }
+  size_t print(int value) { return printf("%d", value); }
+  size_t print(unsigned int value) { return printf("%u", value); }
+  size_t print(long value) { return printf("%ld", value); }
+  size_t print(unsigned long value) { return printf("%lu", value); }
+  size_t print(double value, int decimals = 2) { return printf("%.*f", decimals, value); }
+  size_t print(const IPAddress &ip) { return printf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]); }
+
+  size_t println() { return write("\r\n", 2); }
+  template <typename T>
+  size_t println(const T &value)
+  {
+    size_t n = print(value);
+    return n + println();
+  }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  unsigned long _baud = 115200;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+  void restart();
+  uint32_t getFreeHeap();
+};
+
+extern EspClass ESP;
+
+// FreeRTOS, with a 1 kHz tick as on the ESP32
+typedef void *TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+#define pdPASS 1
+
+int xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackSize, void *parameter,
+                            unsigned int priority, TaskHandle_t *handle, int core);
+void vTaskDelay(TickType_t ticks);
+
+uint32_t esp_random();
+
+// SNTP. time() is wrapped at link time to return the virtual wall clock.
+void configTime(long gmtOffset, int daylightOffset, const char *server);
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+
+// Hooks for the simulation driver
+namespace sim
+{
+  // Where Serial writes go, NULL to discard them
+  void setSerialOutput(FILE *out);
+  // Level returned by digitalRead() for a pin
+  void setPinReader(int (*reader)(uint8_t pin));
+  // Called by ESP.restart()
+  void setRestartHandler(void (*handler)());
+  uint64_t serialBytes();
+}
+
+#endif
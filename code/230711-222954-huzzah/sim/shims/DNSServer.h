@@ -0,0 +1,6 @@
+#ifndef DNSServer_h
+#define DNSServer_h
+
+// Only needed by WiFiManager's captive portal, which is not simulated
+
+#endif
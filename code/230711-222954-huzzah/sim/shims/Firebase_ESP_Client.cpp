@@ -0,0 +1,190 @@
+#include "Firebase_ESP_Client.h"
+
+#include "../Firestore.h"
+
+#define FIREBASE_JSON_CAPACITY 512
+
+Firebase_ESP_Client Firebase;
+
+FirebaseJson::FirebaseJson() : _doc(FIREBASE_JSON_CAPACITY)
+{
+  _doc.to<JsonObject>();
+}
+
+// Parse "[n]" into n
+static bool arrayIndex(const std::string &segment, size_t &index)
+{
+  if (segment.size() < 3 || segment[0] != '[' || segment[segment.size() - 1] != ']')
+  {
+    return false;
+  }
+  index = (size_t)strtoul(segment.c_str() + 1, NULL, 10);
+  return true;
+}
+
+// Find the node at `path`, creating the objects and arrays on the way
+JsonVariant FirebaseJson::walk(const String &path)
+{
+  JsonVariant node = _doc.as<JsonVariant>();
+  const std::string &text = path.str();
+  size_t start = 0;
+  while (start <= text.size() && !node.isUnbound())
+  {
+    size_t end = text.find('/', start);
+    end = end == std::string::npos ? text.size() : end;
+    std::string segment = text.substr(start, end - start);
+    start = end + 1;
+    if (segment.empty())
+    {
+      continue;
+    }
+    size_t index;
+    if (arrayIndex(segment, index))
+    {
+      JsonArray array = node.is<JsonArray>() ? node.as<JsonArray>() : node.to<JsonArray>();
+      while (!array.isNull() && array.size() <= index && !array.add().isNull())
+      {
+      }
+      node = array[index].as<JsonVariant>();
+    }
+    else
+    {
+      JsonObject object = node.is<JsonObject>() ? node.as<JsonObject>() : node.to<JsonObject>();
+      if (!object.isNull() && !object.containsKey(segment))
+      {
+        object[segment] = nullptr;
+      }
+      node = object[segment].as<JsonVariant>();
+    }
+  }
+  return node;
+}
+
+void FirebaseJson::grow()
+{
+  DynamicJsonDocument bigger(_doc.capacity() * 2);
+  bigger.set(_doc);
+  _doc = std::move(bigger);
+}
+
+bool FirebaseJson::get(FirebaseJsonData &result, const String &path)
+{
+  JsonVariantConst node = _doc.as<JsonVariantConst>();
+  const std::string &text = path.str();
+  size_t start = 0;
+  while (start <= text.size() && !node.isNull())
+  {
+    size_t end = text.find('/', start);
+    end = end == std::string::npos ? text.size() : end;
+    std::string segment = text.substr(start, end - start);
+    start = end + 1;
+    size_t index;
+    if (segment.empty())
+    {
+      continue;
+    }
+    node = arrayIndex(segment, index) ? node[index] : node[segment];
+  }
+  result.success = !node.isNull();
+  result._json.clear();
+  serializeJson(node, result._json);
+  result.stringValue = node.is<const char *>() ? node.as<const char *>() : result._json.c_str();
+  return result.success;
+}
+
+bool FirebaseJson::setJsonData(const String &data)
+{
+  size_t capacity = FIREBASE_JSON_CAPACITY;
+  while (capacity < data.length() * 2)
+  {
+    capacity *= 2;
+  }
+  DynamicJsonDocument parsed(capacity);
+  if (deserializeJson(parsed, data.str()))
+  {
+    clear();
+    return false;
+  }
+  _doc = std::move(parsed);
+  return true;
+}
+
+void FirebaseJson::clear()
+{
+  _doc.clear();
+  _doc.to<JsonObject>();
+}
+
+const char *FirebaseJson::raw()
+{
+  _raw.clear();
+  serializeJson(_doc, _raw);
+  return _raw.c_str();
+}
+
+void Firebase_ESP_Client::begin(FirebaseConfig *config, FirebaseAuth *auth)
+{
+  // Signing in is a round trip as well
+  sim::firestore().request();
+  auth->token.uid = "sim-user";
+  _ready = true;
+}
+
+bool FB_Firestore::finish(FirebaseData *fbdo, int code, const std::string &payload)
+{
+  fbdo->_httpCode = code;
+  fbdo->_payload = code > 0 ? payload : std::string();
+  fbdo->_errorReason = code == 200 ? std::string() : sim::Firestore::reason(code, payload);
+  return code == 200;
+}
+
+bool FB_Firestore::getDocument(FirebaseData *fbdo, const String &projectId, const String &databaseId,
+                               const String &documentPath, const String &mask)
+{
+  std::string payload;
+  int code = sim::firestore().get(documentPath.str(), payload);
+  return finish(fbdo, code, payload);
+}
+
+bool FB_Firestore::createDocument(FirebaseData *fbdo, const String &projectId, const String &databaseId,
+                                  const String &documentPath, const String &content, const String &mask)
+{
+  std::string payload;
+  int code = sim::firestore().create(documentPath.str(), content.str(), payload);
+  return finish(fbdo, code, payload);
+}
+
+bool FB_Firestore::patchDocument(FirebaseData *fbdo, const String &projectId, const String &databaseId,
+                                 const String &documentPath, const String &content, const String &updateMask)
+{
+  std::string payload;
+  int code = sim::firestore().patch(documentPath.str(), content.str(), updateMask.str(), payload);
+  return finish(fbdo, code, payload);
+}
+
+bool FB_Firestore::commitDocument(FirebaseData *fbdo, const String &projectId, const String &databaseId,
+                                  std::vector<struct fb_esp_firestore_document_write_t> writes,
+                                  const String &transaction)
+{
+  std::vector<sim::FirestoreWrite> updates;
+  for (size_t i = 0; i < writes.size(); i++)
+  {
+    if (writes[i].type == fb_esp_firestore_document_write_type_update)
+    {
+      sim::FirestoreWrite update = {writes[i].update_document_path.str(), writes[i].update_document_content.str(),
+                                    writes[i].update_masks.str()};
+      updates.push_back(update);
+    }
+  }
+  std::string payload;
+  int code = sim::firestore().commit(updates, payload);
+  return finish(fbdo, code, payload);
+}
+
+bool FB_Firestore::runQuery(FirebaseData *fbdo, const String &projectId, const String &databaseId,
+                            const String &documentPath, FirebaseJson *structuredQuery)
+{
+  std::string payload;
+  int code = sim::firestore().runQuery(documentPath.str(), structuredQuery->raw(), payload);
+  return finish(fbdo, code, payload);
+}
@@ -0,0 +1,196 @@
+#ifndef FIREBASE_ESP_CLIENT_H
+#define FIREBASE_ESP_CLIENT_H
+
+// Host stand-in for the Firebase ESP client: FirebaseJson on ArduinoJson and
+// a Firestore API answered by the in-memory store in sim/Firestore.h
+
+#include "Arduino.h"
+
+#include <ArduinoJson.h>
+
+#include <string>
+#include <vector>
+
+#include "mbfs/MB_FS.h"
+
+#define FIREBASE_CLIENT_VERSION "4.3.16"
+
+typedef struct token_info_t
+{
+  int type;
+  int status;
+} TokenInfo;
+
+typedef void (*TokenStatusCallback)(TokenInfo);
+
+// Value found by FirebaseJson::get(), kept as JSON text
+class FirebaseJsonData
+{
+public:
+  template <typename T>
+  T to() const;
+
+  bool success = false;
+  String stringValue;
+
+private:
+  friend class FirebaseJson;
+  std::string _json;
+};
+
+// Numbers and booleans, also when Firestore returned them as strings
+template <typename T>
+T FirebaseJsonData::to() const
+{
+  const char *text = _json.c_str();
+  if (*text == '"')
+  {
+    text++;
+  }
+  if (strncmp(text, "true", 4) == 0)
+  {
+    return (T)1;
+  }
+  return (T)strtod(text, NULL);
+}
+
+template <>
+inline String FirebaseJsonData::to<String>() const
+{
+  return stringValue;
+}
+
+// JSON built by '/' separated paths, "[n]" segments index arrays
+class FirebaseJson
+{
+public:
+  FirebaseJson();
+
+  FirebaseJson &set(const String &path, const String &value) { return put(path, value.str()); }
+  FirebaseJson &set(const String &path, const char *value) { return put(path, std::string(value)); }
+  FirebaseJson &set(const String &path, bool value) { return put(path, value); }
+  template <typename T>
+  FirebaseJson &set(const String &path, T value)
+  {
+    return put(path, value);
+  }
+
+  bool get(FirebaseJsonData &result, const String &path);
+  bool setJsonData(const String &data);
+  void clear();
+  const char *raw();
+
+private:
+  template <typename T>
+  FirebaseJson &put(const String &path, const T &value);
+  JsonVariant walk(const String &path);
+  void grow();
+
+  DynamicJsonDocument _doc;
+  std::string _raw;
+};
+
+template <typename T>
+FirebaseJson &FirebaseJson::put(const String &path, const T &value)
+{
+  for (;;)
+  {
+    JsonVariant node = walk(path);
+    if (!node.isUnbound())
+    {
+      node.set(value);
+    }
+    if (!_doc.overflowed())
+    {
+      return *this;
+    }
+    grow();
+  }
+}
+
+class FirebaseData
+{
+public:
+  String payload() { return _payload; }
+  String errorReason() { return _errorReason; }
+  int httpCode() { return _httpCode; }
+  void setResponseSize(int size) {}
+
+private:
+  friend class FB_Firestore;
+  String _payload;
+  String _errorReason;
+  int _httpCode = 0;
+};
+
+struct FirebaseAuth
+{
+  struct
+  {
+    String email;
+    String password;
+  } user;
+  struct
+  {
+    String uid;
+  } token;
+};
+
+struct FirebaseConfig
+{
+  String api_key;
+  TokenStatusCallback token_status_callback = NULL;
+};
+
+enum fb_esp_firestore_document_write_type
+{
+  fb_esp_firestore_document_write_type_undefined,
+  fb_esp_firestore_document_write_type_update,
+  fb_esp_firestore_document_write_type_delete,
+  fb_esp_firestore_document_write_type_transform
+};
+
+struct fb_esp_firestore_document_write_t
+{
+  String update_masks;
+  fb_esp_firestore_document_write_type type = fb_esp_firestore_document_write_type_undefined;
+  String update_document_content;
+  String update_document_path;
+  String delete_document_path;
+};
+
+class FB_Firestore
+{
+public:
+  bool getDocument(FirebaseData *fbdo, const String &projectId, const String &databaseId, const String &documentPath,
+                   const String &mask = "");
+  bool createDocument(FirebaseData *fbdo, const String &projectId, const String &databaseId,
+                      const String &documentPath, const String &content, const String &mask = "");
+  bool patchDocument(FirebaseData *fbdo, const String &projectId, const String &databaseId,
+                     const String &documentPath, const String &content, const String &updateMask);
+  bool commitDocument(FirebaseData *fbdo, const String &projectId, const String &databaseId,
+                      std::vector<struct fb_esp_firestore_document_write_t> writes, const String &transaction);
+  bool runQuery(FirebaseData *fbdo, const String &projectId, const String &databaseId, const String &documentPath,
+                FirebaseJson *structuredQuery);
+
+private:
+  bool finish(FirebaseData *fbdo, int code, const std::string &payload);
+};
+
+class Firebase_ESP_Client
+{
+public:
+  void begin(FirebaseConfig *config, FirebaseAuth *auth);
+  bool ready() { return _ready; }
+  void reconnectWiFi(bool reconnect) {}
+  void refreshToken(FirebaseConfig *config) {}
+
+  FB_Firestore Firestore;
+
+private:
+  bool _ready = false;
+};
+
+extern Firebase_ESP_Client Firebase;
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef WString_h
+#define WString_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+// Arduino String on top of std::string, with the parts the sketch uses
+class String
+{
+public:
+  String() {}
+  String(const char *value) : _value(value ? value : "") {}
+  String(const std::string &value) : _value(value) {}
+  String(char value) : _value(1, value) {}
+  String(int value) : _value(std::to_string(value)) {}
+  String(unsigned int value) : _value(std::to_string(value)) {}
+  String(long value) : _value(std::to_string(value)) {}
+  String(unsigned long value) : _value(std::to_string(value)) {}
+  String(float value, unsigned int decimals = 2) : _value(format(value, decimals)) {}
+  String(double value, unsigned int decimals = 2) : _value(format(value, decimals)) {}
+
+  const char *c_str() const { return _value.c_str(); }
+  unsigned int length() const { return (unsigned int)_value.size(); }
+  const std::string &str() const { return _value; }
+
+  String &operator+=(const String &other)
+  {
+    _value += other._value;
+    return *this;
+  }
+  String &operator+=(const char *other)
+  {
+    _value += other;
+    return *this;
+  }
+  String &operator+=(char other)
+  {
+    _value += other;
+    return *this;
+  }
+  String &operator+=(int other) { return *this += String(other); }
+  String &operator+=(unsigned int other) { return *this += String(other); }
+  String &operator+=(long other) { return *this += String(other); }
+  String &operator+=(unsigned long other) { return *this += String(other); }
+  String &operator+=(double other) { return *this += String(other); }
+
+  bool operator==(const String &other) const { return _value == other._value; }
+  bool operator==(const char *other) const { return _value == other; }
+  bool operator!=(const String &other) const { return _value != other._value; }
+  bool operator<(const String &other) const { return _value < other._value; }
+  char operator[](unsigned int index) const { return index < _value.size() ? _value[index] : 0; }
+
+  int indexOf(char c, unsigned int from = 0) const
+  {
+    size_t at = _value.find(c, from);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  int indexOf(const char *str, unsigned int from = 0) const
+  {
+    size_t at = _value.find(str, from);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  String substring(unsigned int from) const { return from < _value.size() ? _value.substr(from) : ""; }
+  String substring(unsigned int from, unsigned int to) const
+  {
+    return from < to && from < _value.size() ? _value.substr(from, to - from) : "";
+  }
+  bool startsWith(const char *prefix) const { return _value.compare(0, strlen(prefix), prefix) == 0; }
+  long toInt() const { return atol(_value.c_str()); }
+  float toFloat() const { return (float)atof(_value.c_str()); }
+
+private:
+  static std::string format(double value, unsigned int decimals)
+  {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+    return buffer;
+  }
+
+  std::string _value;
+};
+
+inline String operator+(const String &a, const String &b)
+{
+  String result(a);
+  result += b;
+  return result;
+}
+
+inline String operator+(const String &a, const char *b)
+{
+  String result(a);
+  result += b;
+  return result;
+}
+
+inline String operator+(const char *a, const String &b)
+{
+  String result(a);
+  result += b;
+  return result;
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef WEBSERVER_H
+#define WEBSERVER_H
+
+// Only needed by WiFiManager's captive portal, which is not simulated
+
+#endif
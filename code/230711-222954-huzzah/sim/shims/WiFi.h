@@ -0,0 +1,19 @@
+#ifndef WiFi_h
+#define WiFi_h
+
+#include "Arduino.h"
+
+#include "../Broker.h"
+
+// The sketch's network client talks to the simulated broker
+typedef BrokerClient WiFiClient;
+
+class WiFiClass
+{
+public:
+  IPAddress localIP() { return IPAddress(192, 168, 4, 2); }
+};
+
+extern WiFiClass WiFi;
+
+#endif
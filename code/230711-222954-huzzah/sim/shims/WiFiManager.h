@@ -0,0 +1,17 @@
+#ifndef WiFiManager_h
+#define WiFiManager_h
+
+#include "Arduino.h"
+
+#include <functional>
+
+// The simulated network is always configured
+class WiFiManager
+{
+public:
+  void resetSettings() {}
+  void setAPCallback(std::function<void(WiFiManager *)> callback) {}
+  bool autoConnect(const char *name, const char *password = NULL) { return true; }
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef RTDB_HELPER_H
+#define RTDB_HELPER_H
+
+// The sketch does not use the RTDB helpers
+
+#endif
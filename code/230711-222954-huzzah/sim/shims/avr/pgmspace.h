@@ -0,0 +1,20 @@
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+// Flash and RAM share the address space on the ESP32 and on the host, so
+// program memory is read like any other
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+#define pgm_read_double(addr) (*(const double *)(addr))
+#define pgm_read_ptr(addr) (*(const void *const *)(addr))
+
+#endif
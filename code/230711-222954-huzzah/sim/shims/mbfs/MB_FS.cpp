@@ -0,0 +1,110 @@
+#include "MB_FS.h"
+
+#include "../../SimClock.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// LittleFS on the ESP32 flash: an open walks the metadata, programming is
+// about ten times slower than reading
+#define FLASH_OPEN_US 1500
+#define FLASH_READ_US_PER_BYTE 1
+#define FLASH_WRITE_US_PER_BYTE 10
+
+static std::string flashDirectory = "sim-flash";
+static sim::FlashStats stats = {};
+
+// Host path of a flash path, creating its directories
+static std::string hostPath(const String &filename)
+{
+  std::string path = flashDirectory;
+  const std::string &name = filename.str();
+  for (size_t at = name.find('/', 1); at != std::string::npos; at = name.find('/', at + 1))
+  {
+    mkdir((path + name.substr(0, at)).c_str(), 0755);
+  }
+  return path + (name.empty() || name[0] != '/' ? "/" : "") + name;
+}
+
+int MB_FS::open(const String &filename, mbfs_file_type type, mb_fs_open_mode mode)
+{
+  close(type);
+  sim::sleep(FLASH_OPEN_US);
+  stats.opens++;
+  std::string path = hostPath(filename);
+  _file = fopen(path.c_str(), mode == mb_fs_open_mode_read ? "rb" : mode == mb_fs_open_mode_write ? "wb" : "ab");
+  if (!_file)
+  {
+    return errno == ENOENT ? MB_FS_ERROR_FILE_NOT_FOUND : MB_FS_ERROR_FILE_IO_ERROR;
+  }
+  struct stat info;
+  return fstat(fileno(_file), &info) == 0 ? (int)info.st_size : MB_FS_ERROR_FILE_IO_ERROR;
+}
+
+int MB_FS::read(mbfs_file_type type, uint8_t *buf, size_t len)
+{
+  if (!_file)
+  {
+    return MB_FS_ERROR_FILE_IO_ERROR;
+  }
+  size_t n = fread(buf, 1, len, _file);
+  stats.bytesRead += n;
+  sim::sleep((uint64_t)n * FLASH_READ_US_PER_BYTE);
+  return (int)n;
+}
+
+int MB_FS::write(mbfs_file_type type, uint8_t *buf, size_t len)
+{
+  if (!_file)
+  {
+    return MB_FS_ERROR_FILE_IO_ERROR;
+  }
+  size_t n = fwrite(buf, 1, len, _file);
+  stats.bytesWritten += n;
+  sim::sleep((uint64_t)n * FLASH_WRITE_US_PER_BYTE);
+  return (int)n;
+}
+
+bool MB_FS::seek(mbfs_file_type type, int pos)
+{
+  return _file && fseek(_file, pos, SEEK_SET) == 0;
+}
+
+void MB_FS::close(mbfs_file_type type)
+{
+  if (_file)
+  {
+    fclose(_file);
+    _file = NULL;
+  }
+}
+
+bool MB_FS::existed(const String &filename, mbfs_file_type type)
+{
+  struct stat info;
+  return stat(hostPath(filename).c_str(), &info) == 0;
+}
+
+// Like MB_FS, removing a missing file succeeds
+bool MB_FS::remove(const String &filename, mbfs_file_type type)
+{
+  if (!existed(filename, type))
+  {
+    return true;
+  }
+  sim::sleep(FLASH_OPEN_US);
+  stats.removes++;
+  return unlink(hostPath(filename).c_str()) == 0;
+}
+
+namespace sim
+{
+  void setFlashDirectory(const char *path)
+  {
+    flashDirectory = path;
+    mkdir(path, 0755);
+  }
+
+  const FlashStats &flashStats() { return stats; }
+}
@@ -0,0 +1,66 @@
+#ifndef MBFS_CLASS_H
+#define MBFS_CLASS_H
+
+// Flash file system of the Firebase client, on host files under the
+// directory given to sim::setFlashDirectory(). Reads and writes take the
+// time they take on the ESP32 flash.
+
+#include "../Arduino.h"
+
+#include <string>
+
+enum mbfs_file_type
+{
+  mb_fs_mem_storage_type_undefined,
+  mb_fs_mem_storage_type_flash,
+  mb_fs_mem_storage_type_sd
+};
+
+enum mb_fs_open_mode
+{
+  mb_fs_open_mode_undefined = -1,
+  mb_fs_open_mode_read = 0,
+  mb_fs_open_mode_write,
+  mb_fs_open_mode_append
+};
+
+#define mbfs_flash mb_fs_mem_storage_type_flash
+#define mbfs_sd mb_fs_mem_storage_type_sd
+
+#define MB_FS_ERROR_FILE_IO_ERROR -300
+#define MB_FS_ERROR_FILE_NOT_FOUND -301
+
+class MB_FS
+{
+public:
+  ~MB_FS() { close(mbfs_flash); }
+
+  // Size of the file, or a negative value on error
+  int open(const String &filename, mbfs_file_type type, mb_fs_open_mode mode);
+  int read(mbfs_file_type type, uint8_t *buf, size_t len);
+  int write(mbfs_file_type type, uint8_t *buf, size_t len);
+  bool seek(mbfs_file_type type, int pos);
+  void close(mbfs_file_type type);
+  bool existed(const String &filename, mbfs_file_type type);
+  bool remove(const String &filename, mbfs_file_type type);
+
+private:
+  FILE *_file = NULL;
+};
+
+namespace sim
+{
+  // Host directory holding the flash files, created if missing
+  void setFlashDirectory(const char *path);
+
+  struct FlashStats
+  {
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    uint64_t opens;
+    uint64_t removes;
+  };
+  const FlashStats &flashStats();
+}
+
+#endif
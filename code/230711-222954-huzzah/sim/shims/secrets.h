@@ -0,0 +1,11 @@
+#ifndef SECRETS_H
+#define SECRETS_H
+
+// Placeholder credentials, the simulated Firebase accepts anything
+#define API_KEY "simulation"
+#define USER_EMAIL "user@example.com"
+#define USER_PASSWORD "simulation"
+#define TEST_EMAIL "test@example.com"
+#define TEST_PASSWORD "simulation"
+
+#endif
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cmath>
 #include "secrets.h"
 #include <Arduino.h>
@@ -37,7 +38,29 @@
 // Adafruit Motor Shield Library
 #include <Adafruit_MotorShield.h>
 
-#include <map>
+// Cooperative task scheduler
+#include <Scheduler.h>
+
+// Lock-free queue between the MQTT callback and the uploader task
+#include <SampleQueue.h>
+
+// Batches live writes into Firestore commits
+#include <BatchWriter.h>
+
+// Allocation-free decoder for Tasmota SENSOR messages, defines DeviceData
+#include <SensorDecoder.h>
+
+// Fixed-capacity table of the plugs seen on the broker
+#include <DeviceRegistry.h>
+
+// Constant-memory power and energy rollups
+#include <Rollup.h>
+
+// Values shown on the display, pushed to it as samples arrive
+#include <LiveState.h>
+
+// Flash-backed queue of the samples that could not be uploaded
+#include <Spool.h>
 
 // Time Library
 #include "time.h"
@@ -45,7 +68,14 @@
 // MQTT Server address
 // TODO: Change this address dynamically in App or Web
 #define MQTT_SERVER "mqtt.cetools.org"
-#define MQTT_TOPIC "UCL/OPS/107/EM/gosund/#"
+#define MQTT_TOPIC_ROOT "UCL/OPS/107/EM/gosund/"
+// Topic families handled, the '+' level is the device name
+#define MQTT_LWT_TOPIC MQTT_TOPIC_ROOT "+/LWT"
+#define MQTT_SENSOR_TOPIC MQTT_TOPIC_ROOT "+/SENSOR"
+#define MQTT_CLIENT_ID "DY_Device_Test"
+// Delay before retrying the broker, doubling after each failure
+#define MQTT_RETRY_MIN_MS 1000
+#define MQTT_RETRY_MAX_MS 60000
 
 #define LED_PIN 13
 
@@ -60,16 +90,47 @@
 #define BUTTON1_PIN 15
 #define BUTTON2_PIN 14
 
-// Define Firebase objects
+// Live samples waiting for upload. Must be a power of two.
+#define INGEST_QUEUE_SIZE 64
+// Samples the uploader takes from the queue per pass, so that it commits and
+// replays between them however fast they come in
+#define UPLOADER_DRAIN_SAMPLES 32
+// Firestore requests of the loop() jobs in flight. Must be a power of two.
+#define FIRESTORE_QUEUE_SIZE 16
+// The Arduino loop runs on core 1, the uploader runs next to the WiFi stack
+#define UPLOADER_CORE 0
+#define UPLOADER_STACK_SIZE 8192
+// Live writes are committed together once this many are pending ...
+#define LIVE_BATCH_SIZE 16
+// ... or the oldest one has waited this long (ms)
+#define LIVE_BATCH_DELAY 10000
+
+// Writes a sample takes in the live batch: two metadata patches and its document
+#define LIVE_SAMPLE_WRITES 3
+
+// Files of SPOOL_SEGMENT_SIZE the spool uses: 512 KB of the 1.5 MB flash file
+// system of the Feather ESP32 V2. A spooled sample takes 34 bytes with a
+// "tasmota_XXXXXX" name, so the spool holds about 15,000 samples, an outage of
+// 1 h 45 min with 24 plugs reporting every 10 s.
+#define SPOOL_SEGMENTS 32
+
+// Spooled samples replayed per commit while catching up
+#define SPOOL_REPLAY_SAMPLES (LIVE_BATCH_SIZE - 2)
+
+// How often the overall power is sampled into the rollups (ms)
+#define ROLLUP_SAMPLE_INTERVAL 10000
+// Rollups are uploaded every 15 minutes, hourly and daily ones with them
+#define ROLLUP_UPLOAD_INTERVAL 900000
+
+// Define Firebase objects. Firebase is used by setup(), then only by the
+// uploader task: loop() hands it FirestoreRequests.
 FirebaseData fbdo;
 FirebaseAuth auth;
 FirebaseConfig config;
 
 // Define JSON size
-DynamicJsonDocument incomingLive(256);
-DynamicJsonDocument MQTTincoming(512);
-DynamicJsonDocument firestoreJSON(1024);
-DynamicJsonDocument preferenceJSON(256);
+// Grows by pages for the runQuery responses larger than that
+DynamicJsonDocument firestoreJSON(512, 256);
 
 // Define NeoPixel object
 Adafruit_NeoPixel pixels(NUMPIXELS, LED_PIN, NEO_GRB + NEO_KHZ800);
@@ -84,33 +145,101 @@ Adafruit_MotorShield AFMS = Adafruit_MotorShield();
 // Select which 'port' M1, M2, M3 or M4. In this case, M1
 Adafruit_DCMotor *myMotor = AFMS.getMotor(1);
 
-// Define a data structure for MQTT data processing
-struct DeviceData
+// Define the scheduler that runs the jobs of loop()
+Scheduler scheduler(millis);
+
+// Compact record handed from the MQTT callback to the uploader task
+struct SensorSample
 {
-  unsigned long lastUpdated;
+  char deviceName[DEVICE_NAME_SIZE];
+  time_t capturedAt;
   int power;
-  float today;
-  float yesterday;
-  float total;
-  String time;
-  String startDate;
 };
 
+// A SensorSample as the spool stores it: the name goes without its padding
+struct SpooledSample
+{
+  uint32_t capturedAt;
+  int32_t power;
+  char deviceName[DEVICE_NAME_SIZE - 1]; // not NUL terminated
+};
+
+static_assert(sizeof(SpooledSample) <= SPOOL_RECORD_SIZE, "SpooledSample does not fit a spool record");
+static_assert(sizeof(SensorSample) > sizeof(SpooledSample), "SensorSample records are told apart by their length");
+
+enum FirestoreOp
+{
+  FIRESTORE_GET,
+  FIRESTORE_CREATE,
+  FIRESTORE_PATCH,
+  FIRESTORE_QUERY
+};
+
+struct FirestoreRequest;
+// Runs on loop() with the answer to a request
+typedef void (*FirestoreReplyHandler)(FirestoreRequest &reply);
+
+// A Firestore call of a loop() job. The uploader task makes it and sends the
+// request back with the answer, so loop() never waits on the network.
+struct FirestoreRequest
+{
+  FirestoreRequest(FirestoreOp op, const String &path, FirestoreReplyHandler done)
+      : op(op), path(path), done(done) {}
+
+  FirestoreOp op;
+  String path;
+  FirebaseJson json; // The document, or the structured query
+  String mask;       // The fields of a patch
+  FirestoreReplyHandler done;
+  long value = 0; // For done()
+
+  // Set by the uploader task
+  bool ok = false;
+  int httpCode = 0;
+  String payload; // The response of a read or query, the reason of a failure
+};
+
+// Spool counters for the report of liveDataTask(). The spool belongs to the
+// uploader task, which copies them here after each pass.
+struct SpoolReport
+{
+  std::atomic<uint32_t> pending;
+  std::atomic<uint32_t> bytesUsed;
+  std::atomic<uint32_t> segments;
+  std::atomic<uint32_t> dropped;
+  std::atomic<uint32_t> corrupted;
+};
+
+// Spool file operations on the flash file system configured in FirebaseFS.h
+class FlashSpoolFs : public SpoolFs
+{
+public:
+  int open(const char *path, SpoolOpenMode mode)
+  {
+    return fs.open(path, mbfs_flash, mode == SPOOL_OPEN_READ ? mb_fs_open_mode_read : mb_fs_open_mode_append);
+  }
+  int read(uint8_t *buffer, size_t length) { return fs.read(mbfs_flash, buffer, length); }
+  int write(const uint8_t *buffer, size_t length) { return fs.write(mbfs_flash, (uint8_t *)buffer, length); }
+  bool seek(size_t position) { return fs.seek(mbfs_flash, position); }
+  void close() { fs.close(mbfs_flash); }
+  bool existed(const char *path) { return fs.existed(path, mbfs_flash); }
+  bool remove(const char *path) { return fs.remove(path, mbfs_flash); }
+
+private:
+  MB_FS fs;
+};
+
+FlashSpoolFs spoolFs;
+Spool spool(spoolFs, "/spool", SPOOL_SEGMENT_SIZE, SPOOL_SEGMENTS);
+
 //
 // Define global variables
 //
-unsigned long liveDataMillis = 0;
-unsigned long historyDataMillis = 0;
-unsigned long testMillis = 0;
-unsigned long liveTransitionMillis = 0;
-unsigned long dailyLEDMillis = 0;
-unsigned long lastTransitionMillis = 0;
 unsigned long lastSaveAnimationLEDMillis = 0;
 unsigned long lastSaveMillis = 0;
 unsigned long Button1StateChangeTime = 0;
 unsigned long Button2StateChangeTime = 0;
 const unsigned long DebounceTime = 10;
-int deviceCount = 0;
 int transitionWait = 250;
 int saveWait = 3000;
 int liveLEDCount = 0;
@@ -127,12 +256,29 @@ int maxMarble = 10;
 int isTouched = 0;
 int startTime = 8;
 int endTime = 19;
-std::map<String, DeviceData> deviceList;
-FirebaseJson liveOverallJson;
-FirebaseJson historyOverallJson;
+int liveDataTaskId = -1;
+int historyTaskId = -1;
+int rollupUploadTaskId = -1;
+int hydrateTaskId = -1;
+int historyDevice = -1; // Next device of the history upload
+int mqttState = MQTT_DISCONNECTED;
+DeviceRegistry devices;
+RollupEngine rollups;
+unsigned long rollupUploads = 0;
+LiveState liveState;
+long uploadedMaxPower = -1;
+bool historyLEDShown = false;
+SampleQueue<SensorSample, INGEST_QUEUE_SIZE> ingestQueue(QUEUE_OVERWRITE_OLDEST);
+// Requests to the uploader task and their replies. No more than the queue
+// size are outstanding, so neither overflows.
+SampleQueue<FirestoreRequest *, FIRESTORE_QUEUE_SIZE> firestoreRequests;
+SampleQueue<FirestoreRequest *, FIRESTORE_QUEUE_SIZE> firestoreReplies;
+int firestoreOutstanding = 0;
+SpoolReport spoolReport;
+TaskHandle_t uploaderHandle = NULL;
+String historyTime;
 String defaultPath = "device/";
 String userUID;
-bool initialising = true;
 bool liveLEDInitialising = true;
 bool saveAnimationInit = true;
 bool isDebug = false;
@@ -145,6 +291,12 @@ bool isLEDOn = true;
 bool stopWheel = false;
 bool stopSaving = false;
 bool isRestarting = false;
+bool restartRequested = false;
+// Set while the requests of a job are with the uploader task
+bool liveOverallPending = false;
+bool historyPending = false;
+bool preferencePending = false;
+bool hydratePending = false;
 unsigned int livePower = 0;
 unsigned int liveFactor = 15;
 float todayFactor = 20;
@@ -157,76 +309,88 @@ const char *ntpServer = "pool.ntp.org";
 const long gmtOffset_sec = 0;
 const int daylightOffset_sec = 0;
 
-bool getUserPreference(String path = defaultPath.c_str())
+// Set the preference fields of the user document
+void setPreferenceFields(FirebaseJson &json, bool restarting)
+{
+  json.set("fields/preference/mapValue/fields/unitCost/doubleValue", unitEnergyCost);
+  json.set("fields/preference/mapValue/fields/targetCost/integerValue", targetCost);
+  json.set("fields/preference/mapValue/fields/isLEDOn/booleanValue", isLEDOn);
+  json.set("fields/preference/mapValue/fields/isForceStop/booleanValue", isDebug);
+  json.set("fields/preference/mapValue/fields/stopWheel/booleanValue", stopWheel);
+  json.set("fields/preference/mapValue/fields/stopSaving/booleanValue", stopSaving);
+  json.set("fields/preference/mapValue/fields/isRestarting/booleanValue", restarting);
+  json.set("fields/preference/mapValue/fields/startTime/integerValue", startTime);
+  json.set("fields/preference/mapValue/fields/endTime/integerValue", endTime);
+}
+
+// Take the preferences of the user document. Returns false if it has none.
+bool applyUserPreference(const String &payload)
 {
-  // Print path using printf
-  Serial.printf("path: %s\n", path.c_str());
-  FirebaseJson preferenceJSON;
-  bool isRead = Firebase.Firestore.getDocument(&fbdo, PROJECT_ID, "", path);
-  isRead ? Serial.println("Read Success") : Serial.println("Read Fail");
   FirebaseJson json;
   FirebaseJsonData result;
-  json.setJsonData(fbdo.payload());
+  json.setJsonData(payload);
   if (!json.get(result, "fields/preference"))
   {
-    Serial.println("User preference not found. Creating new preference.");
-    preferenceJSON.set("fields/preference/mapValue/fields/unitCost/doubleValue", unitEnergyCost);
-    preferenceJSON.set("fields/preference/mapValue/fields/targetCost/integerValue", targetCost);
-    preferenceJSON.set("fields/preference/mapValue/fields/isLEDOn/booleanValue", isLEDOn);
-    preferenceJSON.set("fields/preference/mapValue/fields/isForceStop/booleanValue", isDebug);
-    preferenceJSON.set("fields/preference/mapValue/fields/stopWheel/booleanValue", stopWheel);
-    preferenceJSON.set("fields/preference/mapValue/fields/stopSaving/booleanValue", stopSaving);
-    preferenceJSON.set("fields/preference/mapValue/fields/isRestarting/booleanValue", isRestarting);
-    preferenceJSON.set("fields/preference/mapValue/fields/startTime/integerValue", startTime);
-    preferenceJSON.set("fields/preference/mapValue/fields/endTime/integerValue", endTime);
-
-    Firebase.Firestore.patchDocument(&fbdo, PROJECT_ID, "", path, preferenceJSON.raw(), "preference");
-    return true;
+    return false;
   }
-  else
+  if (json.get(result, "fields/preference/mapValue/fields/unitCost/doubleValue"))
+  {
+    unitEnergyCost = result.to<double>();
+  }
+  if (json.get(result, "fields/preference/mapValue/fields/targetCost/integerValue"))
+  {
+    targetCost = result.to<int>();
+  }
+  if (json.get(result, "fields/preference/mapValue/fields/isLEDOn/booleanValue"))
+  {
+    isLEDOn = result.to<bool>();
+  }
+  if (json.get(result, "fields/preference/mapValue/fields/isForceStop/booleanValue"))
+  {
+    isDebug = result.to<bool>();
+  }
+  if (json.get(result, "fields/preference/mapValue/fields/stopWheel/booleanValue"))
+  {
+    stopWheel = result.to<bool>();
+  }
+  if (json.get(result, "fields/preference/mapValue/fields/stopSaving/booleanValue"))
+  {
+    stopSaving = result.to<bool>();
+  }
+  if (json.get(result, "fields/preference/mapValue/fields/isRestarting/booleanValue"))
+  {
+    isRestarting = result.to<bool>();
+  }
+  if (json.get(result, "fields/preference/mapValue/fields/startTime/integerValue"))
+  {
+    startTime = result.to<int>();
+  }
+  if (json.get(result, "fields/preference/mapValue/fields/endTime/integerValue"))
+  {
+    endTime = result.to<int>();
+  }
+  return true;
+}
+
+// Read the preferences at start up, before the uploader task takes over
+// Firestore. liveDataTask() refreshes them through refreshUserPreference().
+bool getUserPreference(String path = defaultPath.c_str())
+{
+  // Print path using printf
+  Serial.printf("path: %s\n", path.c_str());
+  bool isRead = Firebase.Firestore.getDocument(&fbdo, PROJECT_ID, "", path);
+  isRead ? Serial.println("Read Success") : Serial.println("Read Fail");
+  if (applyUserPreference(fbdo.payload()))
   {
     Serial.println("User preference found.");
-    json.setJsonData(fbdo.payload());
-    if (json.get(result, "fields/preference/mapValue/fields/unitCost/doubleValue"))
-    {
-      unitEnergyCost = result.to<double>();
-    }
-    if (json.get(result, "fields/preference/mapValue/fields/targetCost/integerValue"))
-    {
-      targetCost = result.to<int>();
-    }
-    if (json.get(result, "fields/preference/mapValue/fields/isLEDOn/booleanValue"))
-    {
-      isLEDOn = result.to<bool>();
-    }
-    if (json.get(result, "fields/preference/mapValue/fields/isForceStop/booleanValue"))
-    {
-      isDebug = result.to<bool>();
-    }
-    if (json.get(result, "fields/preference/mapValue/fields/stopWheel/booleanValue"))
-    {
-      stopWheel = result.to<bool>();
-    }
-    if (json.get(result, "fields/preference/mapValue/fields/stopSaving/booleanValue"))
-    {
-      stopSaving = result.to<bool>();
-    }
-    if (json.get(result, "fields/preference/mapValue/fields/isRestarting/booleanValue"))
-    {
-      isRestarting = result.to<bool>();
-    }
-    if (json.get(result, "fields/preference/mapValue/fields/startTime/integerValue"))
-    {
-      startTime = result.to<int>();
-    }
-    if (json.get(result, "fields/preference/mapValue/fields/endTime/integerValue"))
-    {
-      endTime = result.to<int>();
-    }
     return true;
   }
 
-  return false;
+  Serial.println("User preference not found. Creating new preference.");
+  FirebaseJson preferenceJSON;
+  setPreferenceFields(preferenceJSON, isRestarting);
+  Firebase.Firestore.patchDocument(&fbdo, PROJECT_ID, "", path, preferenceJSON.raw(), "preference");
+  return true;
 }
 
 void setup()
@@ -301,8 +465,15 @@ void setup()
 
   // Set MQTT Server
   mqttClient.setServer(MQTT_SERVER, 1883);
-  mqttClient.setCallback(callback);
   mqttClient.setBufferSize(512);
+  // Subscribed on every connect, each family straight to its handler
+  mqttClient.subscribe(MQTT_LWT_TOPIC, 0, onDeviceLwt);
+  mqttClient.subscribe(MQTT_SENSOR_TOPIC, 0, onDeviceSensor);
+  mqttClient.setStreamCallback(onLargeMessage);
+  // mqttTask() connects and reconnects without waiting on the broker
+  mqttClient.setConnectCallback(onMqttConnect);
+  mqttClient.setReconnect(MQTT_CLIENT_ID);
+  mqttClient.setReconnectDelay(MQTT_RETRY_MIN_MS, MQTT_RETRY_MAX_MS);
 
   if (!AFMS.begin())
   { // create with the default frequency 1.6KHz
@@ -322,26 +493,30 @@ void setup()
   pinMode(33, INPUT_PULLUP);
 
   getUserPreference(defaultPath.c_str());
+
+  registerTasks();
+
+  // The display follows the local state
+  liveState.subscribe(onLivePower, STATE_MASK(STATE_MEAN_POWER) | STATE_MASK(STATE_MAX_POWER));
+  liveState.subscribe(onToday, STATE_MASK(STATE_TODAY));
+
+  // Upload live samples and make the Firestore calls of loop() from the other core
+  xTaskCreatePinnedToCore(uploaderTask, "uploader", UPLOADER_STACK_SIZE, NULL, 1, &uploaderHandle, UPLOADER_CORE);
 }
 
 void loop()
 {
-  if (isRestarting == true)
-  {
-    // Change isRestarting to false in Firestore
-    FirebaseJson restartJson;
-    restartJson.set("fields/preference/mapValue/fields/unitCost/doubleValue", unitEnergyCost);
-    restartJson.set("fields/preference/mapValue/fields/targetCost/integerValue", targetCost);
-    restartJson.set("fields/preference/mapValue/fields/isLEDOn/booleanValue", isLEDOn);
-    restartJson.set("fields/preference/mapValue/fields/isForceStop/booleanValue", isDebug);
-    restartJson.set("fields/preference/mapValue/fields/stopWheel/booleanValue", stopWheel);
-    restartJson.set("fields/preference/mapValue/fields/stopSaving/booleanValue", stopSaving);
-    restartJson.set("fields/preference/mapValue/fields/isRestarting/booleanValue", false);
-    restartJson.set("fields/preference/mapValue/fields/startTime/integerValue", startTime);
-    restartJson.set("fields/preference/mapValue/fields/endTime/integerValue", endTime);
-    Firebase.Firestore.patchDocument(&fbdo, PROJECT_ID, "", defaultPath.c_str(), restartJson.raw(), "preference");
-    ESP.restart();
+  if (isRestarting == true && !restartRequested)
+  {
+    // Change isRestarting to false in Firestore, the reply restarts
+    FirestoreRequest *request = new FirestoreRequest(FIRESTORE_PATCH, defaultPath, onRestartSaved);
+    setPreferenceFields(request->json, false);
+    request->mask = "preference";
+    restartRequested = postFirestore(request);
   }
+  // Also at night, when the jobs are not run
+  deliverFirestoreReplies();
+
   // if time is after 7pm and before 8am, turn off the LED using timeinfo
   struct tm tinfo;
   getLocalTime(&tinfo);
@@ -366,615 +541,1113 @@ void loop()
   }
   else
   {
-    ////////////////////////////////
-    // Connect MQTT Client
-    ////////////////////////////////
-    if (!mqttClient.connected())
+    // Run the jobs registered in registerTasks()
+    scheduler.run();
+  }
+}
+
+////////////////////////////////
+// Scheduled jobs
+////////////////////////////////
+void registerTasks()
+{
+  // Time critical jobs run every loop and always before network jobs
+  scheduler.addPeriodic("mqtt", mqttTask, 0, PRIORITY_CRITICAL);
+  scheduler.addPeriodic("marble", marbleTask, 0, PRIORITY_CRITICAL);
+  scheduler.addPeriodic("ledTransition", ledTransitionTask, transitionWait, PRIORITY_HIGH);
+
+  // Network jobs yield to the jobs above once the run budget is spent
+  liveDataTaskId = scheduler.addPeriodic("liveData", liveDataTask, 60000, PRIORITY_LOW);
+  historyTaskId = scheduler.addPeriodic("history", historyTask, 1800000, PRIORITY_LOW);
+  scheduler.addPeriodic("liveState", liveStateTask, 0, PRIORITY_HIGH);
+  scheduler.addPeriodic("rollupSample", rollupSampleTask, ROLLUP_SAMPLE_INTERVAL, PRIORITY_NORMAL);
+  hydrateTaskId = scheduler.addPeriodic("hydrate", hydrateTask, 5000, PRIORITY_LOW, true);
+  rollupUploadTaskId = scheduler.addPeriodic("rollupUpload", rollupUploadTask, ROLLUP_UPLOAD_INTERVAL, PRIORITY_LOW);
+}
+
+// Skip a job while the marble saving sequence owns the motor and LEDs and
+// retry it on the next loop, so it runs as soon as saving has finished.
+bool deferWhileSaving(int taskId)
+{
+  if (saveMarbleRequired)
+  {
+    scheduler.trigger(taskId);
+    return true;
+  }
+  return false;
+}
+
+////////////////////////////////
+// Firestore requests of the jobs, made by the uploader task
+////////////////////////////////
+
+// Hand a request to the uploader task, which then owns it until the reply.
+// Returns false, deleting the request, if too many are outstanding.
+bool postFirestore(FirestoreRequest *request)
+{
+  if (firestoreOutstanding >= FIRESTORE_QUEUE_SIZE || !firestoreRequests.push(request, millis()))
+  {
+    Serial.printf("Firestore: too many requests, skipping %s\n", request->path.c_str());
+    delete request;
+    return false;
+  }
+  firestoreOutstanding++;
+  return true;
+}
+
+// Run the handlers of the replies from the uploader task
+void deliverFirestoreReplies()
+{
+  FirestoreRequest *reply;
+  while (firestoreReplies.pop(reply, millis()))
+  {
+    firestoreOutstanding--;
+    if (reply->done)
     {
-      Serial.println("MQTT Client not connected");
-      reconnect();
+      reply->done(*reply);
     }
+    delete reply;
+  }
+}
 
-    ////////////////////////////////
-    // Check for inactive devices every minute
-    // Update overall data
-    // Update User preference
-    ////////////////////////////////
-    if (millis() - liveDataMillis > 60000 && !saveMarbleRequired)
-    {
-      for (auto it = deviceList.begin(); it != deviceList.end();)
-      {
-        if (millis() - it->second.lastUpdated > 60000)
-        {                            // 60000 milliseconds = 1 minute
-          it = deviceList.erase(it); // remove the device from the list
-          deviceCount--;             // decrement the device count
-        }
-        else
-        {
-          ++it;
-        }
-      }
-      // Update Live Overall data
-      Serial.println(updateOverallLive());
+// Reply to a write nothing waits for
+void onWritten(FirestoreRequest &reply)
+{
+  if (reply.ok)
+  {
+    Serial.printf("Written %s\n", reply.path.c_str());
+  }
+  else
+  {
+    Serial.printf("Failed to write %s: %s\n", reply.path.c_str(), reply.payload.c_str());
+  }
+}
 
-      // Check marble saving
-      if (stopSaving == false)
-      {
-        saveMarbleRequired = checkMarbleSaving();
-      }
+// Read the user preferences, applied when the reply comes
+void refreshUserPreference()
+{
+  if (preferencePending)
+  {
+    return;
+  }
+  preferencePending = postFirestore(new FirestoreRequest(FIRESTORE_GET, defaultPath, onPreferenceRead));
+}
+
+void onPreferenceRead(FirestoreRequest &reply)
+{
+  preferencePending = false;
+  if (reply.ok && applyUserPreference(reply.payload))
+  {
+    return;
+  }
+  if (!reply.ok && reply.httpCode != 404)
+  {
+    Serial.println(reply.payload);
+    return;
+  }
 
-      // Refresh User Preference
-      getUserPreference(defaultPath.c_str());
+  Serial.println("User preference not found. Creating new preference.");
+  FirestoreRequest *request = new FirestoreRequest(FIRESTORE_PATCH, defaultPath, onWritten);
+  setPreferenceFields(request->json, isRestarting);
+  request->mask = "preference";
+  postFirestore(request);
+}
 
-      liveDataMillis = millis();
-    }
+void onRestartSaved(FirestoreRequest &reply)
+{
+  ESP.restart();
+}
 
-    ////////////////////////////////
-    // Update history data every 30 mins
-    ////////////////////////////////
-    if (millis() - historyDataMillis > 1800000 && !saveMarbleRequired)
+////////////////////////////////
+// Connect MQTT Client and pump incoming messages
+////////////////////////////////
+void mqttTask()
+{
+  // One step at a time: a connection attempt, a CONNACK or a message
+  mqttClient.loop();
+
+  int state = mqttClient.state();
+  if (state != mqttState)
+  {
+    mqttState = state;
+    if (state != MQTT_CONNECTED)
     {
-      historyDataMillis = millis();
-      Serial.println(updateHistory());
+      Serial.print("MQTT Client not connected, rc=");
+      Serial.println(state);
     }
+  }
+}
+
+////////////////////////////////
+// Check for inactive devices every minute
+// Update overall data
+// Update User preference
+////////////////////////////////
+void liveDataTask()
+{
+  if (deferWhileSaving(liveDataTaskId))
+  {
+    return;
+  }
 
-    ///////////////////////////////
-    // Get live Data for transition animation
-    ///////////////////////////////
-    if (Firebase.ready() && !saveMarbleRequired)
+  // Remove the devices not heard from for a minute, with their rollups
+  devices.expire(millis(), 60000);
+  for (int id = 0; id < DEVICE_REGISTRY_CAPACITY; id++)
+  {
+    if (!devices.contains(id))
     {
-      if (millis() - liveTransitionMillis > 60000 || initialising)
-      {
-        liveTransitionMillis = millis();
-
-        String queryPath = defaultPath;
-        queryPath += "sensors/overall/";
-        FirebaseJson query;
-
-        query.set("select/fields/[0]/fieldPath", "power");
-        query.set("select/fields/[1]/fieldPath", "time");
-        query.set("from/collectionId", "live");
-        query.set("from/allDescendants", false);
-        query.set("orderBy/field/fieldPath", "time");
-        query.set("orderBy/direction", "DESCENDING");
-        query.set("limit", 1);
-
-        JsonArray queryResult = queryFirestore(queryPath, query);
-
-        if (queryResult.size() > 0)
-        {
-          livePower = queryResult[0]["document"]["fields"]["power"]["integerValue"].as<int>();
-          Serial.printf("Power: %d\n", livePower);
-        }
-        else
-        {
-          Serial.println("No query result");
-        }
-
-        // Set LED attribute
-        liveLEDCount = int(mapValue(livePower, 0, roundToHundred(maximumLivePower), 0, maxLiveLED));
-        if (stopWheel == false)
-        {
-          motorSpeed = int(mapValue(livePower, 0, roundToHundred(maximumLivePower), 20, 50));
-        }
-        else
-        {
-          motorSpeed = 0;
-        }
-      }
+      rollups.removeDevice(id);
     }
+  }
+  publishTotals();
+  // Update Live Overall data
+  updateOverallLive();
+
+  QueueStats queueStats = ingestQueue.stats();
+  Serial.printf("Upload queue: depth %u/%u, high water %u, dropped %u, lag %u ms (max %u ms)\n",
+                (unsigned)ingestQueue.size(), (unsigned)ingestQueue.capacity(), (unsigned)queueStats.highWater,
+                (unsigned)(queueStats.overwritten + queueStats.dropped), (unsigned)queueStats.lastLag,
+                (unsigned)queueStats.maxLag);
+  Serial.printf("Spool: pending %u, %u bytes in %u segments, dropped %u, corrupted %u\n",
+                (unsigned)spoolReport.pending.load(), (unsigned)spoolReport.bytesUsed.load(),
+                (unsigned)spoolReport.segments.load(), (unsigned)spoolReport.dropped.load(),
+                (unsigned)spoolReport.corrupted.load());
+
+  // Check marble saving
+  if (stopSaving == false)
+  {
+    saveMarbleRequired = checkMarbleSaving();
+  }
 
-    ////////////////////////////////
-    // Set NeoPixel color based on live data
-    ////////////////////////////////
-    if (!saveMarbleRequired && isLEDOn)
-    {
-      // Show LED animation
-      if (millis() - lastTransitionMillis > transitionWait)
-      {
-        pixels.setPixelColor(CENTRE_LED, pixels.Color(255, 0, 0));
-        if (liveLEDInitialising)
-        {
-          pixels.setPixelColor(CENTRE_LED + lastLEDCount, pixels.Color(232, 229, 88));
-          pixels.show();
-          lastLEDCount++;
-          if (lastLEDCount == liveLEDCount)
-          {
-            liveLEDInitialising = false;
-          }
-        }
-        else
-        {
-          if (liveLEDCount - lastLEDCount > 0)
-          {
-            for (int i = 1; i < liveLEDCount; i++)
-            {
-              pixels.setPixelColor(CENTRE_LED + i, pixels.Color(232, 229, 88));
-            }
-            pixels.show();
-            lastLEDCount++;
-          }
-          else if (liveLEDCount - lastLEDCount < 0)
-          {
-            pixels.setPixelColor(CENTRE_LED + lastLEDCount, pixels.Color(0, 0, 0));
-            pixels.show();
-            lastLEDCount--;
-          }
-          else
-          {
-            pixels.setPixelColor(CENTRE_LED + lastLEDCount, pixels.Color(232, 229, 88));
-            pixels.show();
-          }
-        }
-      }
+  // Refresh User Preference
+  refreshUserPreference();
+}
+
+////////////////////////////////
+// Update history data every 30 mins
+////////////////////////////////
+void historyTask()
+{
+  if (deferWhileSaving(historyTaskId))
+  {
+    return;
+  }
+
+  updateHistory();
+}
+
+////////////////////////////////
+// Upload the rollups every 15 mins, hourly and daily ones with them
+////////////////////////////////
+void rollupUploadTask()
+{
+  if (deferWhileSaving(rollupUploadTaskId))
+  {
+    return;
+  }
+
+  // The uploader task holds them until Firebase is ready
+  rollupUploads++;
+  updateRollups(ROLLUP_15MIN);
+  if (rollupUploads % (3600000 / ROLLUP_UPLOAD_INTERVAL) == 0)
+  {
+    updateRollups(ROLLUP_1HOUR);
+  }
+  if (rollupUploads % (86400000 / ROLLUP_UPLOAD_INTERVAL) == 0)
+  {
+    updateRollups(ROLLUP_1DAY);
+  }
+}
+
+////////////////////////////////
+// Sample the overall power into the rollups
+////////////////////////////////
+void rollupSampleTask()
+{
+  time_t now = time(NULL);
+  rollups.addOverall(now, devices.totals().power);
+
+  RollupStats stats;
+  if (rollups.overall(ROLLUP_1MIN, now, stats) && stats.samples > 0)
+  {
+    liveState.setMeanPower(stats.meanPower);
+  }
+}
+
+////////////////////////////////
+// Deliver state changes to the display
+////////////////////////////////
+void liveStateTask()
+{
+  liveState.dispatch();
+}
+
+// Copy the device totals into the live state
+void publishTotals()
+{
+  const DeviceTotals &totals = devices.totals();
+  liveState.setPower(totals.power);
+  liveState.setToday(totals.today, totals.devices > 0);
+  liveState.setDevices(totals.devices);
+}
+
+////////////////////////////////
+// Set the transition animation and motor speed from the smoothed power
+////////////////////////////////
+void onLivePower(const StateSnapshot &state, uint32_t changed)
+{
+  // The saving sequence owns the motor and LEDs and replays the state after
+  if (saveMarbleRequired)
+  {
+    return;
+  }
+
+  livePower = round(state.meanPower);
+  if (state.maxPower > 0)
+  {
+    maximumLivePower = state.maxPower;
+  }
+
+  // Set LED attribute
+  liveLEDCount = int(mapValue(livePower, 0, roundToHundred(maximumLivePower), 0, maxLiveLED));
+  if (stopWheel == false)
+  {
+    motorSpeed = int(mapValue(livePower, 0, roundToHundred(maximumLivePower), 20, 50));
+  }
+  else
+  {
+    motorSpeed = 0;
+  }
+}
+
+////////////////////////////////
+// Set NeoPixel color based on live data
+////////////////////////////////
+void ledTransitionTask()
+{
+  if (isLEDOn == false)
+  {
+    pixels.clear();
+    pixels.show();
+    historyLEDShown = false;
+    return;
+  }
+  if (saveMarbleRequired)
+  {
+    return;
+  }
+  if (!historyLEDShown)
+  {
+    // Repaint the daily usage once the LEDs are back on
+    liveState.touch(STATE_MASK(STATE_TODAY));
+  }
 
-      // Get history data and set LED
-      if (millis() - dailyLEDMillis > 600000 || initialising)
+  // Show LED animation
+  pixels.setPixelColor(CENTRE_LED, pixels.Color(255, 0, 0));
+  if (liveLEDInitialising)
+  {
+    pixels.setPixelColor(CENTRE_LED + lastLEDCount, pixels.Color(232, 229, 88));
+    pixels.show();
+    lastLEDCount++;
+    if (lastLEDCount == liveLEDCount)
+    {
+      liveLEDInitialising = false;
+    }
+  }
+  else
+  {
+    if (liveLEDCount - lastLEDCount > 0)
+    {
+      for (int i = 1; i < liveLEDCount; i++)
       {
-        dailyLEDMillis = millis();
-
-        String queryPath = defaultPath;
-        queryPath += "sensors/overall/";
-        FirebaseJson query;
-
-        query.set("select/fields/[0]/fieldPath", "today");
-        query.set("select/fields/[1]/fieldPath", "time");
-        query.set("from/collectionId", "history");
-        query.set("from/allDescendants", false);
-        query.set("orderBy/field/fieldPath", "time");
-        query.set("orderBy/direction", "DESCENDING");
-        query.set("limit", 1);
-
-        JsonArray queryResult = queryFirestore(queryPath, query);
-
-        if (queryResult.size() > 0)
-        {
-          float today = queryResult[0]["document"]["fields"]["today"]["doubleValue"].as<float>();
-          Serial.printf("Today: %f\n", today);
-          historyLEDCount = int(mapValue(today, 0, 2, 0, CENTRE_LED - 1));
-          // historyLEDCount = int(map(today, 0, 2, 0, CENTRE_LED - 1));
-        }
-        else
-        {
-          Serial.println("No query result");
-        }
-
-        // Set LED attribute
-        for (int i = 0; i < CENTRE_LED; i++)
-        {
-          pixels.setPixelColor(i, pixels.Color(0, 0, 0));
-        }
-        for (int i = CENTRE_LED - 1; i > CENTRE_LED - historyLEDCount; i--)
-        {
-          pixels.setPixelColor(i, pixels.Color(232, 229, 88));
-          pixels.show();
-        }
+        pixels.setPixelColor(CENTRE_LED + i, pixels.Color(232, 229, 88));
       }
+      pixels.show();
+      lastLEDCount++;
     }
-
-    ////////////////////////////////
-    // Set Motor Speed
-    ////////////////////////////////
-    if (!saveMarbleRequired)
+    else if (liveLEDCount - lastLEDCount < 0)
     {
-      myMotor->run(FORWARD);
-      myMotor->setSpeed(motorSpeed);
+      pixels.setPixelColor(CENTRE_LED + lastLEDCount, pixels.Color(0, 0, 0));
+      pixels.show();
+      lastLEDCount--;
+    }
+    else
+    {
+      pixels.setPixelColor(CENTRE_LED + lastLEDCount, pixels.Color(232, 229, 88));
+      pixels.show();
     }
+  }
+}
+
+////////////////////////////////
+// Show today's usage on the LEDs
+////////////////////////////////
+void onToday(const StateSnapshot &state, uint32_t changed)
+{
+  if (!isLEDOn || saveMarbleRequired)
+  {
+    return;
+  }
+  int count = int(mapValue(state.today, 0, 2, 0, CENTRE_LED - 1));
+  if (historyLEDShown && count == historyLEDCount)
+  {
+    return;
+  }
+  historyLEDCount = count;
+
+  // Set LED attribute
+  for (int i = 0; i < CENTRE_LED; i++)
+  {
+    pixels.setPixelColor(i, pixels.Color(0, 0, 0));
+  }
+  for (int i = CENTRE_LED - 1; i > CENTRE_LED - historyLEDCount; i--)
+  {
+    pixels.setPixelColor(i, pixels.Color(232, 229, 88));
+  }
+  pixels.show();
+  historyLEDShown = true;
+}
+
+////////////////////////////////
+// Set Motor Speed and run the Marble Saving Sequence
+////////////////////////////////
+void marbleTask()
+{
+  if (saveMarbleRequired == false)
+  {
+    myMotor->run(FORWARD);
+    myMotor->setSpeed(motorSpeed);
+    return;
+  }
 
-    ////////////////////////////////
-    // Marble Saving Sequence
-    ////////////////////////////////
-    if (saveMarbleRequired == true)
+  if (isSavingFinished == true)
+  {
+    // wait for the last marble to drop
+    if (millis() - lastSaveMillis > saveWait * 1.3)
     {
-      if (isSavingFinished == true)
-      {
-        // wait for the last marble to drop
-        if (millis() - lastSaveMillis > saveWait * 1.3)
-        {
-          Serial.println("Stopping saving sequence");
-          myMotor->run(RELEASE);
-          myMotor->run(FORWARD);
-          myMotor->setSpeed(motorSpeed);
-          saveMarbleRequired = false;
-          saveAnimationInit = true;
-          isSavingFinished = false;
-          // LED Reset
-          lastLEDCount = 0;
-          pixels.clear();
-          Serial.printf("liveLEDCount: %d\n", liveLEDCount);
-          Serial.printf("historyLEDCount: %d\n", historyLEDCount);
-          for (int i = CENTRE_LED - 1; i > CENTRE_LED - historyLEDCount; i--)
-          {
-            pixels.setPixelColor(i, pixels.Color(232, 229, 88));
-            pixels.show();
-          }
-        }
-      }
-      else
+      Serial.println("Stopping saving sequence");
+      myMotor->run(RELEASE);
+      myMotor->run(FORWARD);
+      myMotor->setSpeed(motorSpeed);
+      saveMarbleRequired = false;
+      saveAnimationInit = true;
+      isSavingFinished = false;
+      // LED Reset
+      lastLEDCount = 0;
+      pixels.clear();
+      Serial.printf("liveLEDCount: %d\n", liveLEDCount);
+      Serial.printf("historyLEDCount: %d\n", historyLEDCount);
+      for (int i = CENTRE_LED - 1; i > CENTRE_LED - historyLEDCount; i--)
       {
-        if (saveAnimationInit == true)
-        {
-          myMotor->run(RELEASE);
-          pixels.clear(); // Set all pixel colors to 'off'
-          saveAnimationInit = false;
-        }
-
-        // Set LED animation
-        if (millis() - lastSaveAnimationLEDMillis > transitionWait / 5 && isLEDOn == true)
-        {
-          pixels.clear();
-          pixels.setPixelColor(saveAnimationLastLEDCount - 2, pixels.Color(232, 239, 247));
-          pixels.setPixelColor(saveAnimationLastLEDCount - 1, pixels.Color(133, 186, 247));
-          pixels.setPixelColor(saveAnimationLastLEDCount, pixels.Color(10, 120, 247));
-          pixels.show();
-          saveAnimationLastLEDCount--;
-          if (saveAnimationLastLEDCount == 0)
-          {
-            saveAnimationLastLEDCount = NUMPIXELS;
-          }
-          lastSaveAnimationLEDMillis = millis();
-        }
-
-        myMotor->run(BACKWARD);
-        myMotor->setSpeed(30);
-        isTouched = digitalRead(33) == LOW ? true : false;
-        if ((millis() - lastSaveMillis > saveWait) && (isTouched == true))
-        {
-          Serial.println("Touch sensor is pressed");
-          savedMarble++;
-          lastSaveMillis = millis();
-          Serial.printf("savedMarble: %d / targetMarble: %d\n", savedMarble, targetMarble);
-        }
-        if (savedMarble >= targetMarble)
-        {
-          Serial.println("Saving is finished");
-          isSavingFinished = true;
-        }
+        pixels.setPixelColor(i, pixels.Color(232, 229, 88));
+        pixels.show();
       }
+      // Catch up with the changes skipped while saving
+      liveState.touch(STATE_ALL);
     }
-    else
+  }
+  else
+  {
+    if (saveAnimationInit == true)
     {
-      myMotor->run(FORWARD);
+      myMotor->run(RELEASE);
+      pixels.clear(); // Set all pixel colors to 'off'
+      saveAnimationInit = false;
     }
 
-    initialising = false;
-
-    if (isLEDOn == false)
+    // Set LED animation
+    if (millis() - lastSaveAnimationLEDMillis > transitionWait / 5 && isLEDOn == true)
     {
       pixels.clear();
+      pixels.setPixelColor(saveAnimationLastLEDCount - 2, pixels.Color(232, 239, 247));
+      pixels.setPixelColor(saveAnimationLastLEDCount - 1, pixels.Color(133, 186, 247));
+      pixels.setPixelColor(saveAnimationLastLEDCount, pixels.Color(10, 120, 247));
       pixels.show();
+      saveAnimationLastLEDCount--;
+      if (saveAnimationLastLEDCount == 0)
+      {
+        saveAnimationLastLEDCount = NUMPIXELS;
+      }
+      lastSaveAnimationLEDMillis = millis();
     }
 
-    lastTransitionMillis = millis();
+    myMotor->run(BACKWARD);
+    myMotor->setSpeed(30);
+    isTouched = digitalRead(33) == LOW ? true : false;
+    if ((millis() - lastSaveMillis > saveWait) && (isTouched == true))
+    {
+      Serial.println("Touch sensor is pressed");
+      savedMarble++;
+      lastSaveMillis = millis();
+      Serial.printf("savedMarble: %d / targetMarble: %d\n", savedMarble, targetMarble);
+    }
+    if (savedMarble >= targetMarble)
+    {
+      Serial.println("Saving is finished");
+      isSavingFinished = true;
+    }
+  }
+}
 
-    // Regularly check for MQTT connection
-    mqttClient.loop();
+// Checks the device name the topic filter captured fits the device table
+bool deviceCaptured(const MQTTTopicMatch &match)
+{
+  if (match.count < 1 || match.captures[0].length >= DEVICE_NAME_SIZE)
+  {
+    Serial.printf("Ignoring topic %s\n", match.topic);
+    return false;
   }
+  return true;
 }
 
-void callback(char *topic, byte *payload, unsigned int length)
+// ".../{deviceName}/LWT": counts the devices
+void onDeviceLwt(const MQTTTopicMatch &match, byte *payload, unsigned int length)
 {
-  String topicString(topic);
-  int lastSlash = topicString.lastIndexOf('/');
-  String lastSection = topicString.substring(0, lastSlash); // Get the string up to the last '/'
-  lastSlash = lastSection.lastIndexOf('/');                 // Find the position of the second last '/'
-  String deviceName = lastSection.substring(lastSlash + 1); // Extract the section after the second last '/'
+  if (!deviceCaptured(match))
+  {
+    return;
+  }
+  const char *device = match.captures[0].start;
+  size_t deviceLength = match.captures[0].length;
+  if (devices.find(device, deviceLength) >= 0)
+  {
+    return;
+  }
+  if (devices.intern(device, deviceLength, millis()) < 0)
+  {
+    Serial.println("Device table is full");
+    return;
+  }
+
+  liveState.setDevices(devices.size());
 
-  // Check number of device
-  if (topicString.indexOf("LWT") != -1 && deviceList.find(deviceName) == deviceList.end())
+  Serial.print("Number of devices: ");
+  Serial.println(devices.size());
+
+  Serial.print("Contents of topicList:");
+  for (int id = devices.first(); id >= 0; id = devices.next(id))
+  {
+    Serial.print(devices.name(id));
+    Serial.print(", ");
+  }
+  Serial.println("");
+}
+
+// ".../{deviceName}/SENSOR": records the reading
+void onDeviceSensor(const MQTTTopicMatch &match, byte *payload, unsigned int length)
+{
+  if (!deviceCaptured(match))
+  {
+    return;
+  }
+  DeviceData data = {};
+  data.lastUpdated = millis(); // Record received time
+  // Decode straight from the MQTT buffer
+  DecodeResult result = decodeSensor(payload, length, data);
+  if (result == DECODE_INVALID)
   {
-    // TODO : Count the number of device regularly
-    deviceCount++;
-    DeviceData data;
-    data.lastUpdated = millis();
-    deviceList[deviceName] = data;
+    Serial.print(F("decodeSensor() failed: "));
+    Serial.println(decodeResultString(result));
+    return;
+  }
 
-    Serial.print("Number of devices: ");
-    Serial.println(deviceCount);
+  int id = devices.intern(match.captures[0].start, match.captures[0].length, data.lastUpdated);
+  if (id < 0)
+  {
+    Serial.println("Device table is full");
+    return;
+  }
+  devices.update(id, data);
+  rollups.addDevice(id, time(NULL), data.power, data.total);
+  publishTotals();
+
+  // Hand the sample to the uploader task, never wait on the network here
+  SensorSample sample;
+  memcpy(sample.deviceName, devices.name(id), sizeof(sample.deviceName));
+  sample.capturedAt = time(NULL);
+  sample.power = data.power;
+  ingestQueue.push(sample, millis());
+}
 
-    Serial.print("Contents of topicList:");
-    for (auto &device : deviceList)
-    {
-      Serial.print(device.first);
-      Serial.print(", ");
-    }
-    Serial.println("");
+// Messages too large for the MQTT buffer arrive here in pieces. None are
+// expected, so note them rather than have them disappear.
+void onLargeMessage(char *topic, byte *chunk, unsigned int length, uint32_t offset, uint32_t total)
+{
+  if (offset == 0)
+  {
+    Serial.printf("Skipping %u byte message on %s\n", (unsigned int)total, topic);
   }
+}
 
-  // Check SENSOR value
-  if (topicString.indexOf("SENSOR") != -1)
+// Sends a batch of live writes as one Firestore commit
+class FirestoreCommitSink : public CommitSink
+{
+public:
+  bool commit(const BatchWrite *writes, size_t count)
   {
-    DeviceData data;
-    data.lastUpdated = millis(); // Record received time
-    char msg[length + 1];        // Convert the bytes data to char
-    memcpy(msg, payload, length);
-    msg[length] = '\0';
-    DeserializationError error = deserializeJson(MQTTincoming, msg); // Convert the Char data to Json format
-    if (error)
+    std::vector<struct fb_esp_firestore_document_write_t> commitWrites;
+    for (size_t i = 0; i < count; i++)
     {
-      Serial.print(F("deserializeJson() failed: "));
-      Serial.println(error.f_str());
-      return;
+      struct fb_esp_firestore_document_write_t write;
+      write.type = fb_esp_firestore_document_write_type_update;
+      write.update_document_path = writes[i].path;
+      write.update_document_content = writes[i].content;
+      write.update_masks = writes[i].mask;
+      commitWrites.push_back(write);
     }
-    data.time = String(MQTTincoming["Time"].as<const char *>());
-    data.startDate = String(MQTTincoming["ENERGY"]["TotalStartTime"].as<const char *>());
-    data.startDate += "Z"; // For ZULU format
-    data.total = MQTTincoming["ENERGY"]["Total"];
-    data.today = MQTTincoming["ENERGY"]["Today"];
-    data.yesterday = MQTTincoming["ENERGY"]["Yesterday"];
-    data.power = MQTTincoming["ENERGY"]["Power"];
-
-    deviceList[deviceName] = data;
-
-    FirebaseJson liveJson;
-    String sensorLocation = "UCL/OPS/107";
-    String sensorType = "EM";
-    int livePower = data.power;
-    String currentTime = getCurrentTime();
-    String documentPath = defaultPath;
-
-    liveJson.set("fields/lastUpdated/timestampValue", currentTime);
-
-    /* Send the live data to Firestore
-    Structure: device/{userUID}/sensors/{deviceName}/live/{autogeratedID}
-    */
-    if (Firebase.Firestore.patchDocument(&fbdo, PROJECT_ID, "", documentPath.c_str(), liveJson.raw(), "lastUpdated"))
+    if (!Firebase.Firestore.commitDocument(&fbdo, PROJECT_ID, "", commitWrites, ""))
+    {
+      Serial.println(fbdo.errorReason());
+      return false;
+    }
+    Serial.printf("Live Data: Committed %u writes\n", (unsigned)count);
+    return true;
+  }
+};
+
+FirestoreCommitSink liveSink;
+BatchWriter liveWriter(liveSink, millis, LIVE_BATCH_SIZE, LIVE_BATCH_DELAY);
+
+// Set while the last live commit failed and its writes wait for a retry
+bool commitFailing = false;
+// Set while spooled samples are in the writer but not committed yet
+bool replayPending = false;
+
+////////////////////////////////
+// Uploader task, pinned to UPLOADER_CORE
+////////////////////////////////
+void uploaderTask(void *parameter)
+{
+  SensorSample sample;
+  liveWriter.setSeed(esp_random());
+  if (!spool.begin())
+  {
+    Serial.println("Spool: recovery failed");
+  }
+  Serial.printf("Spool: %u samples to upload\n", (unsigned)spool.pending());
+
+  while (true)
+  {
+    bool ready = Firebase.ready();
+    for (int drained = 0; drained < UPLOADER_DRAIN_SAMPLES; drained++)
     {
-      documentPath += "sensors/";
-      documentPath += deviceName;
-      documentPath += "/";
-      liveJson.clear();
-      liveJson.set("fields/location/stringValue", sensorLocation);
-      liveJson.set("fields/type/stringValue", sensorType);
-      if (Firebase.Firestore.patchDocument(&fbdo, PROJECT_ID, "", documentPath.c_str(), liveJson.raw(), "location,type"))
+      // Once samples are spooled, newer ones queue behind them to keep the order
+      bool live = ready && !commitFailing && spool.empty();
+      // A full batch is committed by poll() below, the samples wait for it
+      if (live && liveWriter.room() < LIVE_SAMPLE_WRITES)
+      {
+        break;
+      }
+      if (!ingestQueue.pop(sample, millis()))
+      {
+        break;
+      }
+      if (live && batchSample(sample))
+      {
+        continue;
+      }
+      if (live)
       {
-        documentPath += "live/";
-        Serial.println(documentPath);
-        liveJson.clear();
-        liveJson.set("fields/power/integerValue", livePower);
-        liveJson.set("fields/time/timestampValue", currentTime);
-        if (Firebase.Firestore.createDocument(&fbdo, PROJECT_ID, "", documentPath.c_str(), liveJson.raw()))
-        {
-          // Serial.printf("ok\n%s\n\n", fbdo.payload().c_str());
-          // print success message and time
-          Serial.printf("Live Data: Success at %s\n", currentTime.c_str());
-        }
-        else
-        {
-          Serial.println(fbdo.errorReason());
-        }
+        // Refused by the writer, it and the samples after it go to the spool
+        commitFailing = true;
       }
-      else
+      if (!spoolSample(sample))
       {
-        Serial.println(fbdo.errorReason());
+        Serial.println("Spool: append failed, sample lost");
       }
     }
-    else
+
+    if (ready)
     {
-      Serial.println(fbdo.errorReason());
+      // Without room for another sample the batch is as full as it gets. A
+      // failed one waits for the retry of poll().
+      bool full = !commitFailing && liveWriter.room() < LIVE_SAMPLE_WRITES;
+      if (!(full ? liveWriter.flush() : liveWriter.poll()))
+      {
+        commitFailing = true;
+      }
+      else if (liveWriter.pending() == 0)
+      {
+        commitFailing = false;
+      }
+      if (replayPending && !commitFailing && liveWriter.pending() == 0)
+      {
+        spool.ack();
+        replayPending = false;
+      }
+      if (!replayPending && !commitFailing && !spool.empty())
+      {
+        replaySpool();
+      }
+      // One per pass, so a burst of them does not hold up the live commits.
+      // While the commits fail they wait, rather than each adding a timeout
+      // for the samples to queue behind.
+      if (!commitFailing)
+      {
+        runFirestoreRequest();
+      }
     }
+    publishSpoolReport();
+    vTaskDelay(pdMS_TO_TICKS(20));
   }
 }
 
-void reconnect()
+// Make the next Firestore call of loop() and send the answer back
+void runFirestoreRequest()
 {
-  while (!mqttClient.connected())
+  FirestoreRequest *request;
+  if (!firestoreRequests.pop(request, millis()))
   {
-    Serial.print("Attempting MQTT connection...");
-    if (mqttClient.connect("DY_Device_Test"))
-    {
-      Serial.println("connected");
-      Serial.print("Subscription is...");
-      Serial.println(mqttClient.subscribe(MQTT_TOPIC) ? "Success" : "Fail");
-      Serial.print("Subscribed Topic is: ");
-      Serial.println(MQTT_TOPIC);
-    }
-    else
-    {
-      Serial.print("failed, rc=");
-      Serial.print(mqttClient.state());
-      Serial.println(" try again in 5 seconds");
-      delay(5000);
-    }
+    return;
+  }
+  switch (request->op)
+  {
+  case FIRESTORE_GET:
+    request->ok = Firebase.Firestore.getDocument(&fbdo, PROJECT_ID, "", request->path);
+    break;
+  case FIRESTORE_CREATE:
+    request->ok = Firebase.Firestore.createDocument(&fbdo, PROJECT_ID, "", request->path, request->json.raw());
+    break;
+  case FIRESTORE_PATCH:
+    request->ok = Firebase.Firestore.patchDocument(&fbdo, PROJECT_ID, "", request->path, request->json.raw(),
+                                                   request->mask);
+    break;
+  case FIRESTORE_QUERY:
+    request->ok = Firebase.Firestore.runQuery(&fbdo, PROJECT_ID, "", request->path, &request->json);
+    break;
+  }
+  request->httpCode = fbdo.httpCode();
+  if (!request->ok)
+  {
+    request->payload = fbdo.errorReason();
+  }
+  else if (request->op == FIRESTORE_GET || request->op == FIRESTORE_QUERY)
+  {
+    request->payload = fbdo.payload();
   }
+  firestoreReplies.push(request, millis());
 }
 
-int sumPower()
+void publishSpoolReport()
+{
+  const SpoolStats &stats = spool.stats();
+  spoolReport.pending.store(spool.pending(), std::memory_order_relaxed);
+  spoolReport.bytesUsed.store(spool.bytesUsed(), std::memory_order_relaxed);
+  spoolReport.segments.store(spool.segments(), std::memory_order_relaxed);
+  spoolReport.dropped.store(stats.dropped, std::memory_order_relaxed);
+  spoolReport.corrupted.store(stats.corrupted, std::memory_order_relaxed);
+}
+
+bool spoolSample(const SensorSample &sample)
+{
+  SpooledSample record;
+  size_t length = strnlen(sample.deviceName, sizeof(record.deviceName));
+  record.capturedAt = (uint32_t)sample.capturedAt;
+  record.power = sample.power;
+  memcpy(record.deviceName, sample.deviceName, length);
+  return spool.append(&record, offsetof(SpooledSample, deviceName) + length);
+}
+
+// Read the next spooled sample. Returns false if there is none; `valid` is
+// false for a record that is not a sample, which is skipped.
+bool nextSpooledSample(SensorSample &sample, bool &valid)
 {
-  int totalPower = 0;
-  for (auto const &pair : deviceList)
+  uint8_t buffer[SPOOL_RECORD_SIZE];
+  size_t length = spool.next(buffer, sizeof(buffer));
+  if (length == 0)
   {
-    totalPower += pair.second.power;
+    return false;
+  }
+  // Spooled by a firmware that stored the SensorSample as it is
+  if (length == sizeof(sample))
+  {
+    memcpy(&sample, buffer, length);
+    sample.deviceName[sizeof(sample.deviceName) - 1] = '\0';
+    valid = true;
+    return true;
   }
-  return totalPower;
+  SpooledSample record;
+  valid = length > offsetof(SpooledSample, deviceName) && length <= sizeof(record);
+  if (valid)
+  {
+    memcpy(&record, buffer, length);
+    size_t nameLength = length - offsetof(SpooledSample, deviceName);
+    memcpy(sample.deviceName, record.deviceName, nameLength);
+    sample.deviceName[nameLength] = '\0';
+    sample.capturedAt = record.capturedAt;
+    sample.power = record.power;
+  }
+  return true;
 }
 
-float sumTotalUse()
+// Commit the oldest spooled samples. If the commit fails the writer keeps
+// them and retries, and they are acknowledged once it succeeds.
+void replaySpool()
 {
-  float totalUse = 0;
-  for (auto const &pair : deviceList)
+  SensorSample sample;
+  bool valid;
+  int taken = 0;
+  int replayed = 0;
+  // Only read what the writer takes: samples read are acknowledged with it
+  while (taken < SPOOL_REPLAY_SAMPLES && liveWriter.room() >= LIVE_SAMPLE_WRITES &&
+         nextSpooledSample(sample, valid))
   {
-    totalUse += pair.second.total;
+    taken++;
+    if (!valid)
+    {
+      Serial.println("Spool: skipped a record that is not a sample");
+      continue;
+    }
+    batchSample(sample);
+    replayed++;
+  }
+  if (taken == 0)
+  {
+    return;
+  }
+
+  replayPending = true;
+  if (liveWriter.flush())
+  {
+    spool.ack();
+    replayPending = false;
+    Serial.printf("Spool: replayed %d samples, %u left\n", replayed, (unsigned)spool.pending());
+  }
+  else
+  {
+    commitFailing = true;
   }
-  return totalUse;
 }
 
-float sumTodayUse()
+/* Queue the live data for the next Firestore commit
+    Structure: device/{userUID}/sensors/{deviceName}/live/{autogeratedID}
+   Returns false, queuing nothing, if the batch has no room for the sample.
+   Writes too long for the batch are counted by the writer and dropped, they
+   would never fit.
+*/
+bool batchSample(const SensorSample &sample)
 {
-  float totalUse = 0;
-  for (auto const &pair : deviceList)
+  if (liveWriter.room() < LIVE_SAMPLE_WRITES)
+  {
+    return false;
+  }
+
+  FirebaseJson liveJson;
+  String sensorLocation = "UCL/OPS/107";
+  String sensorType = "EM";
+  String currentTime = formatTime(sample.capturedAt);
+  String documentPath = defaultPath;
+  bool queued = true;
+
+  liveJson.set("fields/lastUpdated/timestampValue", currentTime);
+  queued &= liveWriter.patchDocument(documentPath.c_str(), liveJson.raw(), "lastUpdated");
+
+  // Location and type rarely change, the writer skips them when unchanged
+  documentPath += "sensors/";
+  documentPath += sample.deviceName;
+  liveJson.clear();
+  liveJson.set("fields/location/stringValue", sensorLocation);
+  liveJson.set("fields/type/stringValue", sensorType);
+  queued &= liveWriter.patchDocument(documentPath.c_str(), liveJson.raw(), "location,type");
+
+  documentPath += "/live";
+  liveJson.clear();
+  liveJson.set("fields/power/integerValue", sample.power);
+  liveJson.set("fields/time/timestampValue", currentTime);
+  queued &= liveWriter.addDocument(documentPath.c_str(), liveJson.raw());
+  if (!queued)
   {
-    totalUse += pair.second.today;
+    Serial.printf("Live Data: write of %s dropped\n", sample.deviceName);
   }
-  return totalUse;
+  return true;
+}
+
+void onMqttConnect()
+{
+  // The client has subscribed to MQTT_LWT_TOPIC and MQTT_SENSOR_TOPIC again
+  Serial.println("MQTT connected");
+}
+
+int sumPower()
+{
+  return devices.totals().power;
+}
+
+float sumTotalUse()
+{
+  return devices.totals().total;
+}
+
+float sumTodayUse()
+{
+  return devices.totals().today;
 }
 
 float sumYesterdayUse()
 {
-  float YesterdayUse = 0;
-  for (auto const &pair : deviceList)
-  {
-    YesterdayUse += pair.second.yesterday;
-  }
-  return YesterdayUse;
+  return devices.totals().yesterday;
 }
 
 /* Send the live overall data to Firestore
     Structure: device/{userUID}/sensors/overall/live/{autoGeneratedID}
 */
-String updateOverallLive()
+void updateOverallLive()
 {
-  int powerSum = sumPower();
-  String result = "Live Overall Data:";
+  if (liveOverallPending)
+  {
+    Serial.println("Live Overall Data: the last upload is still pending");
+    return;
+  }
   String currentTime = getCurrentTime();
   String liveOverallPath = defaultPath;
   liveOverallPath += "sensors/overall";
   Serial.printf("liveOverallPath: %s\n", liveOverallPath.c_str());
-  // Check overall document exists, if not create one
-  if (!Firebase.Firestore.getDocument(&fbdo, PROJECT_ID, "", liveOverallPath.c_str()))
+  // The document was read or created once at start up, only patch it
+  FirestoreRequest *patch = new FirestoreRequest(FIRESTORE_PATCH, liveOverallPath, onOverallPatched);
+  long maxPower = liveState.snapshot().maxPower;
+  patch->json.set("fields/lastUpdated/timestampValue", currentTime);
+  patch->mask = "lastUpdated";
+  patch->value = -1;
+  // Never lower the stored maximum: only write it once it was read
+  if (uploadedMaxPower >= 0 && maxPower > uploadedMaxPower)
   {
-    FirebaseJson overallInitJson;
-    overallInitJson.set("fields/created/timestampValue", currentTime);
-    overallInitJson.set("fields/maxPower/integerValue", powerSum);
-    Firebase.Firestore.createDocument(&fbdo, PROJECT_ID, "", liveOverallPath.c_str(), overallInitJson.raw());
-    maximumLivePower = powerSum;
-  }
-  else
-  {
-    firestoreJSON.clear();
-    DeserializationError error = deserializeJson(firestoreJSON, fbdo.payload().c_str());
-    if (error)
-    {
-      Serial.print(F("deserializeJson() failed: "));
-      Serial.println(error.f_str());
-    }
-    else
-    {
-      // serializeJsonPretty(firestoreJSON, Serial);
-      Serial.println("Deserialize JSON success");
-    }
-    int maxPower = firestoreJSON["fields"]["maxPower"]["integerValue"];
-    // Serial.printf("maxPower: %d\n", maxPower);
-    // Serial.printf("powerSum: %d\n", powerSum);
-    FirebaseJson overallInitJson;
-    overallInitJson.set("fields/lastUpdated/timestampValue", currentTime);
-    if (maxPower < powerSum)
-    {
-      overallInitJson.set("fields/maxPower/integerValue", powerSum);
-
-      maximumLivePower = powerSum;
-    }
-
-    bool result = Firebase.Firestore.patchDocument(&fbdo, PROJECT_ID, "", liveOverallPath.c_str(), overallInitJson.raw(), "lastUpdated,maxPower");
-    if (!result)
-    {
-      Serial.println(fbdo.errorReason());
-      Serial.println(fbdo.payload());
-    }
+    patch->json.set("fields/maxPower/integerValue", maxPower);
+    patch->mask += ",maxPower";
+    patch->value = maxPower;
   }
+  postFirestore(patch);
 
   liveOverallPath += "/live/";
-  liveOverallJson.set("fields/time/timestampValue", currentTime);
-  liveOverallJson.set("fields/devices/integerValue", deviceCount);
-  liveOverallJson.set("fields/power/integerValue", powerSum);
+  FirestoreRequest *live = new FirestoreRequest(FIRESTORE_CREATE, liveOverallPath, onOverallLiveWritten);
+  live->json.set("fields/time/timestampValue", currentTime);
+  live->json.set("fields/devices/integerValue", devices.size());
+  live->json.set("fields/power/integerValue", sumPower());
+  liveOverallPending = postFirestore(live);
+}
 
-  if (Firebase.Firestore.createDocument(&fbdo, PROJECT_ID, "", liveOverallPath.c_str(), liveOverallJson.raw()))
+void onOverallPatched(FirestoreRequest &reply)
+{
+  if (!reply.ok)
   {
-    // Serial.printf("ok\n%s\n\n", fbdo.payload().c_str());
-    result += "Success at";
-    result += currentTime;
-    return result;
+    Serial.println(reply.payload);
   }
-  else
+  else if (reply.value > uploadedMaxPower)
   {
-    return fbdo.errorReason();
+    uploadedMaxPower = reply.value;
   }
 }
 
-/* Send the live overall data to Firestore
+void onOverallLiveWritten(FirestoreRequest &reply)
+{
+  liveOverallPending = false;
+  onWritten(reply);
+}
+
+/* Send the history data to Firestore, one document after the other
     Structure: device/{userUID}/sensors/{deviceName}/history/{autoGeneratedID}
     Structure: device/{userUID}/sensors/overall/history/{autoGeneratedID}
 */
-String updateHistory()
+void updateHistory()
 {
-  String result = "History Data:";
-  String currentTime = getCurrentTime();
+  if (historyPending)
+  {
+    Serial.println("History Data: the last upload is still pending");
+    return;
+  }
+  historyTime = getCurrentTime();
+  historyDevice = devices.first();
+  historyPending = postNextHistory();
+}
 
-  // Update history data for each device to Firestore
-  for (auto const &pair : deviceList)
+// Post the history of historyDevice, then the overall history. Returns false
+// if nothing was posted.
+bool postNextHistory()
+{
+  String historyPath = defaultPath;
+  historyPath += "sensors/";
+  // The devices expired since the upload started are skipped
+  if (historyDevice >= 0)
   {
-    String historyPath = defaultPath;
-    historyPath += "sensors/";
-    historyPath += pair.first;
+    historyPath += devices.name(historyDevice);
     historyPath += "/history/";
 
-    FirebaseJson historyJson;
-    historyJson.set("fields/time/timestampValue", currentTime);
-    historyJson.set("fields/total/doubleValue", pair.second.total);
-    historyJson.set("fields/today/doubleValue", pair.second.today);
-    historyJson.set("fields/yesterday/doubleValue", pair.second.yesterday);
-    historyJson.set("fields/startDate/timestampValue", pair.second.startDate);
+    FirestoreRequest *request = new FirestoreRequest(FIRESTORE_CREATE, historyPath, onHistoryWritten);
+    request->json.set("fields/time/timestampValue", historyTime);
+    request->json.set("fields/total/doubleValue", devices.total(historyDevice));
+    request->json.set("fields/today/doubleValue", devices.today(historyDevice));
+    request->json.set("fields/yesterday/doubleValue", devices.yesterday(historyDevice));
+    request->json.set("fields/startDate/timestampValue", devices.startDate(historyDevice));
+    return postFirestore(request);
+  }
 
-    if (Firebase.Firestore.createDocument(&fbdo, PROJECT_ID, "", historyPath.c_str(), historyJson.raw()))
-    {
-      result += pair.first;
-      result += ",";
-      result += "Success at";
-      result += currentTime;
-    }
-    else
+  historyPath += "overall/history/";
+  FirestoreRequest *request = new FirestoreRequest(FIRESTORE_CREATE, historyPath, onHistoryWritten);
+  request->json.set("fields/total/doubleValue", sumTotalUse());
+  request->json.set("fields/today/doubleValue", sumTodayUse());
+  request->json.set("fields/yesterday/doubleValue", sumYesterdayUse());
+  request->json.set("fields/time/timestampValue", historyTime);
+  request->value = 1;
+  return postFirestore(request);
+}
+
+void onHistoryWritten(FirestoreRequest &reply)
+{
+  onWritten(reply);
+  // value is set on the overall history, the last one
+  if (reply.value)
+  {
+    historyPending = false;
+    return;
+  }
+  historyDevice = devices.next(historyDevice);
+  historyPending = postNextHistory();
+}
+
+// Set the statistics of a window under `prefix`
+void setRollupFields(FirebaseJson &json, const String &prefix, const RollupStats &stats)
+{
+  json.set(prefix + "samples/integerValue", (int)stats.samples);
+  json.set(prefix + "minPower/integerValue", stats.minPower);
+  json.set(prefix + "maxPower/integerValue", stats.maxPower);
+  json.set(prefix + "meanPower/doubleValue", stats.meanPower);
+  json.set(prefix + "p50Power/integerValue", stats.p50Power);
+  json.set(prefix + "p95Power/integerValue", stats.p95Power);
+  json.set(prefix + "energy/doubleValue", stats.energy);
+}
+
+/* Send one document with the overall and per-device rollups of a window
+    Structure: device/{userUID}/sensors/overall/rollups/{autoGeneratedID}
+*/
+void updateRollups(RollupWindow window)
+{
+  time_t now = time(NULL);
+  String currentTime = formatTime(now);
+  RollupStats stats;
+
+  String rollupPath = defaultPath;
+  rollupPath += "sensors/overall/rollups/";
+  FirestoreRequest *request = new FirestoreRequest(FIRESTORE_CREATE, rollupPath, onWritten);
+  FirebaseJson &rollupJson = request->json;
+  rollupJson.set("fields/window/stringValue", rollupWindowName(window));
+  rollupJson.set("fields/time/timestampValue", currentTime);
+  rollupJson.set("fields/devices/integerValue", devices.size());
+  if (rollups.overall(window, now, stats))
+  {
+    setRollupFields(rollupJson, "fields/", stats);
+  }
+  for (int id = devices.first(); id >= 0; id = devices.next(id))
+  {
+    if (rollups.device(id, window, now, stats))
     {
-      result += "\n";
-      result += pair.first;
-      result += " Error:";
-      result += fbdo.errorReason();
-      result += "\n";
+      String prefix = "fields/sensors/mapValue/fields/";
+      prefix += devices.name(id);
+      prefix += "/mapValue/fields/";
+      setRollupFields(rollupJson, prefix, stats);
     }
   }
 
-  // Update overall history data to Firestore
-  String historyOverallPath = defaultPath;
-  historyOverallPath += "sensors/overall/history/";
+  postFirestore(request);
+}
+
+////////////////////////////////
+// Read the stored state once at start up
+////////////////////////////////
+void hydrateTask()
+{
+  if (!hydratePending)
+  {
+    hydratePending = hydrateState();
+  }
+}
 
-  historyOverallJson.set("fields/total/doubleValue", sumTotalUse());
-  historyOverallJson.set("fields/today/doubleValue", sumTodayUse());
-  historyOverallJson.set("fields/yesterday/doubleValue", sumYesterdayUse());
-  historyOverallJson.set("fields/time/timestampValue", currentTime);
+/* Seed the live state from Firestore, creating the overall document if needed.
+   Each step posts the next from the reply to the one before, hydrateTask()
+   starts over if one fails.
+    Structure: device/{userUID}/sensors/overall
+    Structure: device/{userUID}/sensors/overall/history/{autoGeneratedID}
+*/
+bool hydrateState()
+{
+  String overallPath = defaultPath;
+  overallPath += "sensors/overall";
+  return postFirestore(new FirestoreRequest(FIRESTORE_GET, overallPath, onOverallRead));
+}
 
-  if (Firebase.Firestore.createDocument(&fbdo, PROJECT_ID, "", historyOverallPath.c_str(), historyOverallJson.raw()))
+void onOverallRead(FirestoreRequest &reply)
+{
+  if (reply.ok)
+  {
+    firestoreJSON.clear();
+    DeserializationError error = deserializeJson(firestoreJSON, reply.payload.c_str());
+    if (error)
+    {
+      Serial.print(F("deserializeJson() failed: "));
+      Serial.println(error.f_str());
+      hydratePending = false;
+      return;
+    }
+    uploadedMaxPower = firestoreJSON["fields"]["maxPower"]["integerValue"].as<long>();
+    liveState.hydrateMaxPower(uploadedMaxPower);
+    hydratePending = queryToday(reply.path);
+  }
+  else if (reply.httpCode == 404)
   {
-    result += "\n";
-    result += "History Overall Success at";
-    result += currentTime;
+    long maxPower = liveState.snapshot().maxPower;
+    FirestoreRequest *request = new FirestoreRequest(FIRESTORE_CREATE, reply.path, onOverallCreated);
+    request->json.set("fields/created/timestampValue", getCurrentTime());
+    request->json.set("fields/maxPower/integerValue", maxPower);
+    request->value = maxPower;
+    hydratePending = postFirestore(request);
   }
   else
   {
-    result += "\n";
-    result += "History Overall Failed at";
-    result += currentTime;
-    result += "\nError:";
-    result += fbdo.errorReason();
-    result += "\n";
+    Serial.println(reply.payload);
+    hydratePending = false;
   }
-
-  // Return result message
-  return result;
 }
 
-bool refreshFirebase()
+void onOverallCreated(FirestoreRequest &reply)
 {
-  Firebase.refreshToken(&config);
-  Serial.print("Token refreshed.");
-  if (Firebase.ready())
+  if (!reply.ok)
   {
-    Serial.println("Firebase Ready.");
-    return true;
+    Serial.println(reply.payload);
+    hydratePending = false;
+    return;
   }
-  else
+  uploadedMaxPower = reply.value;
+  hydratePending = queryToday(reply.path);
+}
+
+// Today's usage until the plugs report
+bool queryToday(const String &overallPath)
+{
+  String queryPath = overallPath;
+  queryPath += "/";
+  FirestoreRequest *request = new FirestoreRequest(FIRESTORE_QUERY, queryPath, onTodayRead);
+  FirebaseJson &query = request->json;
+  query.set("select/fields/[0]/fieldPath", "today");
+  query.set("select/fields/[1]/fieldPath", "time");
+  query.set("from/collectionId", "history");
+  query.set("from/allDescendants", false);
+  query.set("orderBy/field/fieldPath", "time");
+  query.set("orderBy/direction", "DESCENDING");
+  query.set("limit", 1);
+  return postFirestore(request);
+}
+
+void onTodayRead(FirestoreRequest &reply)
+{
+  // Without a result the plugs set it soon enough
+  JsonArray queryResult = parseQueryResult(reply);
+  if (queryResult.size() > 0)
   {
-    Serial.print("Firebase Failed.");
-    return false;
+    float today = queryResult[0]["document"]["fields"]["today"]["doubleValue"].as<float>();
+    Serial.printf("Today: %f\n", today);
+    liveState.hydrateToday(today);
   }
+  Serial.printf("State hydrated, maxPower: %ld\n", uploadedMaxPower);
+  hydratePending = false;
+  scheduler.remove(hydrateTaskId);
 }
 
 void rainbowFade2White(int wait, int rainbowLoops, int whiteLoops)
@@ -1070,12 +1743,24 @@ String getCurrentTime()
   return String(buffer);
 }
 
-JsonArray queryFirestore(String path, FirebaseJson query)
+// Format a timestamp as ISO 8601 / RFC 3339 (Zulu Time). Safe to call from
+// any task.
+String formatTime(time_t t)
+{
+  struct tm timeinfo;
+  char buffer[32];
+  gmtime_r(&t, &timeinfo);
+  strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+  return String(buffer);
+}
+
+// The documents of a runQuery reply
+JsonArray parseQueryResult(const FirestoreRequest &reply)
 {
   firestoreJSON.clear();
-  if (Firebase.Firestore.runQuery(&fbdo, PROJECT_ID, "", path, &query))
+  if (reply.ok)
   {
-    DeserializationError error = deserializeJson(firestoreJSON, fbdo.payload().c_str());
+    DeserializationError error = deserializeJson(firestoreJSON, reply.payload.c_str());
 
     // Test if parsing succeeds.
     if (error)
@@ -1083,9 +1768,9 @@ JsonArray queryFirestore(String path, FirebaseJson query)
       Serial.print(F("deserializeJson() failed: "));
       Serial.println(error.f_str());
     }
-    // Here's how you can access values in the document
-    return firestoreJSON.as<JsonArray>();
   }
+  // An empty array when the query failed
+  return firestoreJSON.as<JsonArray>();
 }
 
 int roundToHundred(int num)
@@ -0,0 +1,311 @@
+#include <unity.h>
+
+#include <BatchWriter.h>
+
+#include <stdio.h>
+#include <string.h>
+
+static unsigned long fakeNow = 0;
+static unsigned long fakeClock()
+{
+  return fakeNow;
+}
+
+// Stand-in for the Firestore REST endpoint. Renders each commit the way it
+// would be POSTed and records the request count and the last body.
+class FakeFirestore : public CommitSink
+{
+public:
+  FakeFirestore() : requests(0), documents(0), fail(false) {}
+
+  bool commit(const BatchWrite *writes, size_t count)
+  {
+    requests++;
+    size_t length = BatchWriter::renderCommit(writes, count, "energycelab", "", body, sizeof(body));
+    if (length == 0 || fail)
+    {
+      return false;
+    }
+    documents += count;
+    return true;
+  }
+
+  int requests;
+  int documents;
+  bool fail;
+  char body[4096];
+};
+
+static const char *liveContent = "{\"fields\":{\"power\":{\"integerValue\":\"12\"}}}";
+static const char *metaContent = "{\"fields\":{\"location\":{\"stringValue\":\"UCL/OPS/107\"},\"type\":{\"stringValue\":\"EM\"}}}";
+
+void setUp()
+{
+  fakeNow = 0;
+}
+
+void tearDown() {}
+
+void test_flush_when_batch_is_full()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 4, 10000);
+
+  for (int i = 0; i < 4; i++)
+  {
+    TEST_ASSERT_TRUE(writer.addDocument("device/uid/sensors/plug1/live", liveContent));
+    writer.poll();
+  }
+  TEST_ASSERT_EQUAL(1, firestore.requests);
+  TEST_ASSERT_EQUAL(4, firestore.documents);
+  TEST_ASSERT_EQUAL(0, writer.pending());
+}
+
+void test_flush_when_batch_is_old()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 16, 5000);
+
+  writer.addDocument("device/uid/sensors/plug1/live", liveContent);
+  fakeNow = 4999;
+  writer.poll();
+  TEST_ASSERT_EQUAL(0, firestore.requests);
+  fakeNow = 5000;
+  writer.poll();
+  TEST_ASSERT_EQUAL(1, firestore.requests);
+  TEST_ASSERT_EQUAL(1, firestore.documents);
+}
+
+void test_full_batch_rejects_writes()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 2, 5000);
+
+  TEST_ASSERT_TRUE(writer.addDocument("a", liveContent));
+  TEST_ASSERT_TRUE(writer.patchDocument("b", metaContent, "location,type"));
+  TEST_ASSERT_EQUAL(0, writer.room());
+  TEST_ASSERT_FALSE(writer.addDocument("a", liveContent));
+  TEST_ASSERT_FALSE(writer.patchDocument("c", metaContent, "location,type"));
+  // Nothing is sent, the pending writes wait for the caller to commit them
+  TEST_ASSERT_EQUAL(0, firestore.requests);
+  TEST_ASSERT_EQUAL(2, writer.pending());
+  TEST_ASSERT_EQUAL(2, writer.stats().rejected);
+  TEST_ASSERT_EQUAL(0, writer.stats().dropped);
+
+  // A pending patch of the same target still takes the new value
+  TEST_ASSERT_TRUE(writer.patchDocument("b", liveContent, "location,type"));
+
+  firestore.fail = true;
+  TEST_ASSERT_FALSE(writer.flush());
+  TEST_ASSERT_FALSE(writer.addDocument("a", liveContent));
+  TEST_ASSERT_EQUAL(2, writer.pending());
+
+  firestore.fail = false;
+  TEST_ASSERT_TRUE(writer.flush());
+  TEST_ASSERT_EQUAL(2, firestore.documents);
+  TEST_ASSERT_TRUE(writer.addDocument("a", liveContent));
+}
+
+void test_failed_full_batch_waits_for_retry()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 2, 1000);
+
+  writer.addDocument("a", liveContent);
+  writer.addDocument("a", liveContent);
+  firestore.fail = true;
+  TEST_ASSERT_FALSE(writer.poll());
+  TEST_ASSERT_EQUAL(1, firestore.requests);
+
+  // Full as it is, the batch is not sent again before maxDelay
+  fakeNow = 999;
+  TEST_ASSERT_TRUE(writer.poll());
+  TEST_ASSERT_EQUAL(1, firestore.requests);
+  firestore.fail = false;
+  fakeNow = 1000;
+  TEST_ASSERT_TRUE(writer.poll());
+  TEST_ASSERT_EQUAL(2, firestore.requests);
+  TEST_ASSERT_EQUAL(0, writer.pending());
+
+  // Once a commit went through, a full batch is sent right away again
+  writer.addDocument("a", liveContent);
+  writer.addDocument("a", liveContent);
+  TEST_ASSERT_TRUE(writer.poll());
+  TEST_ASSERT_EQUAL(3, firestore.requests);
+}
+
+void test_patches_are_coalesced_while_pending()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 16, 5000);
+
+  writer.patchDocument("device/uid", "{\"fields\":{\"lastUpdated\":{\"timestampValue\":\"2023-07-11T22:00:00Z\"}}}", "lastUpdated");
+  writer.patchDocument("device/uid", "{\"fields\":{\"lastUpdated\":{\"timestampValue\":\"2023-07-11T22:00:10Z\"}}}", "lastUpdated");
+  TEST_ASSERT_EQUAL(1, writer.pending());
+  TEST_ASSERT_EQUAL(1, writer.stats().coalesced);
+
+  writer.flush();
+  TEST_ASSERT_TRUE(strstr(firestore.body, "22:00:10Z") != NULL);
+  TEST_ASSERT_TRUE(strstr(firestore.body, "22:00:00Z") == NULL);
+}
+
+void test_unchanged_metadata_is_elided()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 16, 5000);
+
+  writer.patchDocument("device/uid/sensors/plug1", metaContent, "location,type");
+  writer.flush();
+  TEST_ASSERT_EQUAL(1, firestore.documents);
+
+  writer.patchDocument("device/uid/sensors/plug1", metaContent, "location,type");
+  TEST_ASSERT_EQUAL(0, writer.pending());
+  TEST_ASSERT_EQUAL(1, writer.stats().elided);
+
+  // A different device or a changed value is still written
+  writer.patchDocument("device/uid/sensors/plug2", metaContent, "location,type");
+  writer.patchDocument("device/uid/sensors/plug1", "{\"fields\":{\"location\":{\"stringValue\":\"UCL/OPS/108\"},\"type\":{\"stringValue\":\"EM\"}}}", "location,type");
+  TEST_ASSERT_EQUAL(2, writer.pending());
+}
+
+void test_failed_commit_is_retried()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 16, 1000);
+
+  writer.addDocument("a", liveContent);
+  writer.patchDocument("device/uid/sensors/plug1", metaContent, "location,type");
+  firestore.fail = true;
+  fakeNow = 1000;
+  TEST_ASSERT_FALSE(writer.poll());
+  TEST_ASSERT_EQUAL(2, writer.pending());
+
+  firestore.fail = false;
+  fakeNow = 1500;
+  TEST_ASSERT_TRUE(writer.poll());
+  TEST_ASSERT_EQUAL(2, writer.pending());
+  fakeNow = 2000;
+  TEST_ASSERT_TRUE(writer.poll());
+  TEST_ASSERT_EQUAL(0, writer.pending());
+  TEST_ASSERT_EQUAL(1, writer.stats().failures);
+  TEST_ASSERT_EQUAL(2, firestore.documents);
+
+  // Metadata from a failed commit is not considered stored until it succeeds
+  writer.patchDocument("device/uid/sensors/plug1", metaContent, "location,type");
+  TEST_ASSERT_EQUAL(1, writer.stats().elided);
+}
+
+void test_oversized_write_is_dropped()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 16, 1000);
+  char content[BATCH_CONTENT_SIZE + 1];
+  memset(content, 'x', sizeof(content) - 1);
+  content[sizeof(content) - 1] = '\0';
+
+  TEST_ASSERT_FALSE(writer.addDocument("a", content));
+  TEST_ASSERT_EQUAL(1, writer.stats().dropped);
+  TEST_ASSERT_EQUAL(0, writer.pending());
+}
+
+void test_render_commit_body()
+{
+  BatchWrite writes[2];
+  strcpy(writes[0].path, "device/uid/sensors/plug1/live/abc");
+  strcpy(writes[0].content, "{\"fields\":{\"power\":{\"integerValue\":\"12\"}}}");
+  writes[0].mask[0] = '\0';
+  strcpy(writes[1].path, "device/uid/sensors/plug1/");
+  strcpy(writes[1].content, metaContent);
+  strcpy(writes[1].mask, "location,type");
+
+  char body[1024];
+  size_t length = BatchWriter::renderCommit(writes, 2, "energycelab", "", body, sizeof(body));
+  TEST_ASSERT_EQUAL(strlen(body), length);
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"writes\":["
+      "{\"update\":{\"name\":\"projects/energycelab/databases/(default)/documents/device/uid/sensors/plug1/live/abc\","
+      "\"fields\":{\"power\":{\"integerValue\":\"12\"}}}},"
+      "{\"update\":{\"name\":\"projects/energycelab/databases/(default)/documents/device/uid/sensors/plug1\","
+      "\"fields\":{\"location\":{\"stringValue\":\"UCL/OPS/107\"},\"type\":{\"stringValue\":\"EM\"}}},"
+      "\"updateMask\":{\"fieldPaths\":[\"location\",\"type\"]}}"
+      "]}",
+      body);
+
+  TEST_ASSERT_EQUAL(0, BatchWriter::renderCommit(writes, 2, "energycelab", "", body, 64));
+}
+
+void test_generated_ids_are_unique()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 2, 1000);
+  writer.setSeed(42);
+
+  writer.addDocument("device/uid/sensors/plug1/live/", liveContent);
+  writer.addDocument("device/uid/sensors/plug1/live", liveContent);
+  writer.flush();
+
+  const char *first = strstr(firestore.body, "/live/");
+  TEST_ASSERT_NOT_NULL(first);
+  const char *second = strstr(first + 1, "/live/");
+  TEST_ASSERT_NOT_NULL(second);
+  TEST_ASSERT_EQUAL('"', first[6 + 20]);
+  TEST_ASSERT_FALSE(strncmp(first + 6, second + 6, 20) == 0);
+}
+
+// Two dozen plugs reporting every 10 s for 10 minutes. Unbatched, each
+// sample costs three requests (two metadata patches and one create).
+void test_request_count_for_a_deployment()
+{
+  FakeFirestore firestore;
+  BatchWriter writer(firestore, fakeClock, 16, 10000);
+  const int plugs = 24;
+  int samples = 0;
+  char path[64];
+  char content[96];
+
+  for (fakeNow = 0; fakeNow < 600000; fakeNow += 10000)
+  {
+    for (int plug = 0; plug < plugs; plug++)
+    {
+      // Room for the three writes of a sample, as the uploader makes sure
+      if (writer.room() < 3)
+      {
+        writer.flush();
+      }
+      snprintf(content, sizeof(content), "{\"fields\":{\"lastUpdated\":{\"timestampValue\":\"%lu\"}}}", fakeNow);
+      writer.patchDocument("device/uid", content, "lastUpdated");
+      snprintf(path, sizeof(path), "device/uid/sensors/plug%d", plug);
+      writer.patchDocument(path, metaContent, "location,type");
+      snprintf(path, sizeof(path), "device/uid/sensors/plug%d/live", plug);
+      writer.addDocument(path, liveContent);
+      writer.poll();
+      samples++;
+    }
+  }
+  writer.flush();
+
+  char message[96];
+  snprintf(message, sizeof(message), "%d samples: %d requests unbatched, %d batched", samples, samples * 3,
+           firestore.requests);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(0, writer.stats().dropped);
+  TEST_ASSERT_EQUAL(0, writer.stats().rejected);
+  TEST_ASSERT_LESS_THAN(samples * 3 / 10, firestore.requests);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_flush_when_batch_is_full);
+  RUN_TEST(test_flush_when_batch_is_old);
+  RUN_TEST(test_full_batch_rejects_writes);
+  RUN_TEST(test_failed_full_batch_waits_for_retry);
+  RUN_TEST(test_patches_are_coalesced_while_pending);
+  RUN_TEST(test_unchanged_metadata_is_elided);
+  RUN_TEST(test_failed_commit_is_retried);
+  RUN_TEST(test_oversized_write_is_dropped);
+  RUN_TEST(test_render_commit_body);
+  RUN_TEST(test_generated_ids_are_unique);
+  RUN_TEST(test_request_count_for_a_deployment);
+  return UNITY_END();
+}
@@ -0,0 +1,294 @@
+#include <unity.h>
+
+#include <DeviceRegistry.h>
+
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static DeviceRegistry registry;
+
+static DeviceData reading(unsigned long now, int power, float today, float yesterday, float total)
+{
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+  data.lastUpdated = now;
+  data.power = power;
+  data.today = today;
+  data.yesterday = yesterday;
+  data.total = total;
+  strcpy(data.startDate, "2023-01-20T14:51:33Z");
+  return data;
+}
+
+// The device level of ".../<device>/SENSOR", not NUL terminated, as the '+'
+// of the firmware's topic filter captures it
+static const char *deviceLevel(const char *topic, size_t &length)
+{
+  const char *end = strrchr(topic, '/');
+  const char *start = end;
+  while (start > topic && start[-1] != '/')
+  {
+    start--;
+  }
+  length = end - start;
+  return start;
+}
+
+void setUp()
+{
+  registry.clear();
+}
+
+void tearDown() {}
+
+void test_intern_returns_stable_ids()
+{
+  int a = registry.intern("plug1", 0);
+  int b = registry.intern("plug2", 0);
+
+  TEST_ASSERT_TRUE(a >= 0);
+  TEST_ASSERT_TRUE(b >= 0);
+  TEST_ASSERT_NOT_EQUAL(a, b);
+  TEST_ASSERT_EQUAL(a, registry.intern("plug1", 100));
+  TEST_ASSERT_EQUAL(a, registry.find("plug1"));
+  TEST_ASSERT_EQUAL(-1, registry.find("plug3"));
+  TEST_ASSERT_EQUAL(2, registry.size());
+  TEST_ASSERT_EQUAL_STRING("plug2", registry.name(b));
+  // Interning an existing name does not refresh it
+  TEST_ASSERT_EQUAL(0, registry.lastUpdated(a));
+}
+
+void test_find_by_topic_slice()
+{
+  const char *topic = "UCL/OPS/107/EM/gosund/plug12/SENSOR";
+  size_t length;
+  const char *device = deviceLevel(topic, length);
+
+  int id = registry.intern(device, length, 0);
+  TEST_ASSERT_EQUAL_STRING("plug12", registry.name(id));
+  TEST_ASSERT_EQUAL(id, registry.find("plug12"));
+  // A prefix of a registered name is a different device
+  TEST_ASSERT_EQUAL(-1, registry.find("plug1"));
+  TEST_ASSERT_EQUAL(-1, registry.find("plug12", 5));
+}
+
+void test_rejects_bad_names()
+{
+  char longName[DEVICE_NAME_SIZE + 1];
+  memset(longName, 'a', DEVICE_NAME_SIZE);
+  longName[DEVICE_NAME_SIZE] = '\0';
+
+  TEST_ASSERT_EQUAL(-1, registry.intern("", 0));
+  TEST_ASSERT_EQUAL(-1, registry.intern(longName, 0));
+  TEST_ASSERT_TRUE(registry.intern(longName, DEVICE_NAME_SIZE - 1, 0) >= 0);
+  TEST_ASSERT_EQUAL(1, registry.size());
+}
+
+void test_totals_follow_updates()
+{
+  int a = registry.intern("plug1", 0);
+  int b = registry.intern("plug2", 0);
+
+  registry.update(a, reading(10, 100, 1.5f, 2.0f, 30.0f));
+  registry.update(b, reading(10, 50, 0.5f, 1.0f, 20.0f));
+  TEST_ASSERT_EQUAL(150, registry.totals().power);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, registry.totals().today);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, registry.totals().yesterday);
+  TEST_ASSERT_EQUAL_FLOAT(50.0f, registry.totals().total);
+
+  registry.update(a, reading(20, 10, 1.75f, 2.0f, 30.25f));
+  TEST_ASSERT_EQUAL(60, registry.totals().power);
+  TEST_ASSERT_EQUAL_FLOAT(2.25f, registry.totals().today);
+  TEST_ASSERT_EQUAL_FLOAT(50.25f, registry.totals().total);
+  TEST_ASSERT_EQUAL_STRING("2023-01-20T14:51:33Z", registry.startDate(a));
+  TEST_ASSERT_EQUAL(20, registry.lastUpdated(a));
+
+  registry.remove(b);
+  TEST_ASSERT_EQUAL(10, registry.totals().power);
+  TEST_ASSERT_EQUAL(1, registry.totals().devices);
+  TEST_ASSERT_FALSE(registry.update(b, reading(0, 1, 0, 0, 0)));
+}
+
+void test_expire_drops_stale_devices()
+{
+  int a = registry.intern("plug1", 0);
+  int b = registry.intern("plug2", 0);
+  int c = registry.intern("plug3", 0);
+  registry.update(a, reading(1000, 1, 0, 0, 0));
+  registry.update(b, reading(65000, 2, 0, 0, 0));
+  registry.update(c, reading(500, 4, 0, 0, 0));
+
+  TEST_ASSERT_EQUAL(2, registry.expire(70000, 60000));
+  TEST_ASSERT_EQUAL(1, registry.size());
+  TEST_ASSERT_EQUAL(2, registry.totals().power);
+  TEST_ASSERT_EQUAL(-1, registry.find("plug1"));
+  TEST_ASSERT_EQUAL(b, registry.find("plug2"));
+
+  // Survives millis() wrapping
+  registry.update(b, reading((unsigned long)-16, 2, 0, 0, 0));
+  TEST_ASSERT_EQUAL(0, registry.expire(0x10, 60000));
+}
+
+void test_iteration_visits_every_device_once()
+{
+  int seen[DEVICE_REGISTRY_CAPACITY] = {0};
+  char name[16];
+  for (int i = 0; i < 100; i++)
+  {
+    snprintf(name, sizeof(name), "plug%d", i);
+    registry.intern(name, 0);
+  }
+  for (int i = 0; i < 100; i += 3)
+  {
+    snprintf(name, sizeof(name), "plug%d", i);
+    registry.remove(registry.find(name));
+  }
+
+  int count = 0;
+  for (int id = registry.first(); id >= 0; id = registry.next(id))
+  {
+    seen[id]++;
+    count++;
+  }
+  TEST_ASSERT_EQUAL(registry.size(), count);
+  for (int i = 0; i < DEVICE_REGISTRY_CAPACITY; i++)
+  {
+    TEST_ASSERT_TRUE(seen[i] <= 1);
+  }
+}
+
+void test_fill_and_churn()
+{
+  char name[16];
+  for (int i = 0; i < DEVICE_REGISTRY_CAPACITY; i++)
+  {
+    snprintf(name, sizeof(name), "dev%d", i);
+    TEST_ASSERT_TRUE(registry.intern(name, 0) >= 0);
+  }
+  TEST_ASSERT_EQUAL(-1, registry.intern("onemore", 0));
+
+  // Remove and re-add in a different order, exercising backward shifts
+  for (int round = 0; round < 20; round++)
+  {
+    for (int i = round % 7; i < DEVICE_REGISTRY_CAPACITY; i += 7)
+    {
+      snprintf(name, sizeof(name), "dev%d", i);
+      TEST_ASSERT_TRUE(registry.remove(registry.find(name)));
+    }
+    for (int i = round % 7; i < DEVICE_REGISTRY_CAPACITY; i += 7)
+    {
+      snprintf(name, sizeof(name), "dev%d", i);
+      TEST_ASSERT_EQUAL(-1, registry.find(name));
+      TEST_ASSERT_TRUE(registry.intern(name, 0) >= 0);
+    }
+    for (int i = 0; i < DEVICE_REGISTRY_CAPACITY; i++)
+    {
+      snprintf(name, sizeof(name), "dev%d", i);
+      int id = registry.find(name);
+      TEST_ASSERT_TRUE(id >= 0);
+      TEST_ASSERT_EQUAL_STRING(name, registry.name(id));
+    }
+  }
+  TEST_ASSERT_EQUAL(DEVICE_REGISTRY_CAPACITY, registry.size());
+}
+
+// The firmware kept a std::map<String, DeviceData> and walked it four times
+// for the sums (std::string stands in for Arduino String on the host).
+struct StringDeviceData
+{
+  unsigned long lastUpdated;
+  int power;
+  float today;
+  float yesterday;
+  float total;
+  std::string time;
+  std::string startDate;
+};
+
+void test_benchmark_against_map()
+{
+  const int devices = 250;
+  const int iterations = 200000;
+  static char topics[devices][48];
+  char message[160];
+  for (int i = 0; i < devices; i++)
+  {
+    snprintf(topics[i], sizeof(topics[i]), "UCL/OPS/107/EM/gosund/plug%03d/SENSOR", i);
+  }
+  DeviceData data = reading(0, 1, 0.5f, 0.25f, 10.0f);
+
+  std::map<std::string, StringDeviceData> deviceList;
+  long mapPower = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+  {
+    size_t length;
+    const char *device = deviceLevel(topics[i % devices], length);
+    StringDeviceData &entry = deviceList[std::string(device, length)];
+    entry.lastUpdated = i;
+    entry.power = data.power;
+    entry.today = data.today;
+    entry.yesterday = data.yesterday;
+    entry.total = data.total;
+    entry.startDate = data.startDate;
+    if (i % devices == 0)
+    {
+      long power = 0;
+      float today = 0, yesterday = 0, total = 0;
+      for (auto &device : deviceList)
+        power += device.second.power;
+      for (auto &device : deviceList)
+        today += device.second.today;
+      for (auto &device : deviceList)
+        yesterday += device.second.yesterday;
+      for (auto &device : deviceList)
+        total += device.second.total;
+      mapPower += power + (long)(today + yesterday + total);
+    }
+  }
+  double mapSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  long registryPower = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+  {
+    size_t length;
+    const char *device = deviceLevel(topics[i % devices], length);
+    int id = registry.intern(device, length, i);
+    data.lastUpdated = i;
+    registry.update(id, data);
+    if (i % devices == 0)
+    {
+      const DeviceTotals &totals = registry.totals();
+      registryPower += totals.power + (long)(totals.today + totals.yesterday + totals.total);
+    }
+  }
+  double registrySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  snprintf(message, sizeof(message), "std::map:       %.0f updates/s", iterations / mapSeconds);
+  TEST_MESSAGE(message);
+  snprintf(message, sizeof(message), "DeviceRegistry: %.0f updates/s, %u bytes", iterations / registrySeconds,
+           (unsigned)sizeof(DeviceRegistry));
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_EQUAL(devices, registry.size());
+  TEST_ASSERT_EQUAL(devices, deviceList.size());
+  TEST_ASSERT_TRUE(mapPower > 0 && registryPower > 0);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_intern_returns_stable_ids);
+  RUN_TEST(test_find_by_topic_slice);
+  RUN_TEST(test_rejects_bad_names);
+  RUN_TEST(test_totals_follow_updates);
+  RUN_TEST(test_expire_drops_stale_devices);
+  RUN_TEST(test_iteration_visits_every_device_once);
+  RUN_TEST(test_fill_and_churn);
+  RUN_TEST(test_benchmark_against_map);
+  return UNITY_END();
+}
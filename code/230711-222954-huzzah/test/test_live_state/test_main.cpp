@@ -0,0 +1,173 @@
+#include <unity.h>
+
+#include <LiveState.h>
+
+static int powerCalls = 0;
+static int todayCalls = 0;
+static uint32_t lastChanged = 0;
+static StateSnapshot lastState;
+
+static void onPower(const StateSnapshot &state, uint32_t changed)
+{
+  powerCalls++;
+  lastChanged = changed;
+  lastState = state;
+}
+
+static void onToday(const StateSnapshot &state, uint32_t changed)
+{
+  todayCalls++;
+  lastState = state;
+}
+
+void setUp()
+{
+  powerCalls = 0;
+  todayCalls = 0;
+  lastChanged = 0;
+}
+
+void tearDown() {}
+
+void test_updates_are_coalesced_per_dispatch()
+{
+  LiveState state;
+  state.subscribe(onPower, STATE_MASK(STATE_POWER) | STATE_MASK(STATE_MAX_POWER));
+  state.subscribe(onToday, STATE_MASK(STATE_TODAY));
+
+  state.setPower(100);
+  state.setPower(250);
+  state.setPower(200);
+  TEST_ASSERT_EQUAL(1, state.dispatch());
+  TEST_ASSERT_EQUAL(1, powerCalls);
+  TEST_ASSERT_EQUAL(0, todayCalls);
+  TEST_ASSERT_EQUAL(200, lastState.power);
+  TEST_ASSERT_EQUAL(250, lastState.maxPower);
+  TEST_ASSERT_EQUAL(STATE_MASK(STATE_POWER) | STATE_MASK(STATE_MAX_POWER), lastChanged);
+
+  // Nothing changed since
+  TEST_ASSERT_EQUAL(0, state.dispatch());
+  state.setPower(200);
+  TEST_ASSERT_EQUAL(0, state.pending());
+
+  state.setToday(1.25f);
+  state.setPower(150);
+  TEST_ASSERT_EQUAL(2, state.dispatch());
+  TEST_ASSERT_EQUAL(STATE_MASK(STATE_POWER), lastChanged);
+  TEST_ASSERT_EQUAL(1, todayCalls);
+}
+
+void test_listeners_see_known_values_on_subscribe()
+{
+  LiveState state;
+  state.setToday(0.5f);
+
+  state.subscribe(onToday, STATE_MASK(STATE_TODAY));
+  state.subscribe(onPower, STATE_MASK(STATE_POWER));
+  TEST_ASSERT_EQUAL(1, state.dispatch());
+  TEST_ASSERT_EQUAL(1, todayCalls);
+  TEST_ASSERT_EQUAL(0, powerCalls);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, lastState.today);
+}
+
+void test_hydration_never_overrides_local_values()
+{
+  LiveState state;
+  state.hydrateToday(3.0f);
+  TEST_ASSERT_TRUE(state.isSet(STATE_TODAY));
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, state.snapshot().today);
+
+  state.setToday(3.5f);
+  state.hydrateToday(2.0f);
+  TEST_ASSERT_EQUAL_FLOAT(3.5f, state.snapshot().today);
+
+  // The maximum keeps the higher value either way
+  state.setPower(400);
+  state.hydrateMaxPower(350);
+  TEST_ASSERT_EQUAL(400, state.snapshot().maxPower);
+  state.hydrateMaxPower(900);
+  TEST_ASSERT_EQUAL(900, state.snapshot().maxPower);
+  TEST_ASSERT_FALSE(state.raiseMaxPower(500));
+}
+
+void test_hydration_replaces_totals_before_devices_report()
+{
+  LiveState state;
+  // publishTotals() at boot, no device has reported yet
+  state.setToday(0.0f, false);
+  state.hydrateToday(3.0f);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, state.snapshot().today);
+
+  // Later placeholders keep the hydrated value
+  state.setToday(0.0f, false);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, state.snapshot().today);
+
+  // Until a device reports
+  state.setToday(3.25f, true);
+  state.setToday(0.0f, false);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, state.snapshot().today);
+  state.hydrateToday(3.0f);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, state.snapshot().today);
+}
+
+void test_touch_replays_set_fields_only()
+{
+  LiveState state;
+  state.subscribe(onToday, STATE_MASK(STATE_TODAY));
+  state.subscribe(onPower, STATE_MASK(STATE_MEAN_POWER));
+
+  state.touch(STATE_ALL);
+  TEST_ASSERT_EQUAL(0, state.dispatch());
+
+  state.setToday(1.0f);
+  state.dispatch();
+  state.touch(STATE_ALL);
+  TEST_ASSERT_EQUAL(1, state.dispatch());
+  TEST_ASSERT_EQUAL(2, todayCalls);
+  TEST_ASSERT_EQUAL(0, powerCalls);
+}
+
+static LiveState *reentrant = NULL;
+
+static void setsMore(const StateSnapshot &state, uint32_t changed)
+{
+  powerCalls++;
+  reentrant->setMeanPower(state.power / 2.0f);
+}
+
+void test_changes_made_by_listeners_wait_for_next_dispatch()
+{
+  LiveState state;
+  reentrant = &state;
+  state.subscribe(setsMore, STATE_MASK(STATE_POWER));
+  state.subscribe(onToday, STATE_MASK(STATE_MEAN_POWER));
+
+  state.setPower(80);
+  TEST_ASSERT_EQUAL(1, state.dispatch());
+  TEST_ASSERT_EQUAL(STATE_MASK(STATE_MEAN_POWER), state.pending());
+  TEST_ASSERT_EQUAL(1, state.dispatch());
+  TEST_ASSERT_EQUAL_FLOAT(40.0f, lastState.meanPower);
+}
+
+void test_listener_table_is_bounded()
+{
+  LiveState state;
+  for (int i = 0; i < LIVE_STATE_MAX_LISTENERS; i++)
+  {
+    TEST_ASSERT_TRUE(state.subscribe(onPower, STATE_MASK(STATE_POWER)));
+  }
+  TEST_ASSERT_FALSE(state.subscribe(onPower, STATE_MASK(STATE_POWER)));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_updates_are_coalesced_per_dispatch);
+  RUN_TEST(test_listeners_see_known_values_on_subscribe);
+  RUN_TEST(test_hydration_never_overrides_local_values);
+  RUN_TEST(test_hydration_replaces_totals_before_devices_report);
+  RUN_TEST(test_touch_replays_set_fields_only);
+  RUN_TEST(test_changes_made_by_listeners_wait_for_next_dispatch);
+  RUN_TEST(test_listener_table_is_bounded);
+  return UNITY_END();
+}
@@ -0,0 +1,196 @@
+#include <unity.h>
+
+#include <Rollup.h>
+
+#include <stdlib.h>
+
+static RollupEngine engine;
+static RollupStats stats;
+
+// Arbitrary epoch time, aligned to a day so slot boundaries are predictable
+static const uint32_t start = 19500u * 86400u;
+
+void setUp()
+{
+  engine.clear();
+}
+
+void tearDown() {}
+
+void test_empty_windows_have_no_data()
+{
+  TEST_ASSERT_FALSE(engine.overall(ROLLUP_1MIN, start, stats));
+  TEST_ASSERT_FALSE(engine.device(0, ROLLUP_1DAY, start, stats));
+  TEST_ASSERT_FALSE(engine.device(-1, ROLLUP_1DAY, start, stats));
+}
+
+void test_min_max_mean()
+{
+  engine.addOverall(start, 100);
+  engine.addOverall(start + 5, 300);
+  engine.addOverall(start + 10, 200);
+
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_1MIN, start + 10, stats));
+  TEST_ASSERT_EQUAL(3, stats.samples);
+  TEST_ASSERT_EQUAL(100, stats.minPower);
+  TEST_ASSERT_EQUAL(300, stats.maxPower);
+  TEST_ASSERT_EQUAL_FLOAT(200.0f, stats.meanPower);
+
+  // Every window sees the same samples
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_1DAY, start + 10, stats));
+  TEST_ASSERT_EQUAL(3, stats.samples);
+}
+
+void test_windows_slide_in_quarter_steps()
+{
+  // One sample every 15 s for 2 minutes
+  for (uint32_t t = 0; t < 120; t += 15)
+  {
+    engine.addOverall(start + t, t);
+  }
+
+  // The 1 minute window ending at t=105 holds the slots starting at 60..105
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_1MIN, start + 105, stats));
+  TEST_ASSERT_EQUAL(4, stats.samples);
+  TEST_ASSERT_EQUAL(60, stats.minPower);
+  TEST_ASSERT_EQUAL(105, stats.maxPower);
+
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_15MIN, start + 105, stats));
+  TEST_ASSERT_EQUAL(8, stats.samples);
+
+  // Nothing new for a minute
+  TEST_ASSERT_FALSE(engine.overall(ROLLUP_1MIN, start + 180, stats));
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_15MIN, start + 180, stats));
+  TEST_ASSERT_FALSE(engine.overall(ROLLUP_1DAY, start + 2 * 86400, stats));
+}
+
+void test_percentiles()
+{
+  // 0..999 W in random order
+  int order[1000];
+  for (int i = 0; i < 1000; i++)
+  {
+    order[i] = i;
+  }
+  srand(1);
+  for (int i = 999; i > 0; i--)
+  {
+    int j = rand() % (i + 1);
+    int swap = order[i];
+    order[i] = order[j];
+    order[j] = swap;
+  }
+  for (int i = 0; i < 1000; i++)
+  {
+    engine.addOverall(start + i, order[i]);
+  }
+
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_1HOUR, start + 999, stats));
+  TEST_ASSERT_EQUAL(1000, stats.samples);
+  TEST_ASSERT_EQUAL(0, stats.minPower);
+  TEST_ASSERT_EQUAL(999, stats.maxPower);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 499.5f, stats.meanPower);
+  TEST_ASSERT_INT_WITHIN(25, 500, stats.p50Power);
+  TEST_ASSERT_INT_WITHIN(25, 950, stats.p95Power);
+}
+
+void test_percentiles_of_constant_load()
+{
+  for (int i = 0; i < 20; i++)
+  {
+    engine.addOverall(start + i, 42);
+  }
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_1MIN, start + 20, stats));
+  TEST_ASSERT_EQUAL(42, stats.p50Power);
+  TEST_ASSERT_EQUAL(42, stats.p95Power);
+}
+
+void test_energy_deltas()
+{
+  // The first reading is only the baseline
+  engine.addDevice(3, start, 100, 12.0f);
+  engine.addDevice(3, start + 10, 100, 12.25f);
+  engine.addDevice(5, start + 10, 50, 7.0f);
+  engine.addDevice(5, start + 20, 50, 7.5f);
+  // Counter reset on the plug
+  engine.addDevice(5, start + 30, 50, 0.5f);
+  engine.addDevice(5, start + 40, 50, 0.75f);
+
+  TEST_ASSERT_TRUE(engine.device(3, ROLLUP_1MIN, start + 40, stats));
+  TEST_ASSERT_EQUAL(2, stats.samples);
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, stats.energy);
+  TEST_ASSERT_TRUE(engine.device(5, ROLLUP_1MIN, start + 40, stats));
+  TEST_ASSERT_EQUAL_FLOAT(0.75f, stats.energy);
+
+  // Overall energy has no power samples of its own yet
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_1DAY, start + 40, stats));
+  TEST_ASSERT_EQUAL(0, stats.samples);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, stats.energy);
+
+  // A removed device starts from a new baseline
+  engine.removeDevice(3);
+  TEST_ASSERT_FALSE(engine.device(3, ROLLUP_1MIN, start + 40, stats));
+  engine.addDevice(3, start + 50, 100, 20.0f);
+  TEST_ASSERT_TRUE(engine.device(3, ROLLUP_1MIN, start + 50, stats));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.energy);
+}
+
+void test_small_deltas_of_a_large_counter()
+{
+  // 0.1 Wh on a counter at 1000 kWh, below the resolution of a float there
+  engine.addDevice(3, start, 6, 1000.0);
+  engine.addDevice(3, start + 60, 6, 1000.0001);
+
+  TEST_ASSERT_TRUE(engine.device(3, ROLLUP_1MIN, start + 60, stats));
+  TEST_ASSERT_FLOAT_WITHIN(1e-7f, 0.0001f, stats.energy);
+}
+
+void test_devices_without_series_count_towards_overall()
+{
+  int id = ROLLUP_MAX_DEVICES + 1;
+  engine.addDevice(id, start, 10, 1.0f);
+  engine.addDevice(id, start + 10, 10, 1.5f);
+
+  TEST_ASSERT_FALSE(engine.device(id, ROLLUP_1MIN, start + 10, stats));
+  TEST_ASSERT_TRUE(engine.overall(ROLLUP_1MIN, start + 10, stats));
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, stats.energy);
+}
+
+void test_day_of_samples()
+{
+  // A plug reporting 60 W every 10 s for a day uses 1.44 kWh
+  double total = 100.0;
+  for (uint32_t t = 0; t < 86400; t += 10)
+  {
+    engine.addDevice(0, start + t, 60, total);
+    total += 60.0 * 10 / 3600000;
+  }
+
+  TEST_ASSERT_TRUE(engine.device(0, ROLLUP_1HOUR, start + 86399, stats));
+  TEST_ASSERT_EQUAL(360, stats.samples);
+  TEST_ASSERT_TRUE(engine.device(0, ROLLUP_1DAY, start + 86399, stats));
+  TEST_ASSERT_EQUAL(8640, stats.samples);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.44f, stats.energy);
+  TEST_ASSERT_EQUAL(60, stats.minPower);
+  TEST_ASSERT_EQUAL_FLOAT(60.0f, stats.meanPower);
+
+  // A reading in the next day's first slot replaces the oldest quarter
+  engine.addDevice(0, start + 86400, 60, total);
+  TEST_ASSERT_TRUE(engine.device(0, ROLLUP_1DAY, start + 86400, stats));
+  TEST_ASSERT_EQUAL(3 * 2160 + 1, stats.samples);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_windows_have_no_data);
+  RUN_TEST(test_min_max_mean);
+  RUN_TEST(test_windows_slide_in_quarter_steps);
+  RUN_TEST(test_percentiles);
+  RUN_TEST(test_percentiles_of_constant_load);
+  RUN_TEST(test_energy_deltas);
+  RUN_TEST(test_small_deltas_of_a_large_counter);
+  RUN_TEST(test_devices_without_series_count_towards_overall);
+  RUN_TEST(test_day_of_samples);
+  return UNITY_END();
+}
@@ -0,0 +1,219 @@
+#include <unity.h>
+
+#include <SampleQueue.h>
+
+#include <thread>
+
+// Synthetic record about the size of a sensor sample. Every word is derived
+// from the sequence number so a torn copy is detected.
+struct Record
+{
+  uint32_t seq;
+  uint32_t words[15];
+};
+
+static Record makeRecord(uint32_t seq)
+{
+  Record record;
+  record.seq = seq;
+  for (int i = 0; i < 15; i++)
+  {
+    record.words[i] = seq * 2654435761u + i;
+  }
+  return record;
+}
+
+static bool isIntact(const Record &record)
+{
+  for (int i = 0; i < 15; i++)
+  {
+    if (record.words[i] != record.seq * 2654435761u + i)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_push_pop_in_order()
+{
+  SampleQueue<Record, 4> queue;
+  Record out;
+
+  TEST_ASSERT_TRUE(queue.empty());
+  TEST_ASSERT_FALSE(queue.pop(out, 0));
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    TEST_ASSERT_TRUE(queue.push(makeRecord(i), 0));
+  }
+  TEST_ASSERT_EQUAL(3, queue.size());
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    TEST_ASSERT_TRUE(queue.pop(out, 0));
+    TEST_ASSERT_EQUAL(i, out.seq);
+  }
+  TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_drop_newest_when_full()
+{
+  SampleQueue<Record, 4> queue(QUEUE_DROP_NEWEST);
+  Record out;
+
+  for (uint32_t i = 0; i < 6; i++)
+  {
+    queue.push(makeRecord(i), 0);
+  }
+  QueueStats stats = queue.stats();
+  TEST_ASSERT_EQUAL(4, stats.pushed);
+  TEST_ASSERT_EQUAL(2, stats.dropped);
+  TEST_ASSERT_EQUAL(4, stats.highWater);
+
+  TEST_ASSERT_TRUE(queue.pop(out, 0));
+  TEST_ASSERT_EQUAL(0, out.seq);
+}
+
+void test_overwrite_oldest_when_full()
+{
+  SampleQueue<Record, 4> queue(QUEUE_OVERWRITE_OLDEST);
+  Record out;
+
+  for (uint32_t i = 0; i < 6; i++)
+  {
+    TEST_ASSERT_TRUE(queue.push(makeRecord(i), 0));
+  }
+  TEST_ASSERT_EQUAL(4, queue.size());
+  TEST_ASSERT_EQUAL(2, queue.stats().overwritten);
+
+  for (uint32_t i = 2; i < 6; i++)
+  {
+    TEST_ASSERT_TRUE(queue.pop(out, 0));
+    TEST_ASSERT_EQUAL(i, out.seq);
+  }
+  TEST_ASSERT_FALSE(queue.pop(out, 0));
+}
+
+void test_lag_counters()
+{
+  SampleQueue<Record, 8> queue;
+  Record out;
+
+  queue.push(makeRecord(0), 1000);
+  queue.push(makeRecord(1), 1010);
+  queue.pop(out, 1250);
+  queue.pop(out, 1260);
+
+  QueueStats stats = queue.stats();
+  TEST_ASSERT_EQUAL(250, stats.lastLag);
+  TEST_ASSERT_EQUAL(250, stats.maxLag);
+  TEST_ASSERT_EQUAL(2, stats.popped);
+}
+
+void test_index_wrap_around()
+{
+  SampleQueue<Record, 4> queue;
+  Record out;
+
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    TEST_ASSERT_TRUE(queue.push(makeRecord(i), 0));
+    TEST_ASSERT_TRUE(queue.pop(out, 0));
+    TEST_ASSERT_EQUAL(i, out.seq);
+  }
+}
+
+// Feed a large burst of synthetic messages from one thread while another
+// drains, as the MQTT callback and the uploader task do on the two cores.
+static void stress(QueuePolicy policy)
+{
+  const uint32_t messages = 200000;
+  SampleQueue<Record, 64> queue(policy);
+  std::atomic<bool> producerDone(false);
+
+  std::thread producer([&]()
+                       {
+                         for (uint32_t i = 0; i < messages; i++)
+                         {
+                           queue.push(makeRecord(i), i);
+                         }
+                         producerDone = true;
+                       });
+
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  uint32_t outOfOrder = 0;
+  int64_t last = -1;
+  Record out;
+  while (true)
+  {
+    if (queue.pop(out, last < 0 ? 0 : (uint32_t)last))
+    {
+      received++;
+      if (!isIntact(out))
+      {
+        torn++;
+      }
+      if ((int64_t)out.seq <= last)
+      {
+        outOfOrder++;
+      }
+      last = out.seq;
+      if (out.seq == messages - 1)
+      {
+        break;
+      }
+    }
+    else if (producerDone && queue.empty())
+    {
+      // The last messages were dropped
+      break;
+    }
+  }
+  producer.join();
+  while (queue.pop(out, 0))
+  {
+    received++;
+  }
+
+  QueueStats stats = queue.stats();
+  TEST_ASSERT_EQUAL(0, torn);
+  TEST_ASSERT_EQUAL(0, outOfOrder);
+  TEST_ASSERT_EQUAL(received, stats.popped);
+  if (policy == QUEUE_DROP_NEWEST)
+  {
+    TEST_ASSERT_EQUAL(messages, stats.pushed + stats.dropped);
+    TEST_ASSERT_EQUAL(stats.pushed, received);
+  }
+  else
+  {
+    TEST_ASSERT_EQUAL(messages, stats.pushed);
+    TEST_ASSERT_EQUAL(messages, received + stats.overwritten);
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(64, stats.highWater);
+}
+
+void test_stress_drop_newest()
+{
+  stress(QUEUE_DROP_NEWEST);
+}
+
+void test_stress_overwrite_oldest()
+{
+  stress(QUEUE_OVERWRITE_OLDEST);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_push_pop_in_order);
+  RUN_TEST(test_drop_newest_when_full);
+  RUN_TEST(test_overwrite_oldest_when_full);
+  RUN_TEST(test_lag_counters);
+  RUN_TEST(test_index_wrap_around);
+  RUN_TEST(test_stress_drop_newest);
+  RUN_TEST(test_stress_overwrite_oldest);
+  return UNITY_END();
+}
@@ -0,0 +1,275 @@
+#include <unity.h>
+
+#include <Scheduler.h>
+
+// Fake millisecond clock driven by the tests
+static unsigned long fakeNow = 0;
+static unsigned long fakeClock()
+{
+  return fakeNow;
+}
+
+static int order[16];
+static int orderCount = 0;
+static int fastRuns = 0;
+static int slowRuns = 0;
+
+static void record(int id)
+{
+  if (orderCount < 16)
+  {
+    order[orderCount] = id;
+  }
+  orderCount++;
+}
+
+static void taskA() { record(1); }
+static void taskB() { record(2); }
+static void taskC() { record(3); }
+static void fastTask() { fastRuns++; }
+static void slowTask()
+{
+  slowRuns++;
+  fakeNow += 3000; // Simulate a blocking HTTPS round-trip
+}
+
+void setUp()
+{
+  fakeNow = 0;
+  orderCount = 0;
+  fastRuns = 0;
+  slowRuns = 0;
+}
+
+void tearDown() {}
+
+void test_periodic_runs_every_interval()
+{
+  Scheduler scheduler(fakeClock);
+  int id = scheduler.addPeriodic("a", taskA, 100);
+
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  fakeNow = 99;
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  fakeNow = 100;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  fakeNow = 205; // Late by 5 ms, next run stays in phase
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+  fakeNow = 300;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+
+  TEST_ASSERT_EQUAL(3, scheduler.stats(id)->runs);
+  TEST_ASSERT_EQUAL(5, scheduler.stats(id)->maxLateness);
+}
+
+void test_periodic_run_now()
+{
+  Scheduler scheduler(fakeClock);
+  scheduler.addPeriodic("a", taskA, 60000, PRIORITY_NORMAL, true);
+
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+  fakeNow = 59999;
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  fakeNow = 60000;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+}
+
+void test_periodic_skips_missed_periods()
+{
+  Scheduler scheduler(fakeClock);
+  scheduler.addPeriodic("a", taskA, 100);
+
+  fakeNow = 1050;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  fakeNow = 1149;
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  fakeNow = 1150;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+}
+
+void test_zero_interval_runs_once_per_call()
+{
+  Scheduler scheduler(fakeClock);
+  scheduler.addPeriodic("fast", fastTask, 0);
+
+  scheduler.run();
+  scheduler.run();
+  scheduler.run();
+  TEST_ASSERT_EQUAL(3, fastRuns);
+}
+
+void test_oneshot_runs_once_and_frees_slot()
+{
+  Scheduler scheduler(fakeClock);
+  int id = scheduler.addOneShot("once", taskA, 500);
+  TEST_ASSERT_EQUAL(1, scheduler.size());
+
+  fakeNow = 499;
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  fakeNow = 500;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+  fakeNow = 5000;
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+
+  TEST_ASSERT_FALSE(scheduler.isActive(id));
+  TEST_ASSERT_EQUAL(0, scheduler.size());
+}
+
+void test_priority_order()
+{
+  Scheduler scheduler(fakeClock);
+  scheduler.addPeriodic("low", taskA, 10, PRIORITY_LOW);
+  scheduler.addPeriodic("high", taskB, 10, PRIORITY_HIGH);
+  scheduler.addPeriodic("normal", taskC, 10, PRIORITY_NORMAL);
+
+  fakeNow = 10;
+  TEST_ASSERT_EQUAL(3, scheduler.run());
+  TEST_ASSERT_EQUAL(3, orderCount);
+  TEST_ASSERT_EQUAL(2, order[0]);
+  TEST_ASSERT_EQUAL(3, order[1]);
+  TEST_ASSERT_EQUAL(1, order[2]);
+}
+
+void test_same_priority_most_overdue_first()
+{
+  Scheduler scheduler(fakeClock);
+  scheduler.addPeriodic("a", taskA, 100);
+  scheduler.addPeriodic("b", taskB, 20);
+
+  fakeNow = 100;
+  scheduler.run();
+  TEST_ASSERT_EQUAL(2, order[0]);
+  TEST_ASSERT_EQUAL(1, order[1]);
+}
+
+void test_deadline_tasks_earliest_deadline_first()
+{
+  Scheduler scheduler(fakeClock);
+  int late = scheduler.addDeadline("late", taskA, 0, 500);
+  int early = scheduler.addDeadline("early", taskB, 0, 100);
+
+  scheduler.run();
+  TEST_ASSERT_EQUAL(2, orderCount);
+  TEST_ASSERT_EQUAL(2, order[0]);
+  TEST_ASSERT_EQUAL(1, order[1]);
+  TEST_ASSERT_FALSE(scheduler.isActive(late));
+  TEST_ASSERT_FALSE(scheduler.isActive(early));
+}
+
+void test_deadline_miss_is_counted()
+{
+  Scheduler scheduler(fakeClock);
+  int id = scheduler.addDeadline("d", taskA, 100, 200);
+  const TaskStats *stats = scheduler.stats(id);
+
+  fakeNow = 250;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+  TEST_ASSERT_EQUAL(1, stats->missedDeadlines);
+}
+
+void test_budget_keeps_high_priority_tasks_running()
+{
+  // LED transition every 250 ms next to two slow network jobs due together
+  Scheduler scheduler(fakeClock, 50);
+  scheduler.addPeriodic("led", fastTask, 250, PRIORITY_HIGH);
+  scheduler.addPeriodic("live", slowTask, 60000, PRIORITY_LOW);
+  scheduler.addPeriodic("history", slowTask, 60000, PRIORITY_LOW);
+
+  fakeNow = 60000;
+  scheduler.run();
+  // The LED task ran first, then one slow job used up the budget
+  TEST_ASSERT_EQUAL(1, fastRuns);
+  TEST_ASSERT_EQUAL(1, slowRuns);
+
+  scheduler.run();
+  // The LED task got its turn before the second slow job
+  TEST_ASSERT_EQUAL(2, fastRuns);
+  TEST_ASSERT_EQUAL(2, slowRuns);
+}
+
+void test_run_time_accounting()
+{
+  Scheduler scheduler(fakeClock);
+  int id = scheduler.addPeriodic("slow", slowTask, 10000);
+
+  fakeNow = 10000;
+  scheduler.run();
+  fakeNow = 20000;
+  scheduler.run();
+
+  const TaskStats *stats = scheduler.stats(id);
+  TEST_ASSERT_EQUAL(2, stats->runs);
+  TEST_ASSERT_EQUAL(6000, stats->totalTime);
+  TEST_ASSERT_EQUAL(3000, stats->maxTime);
+}
+
+void test_disable_trigger_and_interval()
+{
+  Scheduler scheduler(fakeClock);
+  int id = scheduler.addPeriodic("a", taskA, 100);
+
+  scheduler.setEnabled(id, false);
+  fakeNow = 1000;
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+
+  scheduler.setEnabled(id, true);
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  TEST_ASSERT_EQUAL(100, scheduler.nextDue());
+
+  scheduler.trigger(id);
+  TEST_ASSERT_EQUAL(0, scheduler.nextDue());
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+
+  scheduler.setInterval(id, 10);
+  fakeNow = 1010;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+}
+
+void test_millis_rollover()
+{
+  fakeNow = (unsigned long)-50;
+  Scheduler scheduler(fakeClock);
+  scheduler.addPeriodic("a", taskA, 100);
+
+  fakeNow = 49;
+  TEST_ASSERT_EQUAL(0, scheduler.run());
+  fakeNow = 50;
+  TEST_ASSERT_EQUAL(1, scheduler.run());
+}
+
+void test_table_full()
+{
+  Scheduler scheduler(fakeClock);
+  for (int i = 0; i < SCHEDULER_MAX_TASKS; i++)
+  {
+    TEST_ASSERT_EQUAL(i, scheduler.addPeriodic("a", taskA, 100));
+  }
+  TEST_ASSERT_EQUAL(-1, scheduler.addOneShot("b", taskB, 0));
+
+  TEST_ASSERT_TRUE(scheduler.remove(3));
+  TEST_ASSERT_EQUAL(3, scheduler.addOneShot("b", taskB, 0));
+  TEST_ASSERT_FALSE(scheduler.remove(SCHEDULER_MAX_TASKS));
+  TEST_ASSERT_NULL(scheduler.stats(-1));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_periodic_runs_every_interval);
+  RUN_TEST(test_periodic_run_now);
+  RUN_TEST(test_periodic_skips_missed_periods);
+  RUN_TEST(test_zero_interval_runs_once_per_call);
+  RUN_TEST(test_oneshot_runs_once_and_frees_slot);
+  RUN_TEST(test_priority_order);
+  RUN_TEST(test_same_priority_most_overdue_first);
+  RUN_TEST(test_deadline_tasks_earliest_deadline_first);
+  RUN_TEST(test_deadline_miss_is_counted);
+  RUN_TEST(test_budget_keeps_high_priority_tasks_running);
+  RUN_TEST(test_run_time_accounting);
+  RUN_TEST(test_disable_trigger_and_interval);
+  RUN_TEST(test_millis_rollover);
+  RUN_TEST(test_table_full);
+  return UNITY_END();
+}
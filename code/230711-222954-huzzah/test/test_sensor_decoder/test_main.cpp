@@ -0,0 +1,260 @@
+#include <unity.h>
+
+#include <SensorDecoder.h>
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// Count heap allocations made while a benchmark runs
+static size_t allocations = 0;
+static size_t allocatedBytes = 0;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  allocatedBytes += size;
+  void *ptr = malloc(size);
+  if (ptr == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+static const char sensorMessage[] =
+    "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"TotalStartTime\":\"2023-01-20T14:51:33\","
+    "\"Total\":1234.567,\"Yesterday\":0.321,\"Today\":0.045,\"Period\":0,\"Power\":42,"
+    "\"ApparentPower\":61,\"ReactivePower\":44,\"Factor\":0.69,\"Voltage\":241,\"Current\":0.253}}";
+
+static DecodeResult decode(const char *json, DeviceData &data)
+{
+  return decodeSensor((const uint8_t *)json, strlen(json), data);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_decodes_tasmota_message()
+{
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+
+  TEST_ASSERT_EQUAL(DECODE_OK, decode(sensorMessage, data));
+  TEST_ASSERT_EQUAL_STRING("2023-07-11T22:29:54", data.time);
+  TEST_ASSERT_EQUAL_STRING("2023-01-20T14:51:33Z", data.startDate);
+  TEST_ASSERT_EQUAL_FLOAT(1234.567f, data.total);
+  TEST_ASSERT_EQUAL_FLOAT(0.321f, data.yesterday);
+  TEST_ASSERT_EQUAL_FLOAT(0.045f, data.today);
+  TEST_ASSERT_EQUAL(42, data.power);
+}
+
+void test_payload_is_not_nul_terminated()
+{
+  // The MQTT buffer continues after the payload
+  char buffer[sizeof(sensorMessage) + 8];
+  memcpy(buffer, sensorMessage, sizeof(sensorMessage) - 1);
+  memcpy(buffer + sizeof(sensorMessage) - 1, "garbage!", 8);
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+
+  TEST_ASSERT_EQUAL(DECODE_OK, decodeSensor((const uint8_t *)buffer, sizeof(sensorMessage) - 1, data));
+  TEST_ASSERT_EQUAL(42, data.power);
+}
+
+void test_field_order_and_whitespace_do_not_matter()
+{
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+
+  TEST_ASSERT_EQUAL(DECODE_OK, decode(" { \"ENERGY\" : { \"Power\" : 7 , \"Today\" : 1.5e-1 ,"
+                                      " \"Yesterday\":2, \"Total\":-3.25,\"TotalStartTime\":\"2023-01-01T00:00:00\" } ,"
+                                      " \"Extra\" : [1, {\"a\": \"b\\\"c\"}, true, null], \"Time\":\"2023-07-11T00:00:00\" } ",
+                                      data));
+  TEST_ASSERT_EQUAL(7, data.power);
+  TEST_ASSERT_EQUAL_FLOAT(0.15f, data.today);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, data.yesterday);
+  TEST_ASSERT_EQUAL_FLOAT(-3.25f, data.total);
+}
+
+void test_missing_fields_are_reported()
+{
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+  data.today = 9;
+
+  TEST_ASSERT_EQUAL(DECODE_INCOMPLETE, decode("{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"Power\":5}}", data));
+  TEST_ASSERT_EQUAL(5, data.power);
+  TEST_ASSERT_EQUAL_FLOAT(9.0f, data.today);
+
+  TEST_ASSERT_EQUAL(DECODE_INCOMPLETE, decode("{}", data));
+}
+
+void test_fields_that_are_not_numbers_are_left_out()
+{
+  const char *messages[] = {
+      "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"TotalStartTime\":\"2023-01-20T14:51:33\","
+      "\"Total\":1,\"Yesterday\":2,\"Today\":3,\"Power\":\"42\"}}",
+      "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"TotalStartTime\":\"2023-01-20T14:51:33\","
+      "\"Total\":1,\"Yesterday\":2,\"Today\":3,\"Power\":null}}",
+      "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"TotalStartTime\":\"2023-01-20T14:51:33\","
+      "\"Total\":1,\"Yesterday\":2,\"Today\":3,\"Power\":1e10}}",
+      "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"TotalStartTime\":\"2023-01-20T14:51:33\","
+      "\"Total\":1,\"Yesterday\":2,\"Today\":1e39,\"Power\":4}}",
+  };
+  for (size_t i = 0; i < sizeof(messages) / sizeof(messages[0]); i++)
+  {
+    DeviceData data;
+    memset(&data, 0, sizeof(data));
+    data.power = 9;
+    data.today = 9;
+
+    TEST_ASSERT_EQUAL(DECODE_INCOMPLETE, decode(messages[i], data));
+    TEST_ASSERT_EQUAL(i < 3 ? 9 : 4, data.power);
+    TEST_ASSERT_EQUAL_FLOAT(i < 3 ? 3.0f : 9.0f, data.today);
+  }
+
+  // A sign is not a number on its own
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+  TEST_ASSERT_EQUAL(DECODE_INVALID, decode("{\"ENERGY\":{\"Power\":-\"42\"}}", data));
+}
+
+void test_invalid_input()
+{
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+
+  TEST_ASSERT_EQUAL(DECODE_INVALID, decode("", data));
+  TEST_ASSERT_EQUAL(DECODE_INVALID, decode("Online", data));
+  TEST_ASSERT_EQUAL(DECODE_INVALID, decode("{\"Time\":\"2023", data));
+  TEST_ASSERT_EQUAL(DECODE_INVALID, decode("{\"ENERGY\":{\"Power\":}}", data));
+  TEST_ASSERT_EQUAL(DECODE_INVALID, decode("{\"Time\":\"x\",}", data));
+  TEST_ASSERT_EQUAL(DECODE_INVALID, decode("{\"a\":[[[[[[[[[[1]]]]]]]]]]}", data));
+  TEST_ASSERT_EQUAL(DECODE_INVALID, decodeSensor(NULL, 0, data));
+
+  // Every truncation of a valid message is rejected without reading past it
+  for (size_t length = 0; length < sizeof(sensorMessage) - 1; length++)
+  {
+    TEST_ASSERT_EQUAL(DECODE_INVALID, decodeSensor((const uint8_t *)sensorMessage, length, data));
+  }
+}
+
+void test_long_timestamp_is_truncated()
+{
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+
+  decode("{\"Time\":\"2023-07-11T22:29:54.123456789\",\"ENERGY\":{\"TotalStartTime\":\"2023-01-20T14:51:33.999\"}}", data);
+  TEST_ASSERT_EQUAL_STRING("2023-07-11T22:29:54", data.time);
+  TEST_ASSERT_EQUAL_STRING("2023-01-20T14:51:33Z", data.startDate);
+}
+
+// The path the firmware used before: copy into a VLA, deserializeJson() into
+// a DynamicJsonDocument and copy the strings out (std::string standing in for
+// Arduino String on the host).
+struct StringDeviceData
+{
+  unsigned long lastUpdated;
+  int power;
+  float today;
+  float yesterday;
+  float total;
+  std::string time;
+  std::string startDate;
+};
+
+static bool decodeWithDocument(DynamicJsonDocument &doc, const uint8_t *payload, size_t length,
+                               StringDeviceData &data)
+{
+  char msg[512];
+  memcpy(msg, payload, length);
+  msg[length] = '\0';
+  if (deserializeJson(doc, msg))
+  {
+    return false;
+  }
+  data.time = std::string(doc["Time"].as<const char *>());
+  data.startDate = std::string(doc["ENERGY"]["TotalStartTime"].as<const char *>());
+  data.startDate += "Z";
+  data.total = doc["ENERGY"]["Total"];
+  data.today = doc["ENERGY"]["Today"];
+  data.yesterday = doc["ENERGY"]["Yesterday"];
+  data.power = doc["ENERGY"]["Power"];
+  return true;
+}
+
+void test_benchmark_against_deserialize_json()
+{
+  const int iterations = 200000;
+  const uint8_t *payload = (const uint8_t *)sensorMessage;
+  const size_t length = sizeof(sensorMessage) - 1;
+  char message[160];
+  int checksum = 0;
+
+  DynamicJsonDocument doc(512);
+  StringDeviceData stringData;
+  allocations = 0;
+  allocatedBytes = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+  {
+    decodeWithDocument(doc, payload, length, stringData);
+    checksum += stringData.power;
+  }
+  double documentSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  size_t documentAllocations = allocations;
+  size_t documentBytes = allocatedBytes;
+
+  DeviceData data;
+  memset(&data, 0, sizeof(data));
+  allocations = 0;
+  allocatedBytes = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+  {
+    decodeSensor(payload, length, data);
+    checksum += data.power;
+  }
+  double decoderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  size_t decoderAllocations = allocations;
+
+  snprintf(message, sizeof(message), "deserializeJson: %.0f msg/s, %u allocations, %u bytes",
+           iterations / documentSeconds, (unsigned)documentAllocations, (unsigned)documentBytes);
+  TEST_MESSAGE(message);
+  snprintf(message, sizeof(message), "decodeSensor:    %.0f msg/s, %u allocations",
+           iterations / decoderSeconds, (unsigned)decoderAllocations);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_EQUAL(iterations * 84, checksum);
+  TEST_ASSERT_EQUAL(0, decoderAllocations);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_decodes_tasmota_message);
+  RUN_TEST(test_payload_is_not_nul_terminated);
+  RUN_TEST(test_field_order_and_whitespace_do_not_matter);
+  RUN_TEST(test_missing_fields_are_reported);
+  RUN_TEST(test_fields_that_are_not_numbers_are_left_out);
+  RUN_TEST(test_invalid_input);
+  RUN_TEST(test_long_timestamp_is_truncated);
+  RUN_TEST(test_benchmark_against_deserialize_json);
+  return UNITY_END();
+}
@@ -0,0 +1,474 @@
+#include <unity.h>
+
+#include <Spool.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+
+// Stand-in for MB_FS on the host: the spool paths are files under a
+// temporary directory. Counts the writes to each segment file.
+class FileSpoolFs : public SpoolFs
+{
+public:
+  FileSpoolFs() : file(NULL), failWrites(false)
+  {
+    strcpy(root, "/tmp/spoolXXXXXX");
+    if (mkdtemp(root) == NULL)
+    {
+      root[0] = '\0';
+    }
+    char dir[96];
+    snprintf(dir, sizeof(dir), "%s/spool", root);
+    mkdir(dir, 0700);
+    memset(writes, 0, sizeof(writes));
+  }
+
+  ~FileSpoolFs()
+  {
+    close();
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    if (system(command) != 0)
+    {
+      printf("could not remove %s\n", root);
+    }
+  }
+
+  int open(const char *path, SpoolOpenMode mode)
+  {
+    close();
+    file = fopen(resolve(path), mode == SPOOL_OPEN_READ ? "rb" : "ab");
+    if (file == NULL)
+    {
+      return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (mode == SPOOL_OPEN_APPEND)
+    {
+      writes[path[strlen(path) - 1] - '0']++;
+    }
+    return (int)size;
+  }
+
+  int read(uint8_t *buffer, size_t length) { return file ? (int)fread(buffer, 1, length, file) : -1; }
+
+  int write(const uint8_t *buffer, size_t length)
+  {
+    if (file == NULL)
+    {
+      return -1;
+    }
+    // Simulate a power cut half way through the write
+    if (failWrites)
+    {
+      return (int)fwrite(buffer, 1, length / 2, file);
+    }
+    return (int)fwrite(buffer, 1, length, file);
+  }
+
+  bool seek(size_t position) { return file && fseek(file, (long)position, SEEK_SET) == 0; }
+
+  void close()
+  {
+    if (file)
+    {
+      fclose(file);
+      file = NULL;
+    }
+  }
+
+  bool existed(const char *path)
+  {
+    struct stat info;
+    return stat(resolve(path), &info) == 0;
+  }
+
+  bool remove(const char *path) { return !existed(path) || unlink(resolve(path)) == 0; }
+
+  long size(const char *path)
+  {
+    struct stat info;
+    return stat(resolve(path), &info) == 0 ? (long)info.st_size : -1;
+  }
+
+  // Cut `bytes` off the end of a file, as a crash during a write would
+  void truncateBy(const char *path, long bytes)
+  {
+    if (truncate(resolve(path), size(path) - bytes) != 0)
+    {
+      printf("truncate failed\n");
+    }
+  }
+
+  void flipByte(const char *path, long offset)
+  {
+    FILE *f = fopen(resolve(path), "r+b");
+    fseek(f, offset, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(c ^ 0xFF, f);
+    fclose(f);
+  }
+
+  const char *resolve(const char *path)
+  {
+    snprintf(resolved, sizeof(resolved), "%s%s", root, path);
+    return resolved;
+  }
+
+  FILE *file;
+  bool failWrites;
+  int writes[10];
+  char root[64];
+  char resolved[128];
+};
+
+struct Record
+{
+  uint32_t id;
+  int32_t power;
+  char device[24];
+};
+
+static bool appendRecord(Spool &spool, uint32_t id)
+{
+  Record record;
+  memset(&record, 0, sizeof(record));
+  record.id = id;
+  record.power = (int32_t)(id * 7 % 3000);
+  snprintf(record.device, sizeof(record.device), "gosund_p1_%u", (unsigned)(id % 24));
+  return spool.append(&record, sizeof(record));
+}
+
+// Read the next record and return its id, or 0 if there is none
+static uint32_t nextId(Spool &spool)
+{
+  Record record;
+  size_t length = spool.next(&record, sizeof(record));
+  if (length == 0)
+  {
+    return 0;
+  }
+  TEST_ASSERT_EQUAL(sizeof(record), length);
+  TEST_ASSERT_EQUAL((int32_t)(record.id * 7 % 3000), record.power);
+  return record.id;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_records_replay_in_order()
+{
+  FileSpoolFs fs;
+  Spool spool(fs);
+  TEST_ASSERT_TRUE(spool.begin());
+  TEST_ASSERT_TRUE(spool.empty());
+
+  for (uint32_t id = 1; id <= 50; id++)
+  {
+    TEST_ASSERT_TRUE(appendRecord(spool, id));
+  }
+  TEST_ASSERT_EQUAL(50, spool.pending());
+
+  for (uint32_t id = 1; id <= 50; id++)
+  {
+    TEST_ASSERT_EQUAL(id, nextId(spool));
+  }
+  TEST_ASSERT_EQUAL(0, nextId(spool));
+  TEST_ASSERT_EQUAL(50, spool.pending());
+  TEST_ASSERT_TRUE(spool.ack());
+  TEST_ASSERT_TRUE(spool.empty());
+  TEST_ASSERT_EQUAL(50, spool.stats().acked);
+}
+
+void test_rewind_reads_unacked_records_again()
+{
+  FileSpoolFs fs;
+  Spool spool(fs);
+  spool.begin();
+  for (uint32_t id = 1; id <= 10; id++)
+  {
+    appendRecord(spool, id);
+  }
+
+  TEST_ASSERT_EQUAL(1, nextId(spool));
+  TEST_ASSERT_EQUAL(2, nextId(spool));
+  spool.ack();
+  TEST_ASSERT_EQUAL(3, nextId(spool));
+  TEST_ASSERT_EQUAL(4, nextId(spool));
+  // The upload of 3 and 4 failed
+  spool.rewind();
+  TEST_ASSERT_EQUAL(3, nextId(spool));
+
+  // Appends in between keep their place behind the older records
+  appendRecord(spool, 11);
+  for (uint32_t id = 4; id <= 11; id++)
+  {
+    TEST_ASSERT_EQUAL(id, nextId(spool));
+  }
+  TEST_ASSERT_EQUAL(0, nextId(spool));
+}
+
+void test_restart_resumes_after_last_ack()
+{
+  FileSpoolFs fs;
+  {
+    Spool spool(fs);
+    spool.begin();
+    for (uint32_t id = 1; id <= 20; id++)
+    {
+      appendRecord(spool, id);
+    }
+    for (uint32_t id = 1; id <= 8; id++)
+    {
+      nextId(spool);
+    }
+    spool.ack();
+    // Read but not acknowledged when the device restarts
+    nextId(spool);
+    nextId(spool);
+  }
+
+  Spool spool(fs);
+  TEST_ASSERT_TRUE(spool.begin());
+  TEST_ASSERT_EQUAL(12, spool.pending());
+  for (uint32_t id = 9; id <= 20; id++)
+  {
+    TEST_ASSERT_EQUAL(id, nextId(spool));
+  }
+  TEST_ASSERT_EQUAL(0, nextId(spool));
+
+  // Numbering carries on across the restart
+  appendRecord(spool, 21);
+  TEST_ASSERT_EQUAL(21, nextId(spool));
+}
+
+void test_torn_write_is_discarded_on_recovery()
+{
+  FileSpoolFs fs;
+  {
+    Spool spool(fs);
+    spool.begin();
+    for (uint32_t id = 1; id <= 5; id++)
+    {
+      appendRecord(spool, id);
+    }
+    // Power is cut half way through the sixth record
+    fs.failWrites = true;
+    TEST_ASSERT_FALSE(appendRecord(spool, 6));
+    fs.failWrites = false;
+  }
+
+  Spool spool(fs);
+  TEST_ASSERT_TRUE(spool.begin());
+  TEST_ASSERT_EQUAL(5, spool.pending());
+  TEST_ASSERT_EQUAL(1, spool.stats().corrupted);
+
+  // Later records go to a fresh segment, behind the recovered ones
+  TEST_ASSERT_TRUE(appendRecord(spool, 7));
+  TEST_ASSERT_EQUAL(2, spool.segments());
+  for (uint32_t id = 1; id <= 5; id++)
+  {
+    TEST_ASSERT_EQUAL(id, nextId(spool));
+  }
+  TEST_ASSERT_EQUAL(7, nextId(spool));
+  TEST_ASSERT_EQUAL(0, nextId(spool));
+}
+
+void test_truncated_segment_keeps_whole_frames()
+{
+  FileSpoolFs fs;
+  {
+    Spool spool(fs);
+    spool.begin();
+    for (uint32_t id = 1; id <= 5; id++)
+    {
+      appendRecord(spool, id);
+    }
+  }
+  fs.truncateBy("/spool/seg0", 3);
+
+  Spool spool(fs);
+  spool.begin();
+  TEST_ASSERT_EQUAL(4, spool.pending());
+  for (uint32_t id = 1; id <= 4; id++)
+  {
+    TEST_ASSERT_EQUAL(id, nextId(spool));
+  }
+  TEST_ASSERT_EQUAL(0, nextId(spool));
+}
+
+void test_crc_stops_at_damaged_frame()
+{
+  FileSpoolFs fs;
+  {
+    Spool spool(fs);
+    spool.begin();
+    for (uint32_t id = 1; id <= 5; id++)
+    {
+      appendRecord(spool, id);
+    }
+  }
+  // Damage the payload of the third record. The segment header frame is
+  // 16 bytes, each record frame 12 + sizeof(Record).
+  long frame = 12 + (long)sizeof(Record);
+  fs.flipByte("/spool/seg0", 16 + 2 * frame + 20);
+
+  Spool spool(fs);
+  spool.begin();
+  TEST_ASSERT_EQUAL(2, spool.pending());
+  TEST_ASSERT_EQUAL(1, nextId(spool));
+  TEST_ASSERT_EQUAL(2, nextId(spool));
+  TEST_ASSERT_EQUAL(0, nextId(spool));
+}
+
+void test_flash_usage_is_bounded()
+{
+  FileSpoolFs fs;
+  const size_t segmentSize = 1024;
+  const size_t maxSegments = 4;
+  Spool spool(fs, "/spool", segmentSize, maxSegments);
+  spool.begin();
+
+  // Offline for a long time: nothing is acknowledged
+  for (uint32_t id = 1; id <= 1000; id++)
+  {
+    TEST_ASSERT_TRUE(appendRecord(spool, id));
+    TEST_ASSERT_LESS_OR_EQUAL(segmentSize * maxSegments, spool.bytesUsed());
+  }
+  TEST_ASSERT_EQUAL(maxSegments, spool.segments());
+  TEST_ASSERT_EQUAL(1000, spool.stats().dropped + spool.pending());
+  TEST_ASSERT_GREATER_THAN(0, spool.stats().dropped);
+
+  // The newest records survive, still in order
+  uint32_t expected = 1000 - (uint32_t)spool.pending() + 1;
+  for (; expected <= 1000; expected++)
+  {
+    TEST_ASSERT_EQUAL(expected, nextId(spool));
+  }
+  TEST_ASSERT_EQUAL(0, nextId(spool));
+}
+
+void test_acked_segments_are_compacted()
+{
+  FileSpoolFs fs;
+  Spool spool(fs, "/spool", 1024, 4);
+  spool.begin();
+  for (uint32_t id = 1; id <= 60; id++)
+  {
+    appendRecord(spool, id);
+  }
+  TEST_ASSERT_GREATER_THAN(1, spool.segments());
+
+  while (nextId(spool) != 0)
+  {
+  }
+  spool.ack();
+  TEST_ASSERT_TRUE(spool.empty());
+  TEST_ASSERT_EQUAL(1, spool.segments());
+  TEST_ASSERT_LESS_OR_EQUAL(1024, spool.bytesUsed());
+
+  // A restart finds nothing to replay
+  Spool restarted(fs, "/spool", 1024, 4);
+  restarted.begin();
+  TEST_ASSERT_TRUE(restarted.empty());
+  TEST_ASSERT_EQUAL(0, nextId(restarted));
+}
+
+void test_segment_files_are_used_evenly()
+{
+  FileSpoolFs fs;
+  Spool spool(fs, "/spool", 1024, 8);
+  spool.begin();
+
+  // Online: every batch of 8 is acknowledged
+  for (uint32_t id = 1; id <= 4000; id++)
+  {
+    appendRecord(spool, id);
+    if (id % 8 == 0)
+    {
+      while (nextId(spool) != 0)
+      {
+      }
+      spool.ack();
+    }
+  }
+
+  int least = fs.writes[0];
+  int most = fs.writes[0];
+  for (int slot = 1; slot < 8; slot++)
+  {
+    least = fs.writes[slot] < least ? fs.writes[slot] : least;
+    most = fs.writes[slot] > most ? fs.writes[slot] : most;
+  }
+  TEST_ASSERT_GREATER_THAN(0, least);
+  TEST_ASSERT_LESS_OR_EQUAL(least * 11 / 10 + 1, most);
+}
+
+void test_replay_throughput()
+{
+  FileSpoolFs fs;
+  Spool spool(fs, "/spool", SPOOL_SEGMENT_SIZE, SPOOL_MAX_SEGMENTS);
+  spool.begin();
+  const uint32_t records = 2000;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint32_t id = 1; id <= records; id++)
+  {
+    appendRecord(spool, id);
+  }
+  double appendSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // Replay in commits of 16 after a restart
+  Spool restarted(fs, "/spool", SPOOL_SEGMENT_SIZE, SPOOL_MAX_SEGMENTS);
+  start = std::chrono::steady_clock::now();
+  restarted.begin();
+  uint32_t expected = records - (uint32_t)restarted.pending() + 1;
+  uint32_t batches = 0;
+  while (!restarted.empty())
+  {
+    for (int i = 0; i < 16; i++)
+    {
+      uint32_t id = nextId(restarted);
+      if (id == 0)
+      {
+        break;
+      }
+      TEST_ASSERT_EQUAL(expected++, id);
+    }
+    restarted.ack();
+    batches++;
+  }
+  double replaySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  char message[160];
+  snprintf(message, sizeof(message), "%u records: append %.0f/s, recover and replay %.0f/s in %u batches, %u dropped",
+           (unsigned)records, records / appendSeconds, (records - spool.stats().dropped) / replaySeconds,
+           (unsigned)batches, (unsigned)spool.stats().dropped);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(records + 1, expected);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_records_replay_in_order);
+  RUN_TEST(test_rewind_reads_unacked_records_again);
+  RUN_TEST(test_restart_resumes_after_last_ack);
+  RUN_TEST(test_torn_write_is_discarded_on_recovery);
+  RUN_TEST(test_truncated_segment_keeps_whole_frames);
+  RUN_TEST(test_crc_stops_at_damaged_frame);
+  RUN_TEST(test_flash_usage_is_bounded);
+  RUN_TEST(test_acked_segments_are_compacted);
+  RUN_TEST(test_segment_files_are_used_evenly);
+  RUN_TEST(test_replay_throughput);
+  return UNITY_END();
+}
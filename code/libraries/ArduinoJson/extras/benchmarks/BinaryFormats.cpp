@@ -0,0 +1,111 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+//
+// Compares the size of the sensor payloads in JSON, MsgPack, and CBOR, and
+// how fast each format is serialized and deserialized.
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+// What the plug publishes on tele/<topic>/SENSOR
+static const char sensorJson[] =
+    "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"TotalStartTime\":"
+    "\"2023-01-20T14:51:33\",\"Total\":1234.567,\"Yesterday\":0.321,"
+    "\"Today\":0.045,\"Period\":0,\"Power\":42,\"ApparentPower\":61,"
+    "\"ReactivePower\":44,\"Factor\":0.69,\"Voltage\":241,\"Current\":0.253}}";
+
+static std::string history(int count) {
+  std::string json = "[";
+  for (int i = 0; i < count; i++) {
+    if (i)
+      json += ",";
+    json += sensorJson;
+  }
+  return json + "]";
+}
+
+template <typename TFunction>
+static double timeIt(int iterations, TFunction f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+    f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+             .count() /
+         iterations;
+}
+
+struct Format {
+  const char* name;
+  size_t (*serialize)(JsonVariantConst, std::string&);
+  DeserializationError (*deserialize)(JsonDocument&, const std::string&);
+};
+
+static const Format formats[] = {
+    {"JSON",
+     [](JsonVariantConst src, std::string& out) {
+       return serializeJson(src, out);
+     },
+     [](JsonDocument& doc, const std::string& in) {
+       return deserializeJson(doc, in);
+     }},
+    {"MsgPack",
+     [](JsonVariantConst src, std::string& out) {
+       return serializeMsgPack(src, out);
+     },
+     [](JsonDocument& doc, const std::string& in) {
+       return deserializeMsgPack(doc, in);
+     }},
+    {"CBOR",
+     [](JsonVariantConst src, std::string& out) {
+       return serializeCbor(src, out);
+     },
+     [](JsonDocument& doc, const std::string& in) {
+       return deserializeCbor(doc, in);
+     }},
+};
+
+static void compare(const std::string& json, int iterations) {
+  DynamicJsonDocument doc(json.size() * 4);
+  deserializeJson(doc, json);
+
+  printf("%-8s %10s %14s %14s\n", "format", "bytes", "write (us)",
+         "read (us)");
+  for (const Format& format : formats) {
+    std::string output;
+    format.serialize(doc, output);
+
+    double write = timeIt(iterations, [&]() {
+      std::string s;
+      format.serialize(doc, s);
+    });
+    DynamicJsonDocument copy(json.size() * 4);
+    double read =
+        timeIt(iterations, [&]() { format.deserialize(copy, output); });
+    if (copy != doc) {
+      printf("%s: the round trip changed the document\n", format.name);
+      exit(1);
+    }
+
+    printf("%-8s %10zu %14.2f %14.2f\n", format.name, output.size(),
+           write * 1e6, read * 1e6);
+  }
+  printf("\n");
+}
+
+int main(int argc, const char* argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 100;
+  int iterations = argc > 2 ? atoi(argv[2]) : 10000;
+
+  printf("One sensor payload\n");
+  compare(sensorJson, iterations);
+
+  printf("An array of %d sensor payloads\n", count);
+  compare(history(count), iterations / count + 1);
+  return 0;
+}
@@ -0,0 +1,72 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+//
+// Formats the doubles of energy history payloads (total, today, yesterday)
+// with writeFloat() (9 significant digits) and writeShortestFloat().
+
+#define ARDUINOJSON_ENABLE_SHORTEST_FLOAT 0
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace ArduinoJson::detail;
+
+static std::vector<double> historyValues(int count) {
+  std::vector<double> values;
+  srand(42);
+  for (int i = 0; i < count; i++) {
+    double total = 1000 + rand() % 100000 / 1000.0;  // kWh, 3 decimals
+    double today = rand() % 10000 / 1000.0;
+    double yesterday = rand() % 10000 / 1000.0;
+    values.push_back(total);
+    values.push_back(today);
+    values.push_back(yesterday);
+    values.push_back(rand() / double(RAND_MAX) * 2300);  // power, full
+  }
+  return values;
+}
+
+template <typename TWrite>
+static void run(const char* name, const std::vector<double>& values,
+                int iterations, TWrite write) {
+  std::string output;
+  size_t exact = 0, bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (double value : values) {
+      output.clear();
+      Writer<std::string> sb(output);
+      TextFormatter<Writer<std::string>> formatter(sb);
+      write(formatter, value);
+      bytes += output.size();
+      if (i == 0 && strtod(output.c_str(), 0) == value)
+        exact++;
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  double count = double(values.size()) * iterations;
+  printf("%-22s %10.1f %10.2f %9.1f%%\n", name, elapsed.count() * 1e9 / count,
+         double(bytes) / count, 100.0 * double(exact) / double(values.size()));
+}
+
+int main(int argc, const char* argv[]) {
+  int samples = argc > 1 ? atoi(argv[1]) : 1000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 200;
+  std::vector<double> values = historyValues(samples);
+
+  printf("%zu doubles\n\n", values.size());
+  printf("%-22s %10s %10s %10s\n", "formatter", "ns/value", "chars", "exact");
+  run("writeFloat()", values, iterations,
+      [](TextFormatter<Writer<std::string>>& f, double v) { f.writeFloat(v); });
+  run("writeShortestFloat()", values, iterations,
+      [](TextFormatter<Writer<std::string>>& f, double v) {
+        f.writeShortestFloat(v);
+      });
+  return 0;
+}
@@ -0,0 +1,136 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+//
+// Reads an NDJSON export of the energy history, one record per line, with
+// deserializeJson() on each line, then with readJsonLines(). memcpy() gives
+// the upper bound.
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static std::string history(int count) {
+  std::string ndjson;
+  char line[160];
+  for (int i = 0; i < count; i++) {
+    snprintf(line, sizeof(line),
+             "{\"id\":\"-NZRIsscOZ8BlW%06d\",\"time\":\"2023-07-%02dT%02d:%02d:"
+             "01\",\"today\":%d.%03d,\"yesterday\":0.625,\"total\":%d.%05d}\n",
+             i, 1 + i / 1440 % 28, i / 60 % 24, i % 60, i % 7, i % 1000,
+             417 + i / 100, i * 7 % 100000);
+    ndjson += line;
+  }
+  return ndjson;
+}
+
+template <typename TFunction>
+static double throughput(const std::string& input, int iterations,
+                         TFunction f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+    f();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return double(input.size()) * iterations / 1e6 / seconds;
+}
+
+int main(int argc, const char* argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 100000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+  std::string input = history(count);
+  std::string copy(input.size(), 0);
+  DynamicJsonDocument doc(1024);
+  StaticJsonDocument<64> filter;
+  filter["total"] = true;
+
+  double total = 0;
+  printf("%d records, %zu bytes\n\n", count, input.size());
+  printf("%-32s %10s\n", "method", "MB/s");
+
+  printf("%-32s %10.1f\n", "memcpy()", throughput(input, iterations, [&]() {
+           memcpy(&copy[0], input.data(), input.size());
+         }));
+
+  printf("%-32s %10.1f\n", "deserializeJson() on each line",
+         throughput(input, iterations, [&]() {
+           const char* p = input.data();
+           const char* end = p + input.size();
+           while (p < end) {
+             const char* eol =
+                 static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+             if (!eol)
+               eol = end;
+             if (!deserializeJson(doc, p, size_t(eol - p)))
+               total += doc["total"].as<double>();
+             p = eol + 1;
+           }
+         }));
+
+  printf("%-32s %10.1f\n", "readJsonLines()",
+         throughput(input, iterations, [&]() {
+           auto lines = readJsonLines(doc, input);
+           DeserializationError err;
+           while ((err = lines.next()) != DeserializationError::EmptyInput)
+             if (!err)
+               total += doc["total"].as<double>();
+         }));
+
+  printf("%-32s %10.1f\n", "readJsonLines() with a filter",
+         throughput(input, iterations, [&]() {
+           auto lines = readJsonLines(doc, input,
+                                      DeserializationOption::Filter(filter));
+           DeserializationError err;
+           while ((err = lines.next()) != DeserializationError::EmptyInput)
+             if (!err)
+               total += doc["total"].as<double>();
+         }));
+
+  // Starts small, and grows by pages: deserializeJson() frees the pages
+  // before each line, readJsonLines() fills them again
+  DynamicJsonDocument growing(64, 128);
+
+  printf("%-32s %10.1f\n", "deserializeJson(), growing doc",
+         throughput(input, iterations, [&]() {
+           const char* p = input.data();
+           const char* end = p + input.size();
+           while (p < end) {
+             const char* eol =
+                 static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+             if (!eol)
+               eol = end;
+             if (!deserializeJson(growing, p, size_t(eol - p)))
+               total += growing["total"].as<double>();
+             p = eol + 1;
+           }
+         }));
+
+  printf("%-32s %10.1f\n", "readJsonLines(), growing doc",
+         throughput(input, iterations, [&]() {
+           auto lines = readJsonLines(growing, input);
+           DeserializationError err;
+           while ((err = lines.next()) != DeserializationError::EmptyInput)
+             if (!err)
+               total += growing["total"].as<double>();
+         }));
+
+  printf("%-32s %10.1f\n", "readJsonLines() from a stream",
+         throughput(input, iterations, [&]() {
+           std::istringstream stream(input);
+           auto lines = readJsonLines(doc, stream);
+           DeserializationError err;
+           while ((err = lines.next()) != DeserializationError::EmptyInput)
+             if (!err)
+               total += doc["total"].as<double>();
+         }));
+
+  printf("\nchecksum: %.1f\n", total);
+  return 0;
+}
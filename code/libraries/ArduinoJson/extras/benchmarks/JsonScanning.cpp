@@ -0,0 +1,89 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+//
+// Filters one field out of a pretty-printed Firestore listing, the way the
+// firmware reads its history. The string is scanned by blocks, the pointer
+// (whose end is unknown) and the stream one character at a time.
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static std::string firestoreListing(int documents) {
+  std::string json = "{\n  \"documents\": [\n";
+  for (int i = 0; i < documents; i++) {
+    std::string id = std::to_string(1688000000 + i * 3600);
+    if (i)
+      json += ",\n";
+    json +=
+        "    {\n"
+        "      \"name\": \"projects/marble/databases/(default)/documents/"
+        "device/uid/history/" +
+        id +
+        "\",\n"
+        "      \"fields\": {\n"
+        "        \"total\": {\n"
+        "          \"doubleValue\": " +
+        std::to_string(1000 + i) +
+        ".125\n"
+        "        },\n"
+        "        \"label\": {\n"
+        "          \"stringValue\": \"Tasmota \\\"Plug\\\" in the living "
+        "room, reading " +
+        id +
+        "\"\n"
+        "        }\n"
+        "      },\n"
+        "      \"createTime\": \"2023-07-11T22:29:54.123456Z\",\n"
+        "      \"updateTime\": \"2023-07-11T22:29:54.123456Z\"\n"
+        "    }";
+  }
+  return json + "\n  ]\n}\n";
+}
+
+template <typename TInput>
+static double parse(DynamicJsonDocument& doc, TInput& input,
+                    JsonDocument& filter) {
+  auto start = std::chrono::steady_clock::now();
+  deserializeJson(doc, input, DeserializationOption::Filter(filter));
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+static void run(const char* name, const std::string& json,
+                JsonDocument& filter, int iterations) {
+  DynamicJsonDocument doc(json.size());
+  double string = 0, pointer = 0, stream = 0;
+  for (int i = 0; i < iterations; i++) {
+    string += parse(doc, json, filter);
+    const char* ptr = json.c_str();
+    pointer += parse(doc, ptr, filter);
+    std::istringstream s(json);
+    stream += parse(doc, s, filter);
+  }
+  double megabytes = double(json.size()) * iterations / 1e6;
+  printf("%-10s %12.1f %12.1f %12.1f %10zu\n", name, megabytes / string,
+         megabytes / pointer, megabytes / stream, doc.memoryUsage());
+}
+
+int main(int argc, const char* argv[]) {
+  int documents = argc > 1 ? atoi(argv[1]) : 1000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+  std::string json = firestoreListing(documents);
+  StaticJsonDocument<128> totals, token;
+  deserializeJson(totals, "{\"documents\":[{\"fields\":{\"total\":true}}]}");
+  deserializeJson(token, "{\"nextPageToken\":true}");
+
+  printf("%d documents, %zu bytes of JSON\n\n", documents, json.size());
+  printf("%-10s %12s %12s %12s %10s\n", "filter", "string MB/s",
+         "pointer MB/s", "stream MB/s", "memory");
+  run("totals", json, totals, iterations);
+  run("token", json, token, iterations);
+  return 0;
+}
@@ -0,0 +1,111 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+//
+// Compares the single-block memory pool with the growing one on a Firestore
+// runQuery response: parse throughput and peak RAM taken from the allocator.
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static size_t current = 0, peak = 0, allocations = 0;
+
+// Tracks the bytes allocated, in a header before each block
+struct TrackingAllocator {
+  void* allocate(size_t n) {
+    size_t* p = static_cast<size_t*>(malloc(n + sizeof(size_t)));
+    if (!p)
+      return 0;
+    *p = n;
+    current += n;
+    if (current > peak)
+      peak = current;
+    allocations++;
+    return p + 1;
+  }
+
+  void deallocate(void* ptr) {
+    size_t* p = static_cast<size_t*>(ptr) - 1;
+    current -= *p;
+    free(p);
+  }
+
+  void* reallocate(void* ptr, size_t n) {
+    size_t* p = static_cast<size_t*>(ptr) - 1;
+    size_t old = *p;
+    p = static_cast<size_t*>(realloc(p, n + sizeof(size_t)));
+    if (!p)
+      return 0;
+    *p = n;
+    current = current - old + n;
+    if (current > peak)
+      peak = current;
+    return p + 1;
+  }
+};
+
+typedef BasicJsonDocument<TrackingAllocator> TrackedDocument;
+
+static std::string runQueryResponse(int documents) {
+  std::string json = "[";
+  for (int i = 0; i < documents; i++) {
+    std::string n = std::to_string(i);
+    if (i)
+      json += ",";
+    json +=
+        "{\"document\":{\"name\":\"projects/marble/databases/(default)/"
+        "documents/device/uid/sensors/overall/history/doc" +
+        n +
+        "\",\"fields\":{\"created\":{\"timestampValue\":\"2023-07-11T22:"
+        "29:54Z\"},\"power\":{\"integerValue\":\"" +
+        std::to_string(i * 37 % 2500) +
+        "\"},\"energy\":{\"doubleValue\":" + std::to_string(i * 0.125) +
+        "}},\"createTime\":\"2023-07-11T22:29:54.123456Z\",\"updateTime\":"
+        "\"2023-07-11T22:29:54.123456Z\"},\"readTime\":\"2023-07-12T08:00:"
+        "00.000000Z\"}";
+  }
+  return json + "]";
+}
+
+static void run(const char* name, const std::string& json, size_t capacity,
+                size_t pageSize, int iterations) {
+  current = peak = allocations = 0;
+  bool ok = true;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    TrackedDocument doc(capacity, pageSize);
+    ok = deserializeJson(doc, json) == DeserializationError::Ok && ok;
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  double mbps = double(json.size()) * iterations / elapsed.count() / 1e6;
+  printf("%-26s %10.1f %10zu %8.1f %s\n", name, mbps, peak,
+         double(allocations) / iterations, ok ? "" : "overflowed");
+}
+
+int main(int argc, const char* argv[]) {
+  int documents = argc > 1 ? atoi(argv[1]) : 20;
+  int iterations = argc > 2 ? atoi(argv[2]) : 2000;
+
+  std::string json = runQueryResponse(documents);
+  DynamicJsonDocument sizing(json.size() * 4);
+  deserializeJson(sizing, json);
+  size_t needed = sizing.memoryUsage();
+
+  printf("%d documents, %zu bytes of JSON, %zu bytes in the pool\n\n",
+         documents, json.size(), needed);
+  printf("%-26s %10s %10s %8s\n", "pool", "MB/s", "peak RAM", "allocs");
+  // Some slack, a string is written before the slot holding it is allocated
+  run("single block, +10%", json, needed + needed / 10, 0, iterations);
+  run("single block, 2x", json, needed * 2, 0, iterations);
+  run("pages of 256", json, 256, 256, iterations);
+  run("pages of 1024", json, 1024, 1024, iterations);
+  run("pages of 4096", json, 4096, 4096, iterations);
+  run("pages of 4096 after +10%", json, needed + needed / 10, 4096,
+      iterations);
+  return 0;
+}
@@ -0,0 +1,107 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+//
+// Parses the numbers of Tasmota ENERGY readings and of Firestore history
+// documents with parseNumber(), and with strtod() as a reference.
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace ArduinoJson::detail;
+
+static std::string format(const char* fmt, double value) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), fmt, value);
+  return buffer;
+}
+
+// The numbers of {"ENERGY":{"Total":1234.567,"Yesterday":1.234,...}}
+static std::vector<std::string> tasmotaNumbers(int readings) {
+  std::vector<std::string> numbers;
+  srand(42);
+  double total = 1000;
+  for (int i = 0; i < readings; i++) {
+    int power = rand() % 2300;
+    double today = rand() % 10000 / 1000.0;
+    total += today;
+    numbers.push_back(format("%.3f", total));
+    numbers.push_back(format("%.3f", rand() % 10000 / 1000.0));  // Yesterday
+    numbers.push_back(format("%.3f", today));
+    numbers.push_back(format("%.0f", power / 60.0));  // Period
+    numbers.push_back(format("%.0f", power));
+    numbers.push_back(format("%.0f", power * 100 / 92.0));  // ApparentPower
+    numbers.push_back(format("%.0f", power * 39 / 92.0));   // ReactivePower
+    numbers.push_back("0.92");                              // Factor
+    numbers.push_back("240");                               // Voltage
+    numbers.push_back(format("%.3f", power / 240.0));       // Current
+  }
+  return numbers;
+}
+
+// The doubleValue and integerValue fields of the history documents, written
+// with all their digits
+static std::vector<std::string> firestoreNumbers(int documents) {
+  std::vector<std::string> numbers;
+  srand(43);
+  for (int i = 0; i < documents; i++) {
+    double total = 1000 + rand() % 100000 / 1000.0;
+    double today = rand() % 10000 / 1000.0 * 1.07;  // sums drift off 3 digits
+    double yesterday = rand() / double(RAND_MAX) * 20;
+    numbers.push_back(format("%.17g", total));
+    numbers.push_back(format("%.17g", today));
+    numbers.push_back(format("%.17g", yesterday));
+    numbers.push_back(format("%.0f", 1688000000.0 + i * 3600));  // timestamp
+    numbers.push_back(format("%.0f", rand() % 2500));            // samples
+  }
+  return numbers;
+}
+
+static void run(const char* name, const std::vector<std::string>& numbers,
+                int iterations) {
+  double sum = 0;
+  size_t exact = 0;
+  VariantData result;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (const std::string& number : numbers) {
+      parseNumber(number.c_str(), result);
+      sum += result.asFloat<double>();
+    }
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (const std::string& number : numbers)
+      sum -= strtod(number.c_str(), 0);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  for (const std::string& number : numbers) {
+    parseNumber(number.c_str(), result);
+    if (result.asFloat<double>() == strtod(number.c_str(), 0))
+      exact++;
+  }
+
+  double count = double(numbers.size()) * iterations;
+  std::chrono::duration<double> ours = middle - start;
+  std::chrono::duration<double> reference = end - middle;
+  printf("%-12s %10zu %12.1f %12.1f %9.1f%% %g\n", name, numbers.size(),
+         ours.count() * 1e9 / count, reference.count() * 1e9 / count,
+         100.0 * double(exact) / double(numbers.size()), sum);
+}
+
+int main(int argc, const char* argv[]) {
+  int samples = argc > 1 ? atoi(argv[1]) : 1000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 100;
+
+  printf("%-12s %10s %12s %12s %10s\n", "corpus", "numbers", "parseNumber",
+         "strtod", "exact");
+  run("Tasmota", tasmotaNumbers(samples), iterations);
+  run("Firestore", firestoreNumbers(samples), iterations);
+  return 0;
+}
@@ -0,0 +1,71 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+//
+// Looks up every field of a Firestore document with many fields, in a fixed
+// pool (walks the members) and in a growing one (indexes large objects).
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static std::string fieldName(int i) {
+  return "sensor" + std::to_string(i);
+}
+
+static std::string firestoreDocument(int fields) {
+  std::string json =
+      "{\"name\":\"projects/marble/databases/(default)/documents/device/uid\","
+      "\"fields\":{";
+  for (int i = 0; i < fields; i++) {
+    if (i)
+      json += ",";
+    json += "\"" + fieldName(i) + "\":{\"integerValue\":\"" +
+            std::to_string(i * 37 % 2500) + "\"}";
+  }
+  return json + "},\"createTime\":\"2023-07-11T22:29:54.123456Z\"}";
+}
+
+static void run(const char* name, const std::string& json,
+                const std::vector<std::string>& keys, DynamicJsonDocument& doc,
+                int iterations) {
+  double parse = 0, lookup = 0;
+  long sum = 0;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    deserializeJson(doc, json);
+    auto parsed = std::chrono::steady_clock::now();
+    JsonObjectConst fields = doc["fields"];
+    for (const std::string& key : keys)
+      sum += atol(fields[key]["integerValue"] | "0");
+    auto done = std::chrono::steady_clock::now();
+    parse += std::chrono::duration<double>(parsed - start).count();
+    lookup += std::chrono::duration<double>(done - parsed).count();
+  }
+  printf("%-22s %10.2f %10.2f %10zu %ld\n", name, parse * 1e6 / iterations,
+         lookup * 1e6 / iterations, doc.memoryUsage(), sum / iterations);
+}
+
+int main(int argc, const char* argv[]) {
+  int fields = argc > 1 ? atoi(argv[1]) : 100;
+  int iterations = argc > 2 ? atoi(argv[2]) : 2000;
+
+  std::string json = firestoreDocument(fields);
+  std::vector<std::string> keys;
+  for (int i = 0; i < fields; i++)
+    keys.push_back(fieldName(i));
+
+  DynamicJsonDocument fixed(json.size() * 4);
+  DynamicJsonDocument paged(1024, 1024);
+
+  printf("%d fields, %zu bytes of JSON, index %s\n\n", fields, json.size(),
+         ARDUINOJSON_ENABLE_OBJECT_INDEX ? "enabled" : "disabled");
+  printf("%-22s %10s %10s %10s\n", "pool", "parse us", "lookup us", "memory");
+  run("fixed (no index)", json, keys, fixed, iterations);
+  run("pages of 1024", json, keys, paged, iterations);
+  return 0;
+}
@@ -0,0 +1,137 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+//
+// Fills an array of bound structs from a JSON input, either through a
+// JsonDocument (deserializeJson() then as<T>()) or straight from the parser
+// (bindJson()). Counts the allocations and the bytes of RAM each one writes.
+
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+struct Field {
+  char type[12];
+  double value;
+};
+ARDUINOJSON_BIND(Field, ARDUINOJSON_BIND_MEMBER("type", type),
+                 ARDUINOJSON_BIND_MEMBER("value", value))
+
+struct Reading {
+  char device[16];
+  long time;
+  bool online;
+  Field fields[3];
+};
+ARDUINOJSON_BIND(Reading, ARDUINOJSON_BIND_MEMBER("device", device),
+                 ARDUINOJSON_BIND_MEMBER("time", time),
+                 ARDUINOJSON_BIND_MEMBER("online", online),
+                 ARDUINOJSON_BIND_MEMBER("fields", fields))
+
+const int maxReadings = 1000;
+static Reading readings[maxReadings];
+
+static size_t allocations = 0;
+static size_t allocatedBytes = 0;
+
+struct CountingAllocator {
+  void* allocate(size_t n) {
+    allocations++;
+    allocatedBytes += n;
+    return malloc(n);
+  }
+
+  void deallocate(void* p) {
+    free(p);
+  }
+
+  void* reallocate(void* p, size_t n) {
+    allocations++;
+    allocatedBytes += n;
+    return realloc(p, n);
+  }
+};
+
+typedef BasicJsonDocument<CountingAllocator> CountingJsonDocument;
+
+static std::string readingsJson(int count) {
+  std::string json = "[";
+  for (int i = 0; i < count; i++) {
+    std::string n = std::to_string(i);
+    if (i)
+      json += ",";
+    json += "{\"device\":\"plug-" + n + "\",\"time\":" +
+            std::to_string(1689000000 + i) +
+            ",\"online\":true,\"firmware\":\"tasmota 12.5.0\",\"fields\":["
+            "{\"type\":\"power\",\"value\":" +
+            n + ".5,\"unit\":\"W\"},{\"type\":\"voltage\",\"value\":230.1},"
+            "{\"type\":\"current\",\"value\":0.25}]}";
+  }
+  return json + "]";
+}
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+static double viaDocument(const std::string& json, int count,
+                          size_t& poolUsage) {
+  auto start = std::chrono::steady_clock::now();
+  CountingJsonDocument doc(json.size() * 4);
+  deserializeJson(doc, json);
+  int i = 0;
+  for (JsonVariantConst reading : doc.as<JsonArrayConst>())
+    if (i < count)
+      readings[i++] = reading.as<Reading>();
+  double t = elapsed(start);
+  poolUsage = doc.memoryUsage();
+  return t;
+}
+
+static double viaBinding(const std::string& json) {
+  auto start = std::chrono::steady_clock::now();
+  bindJson(json, readings);
+  return elapsed(start);
+}
+
+int main(int argc, const char* argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 100;
+  int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+  if (count > maxReadings)
+    count = maxReadings;
+
+  std::string json = readingsJson(count);
+  size_t structBytes = sizeof(Reading) * size_t(count);
+  printf("%d readings, %zu bytes of JSON, %zu bytes of structs\n\n", count,
+         json.size(), structBytes);
+  printf("%-10s %10s %14s %14s %10s\n", "method", "MB/s", "allocations",
+         "bytes written", "checksum");
+
+  size_t poolUsage = 0;
+  double seconds = 0;
+  allocations = allocatedBytes = 0;
+  for (int i = 0; i < iterations; i++)
+    seconds += viaDocument(json, count, poolUsage);
+  double checksum = readings[count - 1].fields[0].value;
+  printf("%-10s %10.1f %14.1f %14zu %10.1f\n", "document",
+         double(json.size()) * iterations / 1e6 / seconds,
+         double(allocations) / iterations, poolUsage + structBytes, checksum);
+
+  readings[count - 1] = Reading();
+  seconds = 0;
+  allocations = allocatedBytes = 0;
+  for (int i = 0; i < iterations; i++)
+    seconds += viaBinding(json);
+  checksum = readings[count - 1].fields[0].value;
+  // the parser's buffer for the strings, on the stack
+  printf("%-10s %10.1f %14.1f %14zu %10.1f\n", "binding",
+         double(json.size()) * iterations / 1e6 / seconds,
+         double(allocations) / iterations,
+         size_t(ARDUINOJSON_PARSER_STRING_SIZE) + structBytes, checksum);
+  return 0;
+}
@@ -0,0 +1,24 @@
+#include <ArduinoJson.h>
+
+#include <stdlib.h>  // abort
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  DynamicJsonDocument doc(4096);
+  DeserializationError error = deserializeCbor(doc, data, size);
+  if (!error) {
+    std::string cbor;
+    if (serializeCbor(doc, cbor) != measureCbor(doc))
+      abort();
+
+    // The output is in the preferred serialization, so it must come back
+    // unchanged
+    DynamicJsonDocument copy(4096);
+    if (deserializeCbor(copy, cbor) != DeserializationError::Ok)
+      abort();
+    std::string again;
+    serializeCbor(copy, again);
+    if (again != cbor)
+      abort();
+  }
+  return 0;
+}
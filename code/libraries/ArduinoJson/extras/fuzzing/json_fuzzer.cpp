@@ -1,11 +1,95 @@
 #include <ArduinoJson.h>
 
+#include <stdlib.h>  // abort
+#include <sstream>
+
+// Rebuilds a document from the events of parseJson()
+struct DocumentBuilder {
+  DocumentBuilder(JsonDocument& doc) : doc_(doc), depth_(0) {}
+
+  bool startObject() {
+    stack_[depth_] = next().to<JsonObject>();
+    depth_++;
+    return true;
+  }
+
+  bool key(JsonString key) {
+    key_.assign(key.c_str(), key.size());
+    return true;
+  }
+
+  bool endObject() {
+    depth_--;
+    return true;
+  }
+
+  bool startArray() {
+    stack_[depth_] = next().to<JsonArray>();
+    depth_++;
+    return true;
+  }
+
+  bool endArray() {
+    depth_--;
+    return true;
+  }
+
+  bool value(JsonVariantConst value) {
+    next().set(value);
+    return true;
+  }
+
+ private:
+  JsonVariant next() {
+    if (depth_ == 0)
+      return doc_.to<JsonVariant>();
+    JsonVariant parent = stack_[depth_ - 1];
+    if (parent.is<JsonArray>())
+      return parent.add();
+    return parent[key_].to<JsonVariant>();
+  }
+
+  JsonDocument& doc_;
+  JsonVariant stack_[ARDUINOJSON_DEFAULT_NESTING_LIMIT + 1];
+  int depth_;
+  std::string key_;
+};
+
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   DynamicJsonDocument doc(4096);
   DeserializationError error = deserializeJson(doc, data, size);
+  std::string json;
   if (!error) {
-    std::string json;
     serializeJson(doc, json);
   }
+
+  // A stream is read one character at a time, the same input in RAM is
+  // scanned by blocks; they must agree
+  std::istringstream stream(
+      std::string(reinterpret_cast<const char*>(data), size));
+  DynamicJsonDocument streamed(4096);
+  if (deserializeJson(streamed, stream) != error)
+    abort();
+  if (!error) {
+    std::string streamedJson;
+    serializeJson(streamed, streamedJson);
+    if (streamedJson != json)
+      abort();
+  }
+
+  // parseJson() shares the tokenizer with deserializeJson(), they must agree
+  DynamicJsonDocument rebuilt(4096);
+  DocumentBuilder builder(rebuilt);
+  DeserializationError parseError = parseJson(data, size, builder);
+  if (error != DeserializationError::NoMemory &&
+      parseError != DeserializationError::NoMemory && !rebuilt.overflowed()) {
+    if (parseError != error)
+      abort();
+    std::string rebuiltJson;
+    if (!error)
+      serializeJson(rebuilt, rebuiltJson);
+    if (rebuiltJson != json)
+      abort();
+  }
   return 0;
 }
@@ -0,0 +1,84 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include <sstream>
+
+static const char* samples[] = {
+    "null",
+    "true",
+    "[]",
+    "{}",
+    "[0,-1,23,24,-25,255,256,65535,65536,-65537,2147483647,-2147483648]",
+    "[0.5,-1.5,65504,0.1,3.14159,1e-10,1.5e300,-2.5e-300]",
+    "\"\"",
+    "\"ArduinoJson \\u00e9\\u20ac\"",
+    "[[[]],[{}],{\"a\":[1,{\"b\":null}]}]",
+    "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"TotalStartTime\":"
+    "\"2023-01-20T14:51:33\",\"Total\":1234.567,\"Yesterday\":0.321,"
+    "\"Today\":0.045,\"Period\":0,\"Power\":42,\"ApparentPower\":61,"
+    "\"ReactivePower\":44,\"Factor\":0.69,\"Voltage\":241,\"Current\":0.253}}",
+};
+
+TEST_CASE("CBOR round trip") {
+  DynamicJsonDocument json(4096);
+  DynamicJsonDocument cbor(4096);
+  DynamicJsonDocument msgpack(4096);
+
+  for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+    CAPTURE(samples[i]);
+    REQUIRE(deserializeJson(json, samples[i]) == DeserializationError::Ok);
+
+    std::string output;
+    size_t n = serializeCbor(json, output);
+    REQUIRE(n == output.size());
+    REQUIRE(n == measureCbor(json));
+
+    SECTION("CBOR gives back the same document") {
+      REQUIRE(deserializeCbor(cbor, output) == DeserializationError::Ok);
+      REQUIRE(cbor == json);
+      REQUIRE(cbor.memoryUsage() == json.memoryUsage());
+    }
+
+    SECTION("CBOR and MsgPack agree") {
+      std::string packed;
+      serializeMsgPack(json, packed);
+      REQUIRE(deserializeMsgPack(msgpack, packed) == DeserializationError::Ok);
+      REQUIRE(deserializeCbor(cbor, output) == DeserializationError::Ok);
+      REQUIRE(cbor == msgpack);
+    }
+
+    SECTION("serialization is stable") {
+      REQUIRE(deserializeCbor(cbor, output) == DeserializationError::Ok);
+      std::string again;
+      serializeCbor(cbor, again);
+      REQUIRE(again == output);
+    }
+
+    SECTION("every input type gives the same document") {
+      std::istringstream stream(output);
+      REQUIRE(deserializeCbor(cbor, stream) == DeserializationError::Ok);
+      REQUIRE(cbor == json);
+
+      REQUIRE(deserializeCbor(cbor, output.data(), output.size()) ==
+              DeserializationError::Ok);
+      REQUIRE(cbor == json);
+    }
+  }
+}
+
+TEST_CASE("CBOR vs MsgPack vs JSON sizes") {
+  DynamicJsonDocument doc(4096);
+  deserializeJson(doc, samples[9]);
+
+  size_t jsonSize = measureJson(doc);
+  size_t msgpackSize = measureMsgPack(doc);
+  size_t cborSize = measureCbor(doc);
+
+  CHECK(jsonSize == 233);
+  CHECK(msgpackSize == 206);
+  CHECK(cborSize == 209);
+}
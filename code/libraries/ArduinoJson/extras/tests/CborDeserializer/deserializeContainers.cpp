@@ -0,0 +1,75 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+template <size_t N>
+static void check(const char (&input)[N], const char* expectedJson) {
+  DynamicJsonDocument doc(4096);
+
+  DeserializationError error = deserializeCbor(doc, input, N - 1);
+
+  REQUIRE(error == DeserializationError::Ok);
+  REQUIRE(doc.as<std::string>() == expectedJson);
+}
+
+// The examples come from the appendix A of RFC 8949
+TEST_CASE("deserialize CBOR array") {
+  SECTION("definite length") {
+    check("\x80", "[]");
+    check("\x83\x01\x02\x03", "[1,2,3]");
+    check("\x83\x01\x82\x02\x03\x82\x04\x05", "[1,[2,3],[4,5]]");
+    check("\x98\x19\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0A\x0B\x0C\x0D\x0E"
+          "\x0F\x10\x11\x12\x13\x14\x15\x16\x17\x18\x18\x18\x19",
+          "[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,"
+          "25]");
+  }
+
+  SECTION("indefinite length") {
+    check("\x9F\xFF", "[]");
+    check("\x9F\x01\x82\x02\x03\x9F\x04\x05\xFF\xFF", "[1,[2,3],[4,5]]");
+    check("\x9F\x01\x82\x02\x03\x82\x04\x05\xFF", "[1,[2,3],[4,5]]");
+    check("\x83\x01\x82\x02\x03\x9F\x04\x05\xFF", "[1,[2,3],[4,5]]");
+    check("\x83\x01\x9F\x02\x03\xFF\x82\x04\x05", "[1,[2,3],[4,5]]");
+  }
+
+  SECTION("unsupported elements become null") {
+    check("\x83\x42\x01\x02\xF7\xC1\x01", "[null,null,1]");
+  }
+}
+
+TEST_CASE("deserialize CBOR map") {
+  SECTION("definite length") {
+    check("\xA0", "{}");
+    check("\xA2\x61\x61\x01\x61\x62\x82\x02\x03", "{\"a\":1,\"b\":[2,3]}");
+    check("\x82\x61\x61\xA1\x61\x62\x61\x63", "[\"a\",{\"b\":\"c\"}]");
+    check("\xA5\x61\x61\x61\x41\x61\x62\x61\x42\x61\x63\x61\x43\x61\x64\x61"
+          "\x44\x61\x65\x61\x45",
+          "{\"a\":\"A\",\"b\":\"B\",\"c\":\"C\",\"d\":\"D\",\"e\":\"E\"}");
+  }
+
+  SECTION("indefinite length") {
+    check("\xBF\xFF", "{}");
+    check("\xBF\x61\x61\x01\x61\x62\x9F\x02\x03\xFF\xFF",
+          "{\"a\":1,\"b\":[2,3]}");
+    check("\x82\x61\x61\xBF\x61\x62\x61\x63\xFF", "[\"a\",{\"b\":\"c\"}]");
+    check("\xBF\x63"
+          "Fun\xF5\x63"
+          "Amt\x21\xFF",
+          "{\"Fun\":true,\"Amt\":-2}");
+  }
+
+  SECTION("indefinite-length key") {
+    check("\xA1\x7F\x62ke\x61y\xFF\x01", "{\"key\":1}");
+  }
+
+  SECTION("tagged value") {
+    check("\xA1\x61t\xC1\x1A\x51\x4B\x67\xB0", "{\"t\":1363896240}");
+  }
+
+  SECTION("duplicate keys are kept") {
+    check("\xA2\x61\x61\x01\x61\x61\x02", "{\"a\":1,\"a\":2}");
+  }
+}
@@ -0,0 +1,151 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include <limits>
+
+template <typename T, size_t N, typename U>
+static void check(const char (&input)[N], U expected) {
+  DynamicJsonDocument doc(4096);
+
+  DeserializationError error = deserializeCbor(doc, input, N - 1);
+
+  REQUIRE(error == DeserializationError::Ok);
+  REQUIRE(doc.is<T>());
+  REQUIRE(doc.as<T>() == expected);
+}
+
+template <size_t N>
+static void checkIsNull(const char (&input)[N]) {
+  DynamicJsonDocument doc(4096);
+
+  DeserializationError error = deserializeCbor(doc, input, N - 1);
+
+  REQUIRE(error == DeserializationError::Ok);
+  REQUIRE(doc.as<JsonVariant>().isNull());
+}
+
+// The examples come from the appendix A of RFC 8949
+TEST_CASE("deserialize CBOR value") {
+  SECTION("null and undefined") {
+    checkIsNull("\xF6");
+    checkIsNull("\xF7");
+  }
+
+  SECTION("bool") {
+    check<bool>("\xF4", false);
+    check<bool>("\xF5", true);
+  }
+
+  SECTION("simple values are not supported") {
+    checkIsNull("\xF0");
+    checkIsNull("\xF8\xFF");
+  }
+
+  SECTION("unsigned integer") {
+    check<int>("\x00", 0);
+    check<int>("\x17", 23);
+    check<int>("\x18\x18", 24);
+    check<int>("\x18\xFF", 255);
+    check<int>("\x19\x03\xE8", 1000);
+    check<long>("\x1A\x00\x0F\x42\x40", 1000000);
+    check<uint32_t>("\x1A\xFF\xFF\xFF\xFF", 4294967295U);
+  }
+
+  SECTION("negative integer") {
+    check<int>("\x20", -1);
+    check<int>("\x29", -10);
+    check<int>("\x38\x63", -100);
+    check<int>("\x39\x03\xE7", -1000);
+    check<long>("\x3A\x00\x01\x00\x00", -65537);
+  }
+
+#if ARDUINOJSON_USE_LONG_LONG
+  SECTION("64-bit integer") {
+    check<uint64_t>("\x1B\x00\x00\x00\xE8\xD4\xA5\x10\x00", 1000000000000ULL);
+    check<uint64_t>("\x1B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+                    18446744073709551615ULL);
+    check<int64_t>("\x3B\x7F\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+                   std::numeric_limits<int64_t>::min());
+  }
+
+  SECTION("integers below the range of JsonInteger are not supported") {
+    checkIsNull("\x3B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF");
+    checkIsNull("\x3B\x80\x00\x00\x00\x00\x00\x00\x00");
+  }
+#endif
+
+  SECTION("half-precision float") {
+    check<double>("\xF9\x00\x00", 0.0);
+    check<double>("\xF9\x3C\x00", 1.0);
+    check<double>("\xF9\x3E\x00", 1.5);
+    check<double>("\xF9\x7B\xFF", 65504.0);
+    check<double>("\xF9\x00\x01", 5.960464477539063e-8);
+    check<double>("\xF9\x04\x00", 0.00006103515625);
+    check<double>("\xF9\xC4\x00", -4.0);
+    check<double>("\xF9\x7C\x00", std::numeric_limits<double>::infinity());
+    check<double>("\xF9\xFC\x00", -std::numeric_limits<double>::infinity());
+
+    DynamicJsonDocument doc(64);
+    deserializeCbor(doc, "\xF9\x7E\x00", 3);
+    double nan = doc.as<double>();
+    REQUIRE(nan != nan);
+  }
+
+  SECTION("single-precision float") {
+    check<double>("\xFA\x47\xC3\x50\x00", 100000.0);
+    check<double>("\xFA\x7F\x7F\xFF\xFF", 3.4028234663852886e+38);
+    check<float>("\xFA\x3F\x8C\xCC\xCD", 1.1f);
+  }
+
+  SECTION("double-precision float") {
+    check<double>("\xFB\x3F\xF1\x99\x99\x99\x99\x99\x9A", 1.1);
+    check<double>("\xFB\x7E\x37\xE4\x3C\x88\x00\x75\x9C", 1.0e+300);
+    check<double>("\xFB\xC0\x10\x66\x66\x66\x66\x66\x66", -4.1);
+  }
+
+  SECTION("text string") {
+    check<std::string>("\x60", "");
+    check<std::string>("\x61\x61", "a");
+    check<std::string>("\x64IETF", "IETF");
+    check<std::string>("\x62\x22\x5C", "\"\\");
+    check<std::string>("\x62\xC3\xBC", "\xC3\xBC");
+    check<std::string>("\x78\x05hello", "hello");
+    check<std::string>("\x79\x00\x05hello", "hello");
+    check<std::string>("\x7A\x00\x00\x00\x05hello", "hello");
+    check<std::string>("\x7B\x00\x00\x00\x00\x00\x00\x00\x05hello", "hello");
+  }
+
+  SECTION("indefinite-length text string") {
+    check<std::string>("\x7F\x65strea\x64ming\xFF", "streaming");
+    check<std::string>("\x7F\xFF", "");
+  }
+
+  SECTION("long text string") {
+    std::string s(300, 'x');
+    std::string input = std::string("\x79\x01\x2C", 3) + s;
+    DynamicJsonDocument doc(4096);
+    REQUIRE(deserializeCbor(doc, input) == DeserializationError::Ok);
+    REQUIRE(doc.as<std::string>() == s);
+  }
+
+  SECTION("byte strings are not supported") {
+    checkIsNull("\x40");
+    checkIsNull("\x44\x01\x02\x03\x04");
+    checkIsNull("\x5F\x42\x01\x02\x43\x03\x04\x05\xFF");
+  }
+
+  SECTION("tags are ignored") {
+    check<std::string>("\xC0\x74"
+                       "2013-03-21T20:04:00Z",
+                       "2013-03-21T20:04:00Z");
+    check<int>("\xC1\x1A\x51\x4B\x67\xB0", 1363896240);
+    check<std::string>("\xD8\x20\x76http://www.example.com",
+                       "http://www.example.com");
+    check<int>("\xC6\xD9\xD9\xF7\x01", 1);
+    checkIsNull("\xC2\x49\x01\x00\x00\x00\x00\x00\x00\x00\x00");
+  }
+}
@@ -0,0 +1,107 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+template <size_t N>
+static DeserializationError deserialize(
+    const char (&input)[N], DeserializationOption::NestingLimit nesting = {}) {
+  DynamicJsonDocument doc(4096);
+  return deserializeCbor(doc, input, N - 1, nesting);
+}
+
+TEST_CASE("deserializeCbor() errors") {
+  SECTION("EmptyInput") {
+    REQUIRE(deserialize("") == DeserializationError::EmptyInput);
+  }
+
+  SECTION("IncompleteInput") {
+    REQUIRE(deserialize("\x18") == DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\x19\x01") == DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\x3A\x00\x00\x01") ==
+            DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\xF9\x3C") == DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\xFA\x3F\x8C\xCC") ==
+            DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\xFB\x3F\xF1\x99\x99\x99\x99\x99") ==
+            DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\x64IET") == DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\x7F\x62no") == DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\x44\x01\x02") ==
+            DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\x83\x01\x02") ==
+            DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\x9F\x01\x02") ==
+            DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\xA1\x61\x61") ==
+            DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\xBF\x61\x61\x01") ==
+            DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\xC1") == DeserializationError::IncompleteInput);
+    REQUIRE(deserialize("\xF8") == DeserializationError::IncompleteInput);
+  }
+
+  SECTION("InvalidInput") {
+    SECTION("break outside of an indefinite-length item") {
+      REQUIRE(deserialize("\xFF") == DeserializationError::InvalidInput);
+      REQUIRE(deserialize("\x81\xFF") == DeserializationError::InvalidInput);
+    }
+
+    SECTION("reserved additional information") {
+      REQUIRE(deserialize("\x1C") == DeserializationError::InvalidInput);
+      REQUIRE(deserialize("\x3D") == DeserializationError::InvalidInput);
+      REQUIRE(deserialize("\x7E") == DeserializationError::InvalidInput);
+      REQUIRE(deserialize("\xFC") == DeserializationError::InvalidInput);
+    }
+
+    SECTION("indefinite-length integer") {
+      REQUIRE(deserialize("\x1F") == DeserializationError::InvalidInput);
+      REQUIRE(deserialize("\xDF\x01") == DeserializationError::InvalidInput);
+    }
+
+    SECTION("wrong chunk in an indefinite-length string") {
+      REQUIRE(deserialize("\x7F\x41x\xFF") ==
+              DeserializationError::InvalidInput);
+      REQUIRE(deserialize("\x7F\x7F\xFF\xFF") ==
+              DeserializationError::InvalidInput);
+      REQUIRE(deserialize("\x5F\x61x\xFF") ==
+              DeserializationError::InvalidInput);
+    }
+
+    SECTION("key that isn't a text string") {
+      REQUIRE(deserialize("\xA1\x01\x02") ==
+              DeserializationError::InvalidInput);
+      REQUIRE(deserialize("\xA1\x41k\x02") ==
+              DeserializationError::InvalidInput);
+    }
+  }
+
+  SECTION("NoMemory") {
+    SECTION("document too small") {
+      StaticJsonDocument<JSON_ARRAY_SIZE(2)> doc;
+      REQUIRE(deserializeCbor(doc, "\x83\x01\x02\x03", 4) ==
+              DeserializationError::NoMemory);
+    }
+
+    SECTION("string too long") {
+      StaticJsonDocument<16> doc;
+      REQUIRE(deserializeCbor(doc, "\x74"
+                                   "01234567890123456789",
+                              21) == DeserializationError::NoMemory);
+    }
+  }
+
+  SECTION("TooDeep") {
+    DeserializationOption::NestingLimit nesting(2);
+
+    REQUIRE(deserialize("\x81\x81\x01", nesting) == DeserializationError::Ok);
+    REQUIRE(deserialize("\x81\x81\x81\x01", nesting) ==
+            DeserializationError::TooDeep);
+    REQUIRE(deserialize("\xA1\x61\x61\xBF\x61\x62\xA0\xFF", nesting) ==
+            DeserializationError::TooDeep);
+    REQUIRE(deserialize("\xC1\x81\xC1\x81\xC1\x81\x01", nesting) ==
+            DeserializationError::TooDeep);
+  }
+}
@@ -0,0 +1,114 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+TEST_CASE("deserializeCbor() filter") {
+  StaticJsonDocument<4096> doc;
+  DeserializationError error;
+
+  StaticJsonDocument<200> filter;
+  DeserializationOption::Filter filterOpt(filter);
+
+  SECTION("filter = {include:true,ignore:false}") {
+    filter["include"] = true;
+    filter["ignore"] = false;
+
+    SECTION("skip every type") {
+      // {"ignore":X,"include":42} for each value X
+      const char* values[] = {
+          "\x18\x2A",                       // uint 8
+          "\x39\x03\xE7",                   // negative int 16
+          "\x43\x01\x02\x03",               // byte string
+          "\x63\x61\x62\x63",               // text string
+          "\x7F\x61\x61\x61\x62\xFF",       // indefinite text string
+          "\x82\x01\x61\x61",               // array
+          "\x9F\x01\x9F\xFF\xFF",           // indefinite array
+          "\xA1\x61\x61\x81\x01",           // map
+          "\xBF\x61\x61\xBF\xFF\xFF",       // indefinite map
+          "\xC1\x1A\x51\x4B\x67\xB0",       // tag
+          "\xF5",                           // true
+          "\xF6",                           // null
+          "\xF8\x20",                       // simple value
+          "\xF9\x3C\x01",                   // half
+          "\xFA\x3F\x8C\xCC\xCD",           // float
+          "\xFB\x3F\xF1\x99\x99\x99\x99\x99\x9A",  // double
+      };
+      const size_t sizes[] = {2, 3, 4, 4, 6, 4, 5, 5, 6, 6, 1, 1, 2, 3, 5, 9};
+
+      for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        std::string input = "\xA2\x66ignore";
+        input.append(values[i], sizes[i]);
+        input += "\x67include\x18\x2A";
+
+        error = deserializeCbor(doc, input, filterOpt);
+
+        CAPTURE(i);
+        CHECK(error == DeserializationError::Ok);
+        CHECK(doc.as<std::string>() == "{\"include\":42}");
+        CHECK(doc.memoryUsage() == JSON_OBJECT_SIZE(1) + 8);
+      }
+    }
+
+    SECTION("input truncated in skipped value") {
+      error = deserializeCbor(doc, "\xA2\x66ignore\x19\x01", 10, filterOpt);
+
+      CHECK(error == DeserializationError::IncompleteInput);
+      CHECK(doc.as<std::string>() == "{}");
+      CHECK(doc.memoryUsage() == JSON_OBJECT_SIZE(0));
+    }
+
+    SECTION("invalid skipped value") {
+      error = deserializeCbor(doc, "\xA2\x66ignore\x1C\x67include\x01", 18,
+                              filterOpt);
+
+      CHECK(error == DeserializationError::InvalidInput);
+      CHECK(doc.as<std::string>() == "{}");
+    }
+  }
+
+  SECTION("filter = {sensors:[{temp:true}]}") {
+    filter["sensors"][0]["temp"] = true;
+
+    // {"sensors":[{"id":1,"temp":21.5},{"id":2,"temp":-3}],"count":2}
+    error = deserializeCbor(doc,
+                            "\xA2\x67sensors\x82\xA2\x62id\x01\x64temp\xF9\x4D"
+                            "\x60\xA2\x62id\x02\x64temp\x22\x65"
+                            "count\x02",
+                            filterOpt);
+
+    CHECK(error == DeserializationError::Ok);
+    CHECK(doc.as<std::string>() ==
+          "{\"sensors\":[{\"temp\":21.5},{\"temp\":-3}]}");
+  }
+
+  SECTION("filter = false") {
+    filter.set(false);
+
+    error = deserializeCbor(doc, "\x83\x01\x02\x03", 4, filterOpt);
+
+    CHECK(error == DeserializationError::Ok);
+    CHECK(doc.isNull());
+    CHECK(doc.memoryUsage() == 0);
+  }
+
+  SECTION("filter = true") {
+    filter.set(true);
+
+    error = deserializeCbor(doc, "\x83\x01\x02\x03", 4, filterOpt);
+
+    CHECK(error == DeserializationError::Ok);
+    CHECK(doc.as<std::string>() == "[1,2,3]");
+  }
+
+  SECTION("filter and nesting limit") {
+    filter["include"] = true;
+
+    error = deserializeCbor(doc, "\xA1\x66ignore\x81\x81\x01", 11, filterOpt,
+                            DeserializationOption::NestingLimit(1));
+
+    CHECK(error == DeserializationError::TooDeep);
+  }
+}
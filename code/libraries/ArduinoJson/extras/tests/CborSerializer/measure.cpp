@@ -0,0 +1,27 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+TEST_CASE("measureCbor()") {
+  DynamicJsonDocument doc(4096);
+
+  SECTION("object") {
+    JsonObject object = doc.to<JsonObject>();
+    object["hello"] = "world";
+
+    REQUIRE(measureCbor(doc) == 13);
+  }
+
+  SECTION("same as serializeCbor()") {
+    deserializeJson(doc,
+                    "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"Total\":"
+                    "1234.567,\"Factor\":0.69,\"Power\":42,\"Today\":0.5}}");
+    std::string cbor;
+
+    REQUIRE(measureCbor(doc) == serializeCbor(doc, cbor));
+    REQUIRE(measureCbor(doc) == cbor.size());
+  }
+}
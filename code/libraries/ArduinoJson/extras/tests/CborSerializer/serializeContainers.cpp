@@ -0,0 +1,95 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+static void check(const JsonDocument& doc, const std::string& expected) {
+  std::string actual;
+  size_t len = serializeCbor(doc, actual);
+  CAPTURE(doc);
+  REQUIRE(len == expected.size());
+  REQUIRE(actual == expected);
+}
+
+TEST_CASE("serialize CBOR array") {
+  DynamicJsonDocument doc(JSON_ARRAY_SIZE(65536));
+  JsonArray array = doc.to<JsonArray>();
+
+  SECTION("empty") {
+    check(doc, "\x80");
+  }
+
+  SECTION("[1,2,3]") {
+    array.add(1);
+    array.add(2);
+    array.add(3);
+    check(doc, "\x83\x01\x02\x03");
+  }
+
+  SECTION("[1,[2,3],[4,5]]") {
+    deserializeJson(doc, "[1,[2,3],[4,5]]");
+    check(doc, "\x83\x01\x82\x02\x03\x82\x04\x05");
+  }
+
+  SECTION("24 elements") {
+    std::string expected = "\x98\x18";
+    for (int i = 0; i < 24; i++) {
+      array.add(i);
+      expected += char(i);
+    }
+    check(doc, expected);
+  }
+
+  SECTION("65536 elements") {
+    for (int i = 0; i < 65536; i++)
+      array.add(true);
+    check(doc, std::string("\x9A\x00\x01\x00\x00", 5) +
+                   std::string(65536, '\xF5'));
+  }
+}
+
+TEST_CASE("serialize CBOR object") {
+  DynamicJsonDocument doc(4096);
+  JsonObject object = doc.to<JsonObject>();
+
+  SECTION("empty") {
+    check(doc, "\xA0");
+  }
+
+  SECTION("{\"a\":1,\"b\":[2,3]}") {
+    object["a"] = 1;
+    JsonArray b = object.createNestedArray("b");
+    b.add(2);
+    b.add(3);
+    check(doc, "\xA2\x61\x61\x01\x61\x62\x82\x02\x03");
+  }
+
+  SECTION("[\"a\",{\"b\":\"c\"}]") {
+    deserializeJson(doc, "[\"a\",{\"b\":\"c\"}]");
+    check(doc, "\x82\x61\x61\xA1\x61\x62\x61\x63");
+  }
+
+  SECTION("24 members") {
+    std::string expected = "\xB8\x18";
+    for (char c = 'a'; c < 'a' + 24; c++) {
+      object[std::string(1, c)] = nullptr;
+      expected += std::string("\x61") + c + "\xF6";
+    }
+    check(doc, expected);
+  }
+
+  SECTION("sensor payload") {
+    deserializeJson(doc,
+                    "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{\"Power\":"
+                    "42,\"Factor\":0.69,\"Today\":0.5}}");
+    check(doc, std::string("\xA2\x64Time\x73"
+                           "2023-07-11T22:29:54"
+                           "\x66"
+                           "ENERGY\xA3\x65Power\x18\x2A\x66"
+                           "Factor\xFB\x3F\xE6\x14\x7A\xE1\x47\xAE\x14"
+                           "\x65Today\xF9\x38\x00",
+                           67));
+  }
+}
@@ -0,0 +1,130 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include <limits>
+
+template <typename T>
+static void checkVariant(T value, const char* expected_data,
+                         size_t expected_len) {
+  DynamicJsonDocument doc(4096);
+  JsonVariant variant = doc.to<JsonVariant>();
+  variant.set(value);
+  std::string expected(expected_data, expected_data + expected_len);
+  std::string actual;
+  size_t len = serializeCbor(variant, actual);
+  CAPTURE(variant);
+  REQUIRE(len == expected_len);
+  REQUIRE(actual == expected);
+}
+
+template <typename T, size_t N>
+static void checkVariant(T value, const char (&expected_data)[N]) {
+  const size_t expected_len = N - 1;
+  checkVariant(value, expected_data, expected_len);
+}
+
+template <typename T>
+static void checkVariant(T value, const std::string& expected) {
+  checkVariant(value, expected.data(), expected.length());
+}
+
+// The examples come from the appendix A of RFC 8949
+TEST_CASE("serialize CBOR value") {
+  SECTION("unbound") {
+    checkVariant(JsonVariant(), "\xF6");  // we represent undefined as null
+  }
+
+  SECTION("null") {
+    const char* nil = 0;  // ArduinoJson uses a string for null
+    checkVariant(nil, "\xF6");
+  }
+
+  SECTION("bool") {
+    checkVariant(false, "\xF4");
+    checkVariant(true, "\xF5");
+  }
+
+  SECTION("unsigned integer") {
+    checkVariant(0, "\x00");
+    checkVariant(1, "\x01");
+    checkVariant(10, "\x0A");
+    checkVariant(23, "\x17");
+    checkVariant(24, "\x18\x18");
+    checkVariant(100, "\x18\x64");
+    checkVariant(255U, "\x18\xFF");
+    checkVariant(256U, "\x19\x01\x00");
+    checkVariant(1000, "\x19\x03\xE8");
+    checkVariant(65536, "\x1A\x00\x01\x00\x00");
+    checkVariant(1000000, "\x1A\x00\x0F\x42\x40");
+    checkVariant(4294967295U, "\x1A\xFF\xFF\xFF\xFF");
+  }
+
+#if ARDUINOJSON_USE_LONG_LONG
+  SECTION("64-bit integer") {
+    checkVariant(1000000000000LL, "\x1B\x00\x00\x00\xE8\xD4\xA5\x10\x00");
+    checkVariant(18446744073709551615ULL,
+                 "\x1B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF");
+    checkVariant(std::numeric_limits<long long>::min(),
+                 "\x3B\x7F\xFF\xFF\xFF\xFF\xFF\xFF\xFF");
+  }
+#endif
+
+  SECTION("negative integer") {
+    checkVariant(-1, "\x20");
+    checkVariant(-10, "\x29");
+    checkVariant(-24, "\x37");
+    checkVariant(-25, "\x38\x18");
+    checkVariant(-100, "\x38\x63");
+    checkVariant(-1000, "\x39\x03\xE7");
+    checkVariant(-65537, "\x3A\x00\x01\x00\x00");
+  }
+
+  SECTION("integral float is written as an integer") {
+    checkVariant(0.0, "\x00");
+    checkVariant(-4.0, "\x23");
+    checkVariant(65504.0f, "\x19\xFF\xE0");
+  }
+
+  SECTION("half-precision float") {
+    checkVariant(1.5, "\xF9\x3E\x00");
+    checkVariant(-0.5f, "\xF9\xB8\x00");
+    checkVariant(0.00006103515625, "\xF9\x04\x00");
+    checkVariant(std::numeric_limits<double>::infinity(), "\xF9\x7C\x00");
+    checkVariant(-std::numeric_limits<double>::infinity(), "\xF9\xFC\x00");
+    checkVariant(std::numeric_limits<double>::quiet_NaN(), "\xF9\x7E\x00");
+  }
+
+  SECTION("single-precision float") {
+    checkVariant(100000.5f, "\xFA\x47\xC3\x50\x40");
+    checkVariant(3.4028234663852886e+38, "\xFA\x7F\x7F\xFF\xFF");
+    // the subnormal halves are not used
+    checkVariant(5.960464477539063e-8, "\xFA\x33\x80\x00\x00");
+  }
+
+  SECTION("double-precision float") {
+    checkVariant(1.1, "\xFB\x3F\xF1\x99\x99\x99\x99\x99\x9A");
+    checkVariant(-4.1, "\xFB\xC0\x10\x66\x66\x66\x66\x66\x66");
+    checkVariant(1.0e+300, "\xFB\x7E\x37\xE4\x3C\x88\x00\x75\x9C");
+  }
+
+  SECTION("text string") {
+    checkVariant("", "\x60");
+    checkVariant("a", "\x61\x61");
+    checkVariant("IETF", "\x64IETF");
+    checkVariant("\"\\", "\x62\x22\x5C");
+    checkVariant("\xC3\xBC", "\x62\xC3\xBC");
+    checkVariant(std::string(23, '?'), "\x77" + std::string(23, '?'));
+    checkVariant(std::string(24, '?'), "\x78\x18" + std::string(24, '?'));
+    checkVariant(std::string(256, '?'),
+                 std::string("\x79\x01\x00", 3) + std::string(256, '?'));
+  }
+
+  SECTION("serialized(const char*)") {
+    checkVariant(serialized("\xF5"), "\xF5");
+    checkVariant(serialized("\x82\x01\x02"), "\x82\x01\x02");
+  }
+}
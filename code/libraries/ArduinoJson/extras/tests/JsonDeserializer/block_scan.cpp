@@ -0,0 +1,144 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include <sstream>
+#include <string>
+
+using namespace ArduinoJson::detail;
+
+static const char alphabet[] = {' ',  '\t', '\r', '\n', 'a', '"',
+                                '\'', '\\', '\0', '/',  '\xE9'};
+
+// A string of n characters picked from the alphabet, mostly spaces or letters
+static std::string randomString(uint32_t& seed, size_t n) {
+  std::string s;
+  for (size_t i = 0; i < n; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t r = (seed >> 16) % 64;
+    s += r < sizeof(alphabet) ? alphabet[r] : alphabet[r % 5];
+  }
+  return s;
+}
+
+template <typename TScanner>
+static void checkScanner() {
+  uint32_t seed = 42;
+  for (int i = 0; i < 2000; i++) {
+    std::string s = randomString(seed, size_t(i % 80));
+    for (size_t offset = 0; offset < s.size(); offset += 7) {
+      const char* begin = s.data() + offset;
+      const char* end = s.data() + s.size();
+      CAPTURE(s);
+      CAPTURE(offset);
+      REQUIRE(TScanner::skipSpaces(begin, end) ==
+              ByteScanner::skipSpaces(begin, end));
+      REQUIRE(TScanner::skipStringChars(begin, end, '"') ==
+              ByteScanner::skipStringChars(begin, end, '"'));
+      REQUIRE(TScanner::skipStringChars(begin, end, '\'') ==
+              ByteScanner::skipStringChars(begin, end, '\''));
+    }
+  }
+}
+
+TEST_CASE("BlockScanner") {
+  SECTION("ByteScanner") {
+    const char input[] = "  \t\r\nab\"c\\d";
+    const char* end = input + sizeof(input) - 1;
+    REQUIRE(ByteScanner::skipSpaces(input, end) == input + 5);
+    REQUIRE(ByteScanner::skipStringChars(input, end, '"') == input + 7);
+    REQUIRE(ByteScanner::skipStringChars(input, end, '\'') == input + 9);
+    REQUIRE(ByteScanner::skipSpaces(end, end) == end);
+  }
+
+  SECTION("WordScanner") {
+    checkScanner<WordScanner>();
+  }
+
+  SECTION("BlockScanner") {
+    checkScanner<BlockScanner>();
+  }
+}
+
+// The inputs in RAM with a known size go through the block scanner, the
+// pointers and the streams don't
+static void checkSameResult(const std::string& input,
+                            const std::string& filterJson = "true") {
+  StaticJsonDocument<256> filter;
+  deserializeJson(filter, filterJson);
+
+  DynamicJsonDocument fromString(4096), fromPointer(4096), fromSize(4096),
+      fromStream(4096);
+  DeserializationError stringError = deserializeJson(
+      fromString, input, DeserializationOption::Filter(filter));
+  DeserializationError pointerError = deserializeJson(
+      fromPointer, input.c_str(), DeserializationOption::Filter(filter));
+  DeserializationError sizeError =
+      deserializeJson(fromSize, input.data(), input.size(),
+                      DeserializationOption::Filter(filter));
+  std::istringstream stream(input);
+  DeserializationError streamError = deserializeJson(
+      fromStream, stream, DeserializationOption::Filter(filter));
+
+  CAPTURE(input);
+  REQUIRE(stringError == streamError);
+  REQUIRE(sizeError == streamError);
+  REQUIRE(fromString == fromStream);
+  REQUIRE(fromSize == fromStream);
+  if (input.find('\0') == std::string::npos) {
+    REQUIRE(pointerError == streamError);
+    REQUIRE(fromPointer == fromStream);
+  }
+}
+
+TEST_CASE("deserializeJson() scans the inputs in RAM like the streams") {
+  SECTION("Long strings") {
+    std::string s(100, 'x');
+    checkSameResult("\"" + s + "\"");
+    checkSameResult("'" + s + "'");
+    checkSameResult("\"" + s + "\\\"" + s + "\"");
+    checkSameResult("\"" + s + "\\n\\u00e9" + s + "\"");
+    checkSameResult("\"" + s + "'" + s + "\"");
+    checkSameResult("{\"" + s + "\":\"" + s + "\"}");
+  }
+
+  SECTION("Incomplete strings") {
+    std::string s(100, 'x');
+    checkSameResult("\"" + s);
+    checkSameResult("\"" + s + "\\");
+    checkSameResult("[\"" + s + "\\u00");
+    checkSameResult(std::string("\"abc\0def\"", 9));
+  }
+
+  SECTION("Long runs of spaces") {
+    std::string s(100, ' ');
+    checkSameResult(s);
+    checkSameResult(s + "42" + s);
+    checkSameResult("[" + s + "1," + s + "\t\r\n2" + s + "]");
+    checkSameResult("[" + s + "1" + s);
+  }
+
+  SECTION("Filtered documents") {
+    std::string s(40, 'x');
+    std::string pretty = "{\n  \"fields\": {\n    \"a\": {\n      \"s\": \"" +
+                         s + "\"\n    },\n    \"b\": {\n      \"s\": \"" + s +
+                         "\\\"\"\n    }\n  },\n  \"name\": \"" + s + "\"\n}";
+    checkSameResult(pretty);
+    checkSameResult(pretty, "{\"name\":true}");
+    checkSameResult(pretty, "{\"fields\":{\"b\":true}}");
+    checkSameResult(pretty, "false");
+  }
+
+  SECTION("Random inputs") {
+    uint32_t seed = 43;
+    for (int i = 0; i < 2000; i++) {
+      checkSameResult("[\"" + randomString(seed, 40) + "\"]");
+      checkSameResult("{" + randomString(seed, 40) + "}");
+      checkSameResult("[" + randomString(seed, 40) + "]",
+                      "[{\"a\":true}]");
+    }
+  }
+}
@@ -0,0 +1,218 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include <stdlib.h>  // malloc, free
+#include <sstream>
+#include <string>
+
+// One entry per document: "offset+size error json;"
+template <typename TLines>
+static std::string readAll(JsonDocument& doc, TLines lines) {
+  std::string log;
+  DeserializationError err;
+  while ((err = lines.next()) != DeserializationError::EmptyInput) {
+    log += std::to_string(lines.offset()) + "+" +
+           std::to_string(lines.size()) + " " + err.c_str() + " ";
+    if (!err)
+      serializeJson(doc, log);
+    log += ";";
+  }
+  return log;
+}
+
+// Reads the input from RAM and from a stream, which must agree
+static std::string readAll(const std::string& input) {
+  DynamicJsonDocument doc(1024);
+
+  std::string fromString = readAll(doc, readJsonLines(doc, input));
+
+  std::istringstream stream(input);
+  std::string fromStream = readAll(doc, readJsonLines(doc, stream));
+  CHECK(fromStream == fromString);
+
+  std::string fromCharPtr = readAll(doc, readJsonLines(doc, input.c_str()));
+  CHECK(fromCharPtr == fromString);
+
+  return fromString;
+}
+
+TEST_CASE("readJsonLines()") {
+  SECTION("empty input") {
+    REQUIRE(readAll("") == "");
+    REQUIRE(readAll("\n\n  \r\n\t") == "");
+  }
+
+  SECTION("one document per line") {
+    REQUIRE(readAll("{\"a\":1}\n[2]\n\"three\"\n4\n") ==
+            "0+7 Ok {\"a\":1};8+3 Ok [2];12+7 Ok \"three\";20+1 Ok 4;");
+  }
+
+  SECTION("no newline at the end") {
+    REQUIRE(readAll("{\"a\":1}\n{\"b\":2}") ==
+            "0+7 Ok {\"a\":1};8+7 Ok {\"b\":2};");
+  }
+
+  SECTION("CRLF and blank lines") {
+    REQUIRE(readAll("\r\n{\"a\":1}\r\n\r\n  {\"b\":2}  \r\n") ==
+            "2+7 Ok {\"a\":1};15+7 Ok {\"b\":2};");
+  }
+
+  SECTION("CRLF after scalars") {
+    REQUIRE(readAll("3\r\n\"x\"\r\n[1]\r\ntrue \r\n4\r") ==
+            "0+1 Ok 3;3+3 Ok \"x\";8+3 Ok [1];13+4 Ok true;20+1 Ok 4;");
+    REQUIRE(readAll("\"unterminated\r\n5\r\n") ==
+            "0+13 IncompleteInput ;15+1 Ok 5;");
+  }
+
+  SECTION("concatenated documents") {
+    REQUIRE(readAll("{\"a\":1}{\"b\":2} [3]\n\"x\"{}") ==
+            "0+7 Ok {\"a\":1};7+7 Ok {\"b\":2};15+3 Ok [3];19+3 Ok \"x\";22+2 "
+            "Ok {};");
+  }
+
+  SECTION("the document is replaced") {
+    DynamicJsonDocument doc(1024);
+    auto lines = readJsonLines(doc, "{\"a\":1}\n{\"b\":2}\n");
+
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(doc.as<std::string>() == "{\"a\":1}");
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(doc.as<std::string>() == "{\"b\":2}");
+    REQUIRE(lines.next() == DeserializationError::EmptyInput);
+    REQUIRE(doc.isNull());
+    REQUIRE(lines.next() == DeserializationError::EmptyInput);
+  }
+}
+
+TEST_CASE("readJsonLines() error recovery") {
+  SECTION("InvalidInput skips the rest of the line") {
+    REQUIRE(readAll("{\"a\":1}\n{\"a\":1,} {\"b\":2}\n{\"c\":3}\n") ==
+            "0+7 Ok {\"a\":1};8+8 InvalidInput ;25+7 Ok {\"c\":3};");
+  }
+
+  SECTION("a truncated line doesn't eat the next one") {
+    REQUIRE(readAll("{\"a\":[1,2\n{\"b\":2}\n") ==
+            "0+9 IncompleteInput ;10+7 Ok {\"b\":2};");
+    REQUIRE(readAll("\"unterminated\n{\"b\":2}") ==
+            "0+13 IncompleteInput ;14+7 Ok {\"b\":2};");
+  }
+
+  SECTION("truncated last line") {
+    REQUIRE(readAll("{\"a\":1}\n{\"b\":") ==
+            "0+7 Ok {\"a\":1};8+5 IncompleteInput ;");
+  }
+
+  SECTION("garbage between documents") {
+    REQUIRE(readAll("{\"a\":1}\nhello\n]\n{\"b\":2}\n") ==
+            "0+7 Ok {\"a\":1};8+1 InvalidInput ;14+1 InvalidInput ;16+7 Ok "
+            "{\"b\":2};");
+  }
+
+  SECTION("scalar followed by garbage") {
+    REQUIRE(readAll("42x\n43\n") == "0+3 InvalidInput ;4+2 Ok 43;");
+  }
+
+  SECTION("NoMemory") {
+    StaticJsonDocument<JSON_ARRAY_SIZE(2)> doc;
+    auto lines = readJsonLines(doc, "[1,2]\n[1,2,3]\n[4,5]\n");
+
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(lines.next() == DeserializationError::NoMemory);
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(doc.as<std::string>() == "[4,5]");
+    REQUIRE(lines.next() == DeserializationError::EmptyInput);
+  }
+
+  SECTION("TooDeep") {
+    DynamicJsonDocument doc(1024);
+    auto lines = readJsonLines(doc, "[[1]]\n[[[1]]]\n[2]",
+                               DeserializationOption::NestingLimit(2));
+
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(lines.next() == DeserializationError::TooDeep);
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(doc.as<std::string>() == "[2]");
+    REQUIRE(lines.next() == DeserializationError::EmptyInput);
+  }
+}
+
+TEST_CASE("readJsonLines() options") {
+  DynamicJsonDocument doc(1024);
+
+  SECTION("Filter") {
+    StaticJsonDocument<64> filter;
+    filter["temp"] = true;
+
+    std::string input =
+        "{\"id\":1,\"temp\":21.5,\"name\":\"kitchen\"}\n"
+        "{\"id\":2,\"temp\":19}\n";
+    auto lines =
+        readJsonLines(doc, input, DeserializationOption::Filter(filter));
+
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(doc.as<std::string>() == "{\"temp\":21.5}");
+    REQUIRE(lines.offset() == 0);
+    REQUIRE(lines.size() == 37);
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(doc.as<std::string>() == "{\"temp\":19}");
+    REQUIRE(lines.offset() == 38);
+    REQUIRE(lines.next() == DeserializationError::EmptyInput);
+  }
+
+  SECTION("Filter and NestingLimit") {
+    StaticJsonDocument<64> filter;
+    filter["a"] = true;
+
+    auto lines = readJsonLines(doc, "{\"a\":1,\"b\":[[2]]}",
+                               DeserializationOption::Filter(filter),
+                               DeserializationOption::NestingLimit(2));
+
+    REQUIRE(lines.next() == DeserializationError::TooDeep);
+  }
+
+  SECTION("input with a size") {
+    const char* input = "{\"a\":1}\n{\"b\":2}\n";
+    auto lines = readJsonLines(doc, input, 8);
+
+    REQUIRE(lines.next() == DeserializationError::Ok);
+    REQUIRE(doc.as<std::string>() == "{\"a\":1}");
+    REQUIRE(lines.next() == DeserializationError::EmptyInput);
+  }
+}
+
+struct CountingAllocator {
+  void* allocate(size_t n) {
+    allocations++;
+    return malloc(n);
+  }
+
+  void deallocate(void* p) {
+    free(p);
+  }
+
+  static int allocations;
+};
+
+int CountingAllocator::allocations = 0;
+
+TEST_CASE("readJsonLines() keeps the pages of a growing document") {
+  BasicJsonDocument<CountingAllocator> doc(JSON_OBJECT_SIZE(1),
+                                           JSON_OBJECT_SIZE(4));
+  std::string line = "{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5}\n";
+  std::string input = line + line + line;
+  auto lines = readJsonLines(doc, input);
+
+  CountingAllocator::allocations = 0;
+  REQUIRE(lines.next() == DeserializationError::Ok);
+  int allocations = CountingAllocator::allocations;
+  REQUIRE(allocations > 0);
+
+  REQUIRE(lines.next() == DeserializationError::Ok);
+  REQUIRE(lines.next() == DeserializationError::Ok);
+  REQUIRE(CountingAllocator::allocations == allocations);
+  REQUIRE(doc.size() == 5);
+}
@@ -5,6 +5,8 @@
 #include <ArduinoJson.h>
 #include <stdlib.h>  // malloc, free
 #include <catch.hpp>
+
+#include <algorithm>
 #include <sstream>
 #include <utility>
 
@@ -178,3 +180,130 @@ TEST_CASE("BasicJsonDocument") {
     }
   }
 }
+
+static size_t count(const std::stringstream& log, char c) {
+  std::string s = log.str();
+  return size_t(std::count(s.begin(), s.end(), c));
+}
+
+TEST_CASE("BasicJsonDocument with pages") {
+  std::stringstream log;
+  std::string json = "[";
+  for (int i = 0; i < 100; i++)
+    json += "\"item" + std::to_string(i) + "\",";
+  json += "{\"done\":true}]";
+
+  SECTION("Grows instead of overflowing") {
+    {
+      BasicJsonDocument<SpyingAllocator> doc(64, 128, log);
+      REQUIRE(doc.pageSize() == 128);
+
+      DeserializationError err = deserializeJson(doc, json);
+
+      REQUIRE(err == DeserializationError::Ok);
+      REQUIRE(doc.overflowed() == false);
+      REQUIRE(doc.size() == 101);
+      REQUIRE(doc.capacity() >= doc.memoryUsage());
+      REQUIRE(doc.as<std::string>() == json);
+      REQUIRE(count(log, 'A') > 1);
+    }
+    REQUIRE(count(log, 'F') == count(log, 'A'));
+  }
+
+  SECTION("Keeps a fixed capacity with a page size of 0") {
+    DynamicJsonDocument doc(64, 0);
+
+    DeserializationError err = deserializeJson(doc, json);
+
+    REQUIRE(err == DeserializationError::NoMemory);
+    REQUIRE(doc.pageSize() == 0);
+    REQUIRE(doc.capacity() == 64);
+  }
+
+  SECTION("Releases the added pages when cleared") {
+    BasicJsonDocument<SpyingAllocator> doc(64, 128, log);
+    deserializeJson(doc, json);
+    size_t allocated = count(log, 'A');
+
+    doc.clear();
+
+    REQUIRE(count(log, 'F') == allocated - 1);
+    REQUIRE(doc.memoryUsage() == 0);
+  }
+
+  SECTION("Copy construct") {
+    {
+      BasicJsonDocument<SpyingAllocator> doc1(64, 128, log);
+      deserializeJson(doc1, json);
+
+      BasicJsonDocument<SpyingAllocator> doc2(doc1);
+
+      REQUIRE(doc2.pageSize() == 128);
+      REQUIRE(doc2.as<std::string>() == json);
+      doc2.add(42);
+      REQUIRE(doc2.overflowed() == false);
+    }
+    REQUIRE(count(log, 'F') == count(log, 'A'));
+  }
+
+  SECTION("Move construct") {
+    {
+      BasicJsonDocument<SpyingAllocator> doc1(64, 128, log);
+      deserializeJson(doc1, json);
+      size_t allocated = count(log, 'A');
+
+      BasicJsonDocument<SpyingAllocator> doc2(std::move(doc1));
+
+      REQUIRE(count(log, 'A') == allocated);
+      REQUIRE(doc1.capacity() == 0);
+      REQUIRE(doc2.as<std::string>() == json);
+      // doc2 adds pages of its own
+      for (int i = 0; i < 100; i++)
+        doc2.add(i);
+      REQUIRE(doc2.overflowed() == false);
+    }
+    REQUIRE(count(log, 'F') == count(log, 'A'));
+  }
+
+  SECTION("Move assign") {
+    {
+      BasicJsonDocument<SpyingAllocator> doc1(64, 128, log);
+      deserializeJson(doc1, json);
+      BasicJsonDocument<SpyingAllocator> doc2(8, log);
+
+      doc2 = std::move(doc1);
+
+      REQUIRE(doc2.pageSize() == 128);
+      REQUIRE(doc2.as<std::string>() == json);
+      doc2.clear();
+      REQUIRE(doc2.memoryUsage() == 0);
+    }
+    REQUIRE(count(log, 'F') == count(log, 'A'));
+  }
+
+  SECTION("garbageCollect()") {
+    BasicJsonDocument<ControllableAllocator> doc(64, 128);
+    deserializeJson(doc, json);
+    size_t memoryUsage = doc.memoryUsage();
+    doc.remove(0);
+
+    SECTION("when allocation succeeds") {
+      bool result = doc.garbageCollect();
+
+      REQUIRE(result == true);
+      REQUIRE(doc.memoryUsage() < memoryUsage);
+      REQUIRE(doc.pageSize() == 128);
+      REQUIRE(doc[0] == "item1");
+    }
+
+    SECTION("when allocation fails") {
+      doc.allocator().disable();
+
+      bool result = doc.garbageCollect();
+
+      REQUIRE(result == false);
+      REQUIRE(doc.memoryUsage() == memoryUsage);
+      REQUIRE(doc[0] == "item1");
+    }
+  }
+}
@@ -150,3 +150,34 @@ TEST_CASE("DynamicJsonDocument::shrinkToFit()") {
   serializeJson(doc, json);
   REQUIRE(json == "{\"hello\":[\"world\"]}");
 }
+
+TEST_CASE("DynamicJsonDocument::shrinkToFit() with pages") {
+  DynamicJsonDocument doc(16, 32);
+  std::string json = "[";
+  for (int i = 0; i < 50; i++)
+    json += "\"value" + std::to_string(i) + "\",";
+  json += "{\"key\":null}]";
+  deserializeJson(doc, json);
+  // in a single block, without the links between pages
+  DynamicJsonDocument reference(4096);
+  deserializeJson(reference, json);
+  size_t memoryUsage = reference.memoryUsage();
+
+  // test twice: shrinkToFit() should be idempotent
+  for (int i = 0; i < 2; i++) {
+    doc.shrinkToFit();
+
+    REQUIRE(doc.memoryUsage() == memoryUsage);
+    REQUIRE(doc.capacity() >= memoryUsage);
+    // only the alignment of the variants may remain
+    REQUIRE(doc.capacity() <
+            memoryUsage + sizeof(ArduinoJson::detail::VariantSlot));
+    REQUIRE(doc.pageSize() == 32);
+    REQUIRE(doc.as<std::string>() == json);
+  }
+
+  // still grows afterwards
+  doc.add(42);
+  REQUIRE(doc.overflowed() == false);
+  REQUIRE(doc.size() == 52);
+}
@@ -0,0 +1,140 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+#include <string>
+
+static std::string key(int i) {
+  return "key" + std::to_string(i);
+}
+
+static std::string largeObject(int n) {
+  std::string json = "{";
+  for (int i = 0; i < n; i++) {
+    if (i)
+      json += ",";
+    json += "\"" + key(i) + "\":" + std::to_string(i);
+  }
+  return json + "}";
+}
+
+TEST_CASE("JsonObject index") {
+  const int n = 100;
+  std::string json = largeObject(n);
+  DynamicJsonDocument fixed(8192);
+  REQUIRE(deserializeJson(fixed, json) == DeserializationError::Ok);
+
+  SECTION("Finds every member of a large object") {
+    DynamicJsonDocument doc(256, 512);
+    JsonObject obj = doc.to<JsonObject>();
+    for (int i = 0; i < n; i++)
+      obj[key(i)] = i;
+
+    for (int i = 0; i < n; i++)
+      REQUIRE(obj[key(i)] == i);
+    REQUIRE(obj["key100"].isNull());
+    REQUIRE(obj.containsKey("missing") == false);
+    REQUIRE(obj.size() == n);
+  }
+
+  SECTION("Keeps the members in order") {
+    DynamicJsonDocument doc(256, 512);
+    REQUIRE(deserializeJson(doc, json) == DeserializationError::Ok);
+
+    REQUIRE(doc.as<std::string>() == json);
+  }
+
+  SECTION("Takes memory in a growing document only") {
+    DynamicJsonDocument doc(256, 512);
+    REQUIRE(deserializeJson(doc, json) == DeserializationError::Ok);
+
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+    REQUIRE(doc.memoryUsage() > fixed.memoryUsage());
+#else
+    REQUIRE(doc.memoryUsage() == fixed.memoryUsage());
+#endif
+  }
+
+  SECTION("Leaves small objects alone") {
+    std::string small = largeObject(ARDUINOJSON_OBJECT_INDEX_THRESHOLD);
+    DynamicJsonDocument doc(0, 4096);  // in a single page
+    DynamicJsonDocument reference(4096);
+    REQUIRE(deserializeJson(doc, small) == DeserializationError::Ok);
+    REQUIRE(deserializeJson(reference, small) == DeserializationError::Ok);
+
+    REQUIRE(doc.memoryUsage() == reference.memoryUsage());
+  }
+
+  SECTION("Keeps the last value of a duplicate key") {
+    DynamicJsonDocument doc(256, 512);
+    std::string dup = json.substr(0, json.size() - 1) + ",\"key42\":-1}";
+    REQUIRE(deserializeJson(doc, dup) == DeserializationError::Ok);
+
+    REQUIRE(doc.size() == n);
+    REQUIRE(doc["key42"] == -1);
+  }
+
+  SECTION("Forgets removed members") {
+    DynamicJsonDocument doc(256, 512);
+    REQUIRE(deserializeJson(doc, json) == DeserializationError::Ok);
+    JsonObject obj = doc.as<JsonObject>();
+
+    // including the tail, key99
+    for (int i = 0; i < n; i += 3)
+      obj.remove(key(i));
+
+    for (int i = 0; i < n; i++) {
+      bool removed = i % 3 == 0;
+      REQUIRE(obj.containsKey(key(i)) == !removed);
+      if (!removed)
+        REQUIRE(obj[key(i)] == i);
+    }
+
+    SECTION("and adds them back") {
+      for (int i = 0; i < n; i += 3)
+        obj[key(i)] = -i;
+
+      for (int i = 0; i < n; i++)
+        REQUIRE(obj[key(i)] == (i % 3 == 0 ? -i : i));
+      REQUIRE(obj.size() == n);
+    }
+  }
+
+  SECTION("Removes all members, then starts over") {
+    DynamicJsonDocument doc(256, 512);
+    REQUIRE(deserializeJson(doc, json) == DeserializationError::Ok);
+    JsonObject obj = doc.as<JsonObject>();
+
+    for (int i = 0; i < n; i++)
+      obj.remove(key(i));
+    REQUIRE(obj.size() == 0);
+
+    obj["again"] = 1;
+    REQUIRE(obj["again"] == 1);
+    REQUIRE(doc.as<std::string>() == "{\"again\":1}");
+  }
+
+  SECTION("Survives a copy") {
+    DynamicJsonDocument doc(256, 512);
+    REQUIRE(deserializeJson(doc, json) == DeserializationError::Ok);
+
+    DynamicJsonDocument copy = doc;
+    doc.clear();
+
+    for (int i = 0; i < n; i++)
+      REQUIRE(copy[key(i)] == i);
+  }
+
+  SECTION("Survives shrinkToFit()") {
+    DynamicJsonDocument doc(256, 512);
+    REQUIRE(deserializeJson(doc, json) == DeserializationError::Ok);
+
+    doc.shrinkToFit();
+
+    for (int i = 0; i < n; i++)
+      REQUIRE(doc[key(i)] == i);
+    REQUIRE(doc.as<std::string>() == json);
+  }
+}
@@ -0,0 +1,56 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson.h>
+
+#include <string>
+
+// Writes the events of parseJson() in a string, optionally stopping after a
+// number of them
+struct EventLog {
+  EventLog(int limit = -1) : limit_(limit) {}
+
+  bool startObject() {
+    return log("{");
+  }
+
+  bool key(JsonString key) {
+    return log(std::string(key.c_str(), key.size()) + ":");
+  }
+
+  bool endObject() {
+    return log("}");
+  }
+
+  bool startArray() {
+    return log("[");
+  }
+
+  bool endArray() {
+    return log("]");
+  }
+
+  bool value(JsonVariantConst value) {
+    std::string s;
+    serializeJson(value, s);
+    return log(s);
+  }
+
+  std::string str() const {
+    return str_;
+  }
+
+ private:
+  bool log(const std::string& event) {
+    if (!str_.empty())
+      str_ += " ";
+    str_ += event;
+    return --limit_ != 0;
+  }
+
+  std::string str_;
+  int limit_;
+};
@@ -0,0 +1,236 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include <sstream>
+#include <string>
+
+namespace sensors {
+struct Field {
+  char type[8];
+  double value;
+};
+ARDUINOJSON_BIND(Field, ARDUINOJSON_BIND_MEMBER("type", type),
+                 ARDUINOJSON_BIND_MEMBER("value", value))
+
+struct Reading {
+  char device[8];
+  int samples[3];
+  bool online;
+  std::string label;
+  Field fields[2];
+  long count = -1;
+};
+ARDUINOJSON_BIND(Reading, ARDUINOJSON_BIND_MEMBER("device", device),
+                 ARDUINOJSON_BIND_MEMBER("samples", samples),
+                 ARDUINOJSON_BIND_MEMBER("online", online),
+                 ARDUINOJSON_BIND_MEMBER("label", label),
+                 ARDUINOJSON_BIND_MEMBER("fields", fields),
+                 ARDUINOJSON_BIND_MEMBER("count", count))
+}  // namespace sensors
+
+struct Wide {
+  int k00, k01, k02, k03, k04, k05, k06, k07, k08, k09;
+  int k10, k11, k12, k13, k14, k15, k16, k17, k18, k19;
+};
+ARDUINOJSON_BIND(
+    Wide, ARDUINOJSON_BIND_MEMBER("k00", k00),
+    ARDUINOJSON_BIND_MEMBER("k01", k01), ARDUINOJSON_BIND_MEMBER("k02", k02),
+    ARDUINOJSON_BIND_MEMBER("k03", k03), ARDUINOJSON_BIND_MEMBER("k04", k04),
+    ARDUINOJSON_BIND_MEMBER("k05", k05), ARDUINOJSON_BIND_MEMBER("k06", k06),
+    ARDUINOJSON_BIND_MEMBER("k07", k07), ARDUINOJSON_BIND_MEMBER("k08", k08),
+    ARDUINOJSON_BIND_MEMBER("k09", k09), ARDUINOJSON_BIND_MEMBER("k10", k10),
+    ARDUINOJSON_BIND_MEMBER("k11", k11), ARDUINOJSON_BIND_MEMBER("k12", k12),
+    ARDUINOJSON_BIND_MEMBER("k13", k13), ARDUINOJSON_BIND_MEMBER("k14", k14),
+    ARDUINOJSON_BIND_MEMBER("k15", k15), ARDUINOJSON_BIND_MEMBER("k16", k16),
+    ARDUINOJSON_BIND_MEMBER("k17", k17), ARDUINOJSON_BIND_MEMBER("k18", k18),
+    ARDUINOJSON_BIND_MEMBER("k19", k19))
+
+using sensors::Reading;
+
+static const char* readingJson =
+    "{\"device\":\"plug\",\"samples\":[1,2,3],\"online\":true,"
+    "\"label\":\"living room\",\"fields\":[{\"type\":\"power\",\"value\":"
+    "42.5},{\"value\":230,\"type\":\"voltage\"}],\"count\":7}";
+
+static void checkReading(const Reading& r) {
+  REQUIRE(std::string(r.device) == "plug");
+  REQUIRE(r.samples[0] == 1);
+  REQUIRE(r.samples[1] == 2);
+  REQUIRE(r.samples[2] == 3);
+  REQUIRE(r.online == true);
+  REQUIRE(r.label == "living room");
+  REQUIRE(std::string(r.fields[0].type) == "power");
+  REQUIRE(r.fields[0].value == 42.5);
+  REQUIRE(std::string(r.fields[1].type) == "voltage");
+  REQUIRE(r.fields[1].value == 230);
+  REQUIRE(r.count == 7);
+}
+
+TEST_CASE("bindJson()") {
+  Reading r = Reading();
+
+  SECTION("Nested structs and arrays") {
+    REQUIRE(bindJson(readingJson, r) == DeserializationError::Ok);
+    checkReading(r);
+  }
+
+  SECTION("Input types") {
+    std::string s(readingJson);
+    SECTION("std::string") {
+      REQUIRE(bindJson(s, r) == DeserializationError::Ok);
+    }
+    SECTION("pointer and size") {
+      REQUIRE(bindJson(s.data(), s.size(), r) == DeserializationError::Ok);
+    }
+    SECTION("stream") {
+      std::istringstream stream(s);
+      REQUIRE(bindJson(stream, r) == DeserializationError::Ok);
+    }
+    SECTION("writable char*") {
+      char buffer[512];
+      strcpy(buffer, readingJson);
+      REQUIRE(bindJson(buffer, r) == DeserializationError::Ok);
+    }
+    checkReading(r);
+  }
+
+  SECTION("Unknown keys are skipped, whatever they hold") {
+    REQUIRE(bindJson("{\"x\":{\"count\":1,\"a\":[[{}]]},\"count\":2,"
+                     "\"y\":[3,{\"count\":4}],\"countx\":5,\"coun\":6}",
+                     r) == DeserializationError::Ok);
+    REQUIRE(r.count == 2);
+  }
+
+  SECTION("Values of the wrong type are ignored") {
+    r.samples[1] = 9;
+    REQUIRE(bindJson("{\"count\":\"7\",\"online\":1,\"device\":[\"a\"],"
+                     "\"samples\":{\"0\":1},\"fields\":{\"type\":\"x\"},"
+                     "\"label\":{\"a\":1}}",
+                     r) == DeserializationError::Ok);
+    REQUIRE(r.count == -1);
+    REQUIRE(r.online == false);
+    REQUIRE(r.device[0] == 0);
+    REQUIRE(r.samples[1] == 9);
+    REQUIRE(r.fields[0].type[0] == 0);
+    REQUIRE(r.label.empty());
+  }
+
+  SECTION("Extra elements are skipped, missing ones keep their value") {
+    r.samples[2] = 9;
+    REQUIRE(bindJson("{\"samples\":[1,[2],3,4],"
+                     "\"fields\":[{},{\"value\":1},{\"value\":2}]}",
+                     r) == DeserializationError::Ok);
+    REQUIRE(r.samples[0] == 1);
+    REQUIRE(r.samples[1] == 0);
+    REQUIRE(r.samples[2] == 3);
+    REQUIRE(r.fields[1].value == 1);
+
+    REQUIRE(bindJson("{\"samples\":[5]}", r) == DeserializationError::Ok);
+    REQUIRE(r.samples[0] == 5);
+    REQUIRE(r.samples[2] == 3);
+  }
+
+  SECTION("Long strings are truncated to the char array") {
+    REQUIRE(bindJson("{\"device\":\"0123456789\"}", r) ==
+            DeserializationError::Ok);
+    REQUIRE(std::string(r.device) == "0123456");
+  }
+
+  SECTION("A root array") {
+    sensors::Field fields[2] = {};
+    REQUIRE(bindJson("[{\"value\":1},{\"value\":2}]", fields) ==
+            DeserializationError::Ok);
+    REQUIRE(fields[0].value == 1);
+    REQUIRE(fields[1].value == 2);
+  }
+
+  SECTION("Deeply nested inputs") {
+    std::string json = "{\"x\":";
+    for (int i = 0; i < 20; i++)
+      json += "[";
+    for (int i = 0; i < 20; i++)
+      json += "]";
+    json += ",\"count\":3}";
+    REQUIRE(bindJson(json, r, DeserializationOption::NestingLimit(30)) ==
+            DeserializationError::Ok);
+    REQUIRE(r.count == 3);
+    REQUIRE(bindJson(json, r) == DeserializationError::TooDeep);
+  }
+
+  SECTION("Errors") {
+    REQUIRE(bindJson("{\"count\":", r) == DeserializationError::IncompleteInput);
+    REQUIRE(bindJson("{\"count\":1]", r) == DeserializationError::InvalidInput);
+  }
+
+  SECTION("Many keys") {
+    Wide w = Wide();
+    REQUIRE(bindJson("{\"k19\":19,\"k07\":7,\"k00\":1,\"k1\":5,\"k10\":10}",
+                     w) == DeserializationError::Ok);
+    REQUIRE(w.k19 == 19);
+    REQUIRE(w.k07 == 7);
+    REQUIRE(w.k00 == 1);
+    REQUIRE(w.k10 == 10);
+    REQUIRE(w.k01 == 0);
+  }
+}
+
+TEST_CASE("Perfect hash of the bound keys") {
+  using namespace ArduinoJson::detail;
+  const StructBinding& binding = arduinoJsonBinding(static_cast<Wide*>(0));
+
+  REQUIRE(binding.size == 20);
+  for (size_t i = 0; i < binding.size; i++) {
+    const MemberBinding& member = binding.members[i];
+    CAPTURE(member.key);
+    REQUIRE(hashKey(member.key, member.keyLength) ==
+            hashString(member.key, member.keyLength));
+    REQUIRE(binding.find(member.key) == &member);
+  }
+  REQUIRE(binding.find("k20") == 0);
+  REQUIRE(binding.find("") == 0);
+  REQUIRE(binding.find(JsonString("k00\0", 4)) == 0);
+}
+
+TEST_CASE("Bound structs and JsonVariant") {
+  DynamicJsonDocument doc(4096);
+
+  SECTION("as<T>()") {
+    deserializeJson(doc, readingJson);
+    REQUIRE(doc.is<Reading>() == true);
+    REQUIRE(doc["count"].is<Reading>() == false);
+    checkReading(doc.as<Reading>());
+  }
+
+  SECTION("as<T>() keeps the default values") {
+    deserializeJson(doc, "{\"online\":true}");
+    REQUIRE(doc.as<Reading>().count == -1);
+  }
+
+  SECTION("set()") {
+    Reading r = Reading();
+    bindJson(readingJson, r);
+    doc["reading"] = r;
+    REQUIRE(doc["reading"]["fields"][1]["type"] == "voltage");
+    REQUIRE(doc["reading"]["samples"][2] == 3);
+
+    Reading copy = doc["reading"].as<Reading>();
+    checkReading(copy);
+
+    std::string json;
+    serializeJson(doc["reading"], json);
+    Reading roundTrip = Reading();
+    REQUIRE(bindJson(json, roundTrip) == DeserializationError::Ok);
+    checkReading(roundTrip);
+  }
+
+  SECTION("set() copies the char arrays") {
+    sensors::Field field = {"power", 1};
+    doc.set(field);
+    strcpy(field.type, "other");
+    REQUIRE(doc["type"] == "power");
+  }
+}
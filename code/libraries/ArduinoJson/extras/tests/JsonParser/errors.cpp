@@ -0,0 +1,47 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include "EventLog.hpp"
+
+static DeserializationError parse(const std::string& json) {
+  EventLog log;
+  return parseJson(json, log);
+}
+
+TEST_CASE("parseJson() errors") {
+  SECTION("Same errors as deserializeJson()") {
+    const char* inputs[] = {
+        "",        " ",        "[",       "[1",      "[1,",    "{",
+        "{\"a\"",  "{\"a\":",  "{\"a\":1", "\"hello", "tru",    "nul",
+        "[1 2]",   "{a 1}",    "{\"a\":1,}", "[1,]",  "]",      "}",
+        "truex",   "42x",      "42 ",     "[]x",     "{}x",    "\"a\"x",
+        "-",       "1e",       "\\",      "\"\\u12", "\"\\uZZZZ\"",
+        "[[[[[[[[[[[1]]]]]]]]]]]", "[[[[[[[[[[1]]]]]]]]]]", "/* */1",
+    };
+    for (const char* input : inputs) {
+      CAPTURE(input);
+      DynamicJsonDocument doc(1024);
+      REQUIRE(parse(input) == deserializeJson(doc, input));
+    }
+  }
+
+  SECTION("NestingLimit") {
+    EventLog log;
+    REQUIRE(parseJson("[[1]]", log, DeserializationOption::NestingLimit(1)) ==
+            DeserializationError::TooDeep);
+    REQUIRE(parseJson("[1]", log, DeserializationOption::NestingLimit(1)) ==
+            DeserializationError::Ok);
+  }
+
+  SECTION("NoMemory when a string exceeds the buffer") {
+    std::string longest(ARDUINOJSON_PARSER_STRING_SIZE - 1, 'x');
+    REQUIRE(parse("\"" + longest + "\"") == DeserializationError::Ok);
+    REQUIRE(parse("\"" + longest + "x\"") == DeserializationError::NoMemory);
+    REQUIRE(parse("{\"" + longest + "x\":1}") ==
+            DeserializationError::NoMemory);
+  }
+}
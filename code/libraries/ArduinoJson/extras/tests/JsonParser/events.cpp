@@ -0,0 +1,108 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include "EventLog.hpp"
+
+static std::string events(const char* json, int limit = -1) {
+  EventLog log(limit);
+  DeserializationError err = parseJson(json, log);
+  if (err)
+    return err.c_str();
+  return log.str();
+}
+
+TEST_CASE("parseJson() events") {
+  SECTION("Values") {
+    REQUIRE(events("42") == "42");
+    REQUIRE(events("-1.5") == "-1.5");
+    REQUIRE(events("true") == "true");
+    REQUIRE(events("false") == "false");
+    REQUIRE(events("null") == "null");
+    REQUIRE(events("\"hello\"") == "\"hello\"");
+    REQUIRE(events("'single'") == "\"single\"");
+  }
+
+  SECTION("Escape sequences") {
+    REQUIRE(events("\"a\\tb\\n\\\"\"") == "\"a\\tb\\n\\\"\"");
+#if ARDUINOJSON_DECODE_UNICODE
+    REQUIRE(events("\"\\u00e9\"") == "\"\xC3\xA9\"");
+#endif
+  }
+
+  SECTION("Empty array and object") {
+    REQUIRE(events("[]") == "[ ]");
+    REQUIRE(events("{}") == "{ }");
+    REQUIRE(events(" [ ] ") == "[ ]");
+  }
+
+  SECTION("Nested") {
+    REQUIRE(events("{\"a\":[1,{\"b\":null}],\"c\":\"d\"}") ==
+            "{ a: [ 1 { b: null } ] c: \"d\" }");
+  }
+
+  SECTION("Unquoted keys") {
+    REQUIRE(events("{a:1,b_2:2}") == "{ a: 1 b_2: 2 }");
+  }
+
+  SECTION("Duplicate keys are passed as they come") {
+    REQUIRE(events("{\"a\":1,\"a\":2}") == "{ a: 1 a: 2 }");
+  }
+
+  SECTION("Firestore runQuery response") {
+    const char* json =
+        "[{\"document\":{\"fields\":{\"power\":{\"integerValue\":\"42\"}}},"
+        "\"readTime\":\"2023-07-12T08:00:00Z\"},"
+        "{\"readTime\":\"2023-07-12T08:00:01Z\"}]";
+
+    REQUIRE(events(json) ==
+            "[ { document: { fields: { power: { integerValue: \"42\" } } } "
+            "readTime: \"2023-07-12T08:00:00Z\" } "
+            "{ readTime: \"2023-07-12T08:00:01Z\" } ]");
+  }
+
+  SECTION("Stops when the handler returns false") {
+    REQUIRE(events("[1,2,3]", 1) == "[");
+    REQUIRE(events("[1,2,3]", 3) == "[ 1 2");
+    REQUIRE(events("{\"a\":1,\"b\":2}", 2) == "{ a:");
+    REQUIRE(events("[[1],[2]]", 4) == "[ [ 1 ]");
+    // the rest of the input isn't read, not even to check it
+    REQUIRE(events("[1,2,oops", 2) == "[ 1");
+  }
+
+  SECTION("Uses a constant amount of memory") {
+    std::string json = "[";
+    for (int i = 0; i < 10000; i++)
+      json += "{\"id\":" + std::to_string(i) + "},";
+    json += "null]";
+
+    struct Sum {
+      long total = 0;
+      bool startObject() {
+        return true;
+      }
+      bool key(JsonString) {
+        return true;
+      }
+      bool endObject() {
+        return true;
+      }
+      bool startArray() {
+        return true;
+      }
+      bool endArray() {
+        return true;
+      }
+      bool value(JsonVariantConst value) {
+        total += value.as<long>();
+        return true;
+      }
+    } sum;
+
+    REQUIRE(parseJson(json, sum) == DeserializationError::Ok);
+    REQUIRE(sum.total == 49995000);
+  }
+}
@@ -0,0 +1,54 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+#include <sstream>
+
+#include "CustomReader.hpp"
+#include "EventLog.hpp"
+
+TEST_CASE("parseJson() input types") {
+  EventLog log;
+
+  SECTION("const char*") {
+    const char* input = "{\"a\":[1,\"b\"]}";
+    REQUIRE(parseJson(input, log) == DeserializationError::Ok);
+    REQUIRE(log.str() == "{ a: [ 1 \"b\" ] }");
+  }
+
+  SECTION("char*, decoded in place without a length limit") {
+    std::string longest(ARDUINOJSON_PARSER_STRING_SIZE * 2, 'x');
+    std::string json = "[\"" + longest + "\"]";
+    std::vector<char> input(json.begin(), json.end());
+    input.push_back(0);
+
+    REQUIRE(parseJson(input.data(), log) == DeserializationError::Ok);
+    REQUIRE(log.str() == "[ \"" + longest + "\" ]");
+  }
+
+  SECTION("const char*, size_t") {
+    const char* input = "[1,2]garbage";
+    REQUIRE(parseJson(input, 5, log) == DeserializationError::Ok);
+    REQUIRE(log.str() == "[ 1 2 ]");
+  }
+
+  SECTION("std::string") {
+    REQUIRE(parseJson(std::string("[true]"), log) == DeserializationError::Ok);
+    REQUIRE(log.str() == "[ true ]");
+  }
+
+  SECTION("std::istream") {
+    std::istringstream input("{\"a\":1} {\"b\":2}");
+    REQUIRE(parseJson(input, log) == DeserializationError::Ok);
+    REQUIRE(log.str() == "{ a: 1 }");
+    REQUIRE(input.get() == ' ');
+  }
+
+  SECTION("custom reader") {
+    CustomReader reader("[null]");
+    REQUIRE(parseJson(reader, log) == DeserializationError::Ok);
+    REQUIRE(log.str() == "[ null ]");
+  }
+}
@@ -0,0 +1,228 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson/Memory/MemoryPool.hpp>
+#include <ArduinoJson/StringStorage/StringCopier.hpp>
+#include <ArduinoJson/Strings/StringAdapters.hpp>
+#include <catch.hpp>
+
+#include <stdlib.h>  // malloc, free
+#include <string>
+
+using namespace ArduinoJson::detail;
+
+struct CountingPageAllocator : PageAllocator {
+  CountingPageAllocator()
+      : PageAllocator(allocate, deallocate),
+        allocated(0),
+        freed(0),
+        enabled(true) {}
+
+  static void* allocate(PageAllocator* self, size_t size) {
+    CountingPageAllocator* counter = static_cast<CountingPageAllocator*>(self);
+    if (!counter->enabled)
+      return 0;
+    counter->allocated++;
+    return malloc(size);
+  }
+
+  static void deallocate(PageAllocator* self, void* page) {
+    static_cast<CountingPageAllocator*>(self)->freed++;
+    free(page);
+  }
+
+  int allocated;
+  int freed;
+  bool enabled;
+};
+
+static const char* saveString(MemoryPool& pool, const char* s) {
+  return pool.saveString(adaptString(const_cast<char*>(s)));
+}
+
+static void fillWithVariants(MemoryPool& pool) {
+  while (pool.canAlloc(sizeof(VariantSlot)))
+    pool.allocVariant();
+}
+
+TEST_CASE("MemoryPool with pages") {
+  CountingPageAllocator allocator;
+  const size_t pageSize = 4 * sizeof(VariantSlot);
+
+  SECTION("Starts with a page of the requested capacity") {
+    MemoryPool pool(&allocator, 8 * sizeof(VariantSlot), pageSize);
+
+    REQUIRE(allocator.allocated == 1);
+    REQUIRE(pool.capacity() >= 8 * sizeof(VariantSlot));
+    REQUIRE(pool.capacity() < 9 * sizeof(VariantSlot));
+    REQUIRE(pool.size() == 0);
+    REQUIRE(pool.pageSize() == pageSize);
+
+    pool.freePages();
+  }
+
+  SECTION("Allocates the first page on demand when capacity is 0") {
+    MemoryPool pool(&allocator, 0, pageSize);
+    REQUIRE(allocator.allocated == 0);
+    REQUIRE(pool.capacity() == 0);
+
+    REQUIRE(pool.allocVariant() != 0);
+    REQUIRE(allocator.allocated == 1);
+
+    pool.freePages();
+  }
+
+  SECTION("Adds a page when full") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    fillWithVariants(pool);
+    size_t capacity = pool.capacity();
+    size_t size = pool.size();
+
+    VariantSlot* slot = pool.allocVariant();
+
+    REQUIRE(slot != 0);
+    REQUIRE(pool.overflowed() == false);
+    REQUIRE(allocator.allocated == 2);
+    REQUIRE(pool.capacity() > capacity);
+    REQUIRE(pool.size() == size + sizeof(VariantSlot));
+    REQUIRE(pool.owns(slot));
+
+    pool.freePages();
+  }
+
+  SECTION("inCurrentBlock() tells where the next variants go") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    VariantSlot* first = pool.allocVariant();
+    REQUIRE(pool.inCurrentBlock(first));
+    fillWithVariants(pool);
+    VariantSlot* other = pool.allocVariant();
+
+    REQUIRE(allocator.allocated == 2);
+    REQUIRE(pool.inCurrentBlock(other));
+    REQUIRE(pool.inCurrentBlock(first) == false);
+    REQUIRE(pool.owns(first));
+
+    pool.freePages();
+  }
+
+  SECTION("Saves a string larger than a page") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    std::string s(pageSize * 3, 'x');
+
+    const char* copy = saveString(pool, s.c_str());
+
+    REQUIRE(copy != 0);
+    REQUIRE(copy == s);
+    REQUIRE(pool.size() == s.size() + 1);
+    REQUIRE(pool.overflowed() == false);
+
+    pool.freePages();
+  }
+
+  SECTION("Deduplicates strings of previous pages") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    const char* a = saveString(pool, "hello");
+    fillWithVariants(pool);
+    pool.allocVariant();
+    REQUIRE(allocator.allocated == 2);
+
+    const char* b = saveString(pool, "hello");
+
+#if ARDUINOJSON_ENABLE_STRING_DEDUPLICATION
+    REQUIRE(a == b);
+#else
+    REQUIRE(a != b);
+#endif
+
+    pool.freePages();
+  }
+
+  SECTION("StringCopier moves a string that outgrows the page") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    fillWithVariants(pool);
+    std::string s(pageSize * 2, 'y');
+    StringCopier str(&pool);
+
+    str.startString();
+    str.append(s.c_str());
+    ArduinoJson::JsonString copy = str.save();
+
+    REQUIRE(str.isValid() == true);
+    REQUIRE(copy == s.c_str());
+    REQUIRE(pool.overflowed() == false);
+    REQUIRE(allocator.allocated >= 2);
+
+    pool.freePages();
+  }
+
+  SECTION("clear() keeps only the first page") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    size_t capacity = pool.capacity();
+    for (int i = 0; i < 20; i++)
+      pool.allocVariant();
+    REQUIRE(allocator.allocated > 2);
+
+    pool.clear();
+
+    REQUIRE(allocator.freed == allocator.allocated - 1);
+    REQUIRE(pool.capacity() == capacity);
+    REQUIRE(pool.size() == 0);
+
+    pool.freePages();
+    REQUIRE(allocator.freed == allocator.allocated);
+  }
+
+  SECTION("rewind() keeps the pages to fill them again") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    for (int i = 0; i < 20; i++)
+      pool.allocVariant();
+    int allocated = allocator.allocated;
+    size_t capacity = pool.capacity();
+
+    pool.rewind();
+
+    REQUIRE(allocator.freed == 0);
+    REQUIRE(pool.size() == 0);
+    REQUIRE(pool.capacity() < capacity);
+
+    for (int i = 0; i < 20; i++)
+      pool.allocVariant();
+
+    REQUIRE(allocator.allocated == allocated);
+    REQUIRE(pool.capacity() == capacity);
+    REQUIRE(pool.size() == 20 * sizeof(VariantSlot));
+
+    pool.freePages();
+    REQUIRE(allocator.freed == allocator.allocated);
+  }
+
+  SECTION("rewind() replaces a kept page that is too small") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    fillWithVariants(pool);
+    pool.allocVariant();
+    int allocated = allocator.allocated;
+
+    pool.rewind();
+    fillWithVariants(pool);
+    std::string s(3 * pageSize, 'x');
+    REQUIRE(saveString(pool, s.c_str()) != 0);
+
+    REQUIRE(allocator.allocated == allocated + 1);
+    REQUIRE(allocator.freed == 1);
+
+    pool.freePages();
+    REQUIRE(allocator.freed == allocator.allocated);
+  }
+
+  SECTION("Overflows when the allocator fails") {
+    MemoryPool pool(&allocator, pageSize, pageSize);
+    fillWithVariants(pool);
+    allocator.enabled = false;
+
+    REQUIRE(pool.allocVariant() == 0);
+    REQUIRE(pool.overflowed() == true);
+
+    pool.freePages();
+  }
+}
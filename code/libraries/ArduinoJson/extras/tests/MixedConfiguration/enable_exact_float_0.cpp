@@ -0,0 +1,24 @@
+#define ARDUINOJSON_VERSION_NAMESPACE NoExactFloat
+#define ARDUINOJSON_ENABLE_EXACT_FLOAT 0
+#include <ArduinoJson.h>
+
+#include <catch.hpp>
+
+TEST_CASE("ARDUINOJSON_ENABLE_EXACT_FLOAT == 0") {
+  DynamicJsonDocument doc(4096);
+
+  SECTION("short numbers are still exact") {
+    deserializeJson(doc, "[1234.567,0.1,1e22]");
+
+    REQUIRE(doc[0].as<double>() == 1234.567);
+    REQUIRE(doc[1].as<double>() == 0.1);
+    REQUIRE(doc[2].as<double>() == 1e22);
+  }
+
+  SECTION("long numbers are close") {
+    deserializeJson(doc, "[0.30000000000000004,1.7976931348623157e308]");
+
+    REQUIRE(doc[0].as<double>() == Approx(0.30000000000000004));
+    REQUIRE(doc[1].as<double>() == Approx(1.7976931348623157e308));
+  }
+}
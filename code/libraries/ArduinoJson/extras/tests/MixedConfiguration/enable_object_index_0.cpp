@@ -0,0 +1,22 @@
+#define ARDUINOJSON_VERSION_NAMESPACE NoObjectIndex
+#define ARDUINOJSON_ENABLE_OBJECT_INDEX 0
+#include <ArduinoJson.h>
+
+#include <catch.hpp>
+#include <string>
+
+TEST_CASE("ARDUINOJSON_ENABLE_OBJECT_INDEX == 0") {
+  std::string json = "{";
+  for (int i = 0; i < 100; i++)
+    json += "\"key" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+  json += "\"done\":true}";
+
+  DynamicJsonDocument paged(0, 8192);  // in a single page
+  DynamicJsonDocument fixed(8192);
+  REQUIRE(deserializeJson(paged, json) == DeserializationError::Ok);
+  REQUIRE(deserializeJson(fixed, json) == DeserializationError::Ok);
+
+  REQUIRE(paged.memoryUsage() == fixed.memoryUsage());
+  REQUIRE(paged["key99"] == 99);
+  REQUIRE(paged["done"] == true);
+}
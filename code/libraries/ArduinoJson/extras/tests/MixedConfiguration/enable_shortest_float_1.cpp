@@ -0,0 +1,33 @@
+#define ARDUINOJSON_VERSION_NAMESPACE ShortestFloat
+#define ARDUINOJSON_ENABLE_SHORTEST_FLOAT 1
+#include <ArduinoJson.h>
+
+#include <catch.hpp>
+
+TEST_CASE("ARDUINOJSON_ENABLE_SHORTEST_FLOAT == 1") {
+  DynamicJsonDocument doc(4096);
+  std::string json;
+
+  SECTION("keeps all the digits needed to read back the same value") {
+    doc["X"] = 0.1 + 0.2;
+    serializeJson(doc, json);
+
+    REQUIRE(json == "{\"X\":0.30000000000000004}");
+  }
+
+  SECTION("writes no more digits than needed") {
+    doc["X"] = 1234.567;
+    serializeJson(doc, json);
+
+    REQUIRE(json == "{\"X\":1234.567}");
+  }
+
+  SECTION("uses the same exponentiation thresholds") {
+    doc[0] = 12345678.9;
+    doc[1] = 0.0000012;
+    doc[2] = -1e308;
+    serializeJson(doc, json);
+
+    REQUIRE(json == "[1.23456789e7,1.2e-6,-1e308]");
+  }
+}
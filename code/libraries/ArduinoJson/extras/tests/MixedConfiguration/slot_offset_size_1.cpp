@@ -0,0 +1,82 @@
+#define ARDUINOJSON_VERSION_NAMESPACE SlotOffsetSize1
+#define ARDUINOJSON_SLOT_OFFSET_SIZE 1
+#include <ArduinoJson.h>
+
+#include <catch.hpp>
+#include <string>
+
+// Hands out pages far apart, like heap regions that the distance between two
+// slots can't span
+class DistantPagesAllocator {
+ public:
+  DistantPagesAllocator() : pages_(0) {}
+
+  void* allocate(size_t n) {
+    REQUIRE(n <= sizeof(arena[0]));
+    REQUIRE(pages_ < pageCount);
+    return arena[pages_++];
+  }
+
+  void deallocate(void*) {}
+
+ private:
+  static const size_t pageCount = 32;
+  static void* arena[pageCount][1024];
+  size_t pages_;
+};
+
+const size_t DistantPagesAllocator::pageCount;
+void* DistantPagesAllocator::arena[pageCount][1024];
+
+static std::string array(int n) {
+  std::string json = "[";
+  for (int i = 0; i < n; i++)
+    json += "\"item" + std::to_string(i) + "\",";
+  return json + "[1,2,3]]";
+}
+
+TEST_CASE("ARDUINOJSON_SLOT_OFFSET_SIZE == 1") {
+  SECTION("Links the slots of distant pages") {
+    BasicJsonDocument<DistantPagesAllocator> doc(64, 256);
+    std::string json = array(50);
+
+    REQUIRE(deserializeJson(doc, json) == DeserializationError::Ok);
+
+    REQUIRE(doc.overflowed() == false);
+    REQUIRE(doc.size() == 51);
+    REQUIRE(doc[50][2] == 3);
+    REQUIRE(doc.as<std::string>() == json);
+
+    SECTION("remove()") {
+      // item0, item2...
+      for (size_t i = 0; i < 25; i++)
+        doc.remove(i);
+
+      REQUIRE(doc.size() == 26);
+      REQUIRE(doc[0] == "item1");
+      REQUIRE(doc[24] == "item49");
+      REQUIRE(doc[25][0] == 1);
+    }
+  }
+
+  SECTION("Links slots out of reach in the same block") {
+    // the second element comes after the 200 slots of the first
+    DynamicJsonDocument doc(8192);
+    JsonArray inner = doc.createNestedArray();
+    for (int i = 0; i < 200; i++)
+      inner.add(i);
+    doc.add("last");
+
+    REQUIRE(doc.overflowed() == false);
+    REQUIRE(doc.size() == 2);
+    REQUIRE(doc[0][199] == 199);
+    REQUIRE(doc[1] == "last");
+
+    SECTION("shrinkToFit()") {
+      doc.shrinkToFit();
+
+      REQUIRE(doc[0][199] == 199);
+      REQUIRE(doc[1] == "last");
+    }
+  }
+}
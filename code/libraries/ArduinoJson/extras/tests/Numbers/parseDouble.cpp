@@ -9,6 +9,10 @@
 #include <ArduinoJson.hpp>
 #include <catch.hpp>
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 using namespace ArduinoJson::detail;
 
 void checkDouble(const char* input, double expected) {
@@ -16,6 +20,11 @@ void checkDouble(const char* input, double expected) {
   REQUIRE(parseNumber<double>(input) == Approx(expected));
 }
 
+void checkExactDouble(const char* input, double expected) {
+  CAPTURE(input);
+  REQUIRE(parseNumber<double>(input) == expected);
+}
+
 void checkDoubleNaN(const char* input) {
   CAPTURE(input);
   double result = parseNumber<double>(input);
@@ -82,7 +91,36 @@ TEST_CASE("parseNumber<double>()") {
     checkDouble("-1797693.134862315711111111111111", -1797693.1348623157);
   }
 
+  SECTION("Exact") {
+    checkExactDouble("1234.567", 1234.567);
+    checkExactDouble("0.1", 0.1);
+    checkExactDouble("0.30000000000000004", 0.30000000000000004);
+    checkExactDouble("1.7976931348623157e308", 1.7976931348623157e308);
+    checkExactDouble("2.2250738585072014e-308", 2.2250738585072014e-308);
+    checkExactDouble("123456789012345678901234567890", 1.2345678901234568e29);
+    checkExactDouble("1.2345678901234567890123456789", 1.2345678901234568);
+  }
+
+  SECTION("ExactlyRepresentable") {
+    checkExactDouble("2118307621590751.5", 2118307621590751.5);
+    checkExactDouble("874542511366270.125", 874542511366270.125);
+    checkExactDouble("18446744073709551616", 18446744073709551616.0);
+  }
+
+  SECTION("HalfwayRoundsToEven") {
+    checkExactDouble("9007199254740993", 9007199254740992.0);
+    checkExactDouble("9007199254740995", 9007199254740996.0);
+  }
+
+  SECTION("Subnormal") {
+    checkExactDouble("2.2250738585072011e-308", 2.2250738585072011e-308);
+    checkExactDouble("5e-324", 5e-324);
+    checkExactDouble("4.9e-324", 4.9e-324);
+    checkExactDouble("2e-324", 0.0);
+  }
+
   SECTION("ExponentTooBig") {
+    checkDoubleInf("1.7976931348623159e308", false);
     checkDoubleInf("1e309", false);
     checkDoubleInf("-1e309", true);
     checkDoubleInf("1e65535", false);
@@ -94,3 +132,20 @@ TEST_CASE("parseNumber<double>()") {
     checkDoubleNaN("nan");
   }
 }
+
+TEST_CASE("parseNumber<double>() returns the nearest double") {
+  uint64_t bits = 0x123456789ABCDEF;
+  for (int i = 0; i < 100000; i++) {
+    bits = bits * 6364136223846793005 + 1442695040888963407;
+    double value;
+    uint64_t positive = bits >> 1;
+    memcpy(&value, &positive, sizeof(value));
+    if (value != value || value * 2 == value)  // NaN or infinity
+      continue;
+
+    char input[64];
+    snprintf(input, sizeof(input), "%.*e", int(bits % 20), value);
+    if (parseNumber<double>(input) != strtod(input, 0))
+      FAIL(input);
+  }
+}
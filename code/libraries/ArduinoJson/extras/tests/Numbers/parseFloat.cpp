@@ -9,6 +9,10 @@
 #include <ArduinoJson.hpp>
 #include <catch.hpp>
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 using namespace ArduinoJson::detail;
 
 void checkFloat(const char* input, float expected) {
@@ -16,6 +20,11 @@ void checkFloat(const char* input, float expected) {
   REQUIRE(parseNumber<float>(input) == Approx(expected));
 }
 
+void checkExactFloat(const char* input, float expected) {
+  CAPTURE(input);
+  REQUIRE(parseNumber<float>(input) == expected);
+}
+
 void checkFloatNaN(const char* input) {
   CAPTURE(input);
   float result = parseNumber<float>(input);
@@ -75,6 +84,24 @@ TEST_CASE("parseNumber<float>()") {
     checkFloat("-34028234.66385288611111111111111", -34028234.663852886f);
   }
 
+  SECTION("Exact") {
+    checkExactFloat("1234.567", 1234.567f);
+    checkExactFloat("0.1", 0.1f);
+    checkExactFloat("3.4028235e38", 3.4028235e38f);
+    checkExactFloat("1.17549435e-38", 1.17549435e-38f);
+    checkExactFloat("3.14159265358979323846", 3.14159265358979323846f);
+  }
+
+  SECTION("HalfwayRoundsToEven") {
+    checkExactFloat("16777217", 16777216.0f);
+    checkExactFloat("16777219", 16777220.0f);
+  }
+
+  SECTION("Subnormal") {
+    checkExactFloat("1e-45", 1e-45f);
+    checkExactFloat("1.1754942e-38", 1.1754942e-38f);
+  }
+
   SECTION("ExponentTooBig") {
     checkFloatInf("1e39", false);
     checkFloatInf("-1e39", true);
@@ -99,3 +126,20 @@ TEST_CASE("parseNumber<float>()") {
     checkFloatInf("-1e300", true);
   }
 }
+
+TEST_CASE("parseNumber<float>() returns the nearest float") {
+  uint32_t bits = 0x12345678;
+  for (int i = 0; i < 100000; i++) {
+    bits = bits * 1664525 + 1013904223;
+    float value;
+    uint32_t positive = bits >> 1;
+    memcpy(&value, &positive, sizeof(value));
+    if (value != value || value * 2 == value)  // NaN or infinity
+      continue;
+
+    char input[64];
+    snprintf(input, sizeof(input), "%.*e", int(bits % 12), double(value));
+    if (parseNumber<float>(input) != strtof(input, 0))
+      FAIL(input);
+  }
+}
@@ -0,0 +1,136 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson/Json/TextFormatter.hpp>
+#include <ArduinoJson/Serialization/Writer.hpp>
+#include <catch.hpp>
+
+#include <limits>
+#include <stdlib.h>  // strtod, strtof
+#include <string.h>  // memcpy
+#include <string>
+
+using namespace ArduinoJson::detail;
+
+template <typename T>
+static std::string format(T value) {
+  std::string output;
+  Writer<std::string> sb(output);
+  TextFormatter<Writer<std::string>> formatter(sb);
+  formatter.writeShortestFloat(value);
+  if (formatter.bytesWritten() != output.size())
+    FAIL("wrong count");
+  return output;
+}
+
+static float floatFromBits(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static double doubleFromBits(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Checks every positive finite float whose bits are a multiple of step
+static void checkFloatRoundTrip(uint32_t step) {
+  const uint32_t infinity = 0x7F800000;
+  for (uint64_t bits = 1; bits < infinity; bits += step) {
+    float value = floatFromBits(uint32_t(bits));
+    std::string s = format(value);
+    if (strtof(s.c_str(), 0) != value) {
+      CAPTURE(bits);
+      CAPTURE(s);
+      FAIL("doesn't round-trip");
+    }
+  }
+}
+
+TEST_CASE("writeShortestFloat(double)") {
+  SECTION("Short decimals stay short") {
+    CHECK(format(0.1) == "0.1");
+    CHECK(format(0.3) == "0.3");
+    CHECK(format(1234.567) == "1234.567");
+    CHECK(format(3.14159265359) == "3.14159265359");
+    CHECK(format(42.0) == "42");
+    CHECK(format(100.0) == "100");
+    CHECK(format(0.001) == "0.001");
+  }
+
+  SECTION("All the digits it takes") {
+    CHECK(format(0.1 + 0.2) == "0.30000000000000004");
+    CHECK(format(1.0 / 3) == "0.3333333333333333");
+    CHECK(format(2.0 / 3) == "0.6666666666666666");
+  }
+
+  SECTION("Exponent thresholds of writeFloat()") {
+    CHECK(format(9999999.0) == "9999999");
+    CHECK(format(1e7) == "1e7");
+    CHECK(format(12345678.9) == "1.23456789e7");
+    CHECK(format(1.1e-5) == "0.000011");
+    CHECK(format(1e-5) == "1e-5");
+    CHECK(format(1.5e-6) == "1.5e-6");
+  }
+
+  SECTION("Limits") {
+    CHECK(format(std::numeric_limits<double>::max()) ==
+          "1.7976931348623157e308");
+    CHECK(format(std::numeric_limits<double>::min()) ==
+          "2.2250738585072014e-308");
+    CHECK(format(std::numeric_limits<double>::denorm_min()) == "5e-324");
+  }
+
+  SECTION("Zero") {
+    CHECK(format(0.0) == "0");
+  }
+
+  SECTION("Round-trips random values") {
+    uint64_t bits = 0x123456789ABCDEF;
+    for (int i = 0; i < 1000000; i++) {
+      // xorshift64
+      bits ^= bits << 13;
+      bits ^= bits >> 7;
+      bits ^= bits << 17;
+      double value = doubleFromBits(bits & 0x7FFFFFFFFFFFFFFF);
+      if (value != value || value == std::numeric_limits<double>::infinity())
+        continue;
+      std::string s = format(value);
+      if (strtod(s.c_str(), 0) != value) {
+        CAPTURE(s);
+        FAIL("doesn't round-trip");
+      }
+    }
+  }
+}
+
+TEST_CASE("writeShortestFloat(float)") {
+  SECTION("Short decimals stay short") {
+    CHECK(format(0.1f) == "0.1");
+    CHECK(format(1234.567f) == "1234.567");
+    CHECK(format(3.14159265f) == "3.1415927");
+    CHECK(format(16777216.0f) == "1.6777216e7");
+  }
+
+  SECTION("Limits") {
+    CHECK(format(std::numeric_limits<float>::max()) == "3.4028235e38");
+    CHECK(format(std::numeric_limits<float>::min()) == "1.1754944e-38");
+    CHECK(format(std::numeric_limits<float>::denorm_min()) == "1e-45");
+  }
+
+  SECTION("Round-trips one float in 997") {
+    checkFloatRoundTrip(997);
+  }
+}
+
+// Checks the 2,139,095,039 positive finite floats, as writeFloat() writes the
+// sign before calling writeShortestFloat(). Zero, infinities and NaNs don't go
+// through it either. Takes about 25 minutes in the default unoptimized build:
+// run with NumbersTests "[exhaustive]"
+TEST_CASE("writeShortestFloat(float) round-trips every float",
+          "[.exhaustive]") {
+  checkFloatRoundTrip(1);
+}
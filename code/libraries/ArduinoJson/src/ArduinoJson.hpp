@@ -43,7 +43,13 @@
 #include "ArduinoJson/Variant/VariantCompare.hpp"
 #include "ArduinoJson/Variant/VariantImpl.hpp"
 
+#include "ArduinoJson/Binding/StructBinding.hpp"
+#include "ArduinoJson/Cbor/CborDeserializer.hpp"
+#include "ArduinoJson/Cbor/CborSerializer.hpp"
+#include "ArduinoJson/Json/JsonBinder.hpp"
 #include "ArduinoJson/Json/JsonDeserializer.hpp"
+#include "ArduinoJson/Json/JsonLinesReader.hpp"
+#include "ArduinoJson/Json/JsonParser.hpp"
 #include "ArduinoJson/Json/JsonSerializer.hpp"
 #include "ArduinoJson/Json/PrettyJsonSerializer.hpp"
 #include "ArduinoJson/MsgPack/MsgPackDeserializer.hpp"
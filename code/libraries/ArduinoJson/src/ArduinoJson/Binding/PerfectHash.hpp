@@ -0,0 +1,158 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Polyfills/mpl/index_sequence.hpp>
+
+#include <stdint.h>  // uint8_t, uint32_t, uint64_t
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// A perfect hash maps each key of a fixed set to its own slot, so a lookup is
+// one hash, one table read, and one comparison. The table is computed by the
+// compiler (with C++11 constexpr functions, hence the recursions): it tries
+// the seeds one after the other until the keys land in distinct slots.
+
+const uint32_t noSeed = 0xFFFFFFFF;
+const uint8_t noEntry = 0xFF;
+
+// FNV-1a, at compile time
+constexpr uint32_t hashKey(const char* s, size_t n,
+                           uint32_t h = 2166136261u) {
+  return n ? hashKey(s + 1, n - 1, (h ^ uint8_t(*s)) * 16777619u) : h;
+}
+
+// FNV-1a, at run time
+inline uint32_t hashString(const char* s, size_t n) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; i++)
+    h = (h ^ uint8_t(s[i])) * 16777619u;
+  return h;
+}
+
+// Multiplicative hashing: the top bits of the product select the slot
+constexpr uint8_t hashSlot(uint32_t h, uint32_t seed, uint8_t shift) {
+  return uint8_t(((h ^ seed) * 2654435761u) >> shift);
+}
+
+// The table has at least four slots per key, so that a seed is found quickly
+constexpr uint8_t hashTableBits(size_t keys, uint8_t bits = 2) {
+  return (size_t(1) << bits) >= 4 * keys || bits == 8
+             ? bits
+             : hashTableBits(keys, uint8_t(bits + 1));
+}
+
+template <size_t N>
+struct KeyHashes {
+  uint32_t values[N];
+};
+
+template <size_t Size>
+struct PerfectHash {
+  uint32_t seed;
+  uint8_t shift;
+  uint8_t slots[Size];  // the index of the key, or noEntry
+};
+
+template <typename TEntry, size_t N, size_t... Is>
+constexpr KeyHashes<N> hashKeys(const TEntry (&entries)[N],
+                                index_sequence<Is...>) {
+  return {{hashKey(entries[Is].key, entries[Is].keyLength)...}};
+}
+
+// The 256 slots at most are tracked by four 64-bit words
+constexpr uint64_t slotBit(uint8_t slot, int word) {
+  return slot / 64 == word ? uint64_t(1) << (slot % 64) : 0;
+}
+
+constexpr bool slotIsTaken(uint8_t slot, uint64_t b0, uint64_t b1,
+                           uint64_t b2, uint64_t b3) {
+  return ((b0 & slotBit(slot, 0)) | (b1 & slotBit(slot, 1)) |
+          (b2 & slotBit(slot, 2)) | (b3 & slotBit(slot, 3))) != 0;
+}
+
+template <size_t N>
+constexpr bool slotsAreDistinct(const KeyHashes<N>& hashes, uint32_t seed,
+                                uint8_t shift, size_t i, uint64_t b0 = 0,
+                                uint64_t b1 = 0, uint64_t b2 = 0,
+                                uint64_t b3 = 0);
+
+template <size_t N>
+constexpr bool slotIsFree(const KeyHashes<N>& hashes, uint32_t seed,
+                          uint8_t shift, size_t i, uint8_t slot, uint64_t b0,
+                          uint64_t b1, uint64_t b2, uint64_t b3) {
+  return !slotIsTaken(slot, b0, b1, b2, b3) &&
+         slotsAreDistinct(hashes, seed, shift, i + 1, b0 | slotBit(slot, 0),
+                          b1 | slotBit(slot, 1), b2 | slotBit(slot, 2),
+                          b3 | slotBit(slot, 3));
+}
+
+template <size_t N>
+constexpr bool slotsAreDistinct(const KeyHashes<N>& hashes, uint32_t seed,
+                                uint8_t shift, size_t i, uint64_t b0,
+                                uint64_t b1, uint64_t b2, uint64_t b3) {
+  return i == N || slotIsFree(hashes, seed, shift, i,
+                              hashSlot(hashes.values[i], seed, shift), b0, b1,
+                              b2, b3);
+}
+
+// Splits the range in halves, to keep the recursion shallow
+template <size_t N>
+constexpr uint32_t findSeed(const KeyHashes<N>& hashes, uint8_t shift,
+                            uint32_t first, uint32_t count);
+
+template <size_t N>
+constexpr uint32_t findSeedIfNone(uint32_t found, const KeyHashes<N>& hashes,
+                                  uint8_t shift, uint32_t first,
+                                  uint32_t count) {
+  return found != noSeed ? found : findSeed(hashes, shift, first, count);
+}
+
+template <size_t N>
+constexpr uint32_t findSeed(const KeyHashes<N>& hashes, uint8_t shift,
+                            uint32_t first, uint32_t count) {
+  return count == 1
+             ? (slotsAreDistinct(hashes, first, shift, 0) ? first : noSeed)
+             : findSeedIfNone(findSeed(hashes, shift, first, count / 2),
+                              hashes, shift, first + count / 2,
+                              count - count / 2);
+}
+
+template <size_t N>
+constexpr uint8_t slotOwner(const KeyHashes<N>& hashes, uint32_t seed,
+                            uint8_t shift, uint8_t slot, size_t i = 0) {
+  return i == N ? noEntry
+         : hashSlot(hashes.values[i], seed, shift) == slot
+             ? uint8_t(i)
+             : slotOwner(hashes, seed, shift, slot, i + 1);
+}
+
+template <size_t N, size_t... Slots>
+constexpr PerfectHash<sizeof...(Slots)> makePerfectHash(
+    const KeyHashes<N>& hashes, uint32_t seed, uint8_t shift,
+    index_sequence<Slots...>) {
+  return {seed, shift, {slotOwner(hashes, seed, shift, uint8_t(Slots))...}};
+}
+
+template <size_t N, size_t Bits>
+constexpr PerfectHash<size_t(1) << Bits> makePerfectHash(
+    const KeyHashes<N>& hashes) {
+  return makePerfectHash(hashes,
+                         findSeed(hashes, uint8_t(32 - Bits), 0, 0x10000),
+                         uint8_t(32 - Bits),
+                         make_index_sequence<size_t(1) << Bits>());
+}
+
+// Returns the table of entries that have a key and a keyLength; its seed is
+// noSeed if no seed works, which only happens when two keys are the same
+template <typename TEntry, size_t N>
+constexpr PerfectHash<size_t(1) << hashTableBits(N)> makePerfectHash(
+    const TEntry (&entries)[N]) {
+  static_assert(N <= 64, "too many keys for a perfect hash");
+  return makePerfectHash<N, hashTableBits(N)>(
+      hashKeys(entries, make_index_sequence<N>()));
+}
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
@@ -0,0 +1,249 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Array/JsonArray.hpp>
+#include <ArduinoJson/Binding/PerfectHash.hpp>
+#include <ArduinoJson/Object/JsonObject.hpp>
+#include <ArduinoJson/Variant/Converter.hpp>
+
+#include <string.h>  // memcmp, memcpy
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+struct StructBinding;
+
+// How to read and write a bound value; the tables are built by the compiler
+struct TypeBinding {
+  void (*fromJson)(JsonVariantConst src, void* dst);
+  void (*toJson)(const void* src, JsonVariant dst);
+  const StructBinding& (*members)();  // for the structs
+  const TypeBinding* element;         // for the arrays
+  size_t elementSize;
+  size_t elementCount;
+};
+
+struct MemberBinding {
+  constexpr MemberBinding(const char* k, size_t n, void* (*a)(void*),
+                          const TypeBinding* t)
+      : key(k), keyLength(n), address(a), type(t) {}
+
+  const char* key;
+  size_t keyLength;
+  void* (*address)(void* object);
+  const TypeBinding* type;
+};
+
+template <typename TClass, typename TMember, TMember TClass::*member>
+void* memberAddress(void* object) {
+  return &(static_cast<TClass*>(object)->*member);
+}
+
+struct StructBinding {
+  const MemberBinding* members;
+  size_t size;
+  const uint8_t* slots;
+  uint32_t seed;
+  uint8_t shift;
+
+  // Returns the member with this key, or null
+  const MemberBinding* find(JsonString key) const {
+    uint8_t index =
+        slots[hashSlot(hashString(key.c_str(), key.size()), seed, shift)];
+    if (index == noEntry)
+      return 0;
+    const MemberBinding* member = &members[index];
+    if (member->keyLength != key.size() ||
+        memcmp(member->key, key.c_str(), key.size()) != 0)
+      return 0;
+    return member;
+  }
+
+  void fromJson(JsonVariantConst src, void* dst) const {
+    for (JsonPairConst kvp : src.as<JsonObjectConst>()) {
+      const MemberBinding* member = find(kvp.key());
+      if (member)
+        member->type->fromJson(kvp.value(), member->address(dst));
+    }
+  }
+
+  void toJson(const void* src, JsonVariant dst) const {
+    JsonObject object = dst.to<JsonObject>();
+    if (object.isNull())
+      return;
+    for (size_t i = 0; i < size; i++) {
+      auto slot = object[members[i].key];
+      members[i].type->toJson(
+          members[i].address(const_cast<void*>(src)),
+          JsonVariant(VariantAttorney::getPool(slot),
+                      VariantAttorney::getOrCreateData(slot)));
+    }
+  }
+};
+
+template <typename T, typename = void>
+struct HasStructBinding : false_type {};
+
+template <typename T>
+struct HasStructBinding<
+    T, typename enable_if<is_same<decltype(arduinoJsonBinding(declval<T*>())),
+                                  const StructBinding&>::value>::type>
+    : true_type {};
+
+// The scalars and the strings go through their converter, and keep their
+// value if the JSON has another type
+template <typename T, typename = void>
+struct TypeBindingOf {
+  static void fromJson(JsonVariantConst src, void* dst) {
+    if (src.is<T>())
+      *static_cast<T*>(dst) = src.as<T>();
+  }
+
+  static void toJson(const void* src, JsonVariant dst) {
+    dst.set(*static_cast<const T*>(src));
+  }
+
+  static constexpr TypeBinding value = {fromJson, toJson, 0, 0, 0, 0};
+};
+
+template <typename T, typename Enable>
+constexpr TypeBinding TypeBindingOf<T, Enable>::value;
+
+// A char array holds a string, truncated to fit
+template <size_t N>
+struct TypeBindingOf<char[N]> {
+  static void fromJson(JsonVariantConst src, void* dst) {
+    JsonString s = src.as<JsonString>();
+    if (!s)
+      return;
+    size_t n = s.size() < N - 1 ? s.size() : N - 1;
+    memcpy(dst, s.c_str(), n);
+    static_cast<char*>(dst)[n] = 0;
+  }
+
+  static void toJson(const void* src, JsonVariant dst) {
+    const char* s = static_cast<const char*>(src);
+    size_t n = 0;
+    while (n < N && s[n])
+      n++;
+    dst.set(JsonString(s, n, JsonString::Copied));
+  }
+
+  static constexpr TypeBinding value = {fromJson, toJson, 0, 0, 0, 0};
+};
+
+template <size_t N>
+constexpr TypeBinding TypeBindingOf<char[N]>::value;
+
+// The other arrays take the first N elements, and keep the others
+template <typename T, size_t N>
+struct TypeBindingOf<T[N]> {
+  static void fromJson(JsonVariantConst src, void* dst) {
+    size_t i = 0;
+    for (JsonVariantConst element : src.as<JsonArrayConst>()) {
+      if (i == N)
+        break;
+      TypeBindingOf<T>::fromJson(element, static_cast<T*>(dst) + i++);
+    }
+  }
+
+  static void toJson(const void* src, JsonVariant dst) {
+    JsonArray array = dst.to<JsonArray>();
+    if (array.isNull())
+      return;
+    for (size_t i = 0; i < N; i++)
+      TypeBindingOf<T>::toJson(static_cast<const T*>(src) + i, array.add());
+  }
+
+  static constexpr TypeBinding value = {
+      fromJson, toJson, 0, &TypeBindingOf<T>::value, sizeof(T), N};
+};
+
+template <typename T, size_t N>
+constexpr TypeBinding TypeBindingOf<T[N]>::value;
+
+template <typename T>
+struct TypeBindingOf<T,
+                     typename enable_if<HasStructBinding<T>::value>::type> {
+  static const StructBinding& members() {
+    return arduinoJsonBinding(static_cast<T*>(0));
+  }
+
+  static void fromJson(JsonVariantConst src, void* dst) {
+    members().fromJson(src, dst);
+  }
+
+  static void toJson(const void* src, JsonVariant dst) {
+    members().toJson(src, dst);
+  }
+
+  static constexpr TypeBinding value = {fromJson, toJson, members, 0, 0, 0};
+};
+
+template <typename T>
+constexpr TypeBinding TypeBindingOf<
+    T, typename enable_if<HasStructBinding<T>::value>::type>::value;
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
+
+ARDUINOJSON_BEGIN_PUBLIC_NAMESPACE
+
+// The structs bound with ARDUINOJSON_BIND(), converted member by member; the
+// members missing from the JSON keep their default value
+template <typename T>
+struct Converter<
+    T, typename detail::enable_if<detail::HasStructBinding<T>::value>::type> {
+  static void toJson(const T& src, JsonVariant dst) {
+    detail::TypeBindingOf<T>::toJson(&src, dst);
+  }
+
+  static T fromJson(JsonVariantConst src) {
+    T result = T();
+    detail::TypeBindingOf<T>::fromJson(src, &result);
+    return result;
+  }
+
+  static bool checkJson(JsonVariantConst src) {
+    return src.is<JsonObjectConst>();
+  }
+};
+
+ARDUINOJSON_END_PUBLIC_NAMESPACE
+
+// Binds the JSON keys to the public members of a struct, at compile time:
+//
+//   struct Reading { char device[16]; float power; int samples[4]; };
+//   ARDUINOJSON_BIND(Reading,
+//                    ARDUINOJSON_BIND_MEMBER("device", device),
+//                    ARDUINOJSON_BIND_MEMBER("power", power),
+//                    ARDUINOJSON_BIND_MEMBER("samples", samples))
+//
+// Use it in the namespace of the struct. The members can be scalars, strings,
+// char arrays, other bound structs, and fixed-size arrays of those. Then
+// bindJson() fills the struct straight from the input, and as<T>() and set()
+// convert it from and to a JsonVariant.
+#define ARDUINOJSON_BIND(T, ...)                                             \
+  inline const ::ArduinoJson::detail::StructBinding& arduinoJsonBinding(T*) { \
+    typedef T ArduinoJsonBound;                                              \
+    static constexpr ::ArduinoJson::detail::MemberBinding members[] = {      \
+        __VA_ARGS__};                                                        \
+    static constexpr auto hash =                                             \
+        ::ArduinoJson::detail::makePerfectHash(members);                     \
+    static_assert(hash.seed != ::ArduinoJson::detail::noSeed,                \
+                  "two members of " #T " have the same key");                \
+    static constexpr ::ArduinoJson::detail::StructBinding binding = {        \
+        members, sizeof(members) / sizeof(members[0]), hash.slots,           \
+        hash.seed, hash.shift};                                              \
+    return binding;                                                          \
+  }
+
+#define ARDUINOJSON_BIND_MEMBER(key, member)                          \
+  ::ArduinoJson::detail::MemberBinding(                               \
+      key, sizeof(key) - 1,                                           \
+      &::ArduinoJson::detail::memberAddress<                          \
+          ArduinoJsonBound, decltype(ArduinoJsonBound::member),       \
+          &ArduinoJsonBound::member>,                                 \
+      &::ArduinoJson::detail::TypeBindingOf<decltype(                 \
+          ArduinoJsonBound::member)>::value)
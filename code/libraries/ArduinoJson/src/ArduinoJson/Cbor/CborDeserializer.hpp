@@ -0,0 +1,577 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Cbor/halfFloat.hpp>
+#include <ArduinoJson/Deserialization/deserialize.hpp>
+#include <ArduinoJson/Memory/MemoryPool.hpp>
+#include <ArduinoJson/MsgPack/endianess.hpp>
+#include <ArduinoJson/MsgPack/ieee754.hpp>
+#include <ArduinoJson/Polyfills/limits.hpp>
+#include <ArduinoJson/Polyfills/type_traits.hpp>
+#include <ArduinoJson/Variant/VariantData.hpp>
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// Reads CBOR (RFC 8949). The byte strings, the simple values, and the
+// integers that don't fit in a JsonInteger become null; the tags are ignored.
+template <typename TReader, typename TStringStorage>
+class CborDeserializer {
+ public:
+  CborDeserializer(MemoryPool* pool, TReader reader,
+                   TStringStorage stringStorage)
+      : pool_(pool),
+        reader_(reader),
+        stringStorage_(stringStorage),
+        foundSomething_(false) {}
+
+  template <typename TFilter>
+  DeserializationError parse(VariantData& variant, TFilter filter,
+                             DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+    err = parseVariant(&variant, filter, nestingLimit);
+    return foundSomething_ ? err : DeserializationError::EmptyInput;
+  }
+
+ private:
+  enum { breakCode = 0xFF, indefinite = 31 };
+
+  template <typename TFilter>
+  DeserializationError::Code parseVariant(
+      VariantData* variant, TFilter filter,
+      DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+
+    uint8_t code = 0;
+    err = readByte(code);
+    if (err)
+      return err;
+
+    foundSomething_ = true;
+
+    return parseValue(code, variant, filter, nestingLimit);
+  }
+
+  // Parses the item whose initial byte is code
+  template <typename TFilter>
+  DeserializationError::Code parseValue(
+      uint8_t code, VariantData* variant, TFilter filter,
+      DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+
+    // Tags only give a meaning to the next item
+    while (code >> 5 == 6) {
+      err = skipArgument(code & 0x1F);
+      if (err)
+        return err;
+      err = readByte(code);
+      if (err)
+        return err;
+    }
+
+    bool allowValue = filter.allowValue();
+
+    if (allowValue) {
+      // callers pass a null pointer only when value must be ignored
+      ARDUINOJSON_ASSERT(variant != 0);
+    }
+
+    uint8_t info = code & 0x1F;
+
+    switch (code >> 5) {
+      case 0:
+        if (allowValue)
+          return readInteger(variant, info, false);
+        else
+          return skipArgument(info);
+
+      case 1:
+        if (allowValue)
+          return readInteger(variant, info, true);
+        else
+          return skipArgument(info);
+
+      case 2:  // byte string (not supported)
+        return skipString(2, info);
+
+      case 3:
+        if (allowValue)
+          return readString(variant, info);
+        else
+          return skipString(3, info);
+
+      case 4:
+        return readArray(variant, info, filter, nestingLimit);
+
+      case 5:
+        return readObject(variant, info, filter, nestingLimit);
+    }
+
+    switch (info) {
+      case 20:
+        if (allowValue)
+          variant->setBoolean(false);
+        return DeserializationError::Ok;
+
+      case 21:
+        if (allowValue)
+          variant->setBoolean(true);
+        return DeserializationError::Ok;
+
+      case 24:  // simple value (not supported)
+        return skipBytes(1);
+
+      case 25:
+        if (allowValue)
+          return readHalf(variant);
+        else
+          return skipBytes(2);
+
+      case 26:
+        if (allowValue)
+          return readFloat<float>(variant);
+        else
+          return skipBytes(4);
+
+      case 27:
+        if (allowValue)
+          return readDouble<JsonFloat>(variant);
+        else
+          return skipBytes(8);
+
+      case 28:
+      case 29:
+      case 30:
+      case 31:  // a break outside of an indefinite-length item
+        return DeserializationError::InvalidInput;
+
+      default:  // null, undefined, and the other simple values
+        return DeserializationError::Ok;
+    }
+  }
+
+  DeserializationError::Code readByte(uint8_t& value) {
+    int c = reader_.read();
+    if (c < 0)
+      return DeserializationError::IncompleteInput;
+    value = static_cast<uint8_t>(c);
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError::Code readBytes(uint8_t* p, size_t n) {
+    if (reader_.readBytes(reinterpret_cast<char*>(p), n) == n)
+      return DeserializationError::Ok;
+    return DeserializationError::IncompleteInput;
+  }
+
+  template <typename T>
+  DeserializationError::Code readBytes(T& value) {
+    return readBytes(reinterpret_cast<uint8_t*>(&value), sizeof(value));
+  }
+
+  DeserializationError::Code skipBytes(JsonUInt n) {
+    for (; n; --n) {
+      if (reader_.read() < 0)
+        return DeserializationError::IncompleteInput;
+    }
+    return DeserializationError::Ok;
+  }
+
+  // Reads the argument that follows the initial byte; sets tooBig if it
+  // doesn't fit in a JsonUInt
+  DeserializationError::Code readArgument(uint8_t info, JsonUInt& value,
+                                          bool& tooBig) {
+    DeserializationError::Code err;
+
+    tooBig = false;
+    if (info < 24) {
+      value = info;
+      return DeserializationError::Ok;
+    }
+    if (info > 27)
+      return DeserializationError::InvalidInput;
+
+    uint8_t bytes[8];
+    size_t n = size_t(1) << (info - 24);
+    err = readBytes(bytes, n);
+    if (err)
+      return err;
+
+    value = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (value >> (sizeof(JsonUInt) * 8 - 8))
+        tooBig = true;
+      value = JsonUInt(value << 8 | bytes[i]);
+    }
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError::Code skipArgument(uint8_t info) {
+    JsonUInt value;
+    bool tooBig;
+    return readArgument(info, value, tooBig);
+  }
+
+  // Reads the length of a string or a container
+  DeserializationError::Code readLength(uint8_t info, JsonUInt& length) {
+    DeserializationError::Code err;
+    bool tooBig;
+
+    err = readArgument(info, length, tooBig);
+    if (err)
+      return err;
+
+    // such an input couldn't fit in RAM anyway
+    return tooBig ? DeserializationError::NoMemory : DeserializationError::Ok;
+  }
+
+  DeserializationError::Code readInteger(VariantData* variant, uint8_t info,
+                                         bool negative) {
+    DeserializationError::Code err;
+    JsonUInt value;
+    bool tooBig;
+
+    err = readArgument(info, value, tooBig);
+    if (err)
+      return err;
+
+    if (tooBig)  // not supported
+      return DeserializationError::Ok;
+
+    if (!negative)
+      variant->setInteger(value);
+    else if (value <= JsonUInt(numeric_limits<JsonInteger>::highest()))
+      variant->setInteger(JsonInteger(-1) - JsonInteger(value));
+
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError::Code readHalf(VariantData* variant) {
+    DeserializationError::Code err;
+    uint16_t value;
+
+    err = readBytes(value);
+    if (err)
+      return err;
+
+    fixEndianess(value);
+    variant->setFloat(halfToFloat(value));
+
+    return DeserializationError::Ok;
+  }
+
+  template <typename T>
+  typename enable_if<sizeof(T) == 4, DeserializationError::Code>::type
+  readFloat(VariantData* variant) {
+    DeserializationError::Code err;
+    T value;
+
+    err = readBytes(value);
+    if (err)
+      return err;
+
+    fixEndianess(value);
+    variant->setFloat(value);
+
+    return DeserializationError::Ok;
+  }
+
+  template <typename T>
+  typename enable_if<sizeof(T) == 8, DeserializationError::Code>::type
+  readDouble(VariantData* variant) {
+    DeserializationError::Code err;
+    T value;
+
+    err = readBytes(value);
+    if (err)
+      return err;
+
+    fixEndianess(value);
+    variant->setFloat(value);
+
+    return DeserializationError::Ok;
+  }
+
+  template <typename T>
+  typename enable_if<sizeof(T) == 4, DeserializationError::Code>::type
+  readDouble(VariantData* variant) {
+    DeserializationError::Code err;
+    uint8_t i[8];  // input is 8 bytes
+    T value;       // output is 4 bytes
+    uint8_t* o = reinterpret_cast<uint8_t*>(&value);
+
+    err = readBytes(i, 8);
+    if (err)
+      return err;
+
+    doubleToFloat(i, o);
+    fixEndianess(value);
+    variant->setFloat(value);
+
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError::Code readString(VariantData* variant, uint8_t info) {
+    DeserializationError::Code err;
+
+    err = readString(info);
+    if (err)
+      return err;
+
+    variant->setString(stringStorage_.save());
+    return DeserializationError::Ok;
+  }
+
+  // Reads a text string in the string storage; an indefinite-length string
+  // is a series of definite-length chunks
+  DeserializationError::Code readString(uint8_t info) {
+    DeserializationError::Code err;
+
+    stringStorage_.startString();
+
+    if (info != indefinite) {
+      err = appendChunk(info);
+      if (err)
+        return err;
+    } else {
+      for (;;) {
+        uint8_t code;
+        err = readByte(code);
+        if (err)
+          return err;
+        if (code == breakCode)
+          break;
+        if (code >> 5 != 3 || (code & 0x1F) == indefinite)
+          return DeserializationError::InvalidInput;
+        err = appendChunk(code & 0x1F);
+        if (err)
+          return err;
+      }
+    }
+
+    if (!stringStorage_.isValid())
+      return DeserializationError::NoMemory;
+
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError::Code appendChunk(uint8_t info) {
+    DeserializationError::Code err;
+    JsonUInt n;
+
+    err = readLength(info, n);
+    if (err)
+      return err;
+
+    while (n > 0) {
+      char buffer[32];
+      size_t size = n < sizeof(buffer) ? size_t(n) : sizeof(buffer);
+      if (reader_.readBytes(buffer, size) != size)
+        return DeserializationError::IncompleteInput;
+      stringStorage_.append(buffer, size);
+      n -= size;
+    }
+
+    return DeserializationError::Ok;
+  }
+
+  // Skips a byte string (majorType 2) or a text string (majorType 3)
+  DeserializationError::Code skipString(uint8_t majorType, uint8_t info) {
+    DeserializationError::Code err;
+    JsonUInt n;
+
+    if (info != indefinite) {
+      err = readLength(info, n);
+      if (err)
+        return err;
+      return skipBytes(n);
+    }
+
+    for (;;) {
+      uint8_t code;
+      err = readByte(code);
+      if (err)
+        return err;
+      if (code == breakCode)
+        return DeserializationError::Ok;
+      if (code >> 5 != majorType || (code & 0x1F) == indefinite)
+        return DeserializationError::InvalidInput;
+      err = readLength(code & 0x1F, n);
+      if (err)
+        return err;
+      err = skipBytes(n);
+      if (err)
+        return err;
+    }
+  }
+
+  // Reads the initial byte of the next item of a container; sets more to
+  // false at the end of the container
+  DeserializationError::Code readNextItem(bool isIndefinite,
+                                          JsonUInt& remaining, uint8_t& code,
+                                          bool& more) {
+    more = false;
+    if (!isIndefinite) {
+      if (remaining == 0)
+        return DeserializationError::Ok;
+      remaining--;
+    }
+    DeserializationError::Code err = readByte(code);
+    if (err)
+      return err;
+    more = !isIndefinite || code != breakCode;
+    return DeserializationError::Ok;
+  }
+
+  template <typename TFilter>
+  DeserializationError::Code readArray(
+      VariantData* variant, uint8_t info, TFilter filter,
+      DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+
+    if (nestingLimit.reached())
+      return DeserializationError::TooDeep;
+
+    JsonUInt n = 0;
+    bool isIndefinite = info == indefinite;
+    if (!isIndefinite) {
+      err = readLength(info, n);
+      if (err)
+        return err;
+    }
+
+    bool allowArray = filter.allowArray();
+
+    CollectionData* array;
+    if (allowArray) {
+      ARDUINOJSON_ASSERT(variant != 0);
+      array = &variant->toArray();
+    } else {
+      array = 0;
+    }
+
+    TFilter memberFilter = filter[0U];
+
+    for (;;) {
+      uint8_t code = 0;
+      bool more;
+
+      err = readNextItem(isIndefinite, n, code, more);
+      if (err || !more)
+        return err;
+
+      VariantData* value;
+
+      if (memberFilter.allow()) {
+        ARDUINOJSON_ASSERT(array != 0);
+        value = array->addElement(pool_);
+        if (!value)
+          return DeserializationError::NoMemory;
+      } else {
+        value = 0;
+      }
+
+      err = parseValue(code, value, memberFilter, nestingLimit.decrement());
+      if (err)
+        return err;
+    }
+  }
+
+  template <typename TFilter>
+  DeserializationError::Code readObject(
+      VariantData* variant, uint8_t info, TFilter filter,
+      DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+
+    if (nestingLimit.reached())
+      return DeserializationError::TooDeep;
+
+    JsonUInt n = 0;
+    bool isIndefinite = info == indefinite;
+    if (!isIndefinite) {
+      err = readLength(info, n);
+      if (err)
+        return err;
+    }
+
+    CollectionData* object;
+    if (filter.allowObject()) {
+      ARDUINOJSON_ASSERT(variant != 0);
+      object = &variant->toObject();
+    } else {
+      object = 0;
+    }
+
+    for (;;) {
+      uint8_t code = 0;
+      bool more;
+
+      err = readNextItem(isIndefinite, n, code, more);
+      if (err || !more)
+        return err;
+
+      // Only text strings are supported as keys
+      if (code >> 5 != 3)
+        return DeserializationError::InvalidInput;
+
+      err = readString(code & 0x1F);
+      if (err)
+        return err;
+
+      JsonString key = stringStorage_.str();
+      TFilter memberFilter = filter[key.c_str()];
+      VariantData* member;
+
+      if (memberFilter.allow()) {
+        ARDUINOJSON_ASSERT(object != 0);
+
+        // Save key in memory pool.
+        // This MUST be done before adding the slot.
+        key = stringStorage_.save();
+
+        VariantSlot* slot = object->addSlot(pool_);
+        if (!slot)
+          return DeserializationError::NoMemory;
+
+        slot->setKey(key);
+
+        member = slot->data();
+      } else {
+        member = 0;
+      }
+
+      err = parseVariant(member, memberFilter, nestingLimit.decrement());
+      if (err)
+        return err;
+    }
+  }
+
+  MemoryPool* pool_;
+  TReader reader_;
+  TStringStorage stringStorage_;
+  bool foundSomething_;
+};
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
+
+ARDUINOJSON_BEGIN_PUBLIC_NAMESPACE
+
+// Parses a CBOR input and puts the result in a JsonDocument.
+template <typename... Args>
+DeserializationError deserializeCbor(JsonDocument& doc, Args&&... args) {
+  using namespace detail;
+  return deserialize<CborDeserializer>(doc, detail::forward<Args>(args)...);
+}
+
+// Parses a CBOR input and puts the result in a JsonDocument.
+template <typename TChar, typename... Args>
+DeserializationError deserializeCbor(JsonDocument& doc, TChar* input,
+                                     Args&&... args) {
+  using namespace detail;
+  return deserialize<CborDeserializer>(doc, input,
+                                       detail::forward<Args>(args)...);
+}
+
+ARDUINOJSON_END_PUBLIC_NAMESPACE
@@ -0,0 +1,187 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Cbor/halfFloat.hpp>
+#include <ArduinoJson/MsgPack/endianess.hpp>
+#include <ArduinoJson/Polyfills/assert.hpp>
+#include <ArduinoJson/Polyfills/type_traits.hpp>
+#include <ArduinoJson/Serialization/CountingDecorator.hpp>
+#include <ArduinoJson/Serialization/measure.hpp>
+#include <ArduinoJson/Serialization/serialize.hpp>
+#include <ArduinoJson/Variant/VariantData.hpp>
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// Writes CBOR (RFC 8949) with the preferred serialization: the shortest
+// heads, and the shortest float that holds the value
+template <typename TWriter>
+class CborSerializer : public Visitor<size_t> {
+ public:
+  static const bool producesText = false;
+
+  CborSerializer(TWriter writer) : writer_(writer) {}
+
+  template <typename T>
+  typename enable_if<sizeof(T) == 4, size_t>::type visitFloat(T value32) {
+    if (canConvertNumber<JsonInteger>(value32)) {
+      JsonInteger truncatedValue = JsonInteger(value32);
+      if (value32 == T(truncatedValue))
+        return visitSignedInteger(truncatedValue);
+    }
+    uint16_t half;
+    if (floatToHalf(value32, half)) {
+      writeByte(0xF9);
+      writeInteger(half);
+    } else {
+      writeByte(0xFA);
+      writeInteger(value32);
+    }
+    return bytesWritten();
+  }
+
+  template <typename T>
+  ARDUINOJSON_NO_SANITIZE("float-cast-overflow")
+  typename enable_if<sizeof(T) == 8, size_t>::type visitFloat(T value64) {
+    float value32 = float(value64);
+    if (value32 == value64 || value64 != value64)  // NaN fits in a half
+      return visitFloat(value32);
+    writeByte(0xFB);
+    writeInteger(value64);
+    return bytesWritten();
+  }
+
+  size_t visitArray(const CollectionData& array) {
+    writeHead(4, JsonUInt(array.size()));
+    for (const VariantSlot* slot = array.head(); slot; slot = slot->next()) {
+      slot->data()->accept(*this);
+    }
+    return bytesWritten();
+  }
+
+  size_t visitObject(const CollectionData& object) {
+    writeHead(5, JsonUInt(object.size()));
+    for (const VariantSlot* slot = object.head(); slot; slot = slot->next()) {
+      visitString(slot->key());
+      slot->data()->accept(*this);
+    }
+    return bytesWritten();
+  }
+
+  size_t visitString(const char* value) {
+    return visitString(value, strlen(value));
+  }
+
+  size_t visitString(const char* value, size_t n) {
+    ARDUINOJSON_ASSERT(value != NULL);
+    writeHead(3, JsonUInt(n));
+    writeBytes(reinterpret_cast<const uint8_t*>(value), n);
+    return bytesWritten();
+  }
+
+  size_t visitRawJson(const char* data, size_t size) {
+    writeBytes(reinterpret_cast<const uint8_t*>(data), size);
+    return bytesWritten();
+  }
+
+  size_t visitSignedInteger(JsonInteger value) {
+    if (value >= 0)
+      writeHead(0, static_cast<JsonUInt>(value));
+    else
+      writeHead(1, static_cast<JsonUInt>(-(value + 1)));
+    return bytesWritten();
+  }
+
+  size_t visitUnsignedInteger(JsonUInt value) {
+    writeHead(0, value);
+    return bytesWritten();
+  }
+
+  size_t visitBoolean(bool value) {
+    writeByte(value ? 0xF5 : 0xF4);
+    return bytesWritten();
+  }
+
+  size_t visitNull() {
+    writeByte(0xF6);
+    return bytesWritten();
+  }
+
+ private:
+  size_t bytesWritten() const {
+    return writer_.count();
+  }
+
+  void writeByte(uint8_t c) {
+    writer_.write(c);
+  }
+
+  void writeBytes(const uint8_t* p, size_t n) {
+    writer_.write(p, n);
+  }
+
+  template <typename T>
+  void writeInteger(T value) {
+    fixEndianess(value);
+    writeBytes(reinterpret_cast<uint8_t*>(&value), sizeof(value));
+  }
+
+  // The initial byte holds the major type and, if it fits, the argument
+  void writeHead(uint8_t majorType, JsonUInt value) {
+    uint8_t type = uint8_t(majorType << 5);
+    if (value < 24) {
+      writeByte(uint8_t(type | value));
+    } else if (value <= 0xFF) {
+      writeByte(type | 24);
+      writeInteger(uint8_t(value));
+    } else if (value <= 0xFFFF) {
+      writeByte(type | 25);
+      writeInteger(uint16_t(value));
+    }
+#if ARDUINOJSON_USE_LONG_LONG
+    else if (value <= 0xFFFFFFFF)
+#else
+    else
+#endif
+    {
+      writeByte(type | 26);
+      writeInteger(uint32_t(value));
+    }
+#if ARDUINOJSON_USE_LONG_LONG
+    else {
+      writeByte(type | 27);
+      writeInteger(uint64_t(value));
+    }
+#endif
+  }
+
+  CountingDecorator<TWriter> writer_;
+};
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
+
+ARDUINOJSON_BEGIN_PUBLIC_NAMESPACE
+
+// Produces a CBOR document.
+template <typename TDestination>
+inline size_t serializeCbor(JsonVariantConst source, TDestination& output) {
+  using namespace ArduinoJson::detail;
+  return serialize<CborSerializer>(source, output);
+}
+
+// Produces a CBOR document.
+inline size_t serializeCbor(JsonVariantConst source, void* output,
+                            size_t size) {
+  using namespace ArduinoJson::detail;
+  return serialize<CborSerializer>(source, output, size);
+}
+
+// Computes the length of the document that serializeCbor() produces.
+inline size_t measureCbor(JsonVariantConst source) {
+  using namespace ArduinoJson::detail;
+  return measure<CborSerializer>(source);
+}
+
+ARDUINOJSON_END_PUBLIC_NAMESPACE
@@ -0,0 +1,46 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Polyfills/alias_cast.hpp>
+
+#include <stdint.h>  // uint16_t, uint32_t
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// The IEEE 754 half-precision floats of CBOR: 1 sign bit, 5 exponent bits,
+// and 10 mantissa bits
+
+inline float halfToFloat(uint16_t half) {
+  uint32_t sign = uint32_t(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1F;
+  uint32_t mantissa = half & 0x3FF;
+  if (exponent == 0) {  // zero or subnormal: mantissa * 2^-24
+    float value = float(mantissa) / 16777216.0f;
+    return sign ? -value : value;
+  }
+  if (exponent == 0x1F)  // infinity or NaN
+    return alias_cast<float>(sign | 0x7F800000 | mantissa << 13);
+  return alias_cast<float>(sign | (exponent + 127 - 15) << 23 | mantissa << 13);
+}
+
+// Returns false if the value has no exact half-precision equivalent; the
+// subnormal halves are not used
+inline bool floatToHalf(float value, uint16_t& half) {
+  uint32_t bits = alias_cast<uint32_t>(value);
+  uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+  uint32_t exponent = (bits >> 23) & 0xFF;
+  uint32_t mantissa = bits & 0x7FFFFF;
+  if (exponent == 0xFF) {  // infinity or NaN
+    half = uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    return true;
+  }
+  if (exponent < 127 - 14 || exponent > 127 + 15 || (mantissa & 0x1FFF))
+    return false;
+  half = uint16_t(sign | (exponent - 127 + 15) << 10 | mantissa >> 13);
+  return true;
+}
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
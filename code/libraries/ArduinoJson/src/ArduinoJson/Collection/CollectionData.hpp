@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <ArduinoJson/Configuration.hpp>
 #include <ArduinoJson/Namespace.hpp>
 #include <ArduinoJson/Polyfills/assert.hpp>
 
@@ -12,12 +13,13 @@
 ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 
 class MemoryPool;
+class ObjectIndex;
 class VariantData;
 class VariantSlot;
 
 class CollectionData {
   VariantSlot* head_;
-  VariantSlot* tail_;
+  VariantSlot* tail_;  // or the ObjectIndex holding it, see getIndex()
 
  public:
   // Must be a POD!
@@ -79,6 +81,15 @@ class CollectionData {
   VariantSlot* getSlot(TAdaptedString key) const;
 
   VariantSlot* getPreviousSlot(VariantSlot*) const;
+
+  VariantSlot* getTail() const;
+  void setTail(VariantSlot* slot);
+
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  ObjectIndex* getIndex() const;
+  void setIndex(ObjectIndex* index);
+  void updateIndex(VariantSlot* member, MemoryPool* pool);
+#endif
 };
 
 inline const VariantData* collectionToVariant(
@@ -5,30 +5,118 @@
 #pragma once
 
 #include <ArduinoJson/Collection/CollectionData.hpp>
+#include <ArduinoJson/Collection/ObjectIndex.hpp>
 #include <ArduinoJson/Strings/StoragePolicy.hpp>
 #include <ArduinoJson/Strings/StringAdapters.hpp>
 #include <ArduinoJson/Variant/VariantData.hpp>
 
 ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 
+// Links the tail of a collection to a slot that was just allocated.
+// When the tail is in an older page of the pool, or too far away, it needs a
+// FarLink.
+inline bool linkSlots(VariantSlot* tail, VariantSlot* slot, MemoryPool* pool) {
+  if (tail->hasFarLink() ||
+      (pool->inCurrentBlock(tail) && tail->canLinkTo(slot))) {
+    tail->setNextNotNull(slot);
+    return true;
+  }
+  void* link = pool->allocAligned(sizeof(FarLink));
+  if (!link)
+    return false;
+  tail->setFarNext(slot, static_cast<FarLink*>(link));
+  return true;
+}
+
 inline VariantSlot* CollectionData::addSlot(MemoryPool* pool) {
   VariantSlot* slot = pool->allocVariant();
   if (!slot)
     return 0;
 
-  if (tail_) {
-    ARDUINOJSON_ASSERT(pool->owns(tail_));  // Can't alter a linked array/object
-    tail_->setNextNotNull(slot);
-    tail_ = slot;
+  slot->clear();
+
+  VariantSlot* tail = getTail();
+  if (tail) {
+    ARDUINOJSON_ASSERT(pool->owns(tail));  // Can't alter a linked array/object
+    if (!linkSlots(tail, slot, pool)) {
+      pool->markAsOverflowed();
+      return 0;
+    }
+    setTail(slot);
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+    // the key of the previous member is set by now
+    if (tail->key())
+      updateIndex(tail, pool);
+#endif
   } else {
     head_ = slot;
     tail_ = slot;
   }
 
-  slot->clear();
   return slot;
 }
 
+inline VariantSlot* CollectionData::getTail() const {
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  ObjectIndex* index = getIndex();
+  if (index)
+    return index->tail();
+#endif
+  return tail_;
+}
+
+inline void CollectionData::setTail(VariantSlot* slot) {
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  ObjectIndex* index = getIndex();
+  if (index) {
+    index->setTail(slot);
+    return;
+  }
+#endif
+  tail_ = slot;
+}
+
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+// The lowest bit of tail_ tells that it points to an ObjectIndex
+inline ObjectIndex* CollectionData::getIndex() const {
+  size_t tail = reinterpret_cast<size_t>(tail_);
+  if (!(tail & 1))
+    return 0;
+  return reinterpret_cast<ObjectIndex*>(tail - 1);
+}
+
+inline void CollectionData::setIndex(ObjectIndex* index) {
+  tail_ = reinterpret_cast<VariantSlot*>(reinterpret_cast<size_t>(index) | 1);
+}
+
+inline void CollectionData::updateIndex(VariantSlot* member,
+                                        MemoryPool* pool) {
+  ObjectIndex* index = getIndex();
+  if (index) {
+    if (index->last() == member || index->add(member))
+      return;
+  } else {
+    // a fixed pool keeps to the size given by JSON_OBJECT_SIZE()
+    if (!pool->pageSize())
+      return;
+    size_t n = 0;
+    for (VariantSlot* s = head_; s && n <= ARDUINOJSON_OBJECT_INDEX_THRESHOLD;
+         s = s->next())
+      n++;
+    if (n <= ARDUINOJSON_OBJECT_INDEX_THRESHOLD)
+      return;
+  }
+
+  // create the index, or a larger one when it's full
+  VariantSlot* tail = getTail();
+  index = ObjectIndex::create(head_, member, tail, pool);
+  if (index)
+    setIndex(index);
+  else
+    tail_ = tail;  // do without
+}
+#endif
+
 inline VariantData* CollectionData::addElement(MemoryPool* pool) {
   return slotData(addSlot(pool));
 }
@@ -46,7 +134,7 @@ inline VariantData* CollectionData::addMember(TAdaptedString key,
 
 inline void CollectionData::clear() {
   head_ = 0;
-  tail_ = 0;
+  tail_ = 0;  // drops the index too
 }
 
 template <typename TAdaptedString>
@@ -78,6 +166,11 @@ template <typename TAdaptedString>
 inline VariantSlot* CollectionData::getSlot(TAdaptedString key) const {
   if (key.isNull())
     return 0;
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  ObjectIndex* index = getIndex();
+  if (index)
+    return index->find(key, head_);
+#endif
   VariantSlot* slot = head_;
   while (slot) {
     if (stringEquals(key, adaptString(slot->key())))
@@ -151,12 +244,18 @@ inline void CollectionData::removeSlot(VariantSlot* slot) {
     return;
   VariantSlot* prev = getPreviousSlot(slot);
   VariantSlot* next = slot->next();
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  ObjectIndex* index = getIndex();
+  if (index)
+    index->remove(slot, prev);
+#endif
+  // may reuse the memory of the slot
   if (prev)
-    prev->setNext(next);
+    prev->removeNext();
   else
     head_ = next;
   if (!next)
-    tail_ = prev;
+    setTail(prev);
 }
 
 inline void CollectionData::removeElement(size_t index) {
@@ -189,7 +288,18 @@ inline void movePointer(T*& p, ptrdiff_t offset) {
 inline void CollectionData::movePointers(ptrdiff_t stringDistance,
                                          ptrdiff_t variantDistance) {
   movePointer(head_, variantDistance);
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  ObjectIndex* index = getIndex();
+  if (index) {
+    movePointer(index, variantDistance);
+    index->movePointers(variantDistance);
+    setIndex(index);
+  } else {
+    movePointer(tail_, variantDistance);
+  }
+#else
   movePointer(tail_, variantDistance);
+#endif
   for (VariantSlot* slot = head_; slot; slot = slot->next())
     slot->movePointers(stringDistance, variantDistance);
 }
@@ -0,0 +1,186 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Memory/MemoryPool.hpp>
+#include <ArduinoJson/Polyfills/integer.hpp>
+#include <ArduinoJson/Strings/StringAdapters.hpp>
+#include <ArduinoJson/Variant/VariantSlot.hpp>
+
+#include <string.h>  // memset
+
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+template <typename TAdaptedString>
+inline uint32_t hashKey(TAdaptedString key) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  size_t n = key.size();
+  for (size_t i = 0; i < n; i++) {
+    hash ^= static_cast<uint8_t>(key[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// A hash table of the members of a large object, in the memory pool with the
+// variants. The members from the head to last_ are in the table, the ones
+// after (usually just the tail, whose key isn't set yet) are found by walking
+// the list.
+//
+// +-------+-------+--------+-----------+----------+
+// | tail_ | last_ | count_ | capacity_ | buckets  |
+// +-------+-------+--------+-----------+----------+
+//
+// A bucket points to a member, or is null. The members can be in any page of
+// the memory pool, so they can't be located by their distance to the table.
+class ObjectIndex {
+ public:
+  // Returns null when there's no memory for it
+  static ObjectIndex* create(VariantSlot* head, VariantSlot* last,
+                             VariantSlot* tail, MemoryPool* pool) {
+    size_t count = 0;
+    for (VariantSlot* slot = head; slot != last->next(); slot = slot->next())
+      count++;
+    size_t capacity = 8;
+    while (capacity < 2 * (count + 1))
+      capacity *= 2;
+
+    void* block = pool->allocAligned(sizeof(ObjectIndex) +
+                                     capacity * sizeof(VariantSlot*));
+    if (!block)
+      return 0;
+    ObjectIndex* index = static_cast<ObjectIndex*>(block);
+    index->tail_ = tail;
+    index->last_ = 0;
+    index->count_ = 0;
+    index->capacity_ = capacity;
+    memset(index->buckets(), 0, capacity * sizeof(VariantSlot*));
+
+    for (VariantSlot* slot = head; slot != last->next(); slot = slot->next()) {
+      if (!index->add(slot))
+        return 0;
+    }
+    return index;
+  }
+
+  VariantSlot* tail() const {
+    return tail_;
+  }
+
+  void setTail(VariantSlot* tail) {
+    tail_ = tail;
+  }
+
+  VariantSlot* last() const {
+    return last_;
+  }
+
+  // Adds the member after last_, returns false when full
+  bool add(VariantSlot* slot) {
+    ARDUINOJSON_ASSERT(slot->key() != 0);
+    if (2 * (count_ + 1) > capacity_)
+      return false;
+    size_t i = home(slot);
+    while (buckets()[i])
+      i = (i + 1) & (capacity_ - 1);
+    buckets()[i] = slot;
+    count_++;
+    last_ = slot;
+    return true;
+  }
+
+  template <typename TAdaptedString>
+  VariantSlot* find(TAdaptedString key, VariantSlot* head) const {
+    for (size_t i = hashKey(key) & (capacity_ - 1); buckets()[i];
+         i = (i + 1) & (capacity_ - 1)) {
+      VariantSlot* slot = at(i);
+      if (stringEquals(key, adaptString(slot->key())))
+        return slot;
+    }
+    for (VariantSlot* slot = last_ ? last_->next() : head; slot;
+         slot = slot->next()) {
+      if (stringEquals(key, adaptString(slot->key())))
+        return slot;
+    }
+    return 0;
+  }
+
+  void remove(VariantSlot* slot, VariantSlot* previous) {
+    if (slot == last_)
+      last_ = previous;
+    if (!slot->key())  // the tail of addMember() failing
+      return;
+    size_t i = bucketOf(slot);
+    if (i == capacity_)  // after last_
+      return;
+
+    // Backward shift deletion: pull up the following entries that would
+    // otherwise become unreachable
+    size_t j = i;
+    for (;;) {
+      j = (j + 1) & (capacity_ - 1);
+      if (!buckets()[j])
+        break;
+      size_t k = home(at(j));
+      bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+      if (stays)
+        continue;
+      buckets()[i] = buckets()[j];
+      i = j;
+    }
+    buckets()[i] = 0;
+    count_--;
+  }
+
+  // This function is called after a realloc.
+  void movePointers(ptrdiff_t variantDistance) {
+    movePointer(tail_, variantDistance);
+    movePointer(last_, variantDistance);
+    for (size_t i = 0; i < capacity_; i++)
+      movePointer(buckets()[i], variantDistance);
+  }
+
+ private:
+  template <typename T>
+  static void movePointer(T*& p, ptrdiff_t offset) {
+    if (p)
+      p = reinterpret_cast<T*>(
+          reinterpret_cast<void*>(reinterpret_cast<char*>(p) + offset));
+  }
+
+  VariantSlot** buckets() const {
+    const void* p = this + 1;  // prevent warning cast-align
+    return const_cast<VariantSlot**>(static_cast<VariantSlot* const*>(p));
+  }
+
+  VariantSlot* at(size_t i) const {
+    return buckets()[i];
+  }
+
+  size_t home(const VariantSlot* slot) const {
+    return hashKey(adaptString(slot->key())) & (capacity_ - 1);
+  }
+
+  // Returns capacity_ if the slot isn't in the table
+  size_t bucketOf(const VariantSlot* slot) const {
+    for (size_t i = home(slot); buckets()[i]; i = (i + 1) & (capacity_ - 1)) {
+      if (at(i) == slot)
+        return i;
+    }
+    return capacity_;
+  }
+
+  VariantSlot* tail_;
+  VariantSlot* last_;
+  size_t count_;
+  size_t capacity_;
+};
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
+
+#endif
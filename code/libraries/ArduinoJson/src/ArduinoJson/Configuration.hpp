@@ -75,6 +75,16 @@
 #  define ARDUINOJSON_DEFAULT_NESTING_LIMIT 10
 #endif
 
+// Size of the buffer where parseJson() puts a string or a key before passing
+// it to the handler, including the terminator
+#ifndef ARDUINOJSON_PARSER_STRING_SIZE
+#  if defined(__AVR)
+#    define ARDUINOJSON_PARSER_STRING_SIZE 64
+#  else
+#    define ARDUINOJSON_PARSER_STRING_SIZE 256
+#  endif
+#endif
+
 // Number of bits to store the pointer to next node
 // (saves RAM but limits the number of values in a document)
 #ifndef ARDUINOJSON_SLOT_OFFSET_SIZE
@@ -172,6 +182,22 @@
 #  define ARDUINOJSON_NEGATIVE_EXPONENTIATION_THRESHOLD 1e-5
 #endif
 
+// Write the shortest digits that read back as the same float (1), or round to
+// 9 significant digits (0)
+#ifndef ARDUINOJSON_ENABLE_SHORTEST_FLOAT
+#  define ARDUINOJSON_ENABLE_SHORTEST_FLOAT 0
+#endif
+
+// Parse decimal numbers to the nearest float (1), or use a smaller algorithm
+// that is sometimes one unit in the last place off (0)
+#ifndef ARDUINOJSON_ENABLE_EXACT_FLOAT
+#  if defined(__AVR)
+#    define ARDUINOJSON_ENABLE_EXACT_FLOAT 0
+#  else
+#    define ARDUINOJSON_ENABLE_EXACT_FLOAT 1
+#  endif
+#endif
+
 #ifndef ARDUINOJSON_LITTLE_ENDIAN
 #  if defined(_MSC_VER) ||                           \
       (defined(__BYTE_ORDER__) &&                    \
@@ -191,6 +217,17 @@
 #  endif
 #endif
 
+// Index the members of large objects in a hash table, when the document grows
+// by pages; the tag bit it needs in the tail pointer requires alignment
+#ifndef ARDUINOJSON_ENABLE_OBJECT_INDEX
+#  define ARDUINOJSON_ENABLE_OBJECT_INDEX ARDUINOJSON_ENABLE_ALIGNMENT
+#endif
+
+// Number of members above which an object gets an index
+#ifndef ARDUINOJSON_OBJECT_INDEX_THRESHOLD
+#  define ARDUINOJSON_OBJECT_INDEX_THRESHOLD 16
+#endif
+
 #ifndef ARDUINOJSON_TAB
 #  define ARDUINOJSON_TAB "  "
 #endif
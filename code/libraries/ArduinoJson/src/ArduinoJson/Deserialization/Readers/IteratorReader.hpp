@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <ArduinoJson/Strings/StringTraits.hpp>
+
 ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 
 template <typename TIterator>
@@ -27,6 +29,19 @@ class IteratorReader {
       buffer[i++] = *ptr_++;
     return i;
   }
+
+  // The unread characters, for JsonTokenizer to scan them in place
+  TIterator begin() const {
+    return ptr_;
+  }
+
+  TIterator end() const {
+    return end_;
+  }
+
+  void seek(TIterator ptr) {
+    ptr_ = ptr;
+  }
 };
 
 template <typename T>
@@ -34,8 +49,13 @@ struct void_ {
   typedef void type;
 };
 
+// Containers with data() and size() are read in place, see RamReader.hpp
 template <typename TSource>
-struct Reader<TSource, typename void_<typename TSource::const_iterator>::type>
+struct Reader<TSource, typename enable_if<
+                           !(string_traits<TSource>::has_data &&
+                             string_traits<TSource>::has_size),
+                           typename void_<
+                               typename TSource::const_iterator>::type>::type>
     : IteratorReader<typename TSource::const_iterator> {
   explicit Reader(const TSource& source)
       : IteratorReader<typename TSource::const_iterator>(source.begin(),
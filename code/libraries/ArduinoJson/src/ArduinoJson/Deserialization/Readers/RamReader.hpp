@@ -5,6 +5,7 @@
 #pragma once
 
 #include <ArduinoJson/Polyfills/type_traits.hpp>
+#include <ArduinoJson/Strings/StringTraits.hpp>
 
 ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 
@@ -48,4 +49,14 @@ struct BoundedReader<TSource*,
                                     reinterpret_cast<const char*>(ptr) + len) {}
 };
 
+// Containers with data() and size(), like std::string, are read in place
+template <typename TSource>
+struct Reader<TSource,
+              typename enable_if<string_traits<TSource>::has_data &&
+                                 string_traits<TSource>::has_size>::type>
+    : BoundedReader<const char*> {
+  explicit Reader(const TSource& source)
+      : BoundedReader<const char*>(source.data(), source.size()) {}
+};
+
 ARDUINOJSON_END_PRIVATE_NAMESPACE
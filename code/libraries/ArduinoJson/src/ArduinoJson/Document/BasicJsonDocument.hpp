@@ -10,11 +10,13 @@ ARDUINOJSON_BEGIN_PUBLIC_NAMESPACE
 
 // Helper to implement the "base-from-member" idiom
 // (we need to store the allocator before constructing JsonDocument)
+// It also supplies the pages of a memory pool that grows.
 template <typename TAllocator>
-class AllocatorOwner {
+class AllocatorOwner : public detail::PageAllocator {
  public:
-  AllocatorOwner() {}
-  AllocatorOwner(TAllocator a) : allocator_(a) {}
+  AllocatorOwner() : detail::PageAllocator(allocatePage, deallocatePage) {}
+  AllocatorOwner(TAllocator a)
+      : detail::PageAllocator(allocatePage, deallocatePage), allocator_(a) {}
 
   void* allocate(size_t size) {
     return allocator_.allocate(size);
@@ -34,6 +36,14 @@ class AllocatorOwner {
   }
 
  private:
+  static void* allocatePage(detail::PageAllocator* owner, size_t size) {
+    return static_cast<AllocatorOwner*>(owner)->allocate(size);
+  }
+
+  static void deallocatePage(detail::PageAllocator* owner, void* page) {
+    static_cast<AllocatorOwner*>(owner)->deallocate(page);
+  }
+
   TAllocator allocator_;
 };
 
@@ -45,10 +55,19 @@ class BasicJsonDocument : AllocatorOwner<TAllocator>, public JsonDocument {
   explicit BasicJsonDocument(size_t capa, TAllocator alloc = TAllocator())
       : AllocatorOwner<TAllocator>(alloc), JsonDocument(allocPool(capa)) {}
 
+  // Starts with capa bytes, then grows by pages of pageSize bytes instead of
+  // overflowing. A pageSize of 0 keeps the capacity fixed.
+  // The pages must lie within ARDUINOJSON_SLOT_OFFSET_SIZE reach of each
+  // other (a 512KB span on 32-bit), beyond that the document overflows.
+  BasicJsonDocument(size_t capa, size_t pageSize,
+                    TAllocator alloc = TAllocator())
+      : AllocatorOwner<TAllocator>(alloc),
+        JsonDocument(allocPool(capa, pageSize)) {}
+
   // Copy-constructor
   BasicJsonDocument(const BasicJsonDocument& src)
       : AllocatorOwner<TAllocator>(src), JsonDocument() {
-    copyAssignFrom(src);
+    copyAssignFrom(src, src.pageSize());
   }
 
   // Move-constructor
@@ -57,7 +76,7 @@ class BasicJsonDocument : AllocatorOwner<TAllocator>, public JsonDocument {
   }
 
   BasicJsonDocument(const JsonDocument& src) {
-    copyAssignFrom(src);
+    copyAssignFrom(src, 0);
   }
 
   // Construct from variant, array, or object
@@ -85,7 +104,7 @@ class BasicJsonDocument : AllocatorOwner<TAllocator>, public JsonDocument {
   }
 
   BasicJsonDocument& operator=(const BasicJsonDocument& src) {
-    copyAssignFrom(src);
+    copyAssignFrom(src, src.pageSize());
     return *this;
   }
 
@@ -98,14 +117,35 @@ class BasicJsonDocument : AllocatorOwner<TAllocator>, public JsonDocument {
   BasicJsonDocument& operator=(const T& src) {
     size_t requiredSize = src.memoryUsage();
     if (requiredSize > capacity())
-      reallocPool(requiredSize);
+      reallocPool(requiredSize, pageSize());
     set(src);
     return *this;
   }
 
+  // Returns the size of the pages added when the memory pool is full, 0 if
+  // the capacity is fixed.
+  size_t pageSize() const {
+    return pool_.pageSize();
+  }
+
   // Reduces the capacity of the memory pool to match the current usage.
   // https://arduinojson.org/v6/api/basicjsondocument/shrinktofit/
   void shrinkToFit() {
+    if (pageSize()) {
+      // Pages can't move, so copy everything into a single page that fits
+      BasicJsonDocument tmp(*this, memoryUsage());
+      if (tmp.overflowed())
+        return;
+      // Without the FarLinks between the pages, the copy may need less
+      if (tmp.memoryUsage() < memoryUsage()) {
+        BasicJsonDocument exact(tmp, tmp.memoryUsage());
+        if (!exact.overflowed())
+          tmp.moveAssignFrom(exact);
+      }
+      moveAssignFrom(tmp);
+      return;
+    }
+
     ptrdiff_t bytes_reclaimed = pool_.squash();
     if (bytes_reclaimed == 0)
       return;
@@ -134,25 +174,37 @@ class BasicJsonDocument : AllocatorOwner<TAllocator>, public JsonDocument {
   using AllocatorOwner<TAllocator>::allocator;
 
  private:
-  detail::MemoryPool allocPool(size_t requiredSize) {
+  // Copies a growing document, starting with a page of the specified size
+  BasicJsonDocument(const BasicJsonDocument& src, size_t capa)
+      : AllocatorOwner<TAllocator>(src),
+        JsonDocument(allocPool(capa, src.pageSize())) {
+    set(src);
+  }
+
+  detail::MemoryPool allocPool(size_t requiredSize, size_t pageSize = 0) {
+    if (pageSize)
+      return {this, requiredSize, pageSize};
     size_t capa = detail::addPadding(requiredSize);
     return {reinterpret_cast<char*>(this->allocate(capa)), capa};
   }
 
-  void reallocPool(size_t requiredSize) {
+  void reallocPool(size_t requiredSize, size_t pageSize) {
     size_t capa = detail::addPadding(requiredSize);
-    if (capa == pool_.capacity())
+    if (capa == pool_.capacity() && pageSize == this->pageSize())
       return;
     freePool();
-    replacePool(allocPool(detail::addPadding(requiredSize)));
+    replacePool(allocPool(detail::addPadding(requiredSize), pageSize));
   }
 
   void freePool() {
-    this->deallocate(getPool()->buffer());
+    if (pageSize())
+      pool_.freePages();
+    else
+      this->deallocate(getPool()->buffer());
   }
 
-  void copyAssignFrom(const JsonDocument& src) {
-    reallocPool(src.capacity());
+  void copyAssignFrom(const JsonDocument& src, size_t pageSize) {
+    reallocPool(src.capacity(), pageSize);
     set(src);
   }
 
@@ -160,6 +212,8 @@ class BasicJsonDocument : AllocatorOwner<TAllocator>, public JsonDocument {
     freePool();
     data_ = src.data_;
     pool_ = src.pool_;
+    if (pageSize())
+      pool_.setPageAllocator(this);
     src.data_.setNull();
     src.pool_ = {0, 0};
   }
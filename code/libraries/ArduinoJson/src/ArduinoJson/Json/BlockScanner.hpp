@@ -0,0 +1,221 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Namespace.hpp>
+
+#include <stdint.h>  // uint32_t, uint64_t, uintptr_t
+#include <string.h>  // memcpy
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) && ARDUINOJSON_LITTLE_ENDIAN
+#  include <arm_neon.h>
+#endif
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// The scanners find the end of a run of spaces, or of characters that a
+// string holds verbatim, in an input that sits in RAM. They never read past
+// end, which is why a bare const char*, whose end is unknown, doesn't use them.
+
+struct ByteScanner {
+  static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  static bool isStringChar(char c, char quote) {
+    return c != quote && c != '\\' && c != '\0';
+  }
+
+  static const char* skipSpaces(const char* p, const char* end) {
+    while (p != end && isSpace(*p))
+      p++;
+    return p;
+  }
+
+  static const char* skipStringChars(const char* p, const char* end,
+                                     char quote) {
+    while (p != end && isStringChar(*p, quote))
+      p++;
+    return p;
+  }
+};
+
+// Tests a machine word of characters at a time ("SIMD within a register"),
+// then finishes byte by byte
+struct WordScanner {
+#if defined(__SIZEOF_POINTER__) && __SIZEOF_POINTER__ >= 8
+  typedef uint64_t word_t;
+#else
+  typedef uint32_t word_t;
+#endif
+
+  static word_t broadcast(unsigned char c) {
+    return word_t(~word_t(0) / 0xFF * word_t(c));
+  }
+
+  // Sets the high bit of the bytes of x that are zero, and only those
+  static word_t zeroBytes(word_t x) {
+    const word_t lows = broadcast(0x7F);
+    return word_t(~(((x & lows) + lows) | x | lows));
+  }
+
+  static bool isAligned(const char* p) {
+    return reinterpret_cast<uintptr_t>(p) % sizeof(word_t) == 0;
+  }
+
+  static word_t load(const char* p) {
+#if defined(__GNUC__)
+    // so that memcpy() becomes a single load on the MCUs that need alignment
+    p = static_cast<const char*>(__builtin_assume_aligned(p, sizeof(word_t)));
+#endif
+    word_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+  }
+
+  static const char* skipSpaces(const char* p, const char* end) {
+    while (p != end && !isAligned(p)) {
+      if (!ByteScanner::isSpace(*p))
+        return p;
+      p++;
+    }
+    const word_t highs = broadcast(0x80);
+    while (size_t(end - p) >= sizeof(word_t)) {
+      word_t x = load(p);
+      word_t spaces = zeroBytes(x ^ broadcast(' ')) |
+                      zeroBytes(x ^ broadcast('\t')) |
+                      zeroBytes(x ^ broadcast('\r')) |
+                      zeroBytes(x ^ broadcast('\n'));
+      if (spaces != highs)
+        break;
+      p += sizeof(word_t);
+    }
+    return ByteScanner::skipSpaces(p, end);
+  }
+
+  static const char* skipStringChars(const char* p, const char* end,
+                                     char quote) {
+    while (p != end && !isAligned(p)) {
+      if (!ByteScanner::isStringChar(*p, quote))
+        return p;
+      p++;
+    }
+    const word_t quotes = broadcast(static_cast<unsigned char>(quote));
+    const word_t backslashes = broadcast('\\');
+    while (size_t(end - p) >= sizeof(word_t)) {
+      word_t x = load(p);
+      if (zeroBytes(x) | zeroBytes(x ^ quotes) | zeroBytes(x ^ backslashes))
+        break;
+      p += sizeof(word_t);
+    }
+    return ByteScanner::skipStringChars(p, end, quote);
+  }
+};
+
+#if defined(__SSE2__)
+// Tests 16 characters at a time with the SSE2 instructions of x86 CPUs
+struct Sse2Scanner {
+  static __m128i load(const char* p) {
+    return _mm_loadu_si128(static_cast<const __m128i*>(
+        static_cast<const void*>(p)));
+  }
+
+  static const char* skipSpaces(const char* p, const char* end) {
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+      __m128i x = load(p);
+      __m128i spaces = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, tab)),
+          _mm_or_si128(_mm_cmpeq_epi8(x, cr), _mm_cmpeq_epi8(x, lf)));
+      unsigned others = unsigned(_mm_movemask_epi8(spaces)) ^ 0xFFFF;
+      if (others)
+        return p + __builtin_ctz(others);
+      p += 16;
+    }
+    return ByteScanner::skipSpaces(p, end);
+  }
+
+  static const char* skipStringChars(const char* p, const char* end,
+                                     char quote) {
+    const __m128i quotes = _mm_set1_epi8(quote);
+    const __m128i backslashes = _mm_set1_epi8('\\');
+    const __m128i zeros = _mm_setzero_si128();
+    while (end - p >= 16) {
+      __m128i x = load(p);
+      __m128i stops = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(x, quotes),
+                       _mm_cmpeq_epi8(x, backslashes)),
+          _mm_cmpeq_epi8(x, zeros));
+      unsigned mask = unsigned(_mm_movemask_epi8(stops));
+      if (mask)
+        return p + __builtin_ctz(mask);
+      p += 16;
+    }
+    return ByteScanner::skipStringChars(p, end, quote);
+  }
+};
+typedef Sse2Scanner BlockScanner;
+
+#elif defined(__ARM_NEON) && ARDUINOJSON_LITTLE_ENDIAN
+// Tests 16 characters at a time with the NEON instructions of ARM CPUs
+struct NeonScanner {
+  // Turns each byte of a comparison into a nibble, as there is no movemask
+  static uint64_t nibbles(uint8x16_t matches) {
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+  }
+
+  static uint8x16_t load(const char* p) {
+    return vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+  }
+
+  static const char* skipSpaces(const char* p, const char* end) {
+    const uint8x16_t space = vdupq_n_u8(' '), tab = vdupq_n_u8('\t');
+    const uint8x16_t cr = vdupq_n_u8('\r'), lf = vdupq_n_u8('\n');
+    while (end - p >= 16) {
+      uint8x16_t x = load(p);
+      uint8x16_t spaces =
+          vorrq_u8(vorrq_u8(vceqq_u8(x, space), vceqq_u8(x, tab)),
+                   vorrq_u8(vceqq_u8(x, cr), vceqq_u8(x, lf)));
+      uint64_t others = ~nibbles(spaces);
+      if (others)
+        return p + (__builtin_ctzll(others) >> 2);
+      p += 16;
+    }
+    return ByteScanner::skipSpaces(p, end);
+  }
+
+  static const char* skipStringChars(const char* p, const char* end,
+                                     char quote) {
+    const uint8x16_t quotes = vdupq_n_u8(static_cast<uint8_t>(quote));
+    const uint8x16_t backslashes = vdupq_n_u8('\\');
+    const uint8x16_t zeros = vdupq_n_u8(0);
+    while (end - p >= 16) {
+      uint8x16_t x = load(p);
+      uint8x16_t stops =
+          vorrq_u8(vorrq_u8(vceqq_u8(x, quotes), vceqq_u8(x, backslashes)),
+                   vceqq_u8(x, zeros));
+      uint64_t mask = nibbles(stops);
+      if (mask)
+        return p + (__builtin_ctzll(mask) >> 2);
+      p += 16;
+    }
+    return ByteScanner::skipStringChars(p, end, quote);
+  }
+};
+typedef NeonScanner BlockScanner;
+
+#elif defined(__AVR)
+// Words don't pay on an 8-bit CPU
+typedef ByteScanner BlockScanner;
+
+#else
+typedef WordScanner BlockScanner;
+#endif
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
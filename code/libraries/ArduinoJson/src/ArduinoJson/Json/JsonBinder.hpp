@@ -0,0 +1,159 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Binding/StructBinding.hpp>
+#include <ArduinoJson/Json/JsonParser.hpp>
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// A parseJson() handler that writes the values straight into the bound
+// members, and skips everything else
+class StructBinder {
+ public:
+  StructBinder(void* target, const TypeBinding* type)
+      : target_(static_cast<char*>(target)), type_(type), depth_(0) {}
+
+  bool startObject() {
+    if (type_ && type_->members)
+      push(target_, type_, &type_->members());
+    else
+      push(0, 0, 0);
+    target_ = 0;
+    type_ = 0;
+    return true;
+  }
+
+  bool key(JsonString key) {
+    Frame* frame = top();
+    const MemberBinding* member =
+        frame && frame->members ? frame->members->find(key) : 0;
+    if (member) {
+      target_ = static_cast<char*>(member->address(frame->target));
+      type_ = member->type;
+    } else {
+      target_ = 0;
+      type_ = 0;
+    }
+    return true;
+  }
+
+  bool endObject() {
+    return pop();
+  }
+
+  bool startArray() {
+    if (type_ && type_->element) {
+      push(target_, type_, 0);
+      if (top() && type_->elementCount > 0) {
+        type_ = type_->element;
+        return true;
+      }
+    } else {
+      push(0, 0, 0);
+    }
+    target_ = 0;
+    type_ = 0;
+    return true;
+  }
+
+  bool endArray() {
+    return pop();
+  }
+
+  bool value(JsonVariantConst value) {
+    if (type_)
+      type_->fromJson(value, target_);
+    next();
+    return true;
+  }
+
+ private:
+  struct Frame {
+    char* target;
+    const TypeBinding* type;
+    const StructBinding* members;
+    size_t index;
+  };
+
+  // The frames deeper than the stack are skipped
+  Frame* top() {
+    return depth_ > 0 && depth_ <= maxDepth ? &stack_[depth_ - 1] : 0;
+  }
+
+  void push(char* target, const TypeBinding* type,
+            const StructBinding* members) {
+    depth_++;
+    Frame* frame = top();
+    if (!frame)
+      return;
+    frame->target = target;
+    frame->type = type;
+    frame->members = members;
+    frame->index = 0;
+  }
+
+  bool pop() {
+    depth_--;
+    next();
+    return true;
+  }
+
+  // Moves to the next element of the array, if any
+  void next() {
+    target_ = 0;
+    type_ = 0;
+    Frame* frame = top();
+    if (!frame || !frame->type || !frame->type->element)
+      return;
+    frame->index++;
+    if (frame->index < frame->type->elementCount) {
+      target_ = frame->target + frame->index * frame->type->elementSize;
+      type_ = frame->type->element;
+    }
+  }
+
+  static const size_t maxDepth = ARDUINOJSON_DEFAULT_NESTING_LIMIT;
+
+  char* target_;  // where the next value goes, or null to skip it
+  const TypeBinding* type_;
+  size_t depth_;
+  Frame stack_[maxDepth];
+};
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
+
+ARDUINOJSON_BEGIN_PUBLIC_NAMESPACE
+
+// Fills a struct bound with ARDUINOJSON_BIND() (or an array of them) from a
+// JSON input, without a JsonDocument: the values go straight from the parser
+// to the members. The keys that aren't bound are skipped, and so are the
+// values of the wrong type, so the members keep their previous value.
+// The strings are limited to ARDUINOJSON_PARSER_STRING_SIZE, like parseJson().
+template <typename TStream, typename T>
+DeserializationError bindJson(
+    TStream&& input, T& object,
+    DeserializationOption::NestingLimit nestingLimit = {}) {
+  detail::StructBinder binder(&object, &detail::TypeBindingOf<T>::value);
+  return parseJson(detail::forward<TStream>(input), binder, nestingLimit);
+}
+
+template <typename TChar, typename T>
+DeserializationError bindJson(
+    TChar* input, T& object,
+    DeserializationOption::NestingLimit nestingLimit = {}) {
+  detail::StructBinder binder(&object, &detail::TypeBindingOf<T>::value);
+  return parseJson(input, binder, nestingLimit);
+}
+
+template <typename TChar, typename T>
+DeserializationError bindJson(
+    TChar* input, size_t inputSize, T& object,
+    DeserializationOption::NestingLimit nestingLimit = {}) {
+  detail::StructBinder binder(&object, &detail::TypeBindingOf<T>::value);
+  return parseJson(input, inputSize, binder, nestingLimit);
+}
+
+ARDUINOJSON_END_PUBLIC_NAMESPACE
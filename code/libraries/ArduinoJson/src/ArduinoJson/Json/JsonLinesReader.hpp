@@ -0,0 +1,285 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Json/BlockScanner.hpp>
+#include <ArduinoJson/Json/JsonDeserializer.hpp>
+#include <ArduinoJson/Json/Latch.hpp>
+
+#include <string.h>  // memchr
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// The input of JsonLinesReader, one line at a time: the deserializer sees the
+// end of the line as the end of the input. A line ends at '\n' or "\r\n".
+template <typename TReader, bool = IsContiguousReader<TReader>::value>
+class JsonLinesSource {
+ public:
+  JsonLinesSource(TReader reader)
+      : reader_(reader), next_(-1), after_(-1), offset_(0) {}
+
+  // What the deserializer reads: the rest of the line
+  class LineReader {
+   public:
+    LineReader(JsonLinesSource* source) : source_(source) {}
+
+    int read() {
+      return source_->readInLine();
+    }
+
+   private:
+    JsonLinesSource* source_;
+  };
+
+  LineReader line() {
+    return LineReader(this);
+  }
+
+  // Continues where the deserializer stopped
+  void moveTo(const LineReader&) {}
+
+  size_t offset() const {
+    return offset_;
+  }
+
+  bool atEndOfLine() {
+    int c = peek();
+    if (c == '\r')
+      c = peekAfter();
+    return c < 0 || c == '\n';
+  }
+
+  bool atEndOfInput() {
+    return peek() < 0;
+  }
+
+  void skipSpaces() {
+    for (int c = peek(); c == ' ' || c == '\t' || c == '\r'; c = peek()) {
+      if (atEndOfLine())
+        break;
+      take();
+    }
+  }
+
+  // Moves past the next newline
+  void nextLine() {
+    for (int c = peek(); c >= 0; c = peek()) {
+      take();
+      if (c == '\n')
+        break;
+    }
+  }
+
+ private:
+  int readInLine() {
+    if (atEndOfLine())
+      return -1;
+    int c = next_;
+    take();
+    return c;
+  }
+
+  // A stream that timed out may have more to read later
+  int peek() {
+    if (next_ < 0) {
+      next_ = after_ < 0 ? reader_.read() : after_;
+      after_ = -1;
+    }
+    return next_;
+  }
+
+  // Reads the character after the one of peek(), to tell the '\r' of "\r\n"
+  int peekAfter() {
+    if (after_ < 0)
+      after_ = reader_.read();
+    return after_;
+  }
+
+  void take() {
+    next_ = -1;
+    offset_++;
+  }
+
+  TReader reader_;
+  int next_, after_;
+  size_t offset_;
+};
+
+// When the input is in RAM, the line ends are found with memchr(), and the
+// deserializer scans the line in place
+template <typename TReader>
+class JsonLinesSource<TReader, true> {
+ public:
+  typedef IteratorReader<const char*> LineReader;
+
+  JsonLinesSource(TReader reader)
+      : start_(reader.begin()), ptr_(start_), end_(reader.end()) {
+    findLineEnd();
+  }
+
+  LineReader line() const {
+    return LineReader(ptr_, lineEnd_);
+  }
+
+  void moveTo(const LineReader& reader) {
+    ptr_ = reader.begin();
+  }
+
+  size_t offset() const {
+    return size_t(ptr_ - start_);
+  }
+
+  bool atEndOfLine() const {
+    return ptr_ == lineEnd_;
+  }
+
+  bool atEndOfInput() const {
+    return ptr_ == end_;
+  }
+
+  void skipSpaces() {
+    ptr_ = BlockScanner::skipSpaces(ptr_, lineEnd_);
+  }
+
+  void nextLine() {
+    ptr_ = newline_ < end_ ? newline_ + 1 : end_;
+    findLineEnd();
+  }
+
+ private:
+  void findLineEnd() {
+    const void* newline = memchr(ptr_, '\n', size_t(end_ - ptr_));
+    newline_ = newline ? static_cast<const char*>(newline) : end_;
+    lineEnd_ = newline_;
+    if (lineEnd_ > ptr_ && lineEnd_[-1] == '\r')
+      lineEnd_--;
+  }
+
+  const char *start_, *ptr_, *end_, *lineEnd_, *newline_;
+};
+
+// Deserializes the documents of an NDJSON input one after the other, in the
+// same JsonDocument
+template <typename TReader, typename TOptions>
+class JsonLinesReader {
+  typedef JsonLinesSource<TReader> source_type;
+
+ public:
+  JsonLinesReader(JsonDocument& doc, TReader reader, TOptions options)
+      : pool_(VariantAttorney::getPool(doc)),
+        data_(VariantAttorney::getData(doc)),
+        source_(reader),
+        options_(options),
+        offset_(0),
+        size_(0) {}
+
+  DeserializationError next() {
+    pool_->rewind();
+    data_->setNull();
+
+    for (;;) {
+      source_.skipSpaces();
+      if (!source_.atEndOfLine())
+        break;
+      if (source_.atEndOfInput()) {
+        offset_ = source_.offset();
+        size_ = 0;
+        return DeserializationError::EmptyInput;
+      }
+      source_.nextLine();
+    }
+
+    offset_ = source_.offset();
+    JsonDeserializer<typename source_type::LineReader, StringCopier>
+        deserializer(pool_, source_.line(), StringCopier(pool_));
+    DeserializationError err =
+        deserializer.parse(*data_, options_.filter, options_.nestingLimit);
+    source_.moveTo(deserializer.reader());
+    size_ = source_.offset() - offset_;
+
+    if (err)
+      source_.nextLine();
+
+    return err;
+  }
+
+  size_t offset() const {
+    return offset_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  MemoryPool* pool_;
+  VariantData* data_;
+  source_type source_;
+  TOptions options_;
+  size_t offset_, size_;
+};
+
+template <typename TReader, typename TOptions>
+JsonLinesReader<TReader, TOptions> makeJsonLinesReader(JsonDocument& doc,
+                                                       TReader reader,
+                                                       TOptions options) {
+  return JsonLinesReader<TReader, TOptions>(doc, reader, options);
+}
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
+
+ARDUINOJSON_BEGIN_PUBLIC_NAMESPACE
+
+// Reads an NDJSON input (also known as JSON Lines): one document per line,
+// or several on the same line, like {"a":1}{"b":2}. Each call to next()
+// deserializes the next document in the JsonDocument, reusing its memory:
+//
+//   auto lines = readJsonLines(doc, file);
+//   DeserializationError err;
+//   while ((err = lines.next()) != DeserializationError::EmptyInput) {
+//     if (err)
+//       continue;  // the rest of the bad line is skipped
+//     ...
+//   }
+//
+// offset() and size() locate the document in the input. Accepts the same
+// options as deserializeJson(). The input must outlive the reader.
+template <typename TStream, typename... Args,
+          typename = typename detail::enable_if<!detail::is_integral<
+              typename detail::first_or_void<Args...>::type>::value>::type>
+auto readJsonLines(JsonDocument& doc, TStream&& input, Args... args)
+    -> decltype(detail::makeJsonLinesReader(
+        doc, detail::makeReader(detail::forward<TStream>(input)),
+        detail::makeDeserializationOptions(args...))) {
+  using namespace detail;
+  return makeJsonLinesReader(doc, makeReader(detail::forward<TStream>(input)),
+                             makeDeserializationOptions(args...));
+}
+
+template <typename TChar, typename... Args,
+          typename = typename detail::enable_if<!detail::is_integral<
+              typename detail::first_or_void<Args...>::type>::value>::type>
+auto readJsonLines(JsonDocument& doc, TChar* input, Args... args)
+    -> decltype(detail::makeJsonLinesReader(
+        doc, detail::makeReader(input, size_t(0)),
+        detail::makeDeserializationOptions(args...))) {
+  using namespace detail;
+  return makeJsonLinesReader(
+      doc, makeReader(input, strlen(reinterpret_cast<const char*>(input))),
+      makeDeserializationOptions(args...));
+}
+
+template <typename TChar, typename... Args>
+auto readJsonLines(JsonDocument& doc, TChar* input, size_t inputSize,
+                   Args... args)
+    -> decltype(detail::makeJsonLinesReader(
+        doc, detail::makeReader(input, inputSize),
+        detail::makeDeserializationOptions(args...))) {
+  using namespace detail;
+  return makeJsonLinesReader(doc, makeReader(input, inputSize),
+                             makeDeserializationOptions(args...));
+}
+
+ARDUINOJSON_END_PUBLIC_NAMESPACE
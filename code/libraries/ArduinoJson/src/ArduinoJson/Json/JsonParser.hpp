@@ -0,0 +1,279 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Deserialization/Reader.hpp>
+#include <ArduinoJson/Json/JsonTokenizer.hpp>
+#include <ArduinoJson/Polyfills/utility.hpp>
+#include <ArduinoJson/StringStorage/StringStorage.hpp>
+#include <ArduinoJson/Variant/JsonVariantConst.hpp>
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// Walks the JSON input like JsonDeserializer, but passes each token to a
+// handler instead of filling a JsonDocument
+template <typename TReader, typename TStringStorage>
+class JsonParser : JsonTokenizer<TReader, TStringStorage> {
+  typedef JsonTokenizer<TReader, TStringStorage> tokenizer;
+
+ public:
+  JsonParser(TReader reader, TStringStorage stringStorage)
+      : tokenizer(reader, stringStorage), stopped_(false) {}
+
+  template <typename THandler>
+  DeserializationError parse(THandler& handler,
+                             DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+
+    err = skipSpacesAndComments();
+    if (err)
+      return err;
+
+    bool enclosed = current() == '[' || current() == '{';
+
+    err = parseVariant(handler, nestingLimit);
+
+    if (!err && !stopped_ && latch_.last() != 0 && !enclosed &&
+        !value_.isEnclosed()) {
+      // We don't detect trailing characters earlier, so we need to check now
+      return DeserializationError::InvalidInput;
+    }
+
+    return err;
+  }
+
+ private:
+  using tokenizer::current;
+  using tokenizer::eat;
+  using tokenizer::latch_;
+  using tokenizer::move;
+  using tokenizer::parseKey;
+  using tokenizer::parseNumericValue;
+  using tokenizer::parseStringValue;
+  using tokenizer::skipKeyword;
+  using tokenizer::skipSpacesAndComments;
+  using tokenizer::stringStorage_;
+
+  // Records that the handler asked to stop
+  DeserializationError::Code proceed(bool handlerWantsMore) {
+    if (!handlerWantsMore)
+      stopped_ = true;
+    return DeserializationError::Ok;
+  }
+
+  template <typename THandler>
+  DeserializationError::Code parseVariant(
+      THandler& handler, DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+
+    err = skipSpacesAndComments();
+    if (err)
+      return err;
+
+    switch (current()) {
+      case '[':
+        return parseArray(handler, nestingLimit);
+
+      case '{':
+        return parseObject(handler, nestingLimit);
+
+      case '\"':
+      case '\'':
+        err = parseStringValue(value_);
+        break;
+
+      case 't':
+        value_.setBoolean(true);
+        err = skipKeyword("true");
+        break;
+
+      case 'f':
+        value_.setBoolean(false);
+        err = skipKeyword("false");
+        break;
+
+      case 'n':
+        value_.setNull();
+        err = skipKeyword("null");
+        break;
+
+      default:
+        err = parseNumericValue(value_);
+        break;
+    }
+    if (err)
+      return err;
+
+    return proceed(handler.value(JsonVariantConst(&value_)));
+  }
+
+  template <typename THandler>
+  DeserializationError::Code parseArray(
+      THandler& handler, DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+
+    if (nestingLimit.reached())
+      return DeserializationError::TooDeep;
+
+    // Skip opening braket
+    ARDUINOJSON_ASSERT(current() == '[');
+    move();
+
+    if (!handler.startArray())
+      return proceed(false);
+
+    // Skip spaces
+    err = skipSpacesAndComments();
+    if (err)
+      return err;
+
+    // Empty array?
+    if (eat(']'))
+      return proceed(handler.endArray());
+
+    // Read each value
+    for (;;) {
+      // 1 - Parse value
+      err = parseVariant(handler, nestingLimit.decrement());
+      if (err || stopped_)
+        return err;
+
+      // 2 - Skip spaces
+      err = skipSpacesAndComments();
+      if (err)
+        return err;
+
+      // 3 - More values?
+      if (eat(']'))
+        return proceed(handler.endArray());
+      if (!eat(','))
+        return DeserializationError::InvalidInput;
+    }
+  }
+
+  template <typename THandler>
+  DeserializationError::Code parseObject(
+      THandler& handler, DeserializationOption::NestingLimit nestingLimit) {
+    DeserializationError::Code err;
+
+    if (nestingLimit.reached())
+      return DeserializationError::TooDeep;
+
+    // Skip opening brace
+    ARDUINOJSON_ASSERT(current() == '{');
+    move();
+
+    if (!handler.startObject())
+      return proceed(false);
+
+    // Skip spaces
+    err = skipSpacesAndComments();
+    if (err)
+      return err;
+
+    // Empty object?
+    if (eat('}'))
+      return proceed(handler.endObject());
+
+    // Read each key value pair
+    for (;;) {
+      // Parse key
+      err = parseKey();
+      if (err)
+        return err;
+
+      // Skip spaces
+      err = skipSpacesAndComments();
+      if (err)
+        return err;
+
+      // Colon
+      if (!eat(':'))
+        return DeserializationError::InvalidInput;
+
+      if (!handler.key(stringStorage_.str()))
+        return proceed(false);
+
+      // Parse value
+      err = parseVariant(handler, nestingLimit.decrement());
+      if (err || stopped_)
+        return err;
+
+      // Skip spaces
+      err = skipSpacesAndComments();
+      if (err)
+        return err;
+
+      // More keys/values?
+      if (eat('}'))
+        return proceed(handler.endObject());
+      if (!eat(','))
+        return DeserializationError::InvalidInput;
+
+      // Skip spaces
+      err = skipSpacesAndComments();
+      if (err)
+        return err;
+    }
+  }
+
+  bool stopped_;
+  VariantData value_;
+};
+
+template <typename TReader, typename TStringStorage>
+JsonParser<TReader, TStringStorage> makeJsonParser(
+    TReader reader, TStringStorage stringStorage) {
+  return JsonParser<TReader, TStringStorage>(reader, stringStorage);
+}
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
+
+ARDUINOJSON_BEGIN_PUBLIC_NAMESPACE
+
+// Parses a JSON input and passes each token to the handler, in constant
+// memory and without a JsonDocument. The handler has these functions, each
+// returning false to stop the parsing (which then succeeds):
+//
+//   bool startObject();
+//   bool key(JsonString key);
+//   bool endObject();
+//   bool startArray();
+//   bool endArray();
+//   bool value(JsonVariantConst value);  // string, number, boolean, or null
+//
+// The key and the value are only valid during the call. Strings longer than
+// ARDUINOJSON_PARSER_STRING_SIZE fail with NoMemory, unless the input is a
+// writable char*, in which case they are decoded in place.
+template <typename TStream, typename THandler>
+DeserializationError parseJson(
+    TStream&& input, THandler& handler,
+    DeserializationOption::NestingLimit nestingLimit = {}) {
+  using namespace detail;
+  return makeJsonParser(makeReader(detail::forward<TStream>(input)),
+                        makeStringStorage(input))
+      .parse(handler, nestingLimit);
+}
+
+template <typename TChar, typename THandler>
+DeserializationError parseJson(
+    TChar* input, THandler& handler,
+    DeserializationOption::NestingLimit nestingLimit = {}) {
+  using namespace detail;
+  return makeJsonParser(makeReader(input), makeStringStorage(input))
+      .parse(handler, nestingLimit);
+}
+
+template <typename TChar, typename THandler>
+DeserializationError parseJson(
+    TChar* input, size_t inputSize, THandler& handler,
+    DeserializationOption::NestingLimit nestingLimit = {}) {
+  using namespace detail;
+  return makeJsonParser(makeReader(input, inputSize),
+                        makeStringStorage(input))
+      .parse(handler, nestingLimit);
+}
+
+ARDUINOJSON_END_PUBLIC_NAMESPACE
@@ -5,9 +5,20 @@
 #pragma once
 
 #include <ArduinoJson/Polyfills/assert.hpp>
+#include <ArduinoJson/Polyfills/type_traits.hpp>
 
 ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 
+// Readers whose begin() and end() delimit the unread characters in RAM
+template <typename TReader, typename = void>
+struct IsContiguousReader : false_type {};
+
+template <typename TReader>
+struct IsContiguousReader<
+    TReader,
+    typename enable_if<is_same<decltype(declval<const TReader>().begin()),
+                               const char*>::value>::type> : true_type {};
+
 template <typename TReader>
 class Latch {
  public:
@@ -25,6 +36,11 @@ class Latch {
     return current_;
   }
 
+  // Past the current character, if loaded
+  const TReader& reader() const {
+    return reader_;
+  }
+
   FORCE_INLINE char current() {
     if (!loaded_) {
       load();
@@ -32,7 +48,40 @@ class Latch {
     return current_;
   }
 
+  // The characters from the current one to end, when the reader holds them
+  // in RAM. Returns null for the other readers, or at the end of the input.
+  FORCE_INLINE const char* peek(const char*& end) {
+    return peek(end, IsContiguousReader<TReader>());
+  }
+
+  // Moves to a character returned by peek()
+  FORCE_INLINE void seek(const char* ptr) {
+    seek(ptr, IsContiguousReader<TReader>());
+  }
+
  private:
+  const char* peek(const char*&, false_type) {
+    return 0;
+  }
+
+  const char* peek(const char*& end, true_type) {
+    const char* ptr = reader_.begin();
+    if (loaded_) {
+      if (!current_)
+        return 0;
+      ptr--;  // the reader is past the current character
+    }
+    end = reader_.end();
+    return ptr;
+  }
+
+  void seek(const char*, false_type) {}
+
+  void seek(const char* ptr, true_type) {
+    reader_.seek(ptr);
+    loaded_ = false;
+  }
+
   void load() {
     ARDUINOJSON_ASSERT(!ended_);
     int c = reader_.read();
@@ -10,6 +10,7 @@
 #include <ArduinoJson/Json/EscapeSequence.hpp>
 #include <ArduinoJson/Numbers/FloatParts.hpp>
 #include <ArduinoJson/Numbers/JsonInteger.hpp>
+#include <ArduinoJson/Numbers/ShortestFloat.hpp>
 #include <ArduinoJson/Polyfills/assert.hpp>
 #include <ArduinoJson/Polyfills/attributes.hpp>
 #include <ArduinoJson/Polyfills/type_traits.hpp>
@@ -87,6 +88,9 @@ class TextFormatter {
     }
 #endif
 
+#if ARDUINOJSON_ENABLE_SHORTEST_FLOAT
+    writeShortestFloat(value);
+#else
     FloatParts<T> parts(value);
 
     writeInteger(parts.integral);
@@ -97,6 +101,43 @@ class TextFormatter {
       writeRaw('e');
       writeInteger(parts.exponent);
     }
+#endif
+  }
+
+  // Writes a finite positive value with the exponent thresholds of
+  // writeFloat(), but all the digits needed to read it back
+  template <typename T>
+  void writeShortestFloat(T value) {
+    if (value == 0)
+      return writeRaw('0');
+
+    ShortestFloat<T> parts(value);
+    int length = parts.length;
+    int point = length + parts.exponent;  // digits before the decimal point
+
+    if (value >= ARDUINOJSON_POSITIVE_EXPONENTIATION_THRESHOLD ||
+        value <= ARDUINOJSON_NEGATIVE_EXPONENTIATION_THRESHOLD) {
+      writeRaw(parts.digits[0]);
+      if (length > 1) {
+        writeRaw('.');
+        writeRaw(parts.digits + 1, size_t(length - 1));
+      }
+      writeRaw('e');
+      writeInteger(point - 1);
+    } else if (point <= 0) {
+      writeRaw("0.");
+      for (int i = point; i < 0; i++)
+        writeRaw('0');
+      writeRaw(parts.digits, size_t(length));
+    } else if (point < length) {
+      writeRaw(parts.digits, size_t(point));
+      writeRaw('.');
+      writeRaw(parts.digits + point, size_t(length - point));
+    } else {
+      writeRaw(parts.digits, size_t(length));
+      for (int i = length; i < point; i++)
+        writeRaw('0');
+    }
   }
 
   template <typename T>
@@ -26,6 +26,23 @@
 
 ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 
+// Supplies the pages of a MemoryPool that grows on demand
+struct PageAllocator {
+  PageAllocator(void* (*allocate)(PageAllocator*, size_t),
+                void (*deallocate)(PageAllocator*, void*))
+      : allocatePage(allocate), deallocatePage(deallocate) {}
+
+  void* (*allocatePage)(PageAllocator*, size_t);
+  void (*deallocatePage)(PageAllocator*, void*);
+};
+
+// Header at the beginning of each page.
+// left and right are only up to date once a newer page took over.
+struct MemoryPage {
+  MemoryPage* next;
+  char *begin, *left, *right, *end;
+};
+
 // begin_                                   end_
 // v                                           v
 // +-------------+--------------+--------------+
@@ -33,6 +50,19 @@ ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 // +-------------+--------------+--------------+
 //               ^              ^
 //             left_          right_
+//
+// A pool with a PageAllocator doesn't overflow when this block is full:
+// it continues in a new page, linked from the full ones. The pages are
+// separate allocations, so a slot can't link to a slot of another page by
+// distance: it uses a FarLink instead.
+//
+// firstPage_ ... page_
+//                v
+//                +------+------------+--------+-------------+
+//                | next | strings... | (free) | ...variants |
+//                +------+------------+--------+-------------+
+//                       ^                                   ^
+//                     begin_                              end_
 
 class MemoryPool {
  public:
@@ -41,12 +71,34 @@ class MemoryPool {
         left_(buf),
         right_(buf ? buf + capa : 0),
         end_(buf ? buf + capa : 0),
-        overflowed_(false) {
+        overflowed_(false),
+        allocator_(0),
+        firstPage_(0),
+        page_(0),
+        pageSize_(0) {
     ARDUINOJSON_ASSERT(isAligned(begin_));
     ARDUINOJSON_ASSERT(isAligned(right_));
     ARDUINOJSON_ASSERT(isAligned(end_));
   }
 
+  // Starts with a page of capa bytes, then adds pages of pageSize bytes (or
+  // more for a large string) as needed
+  MemoryPool(PageAllocator* allocator, size_t capa, size_t pageSize)
+      : begin_(0),
+        left_(0),
+        right_(0),
+        end_(0),
+        overflowed_(false),
+        allocator_(allocator),
+        firstPage_(0),
+        page_(0),
+        pageSize_(pageSize) {
+    ARDUINOJSON_ASSERT(allocator != 0);
+    ARDUINOJSON_ASSERT(pageSize > 0);
+    if (capa)
+      addPage(capa);
+  }
+
   void* buffer() {
     return begin_;  // NOLINT(clang-analyzer-unix.Malloc)
                     // movePointers() alters this pointer
@@ -54,11 +106,34 @@ class MemoryPool {
 
   // Gets the capacity of the memoryPool in bytes
   size_t capacity() const {
-    return size_t(end_ - begin_);
+    size_t capa = size_t(end_ - begin_);
+    for (MemoryPage* page = firstPage_; page != page_; page = page->next)
+      capa += size_t(page->end - page->begin);
+    return capa;
   }
 
   size_t size() const {
-    return size_t(left_ - begin_ + end_ - right_);
+    size_t n = size_t(left_ - begin_ + end_ - right_);
+    for (MemoryPage* page = firstPage_; page != page_; page = page->next)
+      n += size_t(page->left - page->begin + page->end - page->right);
+    return n;
+  }
+
+  // Returns the size of the pages added when full, 0 if the pool can't grow
+  size_t pageSize() const {
+    return pageSize_;
+  }
+
+  void setPageAllocator(PageAllocator* allocator) {
+    ARDUINOJSON_ASSERT(pageSize_ > 0);
+    allocator_ = allocator;
+  }
+
+  // Returns all the pages to the allocator
+  void freePages() {
+    freePagesFrom(firstPage_);
+    firstPage_ = page_ = 0;
+    begin_ = left_ = right_ = end_ = 0;
   }
 
   bool overflowed() const {
@@ -69,6 +144,17 @@ class MemoryPool {
     return allocRight<VariantSlot>();
   }
 
+  // Allocates whole slots next to the variants, for data that the document
+  // can do without: doesn't mark the pool as overflowed on failure
+  void* allocAligned(size_t bytes) {
+    bytes = (bytes + sizeof(VariantSlot) - 1) / sizeof(VariantSlot) *
+            sizeof(VariantSlot);
+    if (!canAlloc(bytes) && !grow(bytes))
+      return 0;
+    right_ -= bytes;
+    return right_;
+  }
+
   template <typename TAdaptedString>
   const char* saveString(TAdaptedString str) {
     if (str.isNull())
@@ -95,6 +181,17 @@ class MemoryPool {
     *zoneSize = size_t(right_ - left_);
   }
 
+  // Moves the string being written in the free zone to a new page, when it
+  // outgrows the current one
+  bool growFreeZone(char** zoneStart, size_t* zoneSize, size_t used) {
+    ARDUINOJSON_ASSERT(*zoneStart == left_);
+    if (!grow(used * 2 + 2))
+      return false;
+    memcpy(left_, *zoneStart, used);
+    getFreeZone(zoneStart, zoneSize);
+    return true;
+  }
+
   const char* saveStringFromFreeZone(size_t len) {
 #if ARDUINOJSON_ENABLE_STRING_DEDUPLICATION
     const char* dup = findString(adaptString(left_, len));
@@ -113,7 +210,28 @@ class MemoryPool {
     overflowed_ = true;
   }
 
+  // Keeps only the first page, if any
   void clear() {
+    if (firstPage_) {
+      freePagesFrom(firstPage_->next);
+      firstPage_->next = 0;
+      page_ = firstPage_;
+      begin_ = page_->begin;
+      end_ = page_->end;
+    }
+    left_ = begin_;
+    right_ = end_;
+    overflowed_ = false;
+  }
+
+  // Like clear(), but keeps the pages to fill them again, for a series of
+  // documents of similar sizes
+  void rewind() {
+    if (firstPage_) {
+      page_ = firstPage_;
+      begin_ = page_->begin;
+      end_ = page_->end;
+    }
     left_ = begin_;
     right_ = end_;
     overflowed_ = false;
@@ -123,10 +241,21 @@ class MemoryPool {
     return left_ + bytes <= right_;
   }
 
-  bool owns(void* p) const {
+  // Tells if p is in the block where the next variants go
+  bool inCurrentBlock(const void* p) const {
     return begin_ <= p && p < end_;
   }
 
+  bool owns(void* p) const {
+    if (begin_ <= p && p < end_)
+      return true;
+    for (MemoryPage* page = firstPage_; page != page_; page = page->next) {
+      if (page->begin <= p && p < page->end)
+        return true;
+    }
+    return false;
+  }
+
   // Workaround for missing placement new
   void* operator new(size_t, void* p) {
     return p;
@@ -174,11 +303,76 @@ class MemoryPool {
     ARDUINOJSON_ASSERT(isAligned(right_));
   }
 
+  void freePagesFrom(MemoryPage* page) {
+    while (page) {
+      MemoryPage* next = page->next;
+      allocator_->deallocatePage(allocator_, page);
+      page = next;
+    }
+  }
+
+  // Continues in a new page with room for at least the specified bytes
+  bool grow(size_t bytes) {
+    if (!allocator_)
+      return false;
+    if (page_ && page_->next) {  // kept by rewind()
+      MemoryPage* page = page_->next;
+      if (size_t(page->end - page->begin) >= bytes) {
+        page_->left = left_;
+        page_->right = right_;
+        page_ = page;
+        begin_ = left_ = page->begin;
+        end_ = right_ = page->end;
+        return true;
+      }
+      freePagesFrom(page);
+      page_->next = 0;
+    }
+    return addPage(bytes > pageSize_ ? bytes : pageSize_);
+  }
+
+  bool addPage(size_t capa) {
+    capa = addPadding(capa);
+    void* mem = allocator_->allocatePage(allocator_, sizeof(MemoryPage) + capa);
+    if (!mem)
+      return false;
+
+    MemoryPage* page = static_cast<MemoryPage*>(mem);
+    page->next = 0;
+    if (page_) {
+      page_->left = left_;
+      page_->right = right_;
+      page_->next = page;
+    } else {
+      firstPage_ = page;
+    }
+    page_ = page;
+
+    char* buf = static_cast<char*>(mem) + sizeof(MemoryPage);
+    begin_ = left_ = page->begin = buf;
+    end_ = right_ = page->end = buf + capa;
+    checkInvariants();
+    return true;
+  }
+
 #if ARDUINOJSON_ENABLE_STRING_DEDUPLICATION
   template <typename TAdaptedString>
   const char* findString(const TAdaptedString& str) const {
+    // Oldest first, like in a single block, as that's where the common keys
+    // are
+    for (MemoryPage* page = firstPage_; page != page_; page = page->next) {
+      const char* existing = findString(str, page->begin, page->left);
+      if (existing)
+        return existing;
+    }
+    return findString(str, begin_, left_);
+  }
+
+  template <typename TAdaptedString>
+  static const char* findString(const TAdaptedString& str, char* begin,
+                                char* left) {
     size_t n = str.size();
-    for (char* next = begin_; next + n < left_; ++next) {
+    for (char* next = begin; next + n < left; ++next) {
       if (next[n] == '\0' && stringEquals(str, adaptString(next, n)))
         return next;
 
@@ -191,7 +385,7 @@ class MemoryPool {
 #endif
 
   char* allocString(size_t n) {
-    if (!canAlloc(n)) {
+    if (!canAlloc(n) && !grow(n)) {
       overflowed_ = true;
       return 0;
     }
@@ -207,7 +401,7 @@ class MemoryPool {
   }
 
   void* allocRight(size_t bytes) {
-    if (!canAlloc(bytes)) {
+    if (!canAlloc(bytes) && !grow(bytes)) {
       overflowed_ = true;
       return 0;
     }
@@ -217,6 +411,9 @@ class MemoryPool {
 
   char *begin_, *left_, *right_, *end_;
   bool overflowed_;
+  PageAllocator* allocator_;
+  MemoryPage *firstPage_, *page_;
+  size_t pageSize_;
 };
 
 template <typename TAdaptedString, typename TCallback>
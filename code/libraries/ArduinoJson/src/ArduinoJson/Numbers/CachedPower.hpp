@@ -0,0 +1,131 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Polyfills/assert.hpp>
+#include <ArduinoJson/Polyfills/pgmspace_generic.hpp>
+
+#include <stdint.h>
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// A power of ten, normalized and truncated to 128 bits:
+// 10^decimalExponent = (hi + lo / 2^64) * 2^binaryExponent, with an error
+// smaller than one unit of lo; 10^0 to 10^48 are exact.
+// Shared by the parser (which needs the 128 bits) and ShortestFloat (which
+// rounds to the 64 high bits).
+struct CachedPower {
+  static const int minExponent = -344;
+  static const int maxExponent = 328;
+  static const int step = 8;
+
+  uint64_t hi;
+  uint64_t lo;
+  int decimalExponent;
+  int binaryExponent;
+
+  // Returns 10^(minExponent + index * step)
+  CachedPower(int index) {
+    ARDUINOJSON_DEFINE_PROGMEM_ARRAY(  //
+        uint32_t, powers,
+        {
+            0x98EE4A22, 0xECF3188B, 0x9028BED2, 0x939A635C,  // 1e-344
+            0xE3E27A44, 0x4D8D98B7, 0xFD1B1B23, 0x08169B25,  // 1e-336
+            0xA9C98D8C, 0xCB009506, 0x680EFDAF, 0x511F18C2,  // 1e-328
+            0xFD00B897, 0x478238D0, 0x8920B098, 0x955522B4,  // 1e-320
+            0xBC807527, 0xED3E12BC, 0xC6050837, 0x04F5ECF2,  // 1e-312
+            0x8C71DCD9, 0xBA0B4925, 0x9FF0C08B, 0x7F1D0B14,  // 1e-304
+            0xD1476E2C, 0x07286FAA, 0x1AF5AF66, 0x0DB4AEE1,  // 1e-296
+            0x9BECCE62, 0x836AC577, 0x4EE367F9, 0x430AEC32,  // 1e-288
+            0xE858AD24, 0x8F5C22C9, 0xD1B3400F, 0x8F9CFF68,  // 1e-280
+            0xAD1C8EAB, 0x5EE43B66, 0xDA324365, 0x0005EECF,  // 1e-272
+            0x80FA687F, 0x881C7F8E, 0x7CE66634, 0xBC9D0B99,  // 1e-264
+            0xC0314325, 0x637A1939, 0xFA911155, 0xFEFB5308,  // 1e-256
+            0x8F31CC09, 0x37AE58D2, 0xD1B2ECB8, 0xB0908810,  // 1e-248
+            0xD5605FCD, 0xCF32E1D6, 0xFB1E4A9A, 0x90880A64,  // 1e-240
+            0x9EFA548D, 0x26E5A6E1, 0xC47BC501, 0x4A1A6DAF,  // 1e-232
+            0xECE53CEC, 0x4A314EBD, 0xA4F8BF56, 0x35246428,  // 1e-224
+            0xB080392C, 0xC4349DEC, 0xBD8D794D, 0x96AACFB3,  // 1e-216
+            0x8380DEA9, 0x3DA4BC60, 0x4247CB9E, 0x59F71E6D,  // 1e-208
+            0xC3F490AA, 0x77BD60FC, 0xBEDBFC44, 0x11068A9C,  // 1e-200
+            0x91FF8377, 0x5423CC06, 0x7B6306A3, 0x4627DDCF,  // 1e-192
+            0xD98DDAEE, 0x19068C76, 0x3BADD624, 0xDD9B0957,  // 1e-184
+            0xA21727DB, 0x38CB002F, 0xB8ADA00E, 0x5A506A7C,  // 1e-176
+            0xF18899B1, 0xBC3F8CA1, 0xDC44E6C3, 0xCB279AC1,  // 1e-168
+            0xB3F4E093, 0xDB73A093, 0x59ED2167, 0x65690F56,  // 1e-160
+            0x8613FD01, 0x45877585, 0xBD06742C, 0xE95F5F36,  // 1e-152
+            0xC7CABA6E, 0x7C5382C8, 0xFE64A52E, 0xE96B8FC0,  // 1e-144
+            0x94DB4838, 0x40B717EF, 0xA8C2A44E, 0xB4571CDC,  // 1e-136
+            0xDDD0467C, 0x64BCE4A0, 0xAC7CB3F6, 0xD05DDBDE,  // 1e-128
+            0xA54394FE, 0x1EEDB8FE, 0xC2974EB4, 0xEE658828,  // 1e-120
+            0xF64335BC, 0xF065D37D, 0x4D4617B5, 0xFF4A16D5,  // 1e-112
+            0xB77ADA06, 0x17E3BBCB, 0x09CE6EBB, 0x40173744,  // 1e-104
+            0x88B402F7, 0xFD75539B, 0x11DBCB02, 0x18EBB414,  // 1e-96
+            0xCBB41EF9, 0x79346BCA, 0x4F2B40A0, 0x3AD2FFB9,  // 1e-88
+            0x97C560BA, 0x6B0919A5, 0xDCCD879F, 0xC967D41A,  // 1e-80
+            0xE2280B6C, 0x20DD5232, 0x25C6DA63, 0xC38DE1B0,  // 1e-72
+            0xA87FEA27, 0xA539E9A5, 0x3F2398D7, 0x47B36224,  // 1e-64
+            0xFB158592, 0xBE068D2E, 0xEED6E2F0, 0xF0D56712,  // 1e-56
+            0xBB127C53, 0xB17EC159, 0x5560C018, 0x580D5D52,  // 1e-48
+            0x8B61313B, 0xBABCE2C6, 0x2323AC4B, 0x3B3DA015,  // 1e-40
+            0xCFB11EAD, 0x453994BA, 0x67DE18ED, 0xA5814AF2,  // 1e-32
+            0x9ABE14CD, 0x44753B52, 0xC4926A96, 0x72793542,  // 1e-24
+            0xE69594BE, 0xC44DE15B, 0x4C2EBE68, 0x7989A9B3,  // 1e-16
+            0xABCC7711, 0x8461CEFC, 0xFDC20D2B, 0x36BA7C3D,  // 1e-8
+            0x80000000, 0x00000000, 0x00000000, 0x00000000,  // 1e0
+            0xBEBC2000, 0x00000000, 0x00000000, 0x00000000,  // 1e8
+            0x8E1BC9BF, 0x04000000, 0x00000000, 0x00000000,  // 1e16
+            0xD3C21BCE, 0xCCEDA100, 0x00000000, 0x00000000,  // 1e24
+            0x9DC5ADA8, 0x2B70B59D, 0xF0200000, 0x00000000,  // 1e32
+            0xEB194F8E, 0x1AE525FD, 0x5DCFAB08, 0x00000000,  // 1e40
+            0xAF298D05, 0x0E4395D6, 0x9670B12B, 0x7F410000,  // 1e48
+            0x82818F12, 0x81ED449F, 0xBFF8F10E, 0x7A8921A4,  // 1e56
+            0xC2781F49, 0xFFCFA6D5, 0x3CBF6B71, 0xC76B25FB,  // 1e64
+            0x90E40FBE, 0xEA1D3A4A, 0xBC8955E9, 0x46FE31CD,  // 1e72
+            0xD7E77A8F, 0x87DAF7FB, 0xDC33745E, 0xC97BE906,  // 1e80
+            0xA0DC75F1, 0x778E39D6, 0x696361AE, 0x3DB1C721,  // 1e88
+            0xEFB3AB16, 0xC59B14A2, 0xC5CFE94E, 0xF3EA101E,  // 1e96
+            0xB2977EE3, 0x00C50FE7, 0x58EDEC91, 0xEC2CB657,  // 1e104
+            0x850FADC0, 0x9923329E, 0x03E2CF6B, 0xC604DDB0,  // 1e112
+            0xC646D635, 0x01A1511D, 0xB281E1FD, 0x541501B8,  // 1e120
+            0x93BA47C9, 0x80E98CDF, 0xC66F336C, 0x36B10137,  // 1e128
+            0xDC21A117, 0x1D42645D, 0x76707543, 0xF4FA1F73,  // 1e136
+            0xA402B9C5, 0xA8D3A6E7, 0x5F16206C, 0x9C6209A6,  // 1e144
+            0xF46518C2, 0xEF5B8CD1, 0x7EB25866, 0x5FC25D69,  // 1e152
+            0xB616A12B, 0x7FE617AA, 0x577B986B, 0x314D6009,  // 1e160
+            0x87AA9AFF, 0x79042286, 0x90FB44D2, 0xF05D0842,  // 1e168
+            0xCA28A291, 0x859BBF93, 0x7D7B8F75, 0x03CFDCFE,  // 1e176
+            0x969EB7C4, 0x7859E743, 0x9F644AE5, 0xA4B1B325,  // 1e184
+            0xE070F78D, 0x3927556A, 0x85BBE253, 0xF47B1417,  // 1e192
+            0xA738C6BE, 0xBB12D16C, 0xB428F8AC, 0x016561DB,  // 1e200
+            0xF92E0C35, 0x37826145, 0xA7709A56, 0xCCDF8A82,  // 1e208
+            0xB9A74A06, 0x37CE2EE1, 0x6D953E2B, 0xD7173692,  // 1e216
+            0x8A5296FF, 0xE33CC92F, 0x82BD6B70, 0xD99AAA6F,  // 1e224
+            0xCE1DE406, 0x42E3F4B9, 0x36251260, 0xAB9D668E,  // 1e232
+            0x9991A6F3, 0xD6BF1765, 0xACCA6DA1, 0xE0A8EF29,  // 1e240
+            0xE4D5E823, 0x92A40515, 0x0FABAF3F, 0xEAA5334A,  // 1e248
+            0xAA7EEBFB, 0x9DF9DE8D, 0xDDBB901B, 0x98FEEAB7,  // 1e256
+            0xFE0EFB53, 0xD30DD4D7, 0xED238CD3, 0x83AA0110,  // 1e264
+            0xBD49D14A, 0xA79DBC82, 0x4B2D8644, 0xD8A74E18,  // 1e272
+            0x8D07E334, 0x55637EB2, 0xDB0B487B, 0x6423E1E8,  // 1e280
+            0xD226FC19, 0x5C6A2F8C, 0x73832EEC, 0x6FFF3111,  // 1e288
+            0x9C935E00, 0xD4B9D8D2, 0x6ED1BF9A, 0x569F33D3,  // 1e296
+            0xE950DF20, 0x247C83FD, 0x47C6B82E, 0xF32A2069,  // 1e304
+            0xADD57A27, 0xD29339F6, 0x79C5DB9A, 0xF1F9B563,  // 1e312
+            0x81842F29, 0xF2CCE375, 0xE6A11583, 0x00D46640,  // 1e320
+            0xC0FE9088, 0x95CF3B44, 0x505F522E, 0x53053FF2,  // 1e328
+        });
+    ARDUINOJSON_ASSERT(index >= 0 &&
+                       index <= (maxExponent - minExponent) / step);
+    pgm_ptr<uint32_t> table(powers + 4 * index);
+    hi = (uint64_t(table[0]) << 32) | table[1];
+    lo = (uint64_t(table[2]) << 32) | table[3];
+    decimalExponent = minExponent + index * step;
+    // floor(decimalExponent * log2(10)) - 63
+    binaryExponent = ((decimalExponent * 1741647) >> 19) - 63;
+  }
+};
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
@@ -0,0 +1,246 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Numbers/CachedPower.hpp>
+#include <ArduinoJson/Numbers/FloatTraits.hpp>
+#include <ArduinoJson/Polyfills/alias_cast.hpp>
+#include <ArduinoJson/Polyfills/assert.hpp>
+#include <ArduinoJson/Polyfills/pgmspace_generic.hpp>
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// The shortest decimal that reads back as the same float: value is
+// digits * 10^exponent. Uses Grisu2 (Florian Loitsch, "Printing
+// Floating-Point Numbers Quickly and Accurately with Integers", 2010), which
+// always round-trips and gives the shortest digits in almost every case.
+template <typename TFloat>
+struct ShortestFloat {
+  char digits[18];
+  int8_t length;
+  int16_t exponent;
+
+  ShortestFloat(TFloat value) : length(0), exponent(0) {
+    ARDUINOJSON_ASSERT(value > 0);
+    if (fewDecimals(value))
+      return;
+
+    typedef FloatTraits<TFloat> traits;
+    typedef typename traits::mantissa_type bits_type;
+    const int precision = traits::mantissa_bits + 1;  // with the hidden bit
+    const int bias = (sizeof(TFloat) == 8 ? 1023 : 127) + precision - 1;
+    const uint64_t hiddenBit = uint64_t(1) << (precision - 1);
+
+    bits_type bits = alias_cast<bits_type>(value);
+    uint64_t f = uint64_t(bits) & (hiddenBit - 1);
+    int e = int(bits >> (precision - 1));
+
+    // the value and the halfway points to its neighbors
+    Fp v = e ? Fp(f + hiddenBit, e - bias) : Fp(f, 1 - bias);
+    Fp plus = Fp(2 * v.f + 1, v.e - 1).normalized();
+    Fp minus = f == 0 && e > 1 ? Fp(4 * v.f - 1, v.e - 2)
+                               : Fp(2 * v.f - 1, v.e - 1);
+    minus = Fp(minus.f << (minus.e - plus.e), plus.e);
+    v = v.normalized();
+
+    // scale by a power of ten so the exponent lands in [-60, -32]
+    int power;
+    Fp c = cachedPower(plus.e, power);
+    Fp w = v * c;
+    Fp high = plus * c;
+    Fp low = minus * c;
+    // stay inside the interval despite the rounding of the multiplications
+    high.f--;
+    low.f++;
+    exponent = int16_t(-power);
+
+    generateDigits(low, w, high);
+  }
+
+ private:
+  // Fast path for the usual readings, like 1234.567: finds the fewest decimal
+  // places d such that round(value * 10^d) / 10^d gives back value. Both terms
+  // are exact, so the division rounds like strtod() would.
+  bool fewDecimals(TFloat value) {
+    typedef FloatTraits<TFloat> traits;
+    const TFloat limit = TFloat(uint64_t(1) << traits::mantissa_bits);
+    if (value < 1)
+      return false;
+    TFloat scale = 1;
+    for (int d = 0; value * scale < limit; d++, scale *= 10) {
+      uint64_t m = uint64_t(value * scale + TFloat(0.5));
+      if (TFloat(m) / scale != value)
+        continue;
+      exponent = int16_t(-d);
+      while (m % 10 == 0) {
+        m /= 10;
+        exponent++;
+      }
+      char buffer[20];
+      char* end = buffer + sizeof(buffer);
+      char* begin = end;
+      do {
+        *--begin = char('0' + m % 10);
+        m /= 10;
+      } while (m);
+      while (begin < end)
+        digits[length++] = *begin++;
+      return true;
+    }
+    return false;
+  }
+
+  // A floating-point number with a 64-bit significand: f * 2^e
+  struct Fp {
+    uint64_t f;
+    int e;
+
+    Fp(uint64_t f_, int e_) : f(f_), e(e_) {}
+
+    Fp normalized() const {
+      Fp x = *this;
+      while (!(x.f >> 63)) {
+        x.f <<= 1;
+        x.e--;
+      }
+      return x;
+    }
+
+    // Keeps the 64 high bits of the product, rounded
+    Fp operator*(const Fp& y) const {
+      uint64_t a = f >> 32, b = f & 0xFFFFFFFF;
+      uint64_t c = y.f >> 32, d = y.f & 0xFFFFFFFF;
+      uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+      uint64_t mid = (bd >> 32) + (ad & 0xFFFFFFFF) + (bc & 0xFFFFFFFF);
+      mid += uint64_t(1) << 31;
+      return Fp(ac + (ad >> 32) + (bc >> 32) + (mid >> 32), e + y.e + 64);
+    }
+  };
+
+  // Returns 10^power, such that the exponent of 10^power * 2^e is in
+  // [-60, -32]
+  static Fp cachedPower(int e, int& power) {
+    ARDUINOJSON_ASSERT(e >= -1137 && e <= 960);
+
+    // ceil((-61 - e) * log10(2))
+    int x = -61 - e;
+    int decimal = (x * 78913) / (1 << 18) + (x > 0);
+    const int step = CachedPower::step;
+    CachedPower cached((decimal - CachedPower::minExponent + step - 1) / step);
+
+    power = cached.decimalExponent;
+    // rounded to 64 bits
+    return Fp(cached.hi + (cached.lo >> 63), cached.binaryExponent);
+  }
+
+  void generateDigits(Fp low, Fp w, Fp high) {
+    uint64_t delta = high.f - low.f;
+    uint64_t distance = high.f - w.f;
+
+    Fp one(uint64_t(1) << -high.e, high.e);
+    uint32_t integral = uint32_t(high.f >> -one.e);
+    uint64_t fractional = high.f & (one.f - 1);
+
+    int n = 10;  // digits in the integral part
+    while (n > 1 && integral < powerOf10(n - 1))
+      n--;
+
+    while (n > 0) {
+      n--;
+      digits[length++] = char('0' + splitDigit(integral, n));
+      uint64_t rest = (uint64_t(integral) << -one.e) + fractional;
+      if (rest <= delta) {
+        exponent = int16_t(exponent + n);
+        roundLastDigit(distance, delta, rest,
+                       uint64_t(powerOf10(n)) << -one.e);
+        return;
+      }
+    }
+
+    int m = 0;
+    for (;;) {
+      fractional *= 10;
+      digits[length++] = char('0' + (fractional >> -one.e));
+      fractional &= one.f - 1;
+      m++;
+      delta *= 10;
+      distance *= 10;
+      if (fractional <= delta)
+        break;
+    }
+    exponent = int16_t(exponent - m);
+    roundLastDigit(distance, delta, fractional, one.f);
+  }
+
+  static uint32_t powerOf10(int n) {
+    ARDUINOJSON_DEFINE_PROGMEM_ARRAY(
+        uint32_t, powers,
+        {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+         1000000000});
+    return pgm_ptr<uint32_t>(powers)[n];
+  }
+
+  // Returns x / 10^n and leaves x % 10^n; with constant divisors, the
+  // compiler replaces the divisions with multiplications
+  static uint32_t splitDigit(uint32_t& x, int n) {
+    uint32_t digit;
+    switch (n) {
+      case 9:
+        digit = x / 1000000000;
+        x %= 1000000000;
+        break;
+      case 8:
+        digit = x / 100000000;
+        x %= 100000000;
+        break;
+      case 7:
+        digit = x / 10000000;
+        x %= 10000000;
+        break;
+      case 6:
+        digit = x / 1000000;
+        x %= 1000000;
+        break;
+      case 5:
+        digit = x / 100000;
+        x %= 100000;
+        break;
+      case 4:
+        digit = x / 10000;
+        x %= 10000;
+        break;
+      case 3:
+        digit = x / 1000;
+        x %= 1000;
+        break;
+      case 2:
+        digit = x / 100;
+        x %= 100;
+        break;
+      case 1:
+        digit = x / 10;
+        x %= 10;
+        break;
+      default:
+        digit = x;
+        x = 0;
+        break;
+    }
+    return digit;
+  }
+
+  // Moves the last digit closer to w while staying in the interval
+  void roundLastDigit(uint64_t distance, uint64_t delta, uint64_t rest,
+                      uint64_t tenK) {
+    while (rest < distance && delta - rest >= tenK &&
+           (rest + tenK < distance ||
+            distance - rest > rest + tenK - distance)) {
+      digits[length - 1]--;
+      rest += tenK;
+    }
+  }
+};
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
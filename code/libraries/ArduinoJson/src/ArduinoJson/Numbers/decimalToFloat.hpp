@@ -0,0 +1,171 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Numbers/CachedPower.hpp>
+#include <ArduinoJson/Numbers/FloatTraits.hpp>
+#include <ArduinoJson/Polyfills/alias_cast.hpp>
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// Returns the 64 low bits of a * b and puts the 64 high bits in high
+inline uint64_t multiply64(uint64_t a, uint64_t b, uint64_t& high) {
+  uint64_t a0 = a & 0xFFFFFFFF, a1 = a >> 32;
+  uint64_t b0 = b & 0xFFFFFFFF, b1 = b >> 32;
+  uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+  high = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+  return (mid << 32) | (p00 & 0xFFFFFFFF);
+}
+
+// Shifts x left until its highest bit is set, returns the shift
+inline int normalize64(uint64_t& x) {
+  int shift = 0;
+  for (int n = 32; n > 0; n /= 2) {
+    if (!(x >> (64 - n))) {
+      x <<= n;
+      shift += n;
+    }
+  }
+  return shift;
+}
+
+#if ARDUINOJSON_ENABLE_EXACT_FLOAT
+// significand * 10^exponent, computed with 128-bit powers of ten like the
+// Eisel-Lemire algorithm (Daniel Lemire, "Number Parsing at a Gigabyte per
+// Second", 2021). Returns false in the rare cases where the truncated product
+// is too close to a halfway point to decide.
+template <typename TFloat>
+inline bool decimalToFloat128(uint64_t significand, int exponent,
+                              TFloat& result) {
+  typedef FloatTraits<TFloat> traits;
+  typedef typename traits::mantissa_type bits_type;
+  const int precision = traits::mantissa_bits + 1;  // with the hidden bit
+  const int bias = sizeof(TFloat) == 8 ? 1023 : 127;
+
+  int offset = exponent - CachedPower::minExponent;
+  if (offset < 0 || exponent > CachedPower::maxExponent)
+    return false;
+
+  // the table and the products below are exact for small positive powers
+  bool exact = exponent >= 0 && exponent <= 55;  // 5^55 < 2^128
+
+  // 10^exponent = 10^(minExponent + index * step) * 10^(offset % step)
+  CachedPower power(offset / CachedPower::step);
+  uint64_t hi = power.hi, lo = power.lo;
+  int binaryExponent = power.binaryExponent;
+  uint32_t small = 1;
+  for (int i = offset % CachedPower::step; i > 0; i--)
+    small *= 10;
+  if (small > 1) {
+    uint64_t carry, top;
+    uint64_t low = multiply64(lo, small, carry);
+    uint64_t mid = multiply64(hi, small, top) + carry;
+    if (mid < carry)
+      top++;
+    int shift = 64 - normalize64(top);
+    hi = top | (mid >> shift);
+    lo = (mid << (64 - shift)) | (low >> shift);
+    binaryExponent += shift;
+  }
+
+  // Otherwise, the product, truncated three times, is less than 8 units of lo
+  // below the exact value
+  binaryExponent -= normalize64(significand);
+  uint64_t high, carry;
+  exact = multiply64(significand, lo, carry) == 0 && exact;
+  lo = multiply64(significand, hi, high) + carry;
+  if (lo < carry)
+    high++;
+  if (!(high >> 63)) {
+    high = (high << 1) | (lo >> 63);
+    lo <<= 1;
+    binaryExponent--;
+  }
+  // now the value is (high + lo / 2^64) * 2^(binaryExponent + 64)
+
+  int biasedExponent = binaryExponent + 127 + bias;
+  int extra = 64 - precision;  // the bits of high that don't fit
+  if (biasedExponent < 1) {    // subnormal
+    extra += 1 - biasedExponent;
+    biasedExponent = 1;
+    if (extra > 64) {  // less than half the smallest subnormal
+      result = 0;
+      return true;
+    }
+  }
+
+  uint64_t mantissa = extra < 64 ? high >> extra : 0;
+  uint64_t half = uint64_t(1) << (extra - 1);
+  uint64_t rest = high & (2 * half - 1);
+  if (exact) {
+    if (rest == half && !lo)  // ties to even
+      rest = mantissa & 1 ? half + 1 : half - 1;
+  } else {
+    if (lo > ~uint64_t(0) - 8)  // the error could carry into high
+      return false;
+    if (rest == half && !lo)  // could be exactly halfway
+      return false;
+  }
+  if (rest > half || (rest == half && lo))
+    mantissa++;
+
+  // the hidden bit adds one to the exponent, and so does a carry out of the
+  // mantissa
+  uint64_t bits = (uint64_t(biasedExponent - 1) << (precision - 1)) + mantissa;
+  if (bits >= uint64_t(2 * bias + 1) << (precision - 1))
+    result = traits::inf();
+  else
+    result = alias_cast<TFloat>(bits_type(bits));
+  return true;
+}
+#endif
+
+// Returns the float nearest to significand * 10^exponent, or false if it
+// can't tell
+template <typename TFloat>
+inline bool decimalToFloat(uint64_t significand, int exponent,
+                           TFloat& result) {
+  typedef FloatTraits<TFloat> traits;
+  const int precision = traits::mantissa_bits + 1;
+  const int maxExactExponent = sizeof(TFloat) == 8 ? 22 : 10;
+
+  if (significand == 0) {
+    result = 0;
+    return true;
+  }
+
+  // Clinger's fast path: the significand and the power of ten are exact, so
+  // a single multiplication or division rounds correctly
+  if (!(significand >> precision) && exponent >= -maxExactExponent &&
+      exponent <= maxExactExponent) {
+    TFloat power = make_float(TFloat(1), exponent < 0 ? -exponent : exponent);
+    result = exponent < 0 ? TFloat(significand) / power
+                          : TFloat(significand) * power;
+    return true;
+  }
+
+#if ARDUINOJSON_ENABLE_EXACT_FLOAT
+  if (decimalToFloat128(significand, exponent, result))
+    return true;
+
+  // The product is too close to call when the value is exactly
+  // representable, like 2118307621590751.5; significand * 10^-k is then
+  // (significand / 5^k) * 2^-k
+  if (exponent < 0 && exponent >= -27) {  // 5^27 < 2^64
+    uint64_t five = 1;
+    for (int i = exponent; i < 0; i++)
+      five *= 5;
+    if (significand % five == 0) {
+      decimalToFloat128(significand / five, 0, result);
+      result /= TFloat(uint64_t(1) << -exponent);
+      return true;
+    }
+  }
+#endif
+  return false;
+}
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
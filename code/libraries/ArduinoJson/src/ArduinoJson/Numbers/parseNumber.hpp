@@ -6,6 +6,7 @@
 
 #include <ArduinoJson/Numbers/FloatTraits.hpp>
 #include <ArduinoJson/Numbers/convertNumber.hpp>
+#include <ArduinoJson/Numbers/decimalToFloat.hpp>
 #include <ArduinoJson/Polyfills/assert.hpp>
 #include <ArduinoJson/Polyfills/ctype.hpp>
 #include <ArduinoJson/Polyfills/math.hpp>
@@ -59,12 +60,10 @@ inline bool parseNumber(const char* s, VariantData& result) {
 
   while (isdigit(*s)) {
     uint8_t digit = uint8_t(*s - '0');
-    if (mantissa > maxUint / 10)
-      break;
-    mantissa *= 10;
-    if (mantissa > maxUint - digit)
-      break;
-    mantissa += digit;
+    if (mantissa >= maxUint / 10 &&
+        (mantissa > maxUint / 10 || digit > maxUint % 10))
+      break;  // leave the digit for the float below
+    mantissa = mantissa * 10 + digit;
     s++;
   }
 
@@ -82,24 +81,29 @@ inline bool parseNumber(const char* s, VariantData& result) {
     }
   }
 
-  // avoid mantissa overflow
-  while (mantissa > traits::mantissa_max) {
-    mantissa /= 10;
-    exponent_offset++;
-  }
+  // keep up to 19 significant digits, enough to tell any two doubles apart
+  uint64_t significand = mantissa;
+  const uint64_t maxSignificand = (~uint64_t(0) - 9) / 10;
+  bool truncated = false;  // some non-zero digits were dropped
 
-  // remaing digits can't fit in the mantissa
   while (isdigit(*s)) {
-    exponent_offset++;
+    if (significand <= maxSignificand) {
+      significand = significand * 10 + uint8_t(*s - '0');
+    } else {
+      exponent_offset++;
+      truncated |= *s != '0';
+    }
     s++;
   }
 
   if (*s == '.') {
     s++;
     while (isdigit(*s)) {
-      if (mantissa < traits::mantissa_max / 10) {
-        mantissa = mantissa * 10 + uint8_t(*s - '0');
+      if (significand <= maxSignificand) {
+        significand = significand * 10 + uint8_t(*s - '0');
         exponent_offset--;
+      } else {
+        truncated |= *s != '0';
       }
       s++;
     }
@@ -116,9 +120,12 @@ inline bool parseNumber(const char* s, VariantData& result) {
       s++;
     }
 
+    // 20 digits before 1e-324, the smallest subnormal, still make a number
+    const int minExponent = -traits::exponent_max - 36;
     while (isdigit(*s)) {
       exponent = exponent * 10 + (*s - '0');
-      if (exponent + exponent_offset > traits::exponent_max) {
+      if (negative_exponent ? exponent_offset - exponent < minExponent
+                            : exponent + exponent_offset > traits::exponent_max) {
         if (negative_exponent)
           result.setFloat(is_negative ? -0.0f : 0.0f);
         else
@@ -136,8 +143,18 @@ inline bool parseNumber(const char* s, VariantData& result) {
   if (*s != '\0')
     return false;
 
-  JsonFloat final_result =
-      make_float(static_cast<JsonFloat>(mantissa), exponent);
+  // the digits after the 19th can only move the value between significand
+  // and significand + 1
+  JsonFloat final_result, upper;
+  if (!decimalToFloat(significand, exponent, final_result) ||
+      (truncated && (!decimalToFloat(significand + 1, exponent, upper) ||
+                     upper != final_result))) {
+    while (significand > traits::mantissa_max) {
+      significand /= 10;
+      exponent++;
+    }
+    final_result = make_float(static_cast<JsonFloat>(significand), exponent);
+  }
 
   result.setFloat(is_negative ? -final_result : final_result);
   return true;
@@ -0,0 +1,29 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Namespace.hpp>
+
+#include <stddef.h>  // for size_t
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// The std::index_sequence of C++14
+template <size_t... Is>
+struct index_sequence {};
+
+template <size_t N, size_t... Is>
+struct make_index_sequence_impl : make_index_sequence_impl<N - 1, N - 1, Is...> {
+};
+
+template <size_t... Is>
+struct make_index_sequence_impl<0, Is...> {
+  typedef index_sequence<Is...> type;
+};
+
+template <size_t N>
+using make_index_sequence = typename make_index_sequence_impl<N>::type;
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
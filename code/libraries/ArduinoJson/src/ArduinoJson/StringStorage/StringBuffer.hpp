@@ -0,0 +1,57 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2023, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Namespace.hpp>
+#include <ArduinoJson/Strings/JsonString.hpp>
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+// Holds one string at a time, for the parser that doesn't fill a pool
+class StringBuffer {
+ public:
+  StringBuffer() : size_(0), valid_(true) {}
+
+  void startString() {
+    size_ = 0;
+    valid_ = true;
+  }
+
+  JsonString save() {
+    return str();
+  }
+
+  void append(char c) {
+    if (size_ + 1 < sizeof(buffer_))
+      buffer_[size_++] = c;
+    else
+      valid_ = false;
+  }
+
+  void append(const char* s, size_t n) {
+    while (n-- > 0)
+      append(*s++);
+  }
+
+  bool isValid() const {
+    return valid_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  JsonString str() {
+    buffer_[size_] = 0;
+    return JsonString(buffer_, size_, JsonString::Copied);
+  }
+
+ private:
+  size_t size_;
+  bool valid_;
+  char buffer_[ARDUINOJSON_PARSER_STRING_SIZE];
+};
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
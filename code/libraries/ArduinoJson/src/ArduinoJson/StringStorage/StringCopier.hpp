@@ -15,7 +15,7 @@ class StringCopier {
   void startString() {
     pool_->getFreeZone(&ptr_, &capacity_);
     size_ = 0;
-    if (capacity_ == 0)
+    if (capacity_ == 0 && !pool_->growFreeZone(&ptr_, &capacity_, 0))
       pool_->markAsOverflowed();
   }
 
@@ -32,12 +32,18 @@ class StringCopier {
   }
 
   void append(const char* s, size_t n) {
+    if (size_ + n < capacity_) {
+      memcpy(ptr_ + size_, s, n);
+      size_ += n;
+      return;
+    }
     while (n-- > 0)
       append(*s++);
   }
 
   void append(char c) {
-    if (size_ + 1 < capacity_)
+    if (size_ + 1 < capacity_ ||
+        pool_->growFreeZone(&ptr_, &capacity_, size_))
       ptr_[size_++] = c;
     else
       pool_->markAsOverflowed();
@@ -7,6 +7,8 @@
 #include <ArduinoJson/Namespace.hpp>
 #include <ArduinoJson/Strings/JsonString.hpp>
 
+#include <string.h>  // memmove
+
 ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 
 class StringMover {
@@ -27,6 +29,12 @@ class StringMover {
     *writePtr_++ = c;
   }
 
+  // s is further in the same buffer, or right here
+  void append(const char* s, size_t n) {
+    memmove(writePtr_, s, n);
+    writePtr_ += n;
+  }
+
   bool isValid() const {
     return true;
   }
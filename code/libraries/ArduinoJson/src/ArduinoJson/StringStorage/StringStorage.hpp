@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <ArduinoJson/StringStorage/StringBuffer.hpp>
 #include <ArduinoJson/StringStorage/StringCopier.hpp>
 #include <ArduinoJson/StringStorage/StringMover.hpp>
 
@@ -21,4 +22,17 @@ StringMover makeStringStorage(
     typename enable_if<!is_const<TChar>::value>::type* = 0) {
   return StringMover(reinterpret_cast<char*>(input));
 }
+
+// Without a pool, for the parser that passes strings one at a time
+
+template <typename TInput>
+StringBuffer makeStringStorage(TInput&) {
+  return StringBuffer();
+}
+
+template <typename TChar>
+StringMover makeStringStorage(
+    TChar* input, typename enable_if<!is_const<TChar>::value>::type* = 0) {
+  return StringMover(reinterpret_cast<char*>(input));
+}
 ARDUINOJSON_END_PRIVATE_NAMESPACE
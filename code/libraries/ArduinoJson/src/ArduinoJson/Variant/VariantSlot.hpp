@@ -13,6 +13,16 @@ ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
 
 typedef int_t<ARDUINOJSON_SLOT_OFFSET_SIZE * 8>::type VariantSlotDiff;
 
+class VariantSlot;
+
+// Holds the key of a slot and a pointer to the next one, when the next slot
+// is out of the reach of VariantSlotDiff, or in another page of the memory
+// pool, where the distance between them has no meaning
+struct FarLink {
+  const char* key;
+  VariantSlot* next;
+};
+
 class VariantSlot {
   // CAUTION: same layout as VariantData
   // we cannot use composition because it adds padding
@@ -38,6 +48,8 @@ class VariantSlot {
   }
 
   VariantSlot* next() {
+    if (hasFarLink())
+      return farLink()->next;
     return next_ ? this + next_ : 0;
   }
 
@@ -47,11 +59,8 @@ class VariantSlot {
 
   VariantSlot* next(size_t distance) {
     VariantSlot* slot = this;
-    while (distance--) {
-      if (!slot->next_)
-        return 0;
-      slot += slot->next_;
-    }
+    while (slot && distance--)
+      slot = slot->next();
     return slot;
   }
 
@@ -59,21 +68,53 @@ class VariantSlot {
     return const_cast<VariantSlot*>(this)->next(distance);
   }
 
+  // Tells if next_ can hold the distance to the slot, which must be in the
+  // same block of memory
+  bool canLinkTo(const VariantSlot* slot) const {
+    return slot - this > farLinkMarker() &&
+           slot - this <= numeric_limits<VariantSlotDiff>::highest();
+  }
+
+  bool hasFarLink() const {
+    return next_ == farLinkMarker();
+  }
+
   void setNext(VariantSlot* slot) {
-    ARDUINOJSON_ASSERT(!slot || slot - this >=
-                                    numeric_limits<VariantSlotDiff>::lowest());
-    ARDUINOJSON_ASSERT(!slot || slot - this <=
-                                    numeric_limits<VariantSlotDiff>::highest());
+    if (hasFarLink()) {
+      farLink()->next = slot;
+      return;
+    }
+    ARDUINOJSON_ASSERT(!slot || canLinkTo(slot));
     next_ = VariantSlotDiff(slot ? slot - this : 0);
   }
 
   void setNextNotNull(VariantSlot* slot) {
     ARDUINOJSON_ASSERT(slot != 0);
-    ARDUINOJSON_ASSERT(slot - this >=
-                       numeric_limits<VariantSlotDiff>::lowest());
-    ARDUINOJSON_ASSERT(slot - this <=
-                       numeric_limits<VariantSlotDiff>::highest());
-    next_ = VariantSlotDiff(slot - this);
+    setNext(slot);
+  }
+
+  // Links to the slot with a pointer, kept in the FarLink with the key
+  void setFarNext(VariantSlot* slot, FarLink* link) {
+    ARDUINOJSON_ASSERT(!hasFarLink());
+    link->key = key_;
+    link->next = slot;
+    key_ = reinterpret_cast<const char*>(link);
+    next_ = farLinkMarker();
+  }
+
+  // Skips the next slot, which is being removed from the list.
+  // Its memory becomes the FarLink when the following slot is out of reach.
+  void removeNext() {
+    VariantSlot* removed = next();
+    ARDUINOJSON_ASSERT(removed != 0);
+    VariantSlot* slot = removed->next();
+    if (!slot || hasFarLink() ||
+        (!removed->hasFarLink() && canLinkTo(slot))) {
+      setNext(slot);
+      return;
+    }
+    void* link = removed;  // prevent warning cast-align
+    setFarNext(slot, static_cast<FarLink*>(link));
   }
 
   void setKey(JsonString k) {
@@ -82,11 +123,14 @@ class VariantSlot {
       flags_ &= VALUE_MASK;
     else
       flags_ |= OWNED_KEY_BIT;
-    key_ = k.c_str();
+    if (hasFarLink())
+      farLink()->key = k.c_str();
+    else
+      key_ = k.c_str();
   }
 
   const char* key() const {
-    return key_;
+    return hasFarLink() ? farLink()->key : key_;
   }
 
   bool ownsKey() const {
@@ -100,13 +144,34 @@ class VariantSlot {
   }
 
   void movePointers(ptrdiff_t stringDistance, ptrdiff_t variantDistance) {
-    if (flags_ & OWNED_KEY_BIT)
+    if (hasFarLink()) {
+      key_ += variantDistance;  // the FarLink is with the variants
+      FarLink* link = farLink();
+      if (flags_ & OWNED_KEY_BIT)
+        link->key += stringDistance;
+      if (link->next)
+        link->next = reinterpret_cast<VariantSlot*>(reinterpret_cast<void*>(
+            reinterpret_cast<char*>(link->next) + variantDistance));
+    } else if (flags_ & OWNED_KEY_BIT) {
       key_ += stringDistance;
+    }
     if (flags_ & OWNED_VALUE_BIT)
       content_.asString.data += stringDistance;
     if (flags_ & COLLECTION_MASK)
       content_.asCollection.movePointers(stringDistance, variantDistance);
   }
+
+ private:
+  // The value of next_ when key_ points to a FarLink. It's never the
+  // distance to a slot, see canLinkTo().
+  static VariantSlotDiff farLinkMarker() {
+    return numeric_limits<VariantSlotDiff>::lowest();
+  }
+
+  FarLink* farLink() const {
+    const void* link = key_;  // prevent warning cast-align
+    return const_cast<FarLink*>(static_cast<const FarLink*>(link));
+  }
 };
 
 ARDUINOJSON_END_PRIVATE_NAMESPACE
@@ -14,6 +14,7 @@ PubSubClient::PubSubClient() {
     this->stream = NULL;
     setCallback(NULL);
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -24,6 +25,7 @@ PubSubClient::PubSubClient(Client& client) {
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -35,6 +37,7 @@ PubSubClient::PubSubClient(IPAddress addr, uint16_t port, Client& client) {
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -45,6 +48,7 @@ PubSubClient::PubSubClient(IPAddress addr, uint16_t port, Client& client, Stream
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -56,6 +60,7 @@ PubSubClient::PubSubClient(IPAddress addr, uint16_t port, MQTT_CALLBACK_SIGNATUR
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -67,6 +72,7 @@ PubSubClient::PubSubClient(IPAddress addr, uint16_t port, MQTT_CALLBACK_SIGNATUR
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -78,6 +84,7 @@ PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, Client& client) {
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -88,6 +95,7 @@ PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, Client& client, Stream& s
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -99,6 +107,7 @@ PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, MQTT_CALLBACK_SIGNATURE,
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -110,6 +119,7 @@ PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, MQTT_CALLBACK_SIGNATURE,
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -121,6 +131,7 @@ PubSubClient::PubSubClient(const char* domain, uint16_t port, Client& client) {
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -131,6 +142,7 @@ PubSubClient::PubSubClient(const char* domain, uint16_t port, Client& client, St
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -142,6 +154,7 @@ PubSubClient::PubSubClient(const char* domain, uint16_t port, MQTT_CALLBACK_SIGN
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -153,6 +166,7 @@ PubSubClient::PubSubClient(const char* domain, uint16_t port, MQTT_CALLBACK_SIGN
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    setInflightWindow(MQTT_MAX_INFLIGHT);
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -160,6 +174,14 @@ PubSubClient::PubSubClient(const char* domain, uint16_t port, MQTT_CALLBACK_SIGN
 
 PubSubClient::~PubSubClient() {
   free(this->buffer);
+#if MQTT_VERSION == MQTT_VERSION_5
+  clearTopicAliases();
+#endif
+  for (uint8_t i = 0; i < this->inflightCount; i++) {
+    free(this->inflight[i].packet);
+  }
+  free(this->inflight);
+  delete this->router;
 }
 
 boolean PubSubClient::connect(const char *id) {
@@ -180,207 +202,339 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
 
 boolean PubSubClient::connect(const char *id, const char *user, const char *pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession) {
     if (!connected()) {
-        int result = 0;
+        if (!this->connackPending && !startConnect(id,user,pass,willTopic,willQos,willRetain,willMessage,cleanSession)) {
+            return false;
+        }
+        while (this->connackPending) {
+            if (readConnack()) {
+                return true;
+            }
+            yield();
+        }
+        return false;
+    }
+    return true;
+}
+
+boolean PubSubClient::startConnect(const char *id, const char *user, const char *pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession) {
+    int result = 0;
 
 
-        if(_client->connected()) {
-            result = 1;
+    if(_client->connected()) {
+        result = 1;
+    } else {
+        if (domain != NULL) {
+            result = _client->connect(this->domain, this->port);
         } else {
-            if (domain != NULL) {
-                result = _client->connect(this->domain, this->port);
-            } else {
-                result = _client->connect(this->ip, this->port);
-            }
+            result = _client->connect(this->ip, this->port);
         }
+    }
 
-        if (result == 1) {
-            nextMsgId = 1;
-            // Leave room in the buffer for header and variable length field
-            uint16_t length = MQTT_MAX_HEADER_SIZE;
-            unsigned int j;
+    if (result == 1) {
+        nextMsgId = 1;
+        resetPacket();
+        // Leave room in the buffer for header and variable length field
+        uint16_t length = MQTT_MAX_HEADER_SIZE;
+        unsigned int j;
 
 #if MQTT_VERSION == MQTT_VERSION_3_1
-            uint8_t d[9] = {0x00,0x06,'M','Q','I','s','d','p', MQTT_VERSION};
+        uint8_t d[9] = {0x00,0x06,'M','Q','I','s','d','p', MQTT_VERSION};
 #define MQTT_HEADER_VERSION_LENGTH 9
-#elif MQTT_VERSION == MQTT_VERSION_3_1_1
-            uint8_t d[7] = {0x00,0x04,'M','Q','T','T',MQTT_VERSION};
+#elif MQTT_VERSION == MQTT_VERSION_3_1_1 || MQTT_VERSION == MQTT_VERSION_5
+        uint8_t d[7] = {0x00,0x04,'M','Q','T','T',MQTT_VERSION};
 #define MQTT_HEADER_VERSION_LENGTH 7
 #endif
-            for (j = 0;j<MQTT_HEADER_VERSION_LENGTH;j++) {
-                this->buffer[length++] = d[j];
-            }
+        for (j = 0;j<MQTT_HEADER_VERSION_LENGTH;j++) {
+            this->buffer[length++] = d[j];
+        }
 
-            uint8_t v;
-            if (willTopic) {
-                v = 0x04|(willQos<<3)|(willRetain<<5);
-            } else {
-                v = 0x00;
-            }
-            if (cleanSession) {
-                v = v|0x02;
-            }
+        uint8_t v;
+        if (willTopic) {
+            v = 0x04|(willQos<<3)|(willRetain<<5);
+        } else {
+            v = 0x00;
+        }
+        if (cleanSession) {
+            v = v|0x02;
+        }
 
-            if(user != NULL) {
-                v = v|0x80;
+        if(user != NULL) {
+            v = v|0x80;
 
-                if(pass != NULL) {
-                    v = v|(0x80>>1);
-                }
-            }
-            this->buffer[length++] = v;
-
-            this->buffer[length++] = ((this->keepAlive) >> 8);
-            this->buffer[length++] = ((this->keepAlive) & 0xFF);
-
-            CHECK_STRING_LENGTH(length,id)
-            length = writeString(id,this->buffer,length);
-            if (willTopic) {
-                CHECK_STRING_LENGTH(length,willTopic)
-                length = writeString(willTopic,this->buffer,length);
-                CHECK_STRING_LENGTH(length,willMessage)
-                length = writeString(willMessage,this->buffer,length);
+            if(pass != NULL) {
+                v = v|(0x80>>1);
             }
+        }
+        this->buffer[length++] = v;
 
-            if(user != NULL) {
-                CHECK_STRING_LENGTH(length,user)
-                length = writeString(user,this->buffer,length);
-                if(pass != NULL) {
-                    CHECK_STRING_LENGTH(length,pass)
-                    length = writeString(pass,this->buffer,length);
-                }
-            }
+        this->buffer[length++] = ((this->keepAlive) >> 8);
+        this->buffer[length++] = ((this->keepAlive) & 0xFF);
 
-            write(MQTTCONNECT,this->buffer,length-MQTT_MAX_HEADER_SIZE);
+#if MQTT_VERSION == MQTT_VERSION_5
+        uint16_t properties = length++;
+        if (this->sessionExpiry) {
+            this->buffer[length++] = MQTT_PROP_SESSION_EXPIRY;
+            length = writeInt32(this->sessionExpiry,this->buffer,length);
+        }
+        if (MQTT_MAX_TOPIC_ALIASES > 0) {
+            this->buffer[length++] = MQTT_PROP_TOPIC_ALIAS_MAXIMUM;
+            this->buffer[length++] = (MQTT_MAX_TOPIC_ALIASES >> 8);
+            this->buffer[length++] = (MQTT_MAX_TOPIC_ALIASES & 0xFF);
+        }
+        if (!this->streamCallback) {
+            // Have the broker drop what would not fit rather than send it
+            this->buffer[length++] = MQTT_PROP_MAXIMUM_PACKET_SIZE;
+            length = writeInt32(this->bufferSize,this->buffer,length);
+        }
+        this->buffer[properties] = length-properties-1;
+#endif
 
-            lastInActivity = lastOutActivity = millis();
+        CHECK_STRING_LENGTH(length,id)
+        length = writeString(id,this->buffer,length);
+        if (willTopic) {
+#if MQTT_VERSION == MQTT_VERSION_5
+            // No will properties
+            this->buffer[length++] = 0;
+#endif
+            CHECK_STRING_LENGTH(length,willTopic)
+            length = writeString(willTopic,this->buffer,length);
+            CHECK_STRING_LENGTH(length,willMessage)
+            length = writeString(willMessage,this->buffer,length);
+        }
 
-            while (!_client->available()) {
-                unsigned long t = millis();
-                if (t-lastInActivity >= ((int32_t) this->socketTimeout*1000UL)) {
-                    _state = MQTT_CONNECTION_TIMEOUT;
-                    _client->stop();
-                    return false;
-                }
+        if(user != NULL) {
+            CHECK_STRING_LENGTH(length,user)
+            length = writeString(user,this->buffer,length);
+            if(pass != NULL) {
+                CHECK_STRING_LENGTH(length,pass)
+                length = writeString(pass,this->buffer,length);
             }
-            uint8_t llen;
-            uint32_t len = readPacket(&llen);
+        }
 
-            if (len == 4) {
-                if (buffer[3] == 0) {
-                    lastInActivity = millis();
-                    pingOutstanding = false;
-                    _state = MQTT_CONNECTED;
-                    return true;
-                } else {
-                    _state = buffer[3];
-                }
+        write(MQTTCONNECT,this->buffer,length-MQTT_MAX_HEADER_SIZE);
+
+        lastInActivity = lastOutActivity = millis();
+        this->sessionKeepAlive = this->keepAlive;
+        this->connackPending = true;
+        return true;
+    }
+    _state = MQTT_CONNECT_FAILED;
+    return false;
+}
+
+boolean PubSubClient::readConnack() {
+    uint8_t llen;
+    uint32_t len = readPacket(&llen);
+    if (len == 0) {
+        if (_client->connected()) {
+            unsigned long t = millis();
+            if (t-lastInActivity < ((int32_t) this->socketTimeout*1000UL)) {
+                return false;
             }
-            _client->stop();
-        } else {
-            _state = MQTT_CONNECT_FAILED;
+            _state = MQTT_CONNECTION_TIMEOUT;
         }
+        this->connackPending = false;
+        _client->stop();
         return false;
     }
-    return true;
+    this->connackPending = false;
+#if MQTT_VERSION == MQTT_VERSION_5
+    // Flags, reason code and properties
+    boolean complete = len >= (uint32_t)llen+4;
+#else
+    boolean complete = len == 4;
+#endif
+    if (complete) {
+        this->reasonCode = buffer[llen+2];
+        if (buffer[llen+2] == 0) {
+#if MQTT_VERSION == MQTT_VERSION_5
+            readConnackProperties(llen+3, len);
+#endif
+            lastInActivity = millis();
+            pingOutstanding = false;
+            _state = MQTT_CONNECTED;
+            resendInflight();
+            renewRoutes();
+            if (connectCallback) {
+                connectCallback();
+            }
+            return true;
+        } else {
+            _state = buffer[llen+2];
+        }
+    }
+    _client->stop();
+    return false;
 }
 
-// reads a byte into result
-boolean PubSubClient::readByte(uint8_t * result) {
-   uint32_t previousMillis = millis();
-   while(!_client->available()) {
-     yield();
-     uint32_t currentMillis = millis();
-     if(currentMillis - previousMillis >= ((int32_t) this->socketTimeout * 1000)){
-       return false;
-     }
-   }
-   *result = _client->read();
-   return true;
-}
-
-// reads a byte into result[*index] and increments index
-boolean PubSubClient::readByte(uint8_t * result, uint16_t * index){
-  uint16_t current_index = *index;
-  uint8_t * write_address = &(result[current_index]);
-  if(readByte(write_address)){
-    *index = current_index + 1;
-    return true;
-  }
-  return false;
+boolean PubSubClient::reconnect() {
+    if (!this->connackPending) {
+        unsigned long t = millis();
+        if (t - this->lastConnectAttempt < this->reconnectDelay) {
+            return false;
+        }
+        this->lastConnectAttempt = t;
+        // Back off until an attempt succeeds
+        this->reconnectDelay = this->reconnectDelay == 0 ? this->reconnectMin : this->reconnectDelay*2;
+        if (this->reconnectDelay > this->reconnectMax) {
+            this->reconnectDelay = this->reconnectMax;
+        }
+        if (!startConnect(this->reconnectId,this->reconnectUser,this->reconnectPass,this->reconnectWillTopic,
+                          this->reconnectWillQos,this->reconnectWillRetain,this->reconnectWillMessage,this->reconnectCleanSession)) {
+            return false;
+        }
+    }
+    if (readConnack()) {
+        this->reconnectDelay = 0;
+        return true;
+    }
+    return false;
 }
 
-uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
-    uint16_t len = 0;
-    if(!readByte(this->buffer, &len)) return 0;
-    bool isPublish = (this->buffer[0]&0xF0) == MQTTPUBLISH;
-    uint32_t multiplier = 1;
-    uint32_t length = 0;
-    uint8_t digit = 0;
-    uint16_t skip = 0;
-    uint32_t start = 0;
+void PubSubClient::resetPacket() {
+    this->rxCount = 0;
+    this->rxHeaderLength = 0;
+    this->rxOverflow = false;
+}
 
-    do {
-        if (len == 5) {
-            // Invalid remaining length encoding - kill the connection
-            _state = MQTT_DISCONNECTED;
-            _client->stop();
-            return 0;
-        }
-        if(!readByte(&digit)) return 0;
-        this->buffer[len++] = digit;
-        length += (digit & 127) * multiplier;
-        multiplier <<=7; //multiplier *= 128
-    } while ((digit & 128) != 0);
-    *lengthLength = len-1;
-
-    if (isPublish) {
-        // Read in topic length to calculate bytes to skip over for Stream writing
-        if(!readByte(this->buffer, &len)) return 0;
-        if(!readByte(this->buffer, &len)) return 0;
-        skip = (this->buffer[*lengthLength+1]<<8)+this->buffer[*lengthLength+2];
-        start = 2;
-        if (this->buffer[0]&MQTTQOS1) {
-            // skip message id
-            skip += 2;
-        }
-    }
-    uint32_t idx = len;
-
-    for (uint32_t i = start;i<length;i++) {
-        if(!readByte(&digit)) return 0;
-        if (this->stream) {
-            if (isPublish && idx-*lengthLength-2>skip) {
-                this->stream->write(digit);
+// The packet is read straight into the buffer in as few client reads as its
+// layout allows, picking up where the last call left off. The topic of a
+// PUBLISH is stored one byte early, over the low byte of its length, which
+// leaves room to NUL terminate it in place. The payload of a PUBLISH too
+// large for the buffer is read piece by piece into the room after the topic
+// and handed to streamCallback each time.
+uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
+    while (_client->available()) {
+        this->rxLastRead = millis();
+        if (this->rxHeaderLength == 0) {
+            // Fixed header, a byte at a time until its length is known
+            if (this->rxCount == MQTT_MAX_HEADER_SIZE) {
+                // Invalid remaining length encoding - kill the connection
+                _state = MQTT_DISCONNECTED;
+                _client->stop();
+                resetPacket();
+                return 0;
+            }
+            uint8_t digit = _client->read();
+            this->buffer[this->rxCount++] = digit;
+            if (this->rxCount == 1) {
+                this->rxLength = 0;
+                this->rxMultiplier = 1;
+                this->rxTopicLength = 0;
+                this->rxStreamed = false;
+                continue;
+            }
+            this->rxLength += (digit & 127) * this->rxMultiplier;
+            this->rxMultiplier <<= 7; //multiplier *= 128
+            if ((digit & 128) == 0) {
+                this->rxHeaderLength = this->rxCount;
+            }
+        } else {
+            bool isPublish = (this->buffer[0]&0xF0) == MQTTPUBLISH;
+            uint32_t end = this->rxHeaderLength + this->rxLength;
+            uint32_t topicStart = this->rxHeaderLength + 2u;  // past the topic length
+            uint32_t topicEnd = topicStart + this->rxTopicLength;
+            uint32_t payloadStart = topicEnd + ((this->buffer[0]&0x06) ? 2 : 0);
+#if MQTT_VERSION == MQTT_VERSION_5
+            payloadStart = propertiesEnd(payloadStart);
+#endif
+            bool streaming = isPublish && this->streamCallback && end > this->bufferSize &&
+                             this->rxCount >= topicStart && payloadStart < this->bufferSize;
+            if (isPublish && this->rxCount < topicStart && this->rxCount < end) {
+                // Topic length, kept aside as the topic is stored over it
+                uint8_t digit = _client->read();
+                this->rxTopicLength = (this->rxTopicLength << 8) | digit;
+                if (this->rxCount < this->bufferSize) {
+                    this->buffer[this->rxCount] = digit;
+                }
+                this->rxCount++;
+            } else {
+                uint32_t offset = this->rxCount;
+                if (isPublish && this->rxCount < topicEnd) {
+                    end = topicEnd < end ? topicEnd : end;
+                    offset--;
+                } else if (streaming && this->rxCount < payloadStart) {
+                    end = payloadStart;
+                } else if (streaming) {
+                    // Each piece of the payload over the one before
+                    offset = payloadStart;
+                }
+                // Clients hand over what has arrived, up to the size asked for
+                uint32_t want = end - this->rxCount;
+                uint32_t room = offset < this->bufferSize ? this->bufferSize - offset : 0;
+                uint8_t discard[32];
+                uint8_t *data;
+                int rc;
+                if (room > 0) {
+                    data = this->buffer + offset;
+                    rc = _client->read(data, want < room ? want : room);
+                } else {
+                    // Out of room: read past the rest of the packet
+                    data = discard;
+                    rc = _client->read(data, want < sizeof(discard) ? want : sizeof(discard));
+                    this->rxOverflow = true;
+                }
+                if (rc <= 0) {
+                    return 0;
+                }
+                if (streaming && this->rxCount >= payloadStart) {
+                    if (this->rxCount == payloadStart) {
+                        this->rxTopic = publishTopic(this->rxHeaderLength, payloadStart, &payloadStart);
+                    }
+                    if (this->rxTopic) {
+                        this->streamCallback(this->rxTopic, data, rc, this->rxCount-payloadStart, end-payloadStart);
+                        this->rxStreamed = true;
+                    }
+                }
+                if (this->stream && isPublish) {
+                    for (int i = 0; i < rc; i++) {
+                        if (this->rxCount + i >= payloadStart) {
+                            this->stream->write(data[i]);
+                        }
+                    }
+                }
+                this->rxCount += rc;
+                if (isPublish && this->rxCount == topicEnd && topicEnd <= this->bufferSize) {
+                    this->buffer[topicEnd-1] = 0;
+                }
             }
         }
 
-        if (len < this->bufferSize) {
-            this->buffer[len] = digit;
-            len++;
+        if (this->rxHeaderLength != 0 && this->rxCount == this->rxHeaderLength + this->rxLength) {
+            *lengthLength = this->rxHeaderLength - 1;
+            uint32_t len = this->rxCount < this->bufferSize ? this->rxCount : this->bufferSize;
+            bool isPublish = (this->buffer[0]&0xF0) == MQTTPUBLISH;
+            uint32_t topicEnd = this->rxHeaderLength + 2 + this->rxTopicLength;
+            bool keep = (!this->rxOverflow || this->stream) &&
+                        (!isPublish || (topicEnd <= this->rxCount && topicEnd <= this->bufferSize));
+            resetPacket();
+            return keep ? len : 0;
         }
-        idx++;
-    }
-
-    if (!this->stream && idx > this->bufferSize) {
-        len = 0; // This will cause the packet to be ignored.
     }
-    return len;
+    return 0;
 }
 
 boolean PubSubClient::loop() {
     if (connected()) {
         unsigned long t = millis();
-        if ((t - lastInActivity > this->keepAlive*1000UL) || (t - lastOutActivity > this->keepAlive*1000UL)) {
-            if (pingOutstanding) {
+        // A keep alive of 0 turns the mechanism off
+        if (this->sessionKeepAlive != 0 &&
+            ((t - lastInActivity > this->sessionKeepAlive*1000UL) || (t - lastOutActivity > this->sessionKeepAlive*1000UL))) {
+            if (pingOutstanding && (t - lastInActivity > this->sessionKeepAlive*1000UL)) {
                 this->_state = MQTT_CONNECTION_TIMEOUT;
                 _client->stop();
                 return false;
             } else {
+                // Under a heavy inbound load the PINGRESP can be queued behind
+                // messages. While they keep arriving the broker is alive, so
+                // keep pinging it rather than giving up.
+                if (!pingOutstanding) {
+                    lastInActivity = t;
+                }
                 this->buffer[0] = MQTTPINGREQ;
                 this->buffer[1] = 0;
                 _client->write(this->buffer,2);
                 lastOutActivity = t;
-                lastInActivity = t;
                 pingOutstanding = true;
             }
         }
@@ -388,48 +542,69 @@ boolean PubSubClient::loop() {
             uint8_t llen;
             uint16_t len = readPacket(&llen);
             uint16_t msgId = 0;
-            uint8_t *payload;
             if (len > 0) {
                 lastInActivity = t;
                 uint8_t type = this->buffer[0]&0xF0;
                 if (type == MQTTPUBLISH) {
-                    if (callback) {
-                        uint16_t tl = (this->buffer[llen+1]<<8)+this->buffer[llen+2]; /* topic length in bytes */
-                        memmove(this->buffer+llen+2,this->buffer+llen+3,tl); /* move topic inside buffer 1 byte to front */
-                        this->buffer[llen+2+tl] = 0; /* end the topic as a 'C' string with \x00 */
-                        char *topic = (char*) this->buffer+llen+2;
+                    if (callback || this->router || this->rxStreamed) {
+                        uint16_t tl = this->rxTopicLength; /* topic length in bytes */
                         // msgId only present for QOS>0
                         if ((this->buffer[0]&0x06) == MQTTQOS1) {
                             msgId = (this->buffer[llen+3+tl]<<8)+this->buffer[llen+3+tl+1];
-                            payload = this->buffer+llen+3+tl+2;
-                            callback(topic,payload,len-llen-3-tl-2);
-
+                        }
+                        if (!this->rxStreamed) {
+                            uint32_t payloadStart;
+                            char *topic = publishTopic(llen+1,len,&payloadStart); /* already NUL terminated by readPacket */
+                            if (topic) {
+                                dispatch(topic,this->buffer+payloadStart,len-payloadStart);
+                            }
+                        }
+                        if (msgId) {
                             this->buffer[0] = MQTTPUBACK;
                             this->buffer[1] = 2;
                             this->buffer[2] = (msgId >> 8);
                             this->buffer[3] = (msgId & 0xFF);
                             _client->write(this->buffer,4);
                             lastOutActivity = t;
-
-                        } else {
-                            payload = this->buffer+llen+3+tl;
-                            callback(topic,payload,len-llen-3-tl);
                         }
                     }
+                } else if (type == MQTTPUBACK || type == MQTTPUBREC || type == MQTTPUBCOMP) {
+                    if (len >= (uint16_t)llen+3) {
+                        // A reason code follows under MQTT 5, when it is not 0
+                        uint8_t reason = len > (uint16_t)llen+3 ? this->buffer[llen+3] : 0;
+                        handleAck(type, (this->buffer[llen+1]<<8)+this->buffer[llen+2], reason);
+                    }
                 } else if (type == MQTTPINGREQ) {
                     this->buffer[0] = MQTTPINGRESP;
                     this->buffer[1] = 0;
                     _client->write(this->buffer,2);
                 } else if (type == MQTTPINGRESP) {
                     pingOutstanding = false;
+#if MQTT_VERSION == MQTT_VERSION_5
+                } else if (type == MQTTDISCONNECT) {
+                    // The broker is closing the connection, and says why
+                    this->reasonCode = len > (uint16_t)llen+1 ? this->buffer[llen+1] : 0;
+                    _state = MQTT_CONNECTION_LOST;
+                    _client->stop();
+                    return false;
+#endif
                 }
             } else if (!connected()) {
                 // readPacket has closed the connection
                 return false;
             }
+        } else if (this->rxCount > 0 && t - this->rxLastRead >= this->socketTimeout*1000UL) {
+            // A packet stopped arriving part way through
+            this->_state = MQTT_CONNECTION_TIMEOUT;
+            _client->stop();
+            resetPacket();
+            return false;
         }
         return true;
     }
+    if (this->reconnectId) {
+        return reconnect();
+    }
     return false;
 }
 
@@ -447,13 +622,13 @@ boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigne
 
 boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained) {
     if (connected()) {
-        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + plength) {
+        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + MQTT_MAX_PUBLISH_PROPERTIES + plength) {
             // Too long
             return false;
         }
         // Leave room in the buffer for header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        length = writeString(topic,this->buffer,length);
+        length = writeTopic(topic,0,this->buffer,length);
 
         // Add payload
         uint16_t i;
@@ -471,46 +646,67 @@ boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigne
     return false;
 }
 
+boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, uint8_t qos, boolean retained) {
+    if (qos == 0) {
+        return publish(topic, payload, plength, retained);
+    }
+    if (qos > 2 || !connected() || this->inflightCount >= this->inflightWindow) {
+        return false;
+    }
+#if MQTT_VERSION == MQTT_VERSION_5
+    if (this->inflightCount >= this->serverReceiveMax) {
+        // As many as the broker takes at once are awaiting acknowledgement
+        return false;
+    }
+#endif
+    if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + 2 + MQTT_MAX_PUBLISH_PROPERTIES + plength) {
+        // Too long
+        return false;
+    }
+    // Leave room in the buffer for header and variable length field
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    uint16_t msgId = nextPacketId();
+    length = writeTopic(topic,msgId,this->buffer,length);
+    memcpy(this->buffer+length,payload,plength);
+    length += plength;
+
+    uint8_t header = MQTTPUBLISH | (qos << 1);
+    if (retained) {
+        header |= 1;
+    }
+    size_t hlen = buildHeader(header, this->buffer, length-MQTT_MAX_HEADER_SIZE);
+    uint8_t* packet = this->buffer+(MQTT_MAX_HEADER_SIZE-hlen);
+    if (!addInflight(msgId, packet, length-(MQTT_MAX_HEADER_SIZE-hlen))) {
+        return false;
+    }
+    // Once inflight it is delivered, now or after a reconnect
+    writePacket(packet, length-(MQTT_MAX_HEADER_SIZE-hlen));
+    return true;
+}
+
 boolean PubSubClient::publish_P(const char* topic, const char* payload, boolean retained) {
     return publish_P(topic, (const uint8_t*)payload, payload ? strnlen(payload, this->bufferSize) : 0, retained);
 }
 
 boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained) {
-    uint8_t llen = 0;
-    uint8_t digit;
     unsigned int rc = 0;
-    uint16_t tlen;
-    unsigned int pos = 0;
     unsigned int i;
     uint8_t header;
-    unsigned int len;
-    int expectedLength;
 
     if (!connected()) {
         return false;
     }
 
-    tlen = strnlen(topic, this->bufferSize);
-
     header = MQTTPUBLISH;
     if (retained) {
         header |= 1;
     }
-    this->buffer[pos++] = header;
-    len = plength + 2 + tlen;
-    do {
-        digit = len  & 127; //digit = len %128
-        len >>= 7; //len = len / 128
-        if (len > 0) {
-            digit |= 0x80;
-        }
-        this->buffer[pos++] = digit;
-        llen++;
-    } while(len>0);
+    // Leave room in the buffer for header and variable length field
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    length = writeTopic(topic,0,this->buffer,length);
+    size_t hlen = buildHeader(header, this->buffer, plength+length-MQTT_MAX_HEADER_SIZE);
 
-    pos = writeString(topic,this->buffer,pos);
-
-    rc += _client->write(this->buffer,pos);
+    rc += _client->write(this->buffer+(MQTT_MAX_HEADER_SIZE-hlen),length-(MQTT_MAX_HEADER_SIZE-hlen));
 
     for (i=0;i<plength;i++) {
         rc += _client->write((char)pgm_read_byte_near(payload + i));
@@ -518,16 +714,14 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
 
     lastOutActivity = millis();
 
-    expectedLength = 1 + llen + 2 + tlen + plength;
-
-    return (rc == expectedLength);
+    return (rc == length-(MQTT_MAX_HEADER_SIZE-hlen) + plength);
 }
 
 boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, boolean retained) {
     if (connected()) {
         // Send the header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        length = writeString(topic,this->buffer,length);
+        length = writeTopic(topic,0,this->buffer,length);
         uint8_t header = MQTTPUBLISH;
         if (retained) {
             header |= 1;
@@ -579,12 +773,15 @@ size_t PubSubClient::buildHeader(uint8_t header, uint8_t* buf, uint16_t length)
 }
 
 boolean PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
-    uint16_t rc;
     uint8_t hlen = buildHeader(header, buf, length);
+    return writePacket(buf+(MQTT_MAX_HEADER_SIZE-hlen),length+hlen);
+}
 
+boolean PubSubClient::writePacket(uint8_t* packet, uint16_t length) {
+    uint16_t rc;
 #ifdef MQTT_MAX_TRANSFER_SIZE
-    uint8_t* writeBuf = buf+(MQTT_MAX_HEADER_SIZE-hlen);
-    uint16_t bytesRemaining = length+hlen;  //Match the length type
+    uint8_t* writeBuf = packet;
+    uint16_t bytesRemaining = length;  //Match the length type
     uint8_t bytesToWrite;
     boolean result = true;
     while((bytesRemaining > 0) && result) {
@@ -594,14 +791,102 @@ boolean PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
         bytesRemaining -= rc;
         writeBuf += rc;
     }
+    lastOutActivity = millis();
     return result;
 #else
-    rc = _client->write(buf+(MQTT_MAX_HEADER_SIZE-hlen),length+hlen);
+    rc = _client->write(packet,length);
     lastOutActivity = millis();
-    return (rc == hlen+length);
+    return (rc == length);
 #endif
 }
 
+uint16_t PubSubClient::nextPacketId() {
+    // Skip ids still awaiting acknowledgement from before a reconnect
+    do {
+        nextMsgId++;
+        if (nextMsgId == 0) {
+            nextMsgId = 1;
+        }
+    } while (findInflight(nextMsgId) >= 0);
+    return nextMsgId;
+}
+
+int PubSubClient::findInflight(uint16_t msgId) {
+    for (uint8_t i = 0; i < this->inflightCount; i++) {
+        if (this->inflight[i].msgId == msgId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+boolean PubSubClient::addInflight(uint16_t msgId, const uint8_t* packet, uint16_t length) {
+    uint8_t* copy = (uint8_t*)malloc(length);
+    if (copy == NULL) {
+        return false;
+    }
+    memcpy(copy,packet,length);
+    MQTTInflight* entry = &this->inflight[this->inflightCount++];
+    entry->msgId = msgId;
+    entry->length = length;
+    entry->packet = copy;
+    if (this->persistence) {
+        this->persistence->put(msgId, copy, length);
+    }
+    return true;
+}
+
+void PubSubClient::removeInflight(int index) {
+    if (this->persistence) {
+        this->persistence->remove(this->inflight[index].msgId);
+    }
+    free(this->inflight[index].packet);
+    this->inflightCount--;
+    memmove(this->inflight+index, this->inflight+index+1, (this->inflightCount-index)*sizeof(MQTTInflight));
+}
+
+void PubSubClient::handleAck(uint8_t type, uint16_t msgId, uint8_t reason) {
+    this->reasonCode = reason;
+    int index = findInflight(msgId);
+    if (index < 0) {
+        return;
+    }
+    MQTTInflight* entry = &this->inflight[index];
+    uint8_t kind = entry->packet[0]&0xF0;
+    uint8_t qos = entry->packet[0]&0x06;
+    if (type == MQTTPUBREC && kind == MQTTPUBLISH && qos == MQTTQOS2 && reason < 0x80) {
+        // Received by the broker: release it and await PUBCOMP
+        uint8_t pubrel[4] = { MQTTPUBREL|MQTTQOS1, 2, (uint8_t)(msgId >> 8), (uint8_t)(msgId & 0xFF) };
+        uint8_t* packet = (uint8_t*)realloc(entry->packet, sizeof(pubrel));
+        if (packet != NULL) {
+            entry->packet = packet;
+        }
+        memcpy(entry->packet,pubrel,sizeof(pubrel));
+        entry->length = sizeof(pubrel);
+        if (this->persistence) {
+            this->persistence->put(msgId, pubrel, sizeof(pubrel));
+        }
+        writePacket(pubrel, sizeof(pubrel));
+    } else if ((type == MQTTPUBACK && kind == MQTTPUBLISH && qos == MQTTQOS1) ||
+               (type == MQTTPUBREC && kind == MQTTPUBLISH && qos == MQTTQOS2) ||
+               (type == MQTTPUBCOMP && kind == MQTTPUBREL)) {
+        // Done with, delivered or refused
+        removeInflight(index);
+    }
+}
+
+boolean PubSubClient::resendInflight() {
+    boolean result = true;
+    for (uint8_t i = 0; i < this->inflightCount; i++) {
+        MQTTInflight* entry = &this->inflight[i];
+        if ((entry->packet[0]&0xF0) == MQTTPUBLISH) {
+            entry->packet[0] |= 0x08;
+        }
+        result = writePacket(entry->packet, entry->length) && result;
+    }
+    return result;
+}
+
 boolean PubSubClient::subscribe(const char* topic) {
     return subscribe(topic, 0);
 }
@@ -614,19 +899,20 @@ boolean PubSubClient::subscribe(const char* topic, uint8_t qos) {
     if (qos > 1) {
         return false;
     }
-    if (this->bufferSize < 9 + topicLength) {
+    if (this->bufferSize < 9 + MQTT_SUBSCRIBE_PROPERTIES + topicLength) {
         // Too long
         return false;
     }
     if (connected()) {
         // Leave room in the buffer for header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        nextMsgId++;
-        if (nextMsgId == 0) {
-            nextMsgId = 1;
-        }
+        nextPacketId();
         this->buffer[length++] = (nextMsgId >> 8);
         this->buffer[length++] = (nextMsgId & 0xFF);
+#if MQTT_VERSION == MQTT_VERSION_5
+        // No properties
+        this->buffer[length++] = 0;
+#endif
         length = writeString((char*)topic, this->buffer,length);
         this->buffer[length++] = qos;
         return write(MQTTSUBSCRIBE|MQTTQOS1,this->buffer,length-MQTT_MAX_HEADER_SIZE);
@@ -634,23 +920,86 @@ boolean PubSubClient::subscribe(const char* topic, uint8_t qos) {
     return false;
 }
 
+boolean PubSubClient::subscribe(const char* filter, uint8_t qos, MQTT_TOPIC_CALLBACK_SIGNATURE) {
+    if (filter == 0 || qos > 1) {
+        return false;
+    }
+    if (this->bufferSize < 9 + MQTT_SUBSCRIBE_PROPERTIES + strnlen(filter, this->bufferSize)) {
+        // Too long
+        return false;
+    }
+    if (!addRoute(filter, qos, handler)) {
+        return false;
+    }
+    if (connected()) {
+        return subscribe(filter, qos);
+    }
+    return true;
+}
+
+boolean PubSubClient::route(const char* filter, MQTT_TOPIC_CALLBACK_SIGNATURE) {
+    if (filter == 0) {
+        return false;
+    }
+    return addRoute(filter, MQTT_ROUTE_ONLY, handler);
+}
+
+boolean PubSubClient::addRoute(const char* filter, uint8_t qos, MQTT_TOPIC_CALLBACK_SIGNATURE) {
+    if (this->router == NULL) {
+        this->router = new MQTTRouter();
+        if (this->router == NULL) {
+            return false;
+        }
+    }
+    return this->router->add(filter, qos, handler);
+}
+
+boolean PubSubClient::renewRoutes() {
+    boolean result = true;
+    if (this->router) {
+        for (uint8_t i = 0; i < this->router->routeCount; i++) {
+            MQTTRoute* route = &this->router->routes[i];
+            if (route->qos != MQTT_ROUTE_ONLY) {
+                result = subscribe(route->filter, route->qos) && result;
+            }
+        }
+    }
+    return result;
+}
+
+void PubSubClient::dispatch(char* topic, uint8_t* payload, unsigned int length) {
+    if (this->router && this->router->dispatch(topic, payload, length) > 0) {
+        return;
+    }
+    if (callback) {
+        callback(topic, payload, length);
+    }
+}
+
 boolean PubSubClient::unsubscribe(const char* topic) {
 	size_t topicLength = strnlen(topic, this->bufferSize);
     if (topic == 0) {
         return false;
     }
-    if (this->bufferSize < 9 + topicLength) {
+    if (this->bufferSize < 9 + MQTT_SUBSCRIBE_PROPERTIES + topicLength) {
         // Too long
         return false;
     }
+    if (this->router) {
+        for (uint8_t i = 0; i < this->router->routeCount; i++) {
+            if (strcmp(this->router->routes[i].filter, topic) == 0) {
+                this->router->routes[i].qos = MQTT_ROUTE_ONLY;
+            }
+        }
+    }
     if (connected()) {
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        nextMsgId++;
-        if (nextMsgId == 0) {
-            nextMsgId = 1;
-        }
+        nextPacketId();
         this->buffer[length++] = (nextMsgId >> 8);
         this->buffer[length++] = (nextMsgId & 0xFF);
+#if MQTT_VERSION == MQTT_VERSION_5
+        this->buffer[length++] = 0;
+#endif
         length = writeString(topic, this->buffer,length);
         return write(MQTTUNSUBSCRIBE|MQTTQOS1,this->buffer,length-MQTT_MAX_HEADER_SIZE);
     }
@@ -662,6 +1011,7 @@ void PubSubClient::disconnect() {
     this->buffer[1] = 0;
     _client->write(this->buffer,2);
     _state = MQTT_DISCONNECTED;
+    this->connackPending = false;
     _client->flush();
     _client->stop();
     lastInActivity = lastOutActivity = millis();
@@ -680,6 +1030,228 @@ uint16_t PubSubClient::writeString(const char* string, uint8_t* buf, uint16_t po
     return pos;
 }
 
+uint16_t PubSubClient::writeTopic(const char* topic, uint16_t msgId, uint8_t* buf, uint16_t pos) {
+#if MQTT_VERSION == MQTT_VERSION_5
+    // QoS 1 and 2 publishes keep their topic, as they may be sent again
+    // after a reconnect, when the aliases start over
+    boolean known = false;
+    uint16_t alias = msgId ? 0 : topicAlias(topic, &known);
+    if (known) {
+        buf[pos++] = 0;
+        buf[pos++] = 0;
+    } else {
+        pos = writeString(topic,buf,pos);
+    }
+#else
+    pos = writeString(topic,buf,pos);
+#endif
+    if (msgId) {
+        buf[pos++] = (msgId >> 8);
+        buf[pos++] = (msgId & 0xFF);
+    }
+#if MQTT_VERSION == MQTT_VERSION_5
+    uint16_t properties = pos++;
+    if (this->messageExpiry) {
+        buf[pos++] = MQTT_PROP_MESSAGE_EXPIRY;
+        pos = writeInt32(this->messageExpiry,buf,pos);
+    }
+    if (alias) {
+        buf[pos++] = MQTT_PROP_TOPIC_ALIAS;
+        buf[pos++] = (alias >> 8);
+        buf[pos++] = (alias & 0xFF);
+    }
+    buf[properties] = pos-properties-1;
+#endif
+    return pos;
+}
+
+char* PubSubClient::publishTopic(uint8_t headerLength, uint32_t end, uint32_t* payloadStart) {
+    char* topic = (char*)this->buffer+headerLength+1;
+    uint32_t pos = headerLength+2+this->rxTopicLength + ((this->buffer[0]&0x06) ? 2 : 0);
+    if (pos > end) {
+        return NULL;
+    }
+#if MQTT_VERSION == MQTT_VERSION_5
+    uint32_t length;
+    if (!readVarInt(this->buffer,&pos,end,&length) || pos+length > end) {
+        return NULL;
+    }
+    uint32_t properties = pos+length;
+    uint8_t id;
+    uint32_t value;
+    uint32_t alias = 0;
+    while (pos < properties && readProperty(this->buffer,&pos,properties,&id,&value)) {
+        if (id == MQTT_PROP_TOPIC_ALIAS) {
+            alias = value;
+        }
+    }
+    if (alias > MQTT_MAX_TOPIC_ALIASES) {
+        return NULL;
+    }
+    if (alias > 0 && this->rxTopicLength > 0) {
+        char* copy = (char*)realloc(this->aliasIn[alias-1], this->rxTopicLength+1);
+        if (copy != NULL) {
+            memcpy(copy,topic,this->rxTopicLength+1);
+            this->aliasIn[alias-1] = copy;
+        }
+    } else if (alias > 0) {
+        topic = this->aliasIn[alias-1];
+    }
+    pos = properties;
+#endif
+    *payloadStart = pos;
+    return topic;
+}
+
+#if MQTT_VERSION == MQTT_VERSION_5
+uint16_t PubSubClient::writeInt32(uint32_t value, uint8_t* buf, uint16_t pos) {
+    buf[pos++] = (value >> 24);
+    buf[pos++] = (value >> 16) & 0xFF;
+    buf[pos++] = (value >> 8) & 0xFF;
+    buf[pos++] = (value & 0xFF);
+    return pos;
+}
+
+boolean PubSubClient::readVarInt(const uint8_t* buf, uint32_t* pos, uint32_t end, uint32_t* value) {
+    *value = 0;
+    for (uint8_t shift = 0; shift < 28 && *pos < end; shift += 7) {
+        uint8_t digit = buf[(*pos)++];
+        *value |= (uint32_t)(digit & 127) << shift;
+        if ((digit & 128) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+boolean PubSubClient::readProperty(const uint8_t* buf, uint32_t* pos, uint32_t end, uint8_t* id, uint32_t* value) {
+    *id = buf[(*pos)++];
+    *value = 0;
+    uint32_t size;
+    switch (*id) {
+    case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+        size = 1;
+        break;
+    case 0x13: case 0x21: case 0x22: case 0x23:
+        size = 2;
+        break;
+    case 0x02: case 0x11: case 0x18: case 0x27:
+        size = 4;
+        break;
+    case 0x0B:
+        return readVarInt(buf,pos,end,value);
+    case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F:
+        // String or binary data, skipped
+        if (*pos+2 > end) {
+            return false;
+        }
+        *pos += 2 + ((buf[*pos]<<8) | buf[*pos+1]);
+        return *pos <= end;
+    case 0x26:
+        // User property, a pair of strings
+        for (uint8_t i = 0; i < 2; i++) {
+            if (*pos+2 > end) {
+                return false;
+            }
+            *pos += 2 + ((buf[*pos]<<8) | buf[*pos+1]);
+        }
+        return *pos <= end;
+    default:
+        return false;
+    }
+    if (*pos+size > end) {
+        return false;
+    }
+    for (uint8_t i = 0; i < size; i++) {
+        *value = (*value << 8) | buf[(*pos)++];
+    }
+    return true;
+}
+
+void PubSubClient::readConnackProperties(uint32_t pos, uint32_t end) {
+    // Each connection starts over with what the broker allows
+    this->serverReceiveMax = 65535;
+    this->aliasOutMax = 0;
+    clearTopicAliases();
+    uint32_t length;
+    if (!readVarInt(this->buffer,&pos,end,&length)) {
+        return;
+    }
+    end = pos+length < end ? pos+length : end;
+    uint8_t id;
+    uint32_t value;
+    while (pos < end && readProperty(this->buffer,&pos,end,&id,&value)) {
+        if (id == MQTT_PROP_RECEIVE_MAXIMUM && value > 0) {
+            this->serverReceiveMax = value;
+        } else if (id == MQTT_PROP_TOPIC_ALIAS_MAXIMUM) {
+            this->aliasOutMax = value < MQTT_MAX_TOPIC_ALIASES ? value : MQTT_MAX_TOPIC_ALIASES;
+        } else if (id == MQTT_PROP_SERVER_KEEP_ALIVE) {
+            this->sessionKeepAlive = value;
+        }
+    }
+}
+
+void PubSubClient::clearTopicAliases() {
+    for (uint8_t i = 0; i < MQTT_MAX_TOPIC_ALIASES; i++) {
+        free(this->aliasOut[i]);
+        this->aliasOut[i] = NULL;
+        free(this->aliasIn[i]);
+        this->aliasIn[i] = NULL;
+    }
+    this->aliasOutCount = 0;
+}
+
+uint16_t PubSubClient::topicAlias(const char* topic, boolean* known) {
+    for (uint8_t i = 0; i < this->aliasOutCount; i++) {
+        if (strcmp(this->aliasOut[i], topic) == 0) {
+            *known = true;
+            return i+1;
+        }
+    }
+    *known = false;
+    if (this->aliasOutCount >= this->aliasOutMax) {
+        return 0;
+    }
+    size_t length = strlen(topic)+1;
+    char* copy = (char*)malloc(length);
+    if (copy == NULL) {
+        return 0;
+    }
+    memcpy(copy,topic,length);
+    this->aliasOut[this->aliasOutCount++] = copy;
+    return this->aliasOutCount;
+}
+
+uint32_t PubSubClient::propertiesEnd(uint32_t pos) {
+    uint32_t length = 0;
+    for (uint8_t shift = 0; shift < 28; shift += 7) {
+        if (pos >= this->rxCount || pos >= this->bufferSize) {
+            return pos+1;
+        }
+        uint8_t digit = this->buffer[pos++];
+        length |= (uint32_t)(digit & 127) << shift;
+        if ((digit & 128) == 0) {
+            break;
+        }
+    }
+    return pos+length;
+}
+
+PubSubClient& PubSubClient::setSessionExpiry(uint32_t seconds) {
+    this->sessionExpiry = seconds;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setMessageExpiry(uint32_t seconds) {
+    this->messageExpiry = seconds;
+    return *this;
+}
+#endif
+
+uint8_t PubSubClient::getReasonCode() {
+    return this->reasonCode;
+}
+
 
 boolean PubSubClient::connected() {
     boolean rc;
@@ -723,6 +1295,43 @@ PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
     return *this;
 }
 
+PubSubClient& PubSubClient::setStreamCallback(MQTT_STREAM_CALLBACK_SIGNATURE) {
+    this->streamCallback = streamCallback;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setConnectCallback(MQTT_CONNECT_CALLBACK_SIGNATURE) {
+    this->connectCallback = connectCallback;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setReconnect(const char* id) {
+    return setReconnect(id,NULL,NULL,0,0,0,0,1);
+}
+
+PubSubClient& PubSubClient::setReconnect(const char* id, const char* user, const char* pass) {
+    return setReconnect(id,user,pass,0,0,0,0,1);
+}
+
+PubSubClient& PubSubClient::setReconnect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession) {
+    this->reconnectId = id;
+    this->reconnectUser = user;
+    this->reconnectPass = pass;
+    this->reconnectWillTopic = willTopic;
+    this->reconnectWillQos = willQos;
+    this->reconnectWillRetain = willRetain;
+    this->reconnectWillMessage = willMessage;
+    this->reconnectCleanSession = cleanSession;
+    this->reconnectDelay = 0;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setReconnectDelay(uint32_t min, uint32_t max) {
+    this->reconnectMin = min;
+    this->reconnectMax = max;
+    return *this;
+}
+
 PubSubClient& PubSubClient::setClient(Client& client){
     this->_client = &client;
     return *this;
@@ -759,6 +1368,41 @@ boolean PubSubClient::setBufferSize(uint16_t size) {
 uint16_t PubSubClient::getBufferSize() {
     return this->bufferSize;
 }
+
+boolean PubSubClient::setInflightWindow(uint8_t size) {
+    if (size < this->inflightCount) {
+        return false;
+    }
+    // Always keep an allocation, realloc() to 0 bytes may free it
+    MQTTInflight* table = (MQTTInflight*)realloc(this->inflight, (size > 0 ? size : 1)*sizeof(MQTTInflight));
+    if (table == NULL) {
+        return false;
+    }
+    this->inflight = table;
+    this->inflightWindow = size;
+    return true;
+}
+
+uint8_t PubSubClient::getInflightCount() {
+    return this->inflightCount;
+}
+
+PubSubClient& PubSubClient::setPersistence(MQTTPersistence& store) {
+    // Take back what was kept before a restart, without storing it again
+    this->persistence = NULL;
+    uint16_t msgId;
+    for (uint16_t i = 0; this->inflightCount < this->inflightWindow; i++) {
+        uint16_t length = store.get(i, &msgId, this->buffer, this->bufferSize);
+        if (length == 0) {
+            break;
+        }
+        if (findInflight(msgId) < 0 && !addInflight(msgId, this->buffer, length)) {
+            break;
+        }
+    }
+    this->persistence = &store;
+    return *this;
+}
 PubSubClient& PubSubClient::setKeepAlive(uint16_t keepAlive) {
     this->keepAlive = keepAlive;
     return *this;
@@ -767,3 +1411,145 @@ PubSubClient& PubSubClient::setSocketTimeout(uint16_t timeout) {
     this->socketTimeout = timeout;
     return *this;
 }
+
+MQTTRouter::MQTTRouter() {
+    this->nodeCount = 0;
+    this->routeCount = 0;
+    this->root = -1;
+}
+
+int16_t MQTTRouter::findChild(int16_t first, const char* level, uint16_t length) {
+    for (int16_t i = first; i >= 0; i = this->nodes[i].sibling) {
+        if (this->nodes[i].length == length && memcmp(this->nodes[i].level, level, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+boolean MQTTRouter::add(const char* filter, uint8_t qos, MQTT_TOPIC_CALLBACK_SIGNATURE) {
+    if (filter[0] == 0) {
+        return false;
+    }
+    // Check the wildcards and count the levels missing from the trie
+    // before changing anything
+    int16_t node = -1;
+    uint8_t missing = 0;
+    const char* level = filter;
+    const char* end;
+    do {
+        end = strchr(level, '/');
+        uint16_t length = end ? end-level : strlen(level);
+        for (uint16_t i = 0; i < length; i++) {
+            if ((level[i] == '+' || level[i] == '#') && length != 1) {
+                return false;
+            }
+        }
+        if (level[0] == '#' && end) {
+            return false;
+        }
+        if (missing == 0) {
+            node = findChild(node < 0 ? this->root : this->nodes[node].child, level, length);
+        }
+        if (node < 0) {
+            missing++;
+        }
+        level = end+1;
+    } while (end);
+    boolean exists = missing == 0 && this->nodes[node].route >= 0;
+    if (this->nodeCount + missing > MQTT_MAX_ROUTE_LEVELS || (!exists && this->routeCount >= MQTT_MAX_ROUTES)) {
+        return false;
+    }
+
+    node = -1;
+    level = filter;
+    do {
+        end = strchr(level, '/');
+        uint16_t length = end ? end-level : strlen(level);
+        int16_t* chain = node < 0 ? &this->root : &this->nodes[node].child;
+        int16_t next = findChild(*chain, level, length);
+        if (next < 0) {
+            next = this->nodeCount++;
+            Node* added = &this->nodes[next];
+            added->level = level;
+            added->length = length;
+            added->route = -1;
+            added->child = -1;
+            added->sibling = *chain;
+            *chain = next;
+        }
+        node = next;
+        level = end+1;
+    } while (end);
+
+    if (!exists) {
+        this->nodes[node].route = this->routeCount++;
+    }
+    MQTTRoute* route = &this->routes[this->nodes[node].route];
+    route->filter = filter;
+    route->qos = qos;
+    route->handler = handler;
+    return true;
+}
+
+static void capture(MQTTTopicMatch& match, const char* start, uint16_t length) {
+    if (match.count < MQTT_MAX_CAPTURES) {
+        match.captures[match.count].start = start;
+        match.captures[match.count].length = length;
+        match.count++;
+    }
+}
+
+uint8_t MQTTRouter::deliver(int8_t route, MQTTTopicMatch& match, uint8_t* payload, unsigned int length) {
+    if (route < 0 || !this->routes[route].handler) {
+        return 0;
+    }
+    this->routes[route].handler(match, payload, length);
+    return 1;
+}
+
+uint8_t MQTTRouter::walk(int16_t first, const char* level, MQTTTopicMatch& match, uint8_t* payload, unsigned int length) {
+    if (first < 0) {
+        return 0;
+    }
+    const char* end = strchr(level, '/');
+    uint16_t levelLength = end ? end-level : strlen(level);
+    // Wildcards do not match the first level of topics such as $SYS/...
+    boolean wild = level != match.topic || level[0] != '$';
+    uint8_t count = match.count;
+    uint8_t found = 0;
+    for (int16_t i = first; i >= 0; i = this->nodes[i].sibling) {
+        Node* node = &this->nodes[i];
+        boolean plus = node->length == 1 && node->level[0] == '+';
+        if (node->length == 1 && node->level[0] == '#') {
+            if (wild) {
+                capture(match, level, strlen(level));
+                found += deliver(node->route, match, payload, length);
+            }
+        } else if (plus ? wild : node->length == levelLength && memcmp(node->level, level, levelLength) == 0) {
+            if (plus) {
+                capture(match, level, levelLength);
+            }
+            if (end) {
+                found += walk(node->child, end+1, match, payload, length);
+            } else {
+                found += deliver(node->route, match, payload, length);
+                // "a/#" matches "a" as well
+                int16_t rest = findChild(node->child, "#", 1);
+                if (rest >= 0) {
+                    capture(match, level+levelLength, 0);
+                    found += deliver(this->nodes[rest].route, match, payload, length);
+                }
+            }
+        }
+        match.count = count;
+    }
+    return found;
+}
+
+uint8_t MQTTRouter::dispatch(const char* topic, uint8_t* payload, unsigned int length) {
+    MQTTTopicMatch match;
+    match.topic = topic;
+    match.count = 0;
+    return walk(this->root, topic, match, payload, length);
+}
@@ -14,9 +14,11 @@
 
 #define MQTT_VERSION_3_1      3
 #define MQTT_VERSION_3_1_1    4
+#define MQTT_VERSION_5        5
 
 // MQTT_VERSION : Pick the version
 //#define MQTT_VERSION MQTT_VERSION_3_1
+//#define MQTT_VERSION MQTT_VERSION_5
 #ifndef MQTT_VERSION
 #define MQTT_VERSION MQTT_VERSION_3_1_1
 #endif
@@ -36,6 +38,42 @@
 #define MQTT_SOCKET_TIMEOUT 15
 #endif
 
+// MQTT_RECONNECT_MIN / MQTT_RECONNECT_MAX : delay in milliseconds before loop() retries a failed
+//  connection, doubling from the minimum to the maximum. Override with setReconnectDelay()
+#ifndef MQTT_RECONNECT_MIN
+#define MQTT_RECONNECT_MIN 1000
+#endif
+#ifndef MQTT_RECONNECT_MAX
+#define MQTT_RECONNECT_MAX 60000
+#endif
+
+// MQTT_MAX_INFLIGHT : QoS 1 and 2 publishes that can await acknowledgement at once.
+//  Override with setInflightWindow()
+#ifndef MQTT_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT 4
+#endif
+
+// MQTT_MAX_ROUTES / MQTT_MAX_ROUTE_LEVELS : topic filters that can have their own handler, and
+//  the filter levels they can have between them. See subscribe(filter, qos, handler)
+#ifndef MQTT_MAX_ROUTES
+#define MQTT_MAX_ROUTES 8
+#endif
+#ifndef MQTT_MAX_ROUTE_LEVELS
+#define MQTT_MAX_ROUTE_LEVELS 32
+#endif
+
+// MQTT_MAX_CAPTURES : topic levels matched by wildcards that are passed to a handler
+#ifndef MQTT_MAX_CAPTURES
+#define MQTT_MAX_CAPTURES 4
+#endif
+
+// MQTT_MAX_TOPIC_ALIASES : under MQTT 5, topics that can be replaced by an alias in
+//  each direction. Publishes to the same few topics then carry a 2 byte alias in
+//  place of the topic after the first.
+#ifndef MQTT_MAX_TOPIC_ALIASES
+#define MQTT_MAX_TOPIC_ALIASES 8
+#endif
+
 // MQTT_MAX_TRANSFER_SIZE : limit how much data is passed to the network client
 //  in each write call. Needed for the Arduino Wifi Shield. Leave undefined to
 //  pass the entire MQTT packet in each write call.
@@ -52,6 +90,8 @@
 #define MQTT_CONNECT_UNAVAILABLE     3
 #define MQTT_CONNECT_BAD_CREDENTIALS 4
 #define MQTT_CONNECT_UNAUTHORIZED    5
+// Under MQTT 5 a refused connection leaves the CONNACK reason code instead,
+// 0x80 and above
 
 #define MQTTCONNECT     1 << 4  // Client request to connect to Server
 #define MQTTCONNACK     2 << 4  // Connect Acknowledgment
@@ -73,16 +113,111 @@
 #define MQTTQOS1        (1 << 1)
 #define MQTTQOS2        (2 << 1)
 
+// MQTT 5 properties
+#define MQTT_PROP_MESSAGE_EXPIRY      0x02
+#define MQTT_PROP_SESSION_EXPIRY      0x11
+#define MQTT_PROP_SERVER_KEEP_ALIVE   0x13
+#define MQTT_PROP_RECEIVE_MAXIMUM     0x21
+#define MQTT_PROP_TOPIC_ALIAS_MAXIMUM 0x22
+#define MQTT_PROP_TOPIC_ALIAS         0x23
+#define MQTT_PROP_MAXIMUM_PACKET_SIZE 0x27
+
 // Maximum size of fixed header and variable length size header
 #define MQTT_MAX_HEADER_SIZE 5
 
+// Most the properties of a PUBLISH take: their length, message expiry and topic alias
+// and of a SUBSCRIBE or UNSUBSCRIBE: their length
+#if MQTT_VERSION == MQTT_VERSION_5
+#define MQTT_MAX_PUBLISH_PROPERTIES 9
+#define MQTT_SUBSCRIBE_PROPERTIES 1
+#else
+#define MQTT_MAX_PUBLISH_PROPERTIES 0
+#define MQTT_SUBSCRIBE_PROPERTIES 0
+#endif
+
+// The topic of a message given to a handler, with the levels its filter
+// matched by '+' and '#' in order. Captures point into the topic and are
+// not NUL terminated; one made by '#' runs to the end of the topic.
+struct MQTTTopicMatch {
+   const char* topic;
+   uint8_t count;
+   struct {
+      const char* start;
+      uint16_t length;
+   } captures[MQTT_MAX_CAPTURES];
+};
+
 #if defined(ESP8266) || defined(ESP32)
 #include <functional>
 #define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+#define MQTT_CONNECT_CALLBACK_SIGNATURE std::function<void()> connectCallback
+#define MQTT_TOPIC_CALLBACK_SIGNATURE std::function<void(const MQTTTopicMatch&, uint8_t*, unsigned int)> handler
+#define MQTT_STREAM_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int, uint32_t, uint32_t)> streamCallback
 #else
 #define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
+#define MQTT_CONNECT_CALLBACK_SIGNATURE void (*connectCallback)()
+#define MQTT_TOPIC_CALLBACK_SIGNATURE void (*handler)(const MQTTTopicMatch&, uint8_t*, unsigned int)
+#define MQTT_STREAM_CALLBACK_SIGNATURE void (*streamCallback)(char*, uint8_t*, unsigned int, uint32_t, uint32_t)
 #endif
 
+// A topic filter with its own handler
+struct MQTTRoute {
+   const char* filter;
+   uint8_t qos;  // MQTT_ROUTE_ONLY if it is not subscribed to
+   MQTT_TOPIC_CALLBACK_SIGNATURE;
+};
+
+#define MQTT_ROUTE_ONLY 0xFF
+
+// Trie of the routed filters, one node per filter level. Nodes of the same
+// level under a parent are chained by sibling, -1 ending each chain.
+class MQTTRouter {
+private:
+   struct Node {
+      const char* level;  // into the filter, not NUL terminated
+      uint16_t length;
+      int8_t route;       // filter ending at this level, -1 if none
+      int16_t child;
+      int16_t sibling;
+   };
+   Node nodes[MQTT_MAX_ROUTE_LEVELS];
+   uint8_t nodeCount;
+   int16_t root;
+   int16_t findChild(int16_t first, const char* level, uint16_t length);
+   uint8_t deliver(int8_t route, MQTTTopicMatch& match, uint8_t* payload, unsigned int length);
+   uint8_t walk(int16_t first, const char* level, MQTTTopicMatch& match, uint8_t* payload, unsigned int length);
+public:
+   MQTTRoute routes[MQTT_MAX_ROUTES];
+   uint8_t routeCount;
+   MQTTRouter();
+   // Adds a filter, or replaces the handler and qos of one added before.
+   // Returns false if the filter is invalid or there is no room left.
+   boolean add(const char* filter, uint8_t qos, MQTT_TOPIC_CALLBACK_SIGNATURE);
+   // Calls the handler of every filter matching the topic. Returns how many.
+   uint8_t dispatch(const char* topic, uint8_t* payload, unsigned int length);
+};
+
+// A QoS 1 or 2 publish awaiting acknowledgement. The packet is the PUBLISH
+// as sent, or the PUBREL once a QoS 2 publish has been received.
+struct MQTTInflight {
+   uint16_t msgId;
+   uint16_t length;
+   uint8_t* packet;
+};
+
+// Keeps unacknowledged QoS 1 and 2 packets across restarts, in flash for
+// instance. The client holds them in RAM either way and mirrors them here.
+class MQTTPersistence {
+public:
+   virtual ~MQTTPersistence() {}
+   // Stores a packet, replacing any kept for the same message id
+   virtual void put(uint16_t msgId, const uint8_t* packet, uint16_t length) = 0;
+   virtual void remove(uint16_t msgId) = 0;
+   // Copies out the index'th packet kept, oldest first. Returns its length,
+   // 0 once there are no more.
+   virtual uint16_t get(uint16_t index, uint16_t* msgId, uint8_t* packet, uint16_t size) = 0;
+};
+
 #define CHECK_STRING_LENGTH(l,s) if (l+2+strnlen(s, this->bufferSize) > this->bufferSize) {_client->stop();return false;}
 
 class PubSubClient : public Print {
@@ -91,16 +226,106 @@ private:
    uint8_t* buffer;
    uint16_t bufferSize;
    uint16_t keepAlive;
+   uint16_t sessionKeepAlive = 0;  // keepAlive, or what the broker set for this connection
    uint16_t socketTimeout;
    uint16_t nextMsgId;
    unsigned long lastOutActivity;
    unsigned long lastInActivity;
    bool pingOutstanding;
    MQTT_CALLBACK_SIGNATURE;
+   // State of the packet readPacket() is part way through
+   uint32_t rxLength = 0;       // remaining length from the fixed header
+   uint32_t rxCount = 0;        // bytes of the packet read so far
+   uint32_t rxMultiplier = 0;   // weight of the next remaining length digit
+   uint16_t rxTopicLength = 0;  // topic length of a PUBLISH
+   uint8_t rxHeaderLength = 0;  // fixed header size, 0 until it is complete
+   bool rxOverflow = false;     // part of the packet did not fit in the buffer
+   bool rxStreamed = false;     // the payload went to streamCallback as it arrived
+   unsigned long rxLastRead = 0;
+   // Reads what has arrived of the next packet without waiting for more.
+   // Returns the packet length once it is complete, otherwise 0.
    uint32_t readPacket(uint8_t*);
-   boolean readByte(uint8_t * result);
-   boolean readByte(uint8_t * result, uint16_t * index);
+   void resetPacket();
+   MQTT_CONNECT_CALLBACK_SIGNATURE = NULL;
+   MQTT_STREAM_CALLBACK_SIGNATURE = NULL;
+   // Session loop() keeps up, see setReconnect()
+   const char* reconnectId = NULL;
+   const char* reconnectUser = NULL;
+   const char* reconnectPass = NULL;
+   const char* reconnectWillTopic = NULL;
+   uint8_t reconnectWillQos = 0;
+   boolean reconnectWillRetain = false;
+   const char* reconnectWillMessage = NULL;
+   boolean reconnectCleanSession = true;
+   uint32_t reconnectDelay = 0;  // wait before the next attempt, 0 after a success
+   uint32_t reconnectMin = MQTT_RECONNECT_MIN;
+   uint32_t reconnectMax = MQTT_RECONNECT_MAX;
+   unsigned long lastConnectAttempt = 0;
+   bool connackPending = false;
+   // Opens the connection and sends CONNECT
+   boolean startConnect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession);
+   // Returns true once the session is accepted. While it returns false
+   // connackPending tells whether the CONNACK is still awaited.
+   boolean readConnack();
+   // One step of connecting from loop(), with backoff between attempts
+   boolean reconnect();
+   // QoS 1 and 2 publishes awaiting acknowledgement, oldest first
+   MQTTInflight* inflight = NULL;
+   uint8_t inflightCount = 0;
+   uint8_t inflightWindow = 0;
+   MQTTPersistence* persistence = NULL;
+   // Filters with their own handler, allocated by the first one
+   MQTTRouter* router = NULL;
+   boolean addRoute(const char* filter, uint8_t qos, MQTT_TOPIC_CALLBACK_SIGNATURE);
+   // Subscribes again to every routed filter, after a reconnect
+   boolean renewRoutes();
+   // Passes a message to the handlers of the filters it matches, or the
+   // callback if there are none
+   void dispatch(char* topic, uint8_t* payload, unsigned int length);
+   uint16_t nextPacketId();
+   int findInflight(uint16_t msgId);
+   boolean addInflight(uint16_t msgId, const uint8_t* packet, uint16_t length);
+   void removeInflight(int index);
+   void handleAck(uint8_t type, uint16_t msgId, uint8_t reason);
+   uint8_t reasonCode = 0;
+#if MQTT_VERSION == MQTT_VERSION_5
+   // Session settings, and what the broker allows of this connection
+   uint32_t sessionExpiry = 0;
+   uint32_t messageExpiry = 0;
+   uint16_t serverReceiveMax = 65535;
+   uint8_t aliasOutMax = 0;
+   // Topics given an alias, the alias being the index + 1
+   uint8_t aliasOutCount = 0;
+   char* aliasOut[MQTT_MAX_TOPIC_ALIASES] = {};
+   char* aliasIn[MQTT_MAX_TOPIC_ALIASES] = {};
+   uint16_t writeInt32(uint32_t value, uint8_t* buf, uint16_t pos);
+   static boolean readVarInt(const uint8_t* buf, uint32_t* pos, uint32_t end, uint32_t* value);
+   // Reads the property at pos, with the value of an integer one. Returns
+   // false if it runs past end or is unknown.
+   static boolean readProperty(const uint8_t* buf, uint32_t* pos, uint32_t end, uint8_t* id, uint32_t* value);
+   void readConnackProperties(uint32_t pos, uint32_t end);
+   void clearTopicAliases();
+   // Returns the alias of a topic, giving it one if there is room, or 0.
+   // known tells whether the broker has been sent it already.
+   uint16_t topicAlias(const char* topic, boolean* known);
+   // End of the properties starting at pos in the packet being read. Until
+   // their length has been read, one past the next byte of it.
+   uint32_t propertiesEnd(uint32_t pos);
+#endif
+   // Finds the topic and payload of the PUBLISH in the buffer. Under MQTT 5
+   // the topic alias is looked up, or taken note of with its topic. Returns
+   // NULL for a topic longer than the packet, or an alias the broker never
+   // gave.
+   char* publishTopic(uint8_t headerLength, uint32_t end, uint32_t* payloadStart);
+   char* rxTopic = NULL;  // of the PUBLISH being streamed
+   // Writes the topic of a PUBLISH, its packet id if it has one and, under
+   // MQTT 5, its properties. A QoS 0 publish to a topic the broker has an
+   // alias for carries the alias instead of the topic.
+   uint16_t writeTopic(const char* topic, uint16_t msgId, uint8_t* buf, uint16_t pos);
+   // Sends what is inflight again after a reconnect, PUBLISHes marked DUP
+   boolean resendInflight();
    boolean write(uint8_t header, uint8_t* buf, uint16_t length);
+   boolean writePacket(uint8_t* packet, uint16_t length);
    uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos);
    // Build up the header ready to send
    // Returns the size of the header
@@ -134,13 +359,51 @@ public:
    PubSubClient& setServer(uint8_t * ip, uint16_t port);
    PubSubClient& setServer(const char * domain, uint16_t port);
    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+   // Takes the messages too large for the buffer, which are otherwise
+   // dropped, and passes their payload on in pieces as it arrives:
+   // streamCallback(topic, chunk, length, offset, total). The message is
+   // complete once offset + length reaches total. Only the topic has to fit
+   // in the buffer. Messages that fit still go to the callback or handlers.
+   // The callback must not publish or subscribe, which would overwrite the
+   // buffer the rest of the message is read into.
+   PubSubClient& setStreamCallback(MQTT_STREAM_CALLBACK_SIGNATURE);
    PubSubClient& setClient(Client& client);
    PubSubClient& setStream(Stream& stream);
    PubSubClient& setKeepAlive(uint16_t keepAlive);
    PubSubClient& setSocketTimeout(uint16_t timeout);
+   // Called each time a session is accepted, to subscribe for instance
+   PubSubClient& setConnectCallback(MQTT_CONNECT_CALLBACK_SIGNATURE);
+   // Has loop() connect with these details, and reconnect whenever the
+   // connection fails or is lost. Each loop() call takes one step and
+   // returns rather than waiting on the broker, though opening the network
+   // connection itself blocks for as long as the Client takes. The strings
+   // must stay valid. Pass NULL to stop.
+   PubSubClient& setReconnect(const char* id);
+   PubSubClient& setReconnect(const char* id, const char* user, const char* pass);
+   PubSubClient& setReconnect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession);
+   PubSubClient& setReconnectDelay(uint32_t min, uint32_t max);
+
+#if MQTT_VERSION == MQTT_VERSION_5
+   // Asks the broker to keep the session for this long after the connection
+   // closes. 0, the default, ends it with the connection.
+   PubSubClient& setSessionExpiry(uint32_t seconds);
+   // Has the broker discard publishes not yet delivered after this long.
+   // Applies to the following publishes, 0 keeps them indefinitely.
+   PubSubClient& setMessageExpiry(uint32_t seconds);
+#endif
+   // The last reason code the broker sent: the CONNACK return code, and
+   // under MQTT 5 also those of acknowledgements and DISCONNECT
+   uint8_t getReasonCode();
 
    boolean setBufferSize(uint16_t size);
    uint16_t getBufferSize();
+   // Sets how many QoS 1 and 2 publishes can await acknowledgement at once.
+   // Fails if more than that are inflight already.
+   boolean setInflightWindow(uint8_t size);
+   uint8_t getInflightCount();
+   // Mirrors inflight packets to the store, after taking back the ones it
+   // kept before a restart. They are sent again on the next connect.
+   PubSubClient& setPersistence(MQTTPersistence& store);
 
    boolean connect(const char* id);
    boolean connect(const char* id, const char* user, const char* pass);
@@ -152,6 +415,11 @@ public:
    boolean publish(const char* topic, const char* payload, boolean retained);
    boolean publish(const char* topic, const uint8_t * payload, unsigned int plength);
    boolean publish(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
+   // Publishes at QoS 0, 1 or 2. A QoS 1 or 2 message is kept until the
+   // broker acknowledges it, and sent again after a reconnect until then.
+   // Returns false if the inflight window is full: loop() frees it as
+   // acknowledgements arrive.
+   boolean publish(const char* topic, const uint8_t * payload, unsigned int plength, uint8_t qos, boolean retained);
    boolean publish_P(const char* topic, const char* payload, boolean retained);
    boolean publish_P(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
    // Start to publish a message.
@@ -173,6 +441,16 @@ public:
    virtual size_t write(const uint8_t *buffer, size_t size);
    boolean subscribe(const char* topic);
    boolean subscribe(const char* topic, uint8_t qos);
+   // Subscribes to the filter now if connected, and again each time a
+   // session is accepted, and passes the messages matching it to the
+   // handler rather than the callback. A message matching several filters
+   // goes to each of their handlers; one matching none goes to the
+   // callback. The filter must stay valid.
+   boolean subscribe(const char* filter, uint8_t qos, MQTT_TOPIC_CALLBACK_SIGNATURE);
+   // Passes the messages matching the filter to the handler without
+   // subscribing, for a filter another subscription covers
+   boolean route(const char* filter, MQTT_TOPIC_CALLBACK_SIGNATURE);
+   // A routed filter keeps its handler but is not subscribed to again
    boolean unsubscribe(const char* topic);
    boolean loop();
    boolean connected();
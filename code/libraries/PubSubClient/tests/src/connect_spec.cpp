@@ -3,6 +3,7 @@
 #include "Buffer.h"
 #include "BDDTest.h"
 #include "trace.h"
+#include <unistd.h>
 
 
 byte server[] = { 172, 16, 0, 2 };
@@ -11,6 +12,12 @@ void callback(char* topic, byte* payload, unsigned int length) {
   // handle message arrived
 }
 
+int connects = 0;
+
+void connect_callback() {
+  connects++;
+}
+
 
 int test_connect_fails_no_network() {
     IT("fails to connect if underlying client doesn't connect");
@@ -311,6 +318,104 @@ int test_connect_custom_keepalive() {
     END_IT
 }
 
+int test_connect_from_loop() {
+    IT("connects from loop without waiting for the connack");
+    connects = 0;
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connect[] = {0x10,0x18,0x0,0x4,0x4d,0x51,0x54,0x54,0x4,0x2,0x0,0xf,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    shimClient.expect(connect,26);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setConnectCallback(connect_callback);
+    client.setReconnect((char*)"client_test1");
+
+    int rc = client.loop();
+    IS_FALSE(rc);
+    IS_FALSE(client.connected());
+    IS_TRUE(shimClient.received() == 26);
+
+    // Still waiting: nothing is sent again
+    rc = client.loop();
+    IS_FALSE(rc);
+    IS_TRUE(shimClient.received() == 26);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.connected());
+    IS_TRUE(connects == 1);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_reconnect_backs_off() {
+    IT("backs off between connection attempts from loop (takes 3 seconds)");
+    connects = 0;
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(false);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setConnectCallback(connect_callback);
+    client.setReconnect((char*)"client_test1");
+    client.setReconnectDelay(2000, 8000);
+
+    int rc = client.loop();
+    IS_FALSE(rc);
+    IS_TRUE(client.state() == MQTT_CONNECT_FAILED);
+
+    shimClient.setAllowConnect(true);
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    rc = client.loop();
+    IS_FALSE(rc);
+    IS_TRUE(shimClient.received() == 0);
+
+    sleep(3);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.connected());
+    IS_TRUE(connects == 1);
+
+    END_IT
+}
+
+int test_reconnect_after_lost_connection() {
+    IT("reconnects from loop after losing the connection");
+    connects = 0;
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setConnectCallback(connect_callback);
+    client.setReconnect((char*)"client_test1");
+
+    int rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(connects == 1);
+
+    shimClient.setConnected(false);
+    shimClient.respond(connack,4);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.connected());
+    IS_TRUE(connects == 2);
+
+    END_IT
+}
 
 int main()
 {
@@ -332,5 +437,9 @@ int main()
     test_connect_disconnect_connect();
 
     test_connect_custom_keepalive();
+
+    test_connect_from_loop();
+    test_reconnect_backs_off();
+    test_reconnect_after_lost_connection();
     FINISH
 }
@@ -142,6 +142,37 @@ int test_keepalive_no_pings_inbound_qos1() {
     END_IT
 }
 
+int test_keepalive_waits_for_queued_pingresp() {
+    IT("stays connected while the ping response is queued behind messages (takes 40 seconds)");
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+
+    for (int i = 0; i < 40; i++) {
+        TRACE(i<<":");
+        sleep(1);
+        if (i == 15 || i == 31) {
+            byte pingreq[] = { 0xC0,0x0 };
+            shimClient.expect(pingreq,2);
+        }
+        shimClient.respond(publish,16);
+        rc = client.loop();
+        IS_TRUE(rc);
+        IS_FALSE(shimClient.error());
+    }
+
+    END_IT
+}
+
 int test_keepalive_disconnects_hung() {
     IT("disconnects a hung connection (takes 30 seconds)");
 
@@ -179,6 +210,7 @@ int main()
     test_keepalive_pings_with_outbound_qos0();
     test_keepalive_pings_with_inbound_qos0();
     test_keepalive_no_pings_inbound_qos1();
+    test_keepalive_waits_for_queued_pingresp();
     test_keepalive_disconnects_hung();
 
     FINISH
@@ -22,13 +22,24 @@ uint8_t Buffer::next() {
     return 0;
 }
 
+size_t Buffer::next(uint8_t* buf, size_t size) {
+    size_t n = this->length - this->pos;
+    n = size < n ? size : n;
+    memcpy(buf,this->buffer+this->pos,n);
+    this->pos += n;
+    return n;
+}
+
 void Buffer::reset() {
     this->pos = 0;
 }
 
 void Buffer::add(uint8_t* buf, size_t size) {
-    uint16_t i = 0;
-    for (;i<size;i++) {
-        this->buffer[this->length++] = buf[i];
+    if (this->pos == this->length) {
+        // Everything has been read, start again at the front
+        this->pos = 0;
+        this->length = 0;
     }
+    memcpy(this->buffer+this->length,buf,size);
+    this->length += size;
 }
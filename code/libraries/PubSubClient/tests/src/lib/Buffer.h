@@ -15,6 +15,7 @@ public:
 
     virtual bool available();
     virtual uint8_t next();
+    virtual size_t next(uint8_t* buf, size_t size);
     virtual void reset();
 
     virtual void add(uint8_t* buf, size_t size);
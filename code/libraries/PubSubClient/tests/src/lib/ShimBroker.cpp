@@ -0,0 +1,340 @@
+#include "ShimBroker.h"
+#include "trace.h"
+
+static bool readVarInt(const std::string& s, size_t* pos, uint32_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 28 && *pos < s.size(); shift += 7) {
+        uint8_t digit = s[(*pos)++];
+        *value |= (uint32_t)(digit & 127) << shift;
+        if ((digit & 128) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::string varInt(uint32_t value) {
+    std::string s;
+    do {
+        uint8_t digit = value & 127;
+        value >>= 7;
+        s += (char)(value > 0 ? digit | 0x80 : digit);
+    } while (value > 0);
+    return s;
+}
+
+static std::string int16(uint16_t value) {
+    return std::string(1, (char)(value >> 8)) + (char)(value & 0xFF);
+}
+
+static std::string utf8(const std::string& s) {
+    return int16(s.size()) + s;
+}
+
+static bool readString(const std::string& s, size_t* pos, std::string* value) {
+    if (*pos + 2 > s.size()) {
+        return false;
+    }
+    size_t length = ((uint8_t)s[*pos] << 8) | (uint8_t)s[*pos + 1];
+    if (*pos + 2 + length > s.size()) {
+        return false;
+    }
+    *value = s.substr(*pos + 2, length);
+    *pos += 2 + length;
+    return true;
+}
+
+ShimBroker::ShimBroker() {
+    this->connackReason = 0;
+    this->receiveMaximum = 0;
+    this->topicAliasMaximum = 0;
+    this->serverKeepAlive = -1;
+    this->autoAck = true;
+    this->protocolVersion = 0;
+    this->keepAlive = 0;
+    this->sessionExpiry = 0;
+    this->clientAliasMaximum = 0;
+    this->maximumPacketSize = 0;
+    this->pings = 0;
+    this->_connected = false;
+    this->_error = false;
+}
+
+int ShimBroker::connect(IPAddress ip, uint16_t port) {
+    this->_connected = true;
+    return 1;
+}
+
+int ShimBroker::connect(const char *host, uint16_t port) {
+    this->_connected = true;
+    return 1;
+}
+
+size_t ShimBroker::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t ShimBroker::write(const uint8_t *buf, size_t size) {
+    this->inbound.append((const char*)buf, size);
+    // Handle every packet that is complete
+    while (this->inbound.size() >= 2) {
+        size_t pos = 1;
+        uint32_t length;
+        if (!readVarInt(this->inbound, &pos, &length) || pos + length > this->inbound.size()) {
+            break;
+        }
+        uint8_t header = this->inbound[0];
+        std::string body = this->inbound.substr(pos, length);
+        this->inbound.erase(0, pos + length);
+        handle(header, body);
+    }
+    return size;
+}
+
+int ShimBroker::available() {
+    return this->outbound.size();
+}
+
+int ShimBroker::read() {
+    if (this->outbound.empty()) {
+        return -1;
+    }
+    uint8_t b = this->outbound[0];
+    this->outbound.erase(0, 1);
+    return b;
+}
+
+int ShimBroker::read(uint8_t *buf, size_t size) {
+    size_t count = size < this->outbound.size() ? size : this->outbound.size();
+    memcpy(buf, this->outbound.data(), count);
+    this->outbound.erase(0, count);
+    return count;
+}
+
+int ShimBroker::peek() {
+    return this->outbound.empty() ? -1 : (uint8_t)this->outbound[0];
+}
+
+void ShimBroker::flush() {}
+
+void ShimBroker::stop() {
+    this->_connected = false;
+}
+
+uint8_t ShimBroker::connected() {
+    return this->_connected;
+}
+
+ShimBroker::operator bool() {
+    return true;
+}
+
+bool ShimBroker::error() {
+    return this->_error;
+}
+
+bool ShimBroker::readProperties(const std::string& body, size_t* pos, std::map<uint8_t, uint32_t>& properties) {
+    uint32_t length;
+    if (!readVarInt(body, pos, &length) || *pos + length > body.size()) {
+        return false;
+    }
+    size_t end = *pos + length;
+    while (*pos < end) {
+        uint8_t id = body[(*pos)++];
+        int size;
+        switch (id) {
+        case 0x22: case 0x23:
+            size = 2;
+            break;
+        case 0x02: case 0x11: case 0x27:
+            size = 4;
+            break;
+        default:
+            // Nothing else is expected from the client
+            TRACE("unexpected property " << (int)id << "\n");
+            return false;
+        }
+        if (*pos + size > end) {
+            return false;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < size; i++) {
+            value = (value << 8) | (uint8_t)body[(*pos)++];
+        }
+        properties[id] = value;
+    }
+    return true;
+}
+
+void ShimBroker::send(uint8_t header, const std::string& body) {
+    this->outbound += (char)header;
+    this->outbound += varInt(body.size());
+    this->outbound += body;
+}
+
+void ShimBroker::handle(uint8_t header, const std::string& body) {
+    size_t pos = 0;
+    std::map<uint8_t, uint32_t> properties;
+    switch (header & 0xF0) {
+    case 0x10: { // CONNECT
+        std::string protocol;
+        if (!readString(body, &pos, &protocol) || protocol != "MQTT" || pos + 4 > body.size()) {
+            this->_error = true;
+            return;
+        }
+        this->protocolVersion = body[pos];
+        this->keepAlive = ((uint8_t)body[pos + 2] << 8) | (uint8_t)body[pos + 3];
+        pos += 4;
+        if (!readProperties(body, &pos, properties)) {
+            this->_error = true;
+            return;
+        }
+        this->sessionExpiry = properties[0x11];
+        this->clientAliasMaximum = properties[0x22];
+        this->maximumPacketSize = properties[0x27];
+        this->clientAliases.clear();
+        this->brokerAliases.clear();
+
+        std::string connack("\x00", 1);
+        connack += (char)this->connackReason;
+        std::string props;
+        if (this->receiveMaximum) {
+            props += '\x21' + int16(this->receiveMaximum);
+        }
+        if (this->topicAliasMaximum) {
+            props += '\x22' + int16(this->topicAliasMaximum);
+        }
+        if (this->serverKeepAlive >= 0) {
+            props += '\x13' + int16(uint16_t(this->serverKeepAlive));
+        }
+        send(0x20, connack + varInt(props.size()) + props);
+        break;
+    }
+    case 0x30: { // PUBLISH
+        Publish p;
+        p.qos = (header >> 1) & 3;
+        p.dup = (header & 0x08) != 0;
+        p.msgId = 0;
+        p.packetLength = 1 + varInt(body.size()).size() + body.size();
+        if (!readString(body, &pos, &p.topic)) {
+            this->_error = true;
+            return;
+        }
+        if (p.qos > 0) {
+            p.msgId = ((uint8_t)body[pos] << 8) | (uint8_t)body[pos + 1];
+            pos += 2;
+        }
+        if (!readProperties(body, &pos, properties)) {
+            this->_error = true;
+            return;
+        }
+        p.alias = properties[0x23];
+        p.expiry = properties[0x02];
+        p.sentTopic = !p.topic.empty();
+        if (p.alias > this->topicAliasMaximum) {
+            this->_error = true;
+        } else if (p.alias && p.sentTopic) {
+            this->clientAliases[p.alias] = p.topic;
+        } else if (p.alias) {
+            if (this->clientAliases.count(p.alias) == 0) {
+                this->_error = true;
+            }
+            p.topic = this->clientAliases[p.alias];
+        } else if (!p.sentTopic) {
+            this->_error = true;
+        }
+        p.payload = body.substr(pos);
+        this->published.push_back(p);
+        if (p.qos == 1 && this->autoAck) {
+            send(0x40, int16(p.msgId));
+        } else if (p.qos == 1) {
+            this->unacked.push_back(p.msgId);
+        } else if (p.qos == 2) {
+            send(0x50, int16(p.msgId));
+        }
+        break;
+    }
+    case 0x40: // PUBACK
+        this->acked.push_back(((uint8_t)body[0] << 8) | (uint8_t)body[1]);
+        break;
+    case 0x60: // PUBREL
+        send(0x70, body.substr(0, 2));
+        break;
+    case 0x80: { // SUBSCRIBE
+        std::string suback = body.substr(0, 2);
+        pos = 2;
+        if (!readProperties(body, &pos, properties)) {
+            this->_error = true;
+            return;
+        }
+        suback += '\x00';
+        std::string filter;
+        while (readString(body, &pos, &filter) && pos < body.size()) {
+            this->subscriptions.push_back(filter);
+            suback += (char)(body[pos++] & 3);
+        }
+        send(0x90, suback);
+        break;
+    }
+    case 0xA0: { // UNSUBSCRIBE
+        std::string unsuback = body.substr(0, 2);
+        pos = 2;
+        if (!readProperties(body, &pos, properties)) {
+            this->_error = true;
+            return;
+        }
+        unsuback += '\x00';
+        std::string filter;
+        while (readString(body, &pos, &filter)) {
+            unsuback += '\x00';
+        }
+        send(0xB0, unsuback);
+        break;
+    }
+    case 0xC0: // PINGREQ
+        this->pings++;
+        send(0xD0, "");
+        break;
+    case 0xE0: // DISCONNECT
+        this->_connected = false;
+        break;
+    default:
+        this->_error = true;
+    }
+}
+
+void ShimBroker::deliver(const std::string& topic, const std::string& payload, uint8_t qos, uint16_t msgId) {
+    std::string body;
+    std::string props;
+    if (this->brokerAliases.count(topic)) {
+        body += utf8("");
+        props += '\x23' + int16(this->brokerAliases[topic]);
+    } else if (this->brokerAliases.size() < this->clientAliasMaximum) {
+        uint16_t alias = this->brokerAliases.size() + 1;
+        this->brokerAliases[topic] = alias;
+        body += utf8(topic);
+        props += '\x23' + int16(alias);
+    } else {
+        body += utf8(topic);
+    }
+    if (qos > 0) {
+        body += int16(msgId);
+    }
+    body += varInt(props.size()) + props;
+    body += payload;
+    send(0x30 | (qos << 1), body);
+}
+
+void ShimBroker::ack(uint16_t msgId, uint8_t reason) {
+    for (size_t i = 0; i < this->unacked.size(); i++) {
+        if (this->unacked[i] == msgId) {
+            this->unacked.erase(this->unacked.begin() + i);
+            break;
+        }
+    }
+    send(0x40, reason ? int16(msgId) + (char)reason : int16(msgId));
+}
+
+void ShimBroker::disconnect(uint8_t reason) {
+    send(0xE0, std::string(1, (char)reason) + '\x00');
+}
@@ -0,0 +1,85 @@
+#ifndef shimbroker_h
+#define shimbroker_h
+
+#include "Arduino.h"
+#include "Client.h"
+#include "IPAddress.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Stands in for an MQTT 5 broker: takes the packets the client writes,
+// records them and answers as a broker would. Topic aliases are resolved
+// in both directions, so tests can check what the broker made of them.
+class ShimBroker : public Client {
+public:
+    struct Publish {
+        std::string topic;    // with any alias resolved
+        std::string payload;
+        uint8_t qos;
+        bool dup;
+        uint16_t msgId;
+        uint16_t alias;
+        bool sentTopic;       // the packet carried the topic itself
+        uint32_t expiry;      // 0 if there was no message expiry
+        size_t packetLength;
+    };
+
+    // What the CONNACK grants, 0 leaving a property out
+    uint8_t connackReason;
+    uint16_t receiveMaximum;
+    uint16_t topicAliasMaximum;
+    // The Server Keep Alive of the CONNACK, -1 leaving it out
+    int32_t serverKeepAlive;
+    // Acknowledge QoS 1 and 2 publishes as they arrive, otherwise ack()
+    bool autoAck;
+
+    // What the client sent
+    uint8_t protocolVersion;
+    uint16_t keepAlive;
+    uint32_t sessionExpiry;
+    uint16_t clientAliasMaximum;
+    uint32_t maximumPacketSize;
+    std::vector<Publish> published;
+    std::vector<std::string> subscriptions;
+    std::vector<uint16_t> unacked;
+    std::vector<uint16_t> acked;  // by the client
+    int pings;
+
+    ShimBroker();
+    virtual int connect(IPAddress ip, uint16_t port);
+    virtual int connect(const char *host, uint16_t port);
+    virtual size_t write(uint8_t);
+    virtual size_t write(const uint8_t *buf, size_t size);
+    virtual int available();
+    virtual int read();
+    virtual int read(uint8_t *buf, size_t size);
+    virtual int peek();
+    virtual void flush();
+    virtual void stop();
+    virtual uint8_t connected();
+    virtual operator bool();
+
+    // Publishes to the client, with a topic alias if it allows them
+    void deliver(const std::string& topic, const std::string& payload, uint8_t qos = 0, uint16_t msgId = 0);
+    // Acknowledges a QoS 1 publish held back by autoAck being false
+    void ack(uint16_t msgId, uint8_t reason = 0);
+    // Closes the connection from the broker side
+    void disconnect(uint8_t reason);
+    // Set by anything the client sent that a broker would reject
+    bool error();
+
+private:
+    bool _connected;
+    bool _error;
+    std::string inbound;
+    std::string outbound;
+    std::map<uint16_t, std::string> clientAliases;
+    std::map<std::string, uint16_t> brokerAliases;
+    void handle(uint8_t header, const std::string& body);
+    void send(uint8_t header, const std::string& body);
+    bool readProperties(const std::string& body, size_t* pos, std::map<uint8_t, uint32_t>& properties);
+};
+
+#endif
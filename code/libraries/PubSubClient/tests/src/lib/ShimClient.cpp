@@ -101,11 +101,9 @@ int ShimClient::available()  {
 }
 int ShimClient::read()  { return this->responseBuffer->next(); }
 int ShimClient::read(uint8_t *buf, size_t size) {
-    uint16_t i = 0;
-    for (;i<size;i++) {
-        buf[i] = this->read();
-    }
-    return size;
+    // Like a socket, hands over what has arrived up to size
+    size_t n = this->responseBuffer->next(buf,size);
+    return n > 0 ? (int)n : -1;
 }
 int ShimClient::peek()  { return 0; }
 void ShimClient::flush() {}
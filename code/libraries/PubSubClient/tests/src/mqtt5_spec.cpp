@@ -0,0 +1,387 @@
+#include "PubSubClient.h"
+#include "ShimBroker.h"
+#include "BDDTest.h"
+#include "trace.h"
+
+#include <string>
+#include <unistd.h>
+
+// Built with MQTT_VERSION set to MQTT_VERSION_5, see the Makefile
+
+byte server[] = { 172, 16, 0, 2 };
+
+const char* sensorTopic = "UCL/OPS/107/EM/gosund/plug1/SENSOR";
+
+int received = 0;
+std::string lastTopic;
+std::string lastPayload;
+
+void callback(char* topic, byte* payload, unsigned int length) {
+    received++;
+    lastTopic = topic;
+    lastPayload.assign((char*)payload, length);
+}
+
+std::string streamTopic;
+std::string streamed;
+uint32_t streamTotal = 0;
+
+void stream_callback(char* topic, byte* chunk, unsigned int length, uint32_t offset, uint32_t total) {
+    if (offset == 0) {
+        streamTopic = topic;
+        streamed.clear();
+    }
+    streamed.append((char*)chunk, length);
+    streamTotal = total;
+}
+
+int test_connect_properties() {
+    IT("connects with MQTT 5 properties");
+    ShimBroker broker;
+
+    PubSubClient client(server, 1883, callback, broker);
+    client.setBufferSize(300);
+    client.setSessionExpiry(3600);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.connected());
+
+    IS_TRUE(broker.protocolVersion == 5);
+    IS_TRUE(broker.keepAlive == MQTT_KEEPALIVE);
+    IS_TRUE(broker.sessionExpiry == 3600);
+    IS_TRUE(broker.clientAliasMaximum == MQTT_MAX_TOPIC_ALIASES);
+    IS_TRUE(broker.maximumPacketSize == 300);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int test_connect_refused() {
+    IT("leaves the CONNACK reason code of a refused connection");
+    ShimBroker broker;
+    broker.connackReason = 0x87; // Not authorized
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_FALSE(rc);
+    IS_TRUE(client.state() == 0x87);
+    IS_TRUE(client.getReasonCode() == 0x87);
+
+    END_IT
+}
+
+int test_server_keep_alive() {
+    IT("takes the keep alive the broker sets");
+    ShimBroker broker;
+    broker.serverKeepAlive = 30;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(broker.keepAlive == MQTT_KEEPALIVE);
+    client.disconnect();
+
+    // Only for that connection: the next one asks for its own again
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(broker.keepAlive == MQTT_KEEPALIVE);
+
+    END_IT
+}
+
+int test_server_keep_alive_off() {
+    IT("does not ping when the broker turns keep alive off (takes 2 seconds)");
+    ShimBroker broker;
+    broker.serverKeepAlive = 0;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    sleep(2);
+    for (int i = 0; i < 3; i++) {
+        IS_TRUE(client.loop());
+    }
+    IS_TRUE(broker.pings == 0);
+    IS_TRUE(client.connected());
+
+    END_IT
+}
+
+int test_publish_topic_alias() {
+    IT("replaces a topic published before with its alias");
+    ShimBroker broker;
+    broker.topicAliasMaximum = 1;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    for (int i = 0; i < 3; i++) {
+        rc = client.publish(sensorTopic, "{}");
+        IS_TRUE(rc);
+    }
+    // Beyond what the broker allows, the topic is sent every time
+    IS_TRUE(client.publish("other/topic", "{}"));
+    IS_TRUE(client.publish("other/topic", "{}"));
+
+    IS_TRUE(broker.published.size() == 5);
+    IS_TRUE(broker.published[0].sentTopic);
+    IS_TRUE(broker.published[0].alias == 1);
+    for (int i = 1; i < 3; i++) {
+        IS_FALSE(broker.published[i].sentTopic);
+        IS_TRUE(broker.published[i].alias == 1);
+        IS_TRUE(broker.published[i].topic == sensorTopic);
+        IS_TRUE(broker.published[i].payload == "{}");
+        IS_TRUE(broker.published[i].packetLength + strlen(sensorTopic) == broker.published[0].packetLength);
+    }
+    IS_TRUE(broker.published[3].sentTopic);
+    IS_TRUE(broker.published[3].alias == 0);
+    IS_TRUE(broker.published[4].sentTopic);
+
+    // Aliases start over with each connection
+    client.disconnect();
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.publish(sensorTopic, "{}"));
+    IS_TRUE(broker.published[5].sentTopic);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int test_publish_qos1_keeps_topic() {
+    IT("sends the topic of qos 1 publishes in full");
+    ShimBroker broker;
+    broker.topicAliasMaximum = 4;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_TRUE(client.publish(sensorTopic, (const uint8_t*)"{}", 2, 1, false));
+    IS_TRUE(client.publish(sensorTopic, (const uint8_t*)"{}", 2, 1, false));
+    // A PUBACK for each
+    rc = client.loop();
+    IS_TRUE(rc);
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    IS_TRUE(broker.published.size() == 2);
+    IS_TRUE(broker.published[1].sentTopic);
+    IS_TRUE(broker.published[1].alias == 0);
+    IS_TRUE(client.getInflightCount() == 0);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int test_publish_qos2() {
+    IT("completes a qos 2 publish");
+    ShimBroker broker;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_TRUE(client.publish(sensorTopic, (const uint8_t*)"{}", 2, 2, false));
+    IS_TRUE(client.getInflightCount() == 1);
+    // PUBREC, answered by PUBREL
+    rc = client.loop();
+    IS_TRUE(rc);
+    // PUBCOMP
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.getInflightCount() == 0);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int test_receive_topic_alias() {
+    IT("looks up the topic of a message sent with an alias");
+    ShimBroker broker;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.subscribe("UCL/OPS/107/EM/gosund/#"));
+    IS_TRUE(broker.subscriptions.size() == 1);
+    IS_TRUE(broker.subscriptions[0] == "UCL/OPS/107/EM/gosund/#");
+    // SUBACK
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    received = 0;
+    broker.deliver(sensorTopic, "one");
+    broker.deliver(sensorTopic, "two", 1, 0x1234);
+    rc = client.loop();
+    IS_TRUE(rc);
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    IS_TRUE(received == 2);
+    IS_TRUE(lastTopic == sensorTopic);
+    IS_TRUE(lastPayload == "two");
+    IS_TRUE(broker.acked.size() == 1);
+    IS_TRUE(broker.acked[0] == 0x1234);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int test_receive_maximum() {
+    IT("keeps to the receive maximum of the broker");
+    ShimBroker broker;
+    broker.receiveMaximum = 2;
+    broker.autoAck = false;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_TRUE(client.publish(sensorTopic, (const uint8_t*)"1", 1, 1, false));
+    IS_TRUE(client.publish(sensorTopic, (const uint8_t*)"2", 1, 1, false));
+    IS_FALSE(client.publish(sensorTopic, (const uint8_t*)"3", 1, 1, false));
+    IS_TRUE(broker.published.size() == 2);
+
+    broker.ack(broker.unacked[0]);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.publish(sensorTopic, (const uint8_t*)"3", 1, 1, false));
+    IS_TRUE(broker.published.size() == 3);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int test_message_expiry() {
+    IT("sends the message expiry interval");
+    ShimBroker broker;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    client.setMessageExpiry(60);
+    IS_TRUE(client.publish(sensorTopic, "{}"));
+    IS_TRUE(client.publish(sensorTopic, (const uint8_t*)"{}", 2, 1, false));
+    client.setMessageExpiry(0);
+    IS_TRUE(client.publish(sensorTopic, "{}"));
+
+    IS_TRUE(broker.published[0].expiry == 60);
+    IS_TRUE(broker.published[1].expiry == 60);
+    IS_TRUE(broker.published[2].expiry == 0);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int test_reason_codes() {
+    IT("takes the reason codes of acknowledgements and disconnects");
+    ShimBroker broker;
+    broker.autoAck = false;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_TRUE(client.publish(sensorTopic, (const uint8_t*)"{}", 2, 1, false));
+    broker.ack(broker.unacked[0], 0x87);
+    rc = client.loop();
+    IS_TRUE(rc);
+    // Refused, but done with
+    IS_TRUE(client.getInflightCount() == 0);
+    IS_TRUE(client.getReasonCode() == 0x87);
+
+    broker.disconnect(0x8E); // Session taken over
+    rc = client.loop();
+    IS_FALSE(rc);
+    IS_FALSE(client.connected());
+    IS_TRUE(client.state() == MQTT_CONNECTION_LOST);
+    IS_TRUE(client.getReasonCode() == 0x8E);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int test_stream_with_properties() {
+    IT("streams a large message that has properties");
+    ShimBroker broker;
+
+    PubSubClient client(server, 1883, callback, broker);
+    client.setBufferSize(64);
+    client.setStreamCallback(stream_callback);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    // A stream callback takes what does not fit, so there is no limit to ask for
+    IS_TRUE(broker.maximumPacketSize == 0);
+
+    std::string payload;
+    for (int i = 0; i < 300; i++) {
+        payload += (char)('a' + i % 26);
+    }
+    received = 0;
+    broker.deliver(sensorTopic, payload);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(streamTopic == sensorTopic);
+    IS_TRUE(streamed == payload);
+    IS_TRUE(streamTotal == 300);
+
+    // Again, with the alias only
+    streamTopic.clear();
+    broker.deliver(sensorTopic, payload);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(streamTopic == sensorTopic);
+    IS_TRUE(streamed == payload);
+    IS_TRUE(received == 0);
+
+    END_IT
+}
+
+int test_unsubscribe() {
+    IT("unsubscribes");
+    ShimBroker broker;
+
+    PubSubClient client(server, 1883, callback, broker);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_TRUE(client.subscribe("topic", 1));
+    IS_TRUE(client.unsubscribe("topic"));
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    IS_FALSE(broker.error());
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("MQTT 5");
+    test_connect_properties();
+    test_connect_refused();
+    test_server_keep_alive();
+    test_server_keep_alive_off();
+    test_publish_topic_alias();
+    test_publish_qos1_keeps_topic();
+    test_publish_qos2();
+    test_receive_topic_alias();
+    test_receive_maximum();
+    test_message_expiry();
+    test_reason_codes();
+    test_stream_with_properties();
+    test_unsubscribe();
+    FINISH
+}
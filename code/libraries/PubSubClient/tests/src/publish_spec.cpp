@@ -173,8 +173,262 @@ int test_publish_P() {
     END_IT
 }
 
+int test_publish_qos1() {
+    IT("publishes at qos1 and keeps the message until it is acknowledged");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte payload[] = { 0x01,0x02,0x03,0x0,0x05 };
+    int length = 5;
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x32,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x2,0x1,0x2,0x3,0x0,0x5};
+    shimClient.expect(publish,16);
+
+    rc = client.publish((char*)"topic",payload,length,1,false);
+    IS_TRUE(rc);
+    IS_TRUE(client.getInflightCount() == 1);
+
+    byte puback[] = {0x40,0x2,0x0,0x2};
+    shimClient.respond(puback,4);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.getInflightCount() == 0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_qos2() {
+    IT("publishes at qos2 and releases the message when it is received");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte payload[] = { 0x01,0x02,0x03,0x0,0x05 };
+    int length = 5;
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x34,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x2,0x1,0x2,0x3,0x0,0x5};
+    shimClient.expect(publish,16);
+
+    rc = client.publish((char*)"topic",payload,length,2,false);
+    IS_TRUE(rc);
+
+    byte pubrec[] = {0x50,0x2,0x0,0x2};
+    shimClient.respond(pubrec,4);
+    byte pubrel[] = {0x62,0x2,0x0,0x2};
+    shimClient.expect(pubrel,4);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.getInflightCount() == 1);
+
+    byte pubcomp[] = {0x70,0x2,0x0,0x2};
+    shimClient.respond(pubcomp,4);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.getInflightCount() == 0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_inflight_window() {
+    IT("pipelines qos1 messages up to the inflight window");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte payload[] = { 0x01,0x02,0x03,0x0,0x05 };
+    int length = 5;
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    IS_TRUE(client.setInflightWindow(2));
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_TRUE(client.publish((char*)"topic",payload,length,1,false));
+    IS_TRUE(client.publish((char*)"topic",payload,length,1,false));
+    IS_FALSE(client.publish((char*)"topic",payload,length,1,false));
+    IS_TRUE(client.getInflightCount() == 2);
+    IS_FALSE(client.setInflightWindow(1));
+
+    // Acknowledged out of order
+    byte puback[] = {0x40,0x2,0x0,0x3};
+    shimClient.respond(puback,4);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.getInflightCount() == 1);
+
+    // The next id skips the one still inflight
+    byte publish[] = {0x32,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x4,0x1,0x2,0x3,0x0,0x5};
+    shimClient.expect(publish,16);
+    IS_TRUE(client.publish((char*)"topic",payload,length,1,false));
+    IS_TRUE(client.getInflightCount() == 2);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_resend_on_reconnect() {
+    IT("resends unacknowledged messages as duplicates after reconnecting");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte payload[] = { 0x01,0x02,0x03,0x0,0x05 };
+    int length = 5;
 
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
 
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    rc = client.publish((char*)"topic",payload,length,1,false);
+    IS_TRUE(rc);
+
+    shimClient.setConnected(false);
+    IS_FALSE(client.connected());
+
+    byte connect[] = {0x10,0x18,0x0,0x4,0x4d,0x51,0x54,0x54,0x4,0x2,0x0,0xf,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    shimClient.expect(connect,26);
+    byte publish[] = {0x3a,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x2,0x1,0x2,0x3,0x0,0x5};
+    shimClient.expect(publish,16);
+    shimClient.respond(connack,4);
+
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.getInflightCount() == 1);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+// Keeps packets in RAM, standing in for flash
+class MemoryPersistence : public MQTTPersistence {
+public:
+    uint16_t ids[4];
+    uint8_t packets[4][32];
+    uint16_t lengths[4];
+    int count;
+
+    MemoryPersistence() : count(0) {}
+
+    virtual void put(uint16_t msgId, const uint8_t* packet, uint16_t length) {
+        int i = 0;
+        while (i < count && ids[i] != msgId) {
+            i++;
+        }
+        if (i == count) {
+            count++;
+        }
+        ids[i] = msgId;
+        memcpy(packets[i],packet,length);
+        lengths[i] = length;
+    }
+
+    virtual void remove(uint16_t msgId) {
+        for (int i = 0; i < count; i++) {
+            if (ids[i] == msgId) {
+                count--;
+                ids[i] = ids[count];
+                memcpy(packets[i],packets[count],lengths[count]);
+                lengths[i] = lengths[count];
+            }
+        }
+    }
+
+    virtual uint16_t get(uint16_t index, uint16_t* msgId, uint8_t* packet, uint16_t size) {
+        if (index >= count || lengths[index] > size) {
+            return 0;
+        }
+        *msgId = ids[index];
+        memcpy(packet,packets[index],lengths[index]);
+        return lengths[index];
+    }
+};
+
+int test_publish_persistence() {
+    IT("restores unacknowledged messages from a persistence store");
+    MemoryPersistence store;
+
+    byte payload[] = { 0x01,0x02,0x03,0x0,0x05 };
+    int length = 5;
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+
+    {
+        ShimClient shimClient;
+        shimClient.setAllowConnect(true);
+        shimClient.respond(connack,4);
+
+        PubSubClient client(server, 1883, callback, shimClient);
+        client.setPersistence(store);
+        int rc = client.connect((char*)"client_test1");
+        IS_TRUE(rc);
+
+        IS_TRUE(client.publish((char*)"topic",payload,length,1,false));
+        IS_TRUE(client.publish((char*)"topic",payload,length,2,false));
+        IS_TRUE(store.count == 2);
+
+        byte puback[] = {0x40,0x2,0x0,0x2};
+        shimClient.respond(puback,4);
+        rc = client.loop();
+        IS_TRUE(rc);
+        IS_TRUE(store.count == 1);
+
+        // The qos2 message is received, then the device restarts
+        byte pubrec[] = {0x50,0x2,0x0,0x3};
+        shimClient.respond(pubrec,4);
+        rc = client.loop();
+        IS_TRUE(rc);
+        IS_TRUE(store.count == 1);
+        IS_TRUE(store.lengths[0] == 4);
+    }
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setPersistence(store);
+    IS_TRUE(client.getInflightCount() == 1);
+
+    byte connect[] = {0x10,0x18,0x0,0x4,0x4d,0x51,0x54,0x54,0x4,0x2,0x0,0xf,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    shimClient.expect(connect,26);
+    byte pubrel[] = {0x62,0x2,0x0,0x3};
+    shimClient.expect(pubrel,4);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte pubcomp[] = {0x70,0x2,0x0,0x3};
+    shimClient.respond(pubcomp,4);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.getInflightCount() == 0);
+    IS_TRUE(store.count == 0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
 
 int main()
 {
@@ -186,6 +440,11 @@ int main()
     test_publish_not_connected();
     test_publish_too_long();
     test_publish_P();
+    test_publish_qos1();
+    test_publish_qos2();
+    test_publish_inflight_window();
+    test_publish_resend_on_reconnect();
+    test_publish_persistence();
 
     FINISH
 }
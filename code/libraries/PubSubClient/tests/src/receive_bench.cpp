@@ -0,0 +1,90 @@
+#include "PubSubClient.h"
+#include "ShimClient.h"
+#include "Buffer.h"
+#include "trace.h"
+#include <chrono>
+#include <stdio.h>
+
+// Receive throughput with Tasmota SENSOR sized messages, whole and split
+// into TCP segment sized pieces
+
+byte server[] = { 172, 16, 0, 2 };
+
+#define MESSAGES 200000
+
+unsigned long received = 0;
+unsigned long payloadBytes = 0;
+bool complete = true;
+
+void callback(char* topic, byte* payload, unsigned int length) {
+    received++;
+    payloadBytes += length;
+}
+
+// A QoS 0 PUBLISH of a tele/<plug>/SENSOR message about 400 bytes long
+size_t build_publish(byte* packet) {
+    const char* topic = "tele/plug_07/SENSOR";
+    char payload[512];
+    int plength = snprintf(payload, sizeof(payload),
+        "{\"Time\":\"2023-07-11T22:29:54\",\"ENERGY\":{"
+        "\"Total\":123.456,\"Yesterday\":1.234,\"Today\":0.567,\"Period\":12,\"Power\":1234,"
+        "\"ApparentPower\":1300,\"ReactivePower\":400,\"Factor\":0.95,\"Voltage\":230,\"Current\":5.652},"
+        "\"ANALOG\":{\"Temperature\":31.2},\"TempUnit\":\"C\",\"Wifi\":{\"AP\":1,\"SSId\":\"marble-run\","
+        "\"Channel\":6,\"Mode\":\"11n\",\"RSSI\":78,\"Signal\":-61},"
+        "\"Uptime\":\"3T04:05:06\",\"Heap\":25,"
+        "\"Sleep\":50,\"LoadAvg\":19,\"MqttCount\":1}");
+    size_t tlength = strlen(topic);
+    size_t length = 2 + tlength + plength;
+    size_t pos = 0;
+    packet[pos++] = 0x30;
+    packet[pos++] = (length & 127) | 0x80;
+    packet[pos++] = length >> 7;
+    packet[pos++] = tlength >> 8;
+    packet[pos++] = tlength & 0xFF;
+    memcpy(packet + pos, topic, tlength);
+    pos += tlength;
+    memcpy(packet + pos, payload, plength);
+    return pos + plength;
+}
+
+void run(const char* name, size_t segment) {
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setBufferSize(512);
+    client.connect((char*)"client_test1");
+
+    byte packet[600];
+    size_t length = build_publish(packet);
+
+    received = 0;
+    payloadBytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < MESSAGES; i++) {
+        for (size_t sent = 0; sent < length; sent += segment) {
+            shimClient.respond(packet + sent, sent + segment < length ? segment : length - sent);
+            client.loop();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char line[160];
+    snprintf(line, sizeof(line), " - %-28s %8.0f msg/s %7.1f MB/s %6.2f us/msg %s\n", name,
+             received / seconds, received * length / seconds / 1e6, seconds * 1e6 / MESSAGES,
+             received == MESSAGES ? "" : "(messages lost)");
+    LOG(line);
+    complete = complete && received == MESSAGES;
+}
+
+int main()
+{
+    LOG("Receive throughput, " << MESSAGES << " messages\n");
+    run("whole packets", 600);
+    run("64 byte pieces", 64);
+    run("7 byte pieces", 7);
+    return complete ? 0 : 1;
+}
@@ -3,6 +3,7 @@
 #include "Buffer.h"
 #include "BDDTest.h"
 #include "trace.h"
+#include <unistd.h>
 
 
 byte server[] = { 172, 16, 0, 2 };
@@ -324,6 +325,245 @@ int test_receive_qos1() {
     END_IT
 }
 
+int test_receive_split_message() {
+    IT("receives a message that arrives in pieces");
+    reset_callback();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x32,0x10,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x12,0x34,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    byte puback[] = {0x40,0x2,0x12,0x34};
+    shimClient.expect(puback,4);
+
+    // Header, topic length, part of the topic, then the rest
+    int pieces[] = {1, 2, 4, 11};
+    int sent = 0;
+    for (int i = 0; i < 4; i++) {
+        IS_FALSE(callback_called);
+        shimClient.respond(publish+sent,pieces[i]);
+        sent += pieces[i];
+        rc = client.loop();
+        IS_TRUE(rc);
+    }
+
+    IS_TRUE(callback_called);
+    IS_TRUE(strcmp(lastTopic,"topic")==0);
+    IS_TRUE(memcmp(lastPayload,"payload",7)==0);
+    IS_TRUE(lastLength == 7);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_drop_stalled_message() {
+    IT("disconnects when a message stops part way through");
+    reset_callback();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setSocketTimeout(1);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f};
+    shimClient.respond(publish,6);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    sleep(2);
+
+    rc = client.loop();
+    IS_FALSE(rc);
+    IS_FALSE(callback_called);
+    IS_TRUE(client.state() == MQTT_CONNECTION_TIMEOUT);
+
+    END_IT
+}
+
+char streamTopic[64];
+byte streamed[1024];
+uint32_t streamedLength;
+uint32_t streamTotal;
+int streamChunks;
+bool streamInOrder;
+
+void reset_stream() {
+    streamTopic[0] = '\0';
+    streamedLength = 0;
+    streamTotal = 0;
+    streamChunks = 0;
+    streamInOrder = true;
+}
+
+void stream_callback(char* topic, byte* chunk, unsigned int length, uint32_t offset, uint32_t total) {
+    strcpy(streamTopic,topic);
+    streamInOrder = streamInOrder && offset == streamedLength && (streamChunks == 0 || total == streamTotal);
+    memcpy(streamed+offset,chunk,length);
+    streamedLength = offset+length;
+    streamTotal = total;
+    streamChunks++;
+}
+
+// A PUBLISH with a two byte remaining length and a payload of counting bytes
+int build_large_publish(byte* packet, byte qos, int plength) {
+    int length = 2 + 5 + (qos ? 2 : 0) + plength;
+    int pos = 0;
+    packet[pos++] = 0x30 | (qos << 1);
+    packet[pos++] = (length & 127) | 0x80;
+    packet[pos++] = length >> 7;
+    packet[pos++] = 0;
+    packet[pos++] = 5;
+    memcpy(packet+pos,"topic",5);
+    pos += 5;
+    if (qos) {
+        packet[pos++] = 0x12;
+        packet[pos++] = 0x34;
+    }
+    for (int i = 0; i < plength; i++) {
+        packet[pos++] = i % 251;
+    }
+    return pos;
+}
+
+bool streamed_counting(int plength) {
+    for (int i = 0; i < plength; i++) {
+        if (streamed[i] != i % 251) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int test_receive_streamed_message() {
+    IT("streams a message too large for the buffer");
+    reset_callback();
+    reset_stream();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setBufferSize(32);
+    client.setStreamCallback(stream_callback);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte packet[400];
+    int length = build_large_publish(packet, 0, 300);
+    // In pieces that do not line up with the buffer
+    for (int sent = 0; sent < length; sent += 50) {
+        shimClient.respond(packet+sent, sent+50 < length ? 50 : length-sent);
+        rc = client.loop();
+        IS_TRUE(rc);
+    }
+
+    IS_FALSE(callback_called);
+    IS_TRUE(strcmp(streamTopic,"topic")==0);
+    IS_TRUE(streamInOrder);
+    IS_TRUE(streamChunks > 1);
+    IS_TRUE(streamedLength == 300);
+    IS_TRUE(streamTotal == 300);
+    IS_TRUE(streamed_counting(300));
+
+    // Messages that fit still go to the callback
+    reset_stream();
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.respond(publish,16);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(callback_called);
+    IS_TRUE(lastLength == 7);
+    IS_TRUE(streamChunks == 0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_receive_streamed_qos1() {
+    IT("acknowledges a streamed qos1 message");
+    reset_callback();
+    reset_stream();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setBufferSize(32);
+    client.setStreamCallback(stream_callback);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte packet[200];
+    int length = build_large_publish(packet, 1, 150);
+    shimClient.respond(packet,length);
+
+    byte puback[] = {0x40,0x2,0x12,0x34};
+    shimClient.expect(puback,4);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    IS_FALSE(callback_called);
+    IS_TRUE(streamInOrder);
+    IS_TRUE(streamedLength == 150);
+    IS_TRUE(streamTotal == 150);
+    IS_TRUE(streamed_counting(150));
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_drop_message_with_topic_past_its_end() {
+    IT("drops a message whose topic runs past its end");
+    reset_callback();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0x04,0x0,0x5,0x74,0x6f};
+    shimClient.respond(publish,6);
+
+    rc = client.loop();
+
+    IS_TRUE(rc);
+
+    IS_FALSE(callback_called);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
 int main()
 {
     SUITE("Receive");
@@ -331,10 +571,15 @@ int main()
     test_receive_stream();
     test_receive_max_sized_message();
     test_drop_invalid_remaining_length_message();
+    test_drop_message_with_topic_past_its_end();
     test_receive_oversized_message();
     test_resize_buffer();
     test_receive_oversized_stream_message();
     test_receive_qos1();
+    test_receive_split_message();
+    test_drop_stalled_message();
+    test_receive_streamed_message();
+    test_receive_streamed_qos1();
 
     FINISH
 }
@@ -164,6 +164,202 @@ int test_unsubscribe_not_connected() {
     END_IT
 }
 
+char captured[MQTT_MAX_CAPTURES][32];
+uint8_t capturedCount = 0;
+int handled = 0;
+int unrouted = 0;
+
+void unrouted_callback(char* topic, byte* payload, unsigned int length) {
+    unrouted++;
+}
+
+void handler(const MQTTTopicMatch& match, byte* payload, unsigned int length) {
+    handled++;
+    capturedCount = match.count;
+    for (uint8_t i = 0; i < match.count; i++) {
+        memcpy(captured[i], match.captures[i].start, match.captures[i].length);
+        captured[i][match.captures[i].length] = 0;
+    }
+}
+
+// Has the client receive a QoS 0 PUBLISH
+void deliver(ShimClient& shimClient, PubSubClient& client, const char* topic) {
+    byte packet[64];
+    size_t tlength = strlen(topic);
+    packet[0] = 0x30;
+    packet[1] = 2 + tlength + 1;
+    packet[2] = 0;
+    packet[3] = tlength;
+    memcpy(packet + 4, topic, tlength);
+    packet[4 + tlength] = 'x';
+    shimClient.respond(packet, 5 + tlength);
+    handled = 0;
+    unrouted = 0;
+    capturedCount = 0;
+    client.loop();
+}
+
+int test_subscribe_handler() {
+    IT("subscribes with a handler that gets the wildcard levels");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, unrouted_callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte subscribe[] = { 0x82,0xf,0x0,0x2,0x0,0xa,0x61,0x2f,0x2b,0x2f,0x53,0x45,0x4e,0x53,0x4f,0x52,0x0 };
+    shimClient.expect(subscribe,17);
+
+    rc = client.subscribe("a/+/SENSOR", 0, handler);
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    deliver(shimClient, client, "a/plug1/SENSOR");
+    IS_TRUE(handled == 1);
+    IS_TRUE(unrouted == 0);
+    IS_TRUE(capturedCount == 1);
+    IS_TRUE(strcmp(captured[0], "plug1") == 0);
+
+    deliver(shimClient, client, "a/plug1/STATE");
+    IS_TRUE(handled == 0);
+    IS_TRUE(unrouted == 1);
+
+    END_IT
+}
+
+int test_route_wildcards() {
+    IT("routes by filter levels and wildcards");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, unrouted_callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    uint16_t sent = shimClient.received();
+    IS_TRUE(client.route("a/+/b", handler));
+    IS_TRUE(client.route("a/c/#", handler));
+    IS_TRUE(client.route("+/+", handler));
+    IS_TRUE(client.route("#", handler));
+    // Routing alone sends nothing
+    IS_TRUE(shimClient.received() == sent);
+
+    deliver(shimClient, client, "a/x/b");
+    IS_TRUE(handled == 2);   // a/+/b and #
+    IS_TRUE(unrouted == 0);
+
+    deliver(shimClient, client, "a/c/d/e");
+    IS_TRUE(handled == 2);   // a/c/# and #
+
+    deliver(shimClient, client, "a/c");
+    IS_TRUE(handled == 3);   // a/c/#, +/+ and #
+
+    deliver(shimClient, client, "x/y");
+    IS_TRUE(handled == 2);   // +/+ and #
+
+    // Wildcards at the first level do not match $ topics
+    deliver(shimClient, client, "$SYS/x");
+    IS_TRUE(handled == 0);
+    IS_TRUE(unrouted == 1);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_route_captures() {
+    IT("captures every wildcard level in order");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, unrouted_callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    IS_TRUE(client.route("+/b/+/#", handler));
+
+    deliver(shimClient, client, "a/b/c/d/e");
+    IS_TRUE(handled == 1);
+    IS_TRUE(capturedCount == 3);
+    IS_TRUE(strcmp(captured[0], "a") == 0);
+    IS_TRUE(strcmp(captured[1], "c") == 0);
+    IS_TRUE(strcmp(captured[2], "d/e") == 0);
+
+    deliver(shimClient, client, "a/b/c");
+    IS_TRUE(handled == 1);
+    IS_TRUE(capturedCount == 3);
+    IS_TRUE(strcmp(captured[2], "") == 0);
+
+    END_IT
+}
+
+int test_route_invalid_filter() {
+    IT("rejects filters with misplaced wildcards");
+    ShimClient shimClient;
+
+    PubSubClient client(server, 1883, unrouted_callback, shimClient);
+
+    IS_FALSE(client.route("", handler));
+    IS_FALSE(client.route("a/#/b", handler));
+    IS_FALSE(client.route("a+/b", handler));
+    IS_FALSE(client.route("a/b#", handler));
+    IS_TRUE(client.route("a//b", handler));
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_subscribe_handler_renewed() {
+    IT("subscribes to filters with handlers again on each connect");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    PubSubClient client(server, 1883, unrouted_callback, shimClient);
+
+    // Not connected yet: subscribed to once connected
+    int rc = client.subscribe("a/+", 1, handler);
+    IS_TRUE(rc);
+    IS_TRUE(shimClient.received() == 0);
+
+    byte connect[] = {0x10,0x18,0x0,0x4,0x4d,0x51,0x54,0x54,0x4,0x2,0x0,0xf,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    byte subscribe[] = { 0x82,0x8,0x0,0x2,0x0,0x3,0x61,0x2f,0x2b,0x1 };
+    shimClient.expect(connect,26);
+    shimClient.expect(subscribe,10);
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(shimClient.received() == 36);
+    IS_FALSE(shimClient.error());
+
+    // Once unsubscribed it is not renewed, but still routed
+    rc = client.unsubscribe("a/+");
+    IS_TRUE(rc);
+    client.disconnect();
+    uint16_t sent = shimClient.received();
+    shimClient.respond(connack,4);
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(shimClient.received() == sent + 26);
+
+    deliver(shimClient, client, "a/b");
+    IS_TRUE(handled == 1);
+
+    END_IT
+}
+
 int main()
 {
     SUITE("Subscribe");
@@ -174,5 +370,10 @@ int main()
     test_subscribe_too_long();
     test_unsubscribe();
     test_unsubscribe_not_connected();
+    test_subscribe_handler();
+    test_route_wildcards();
+    test_route_captures();
+    test_route_invalid_filter();
+    test_subscribe_handler_renewed();
     FINISH
 }